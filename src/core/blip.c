@@ -0,0 +1,151 @@
+#include <string.h>
+
+#include "blip.h"
+#include "utils.h"
+
+#define BLIP_FRAC_BITS   32
+#define BLIP_PHASE_BITS  6
+#define BLIP_PHASES      (1 << BLIP_PHASE_BITS)
+#define BLIP_HALF_WIDTH  (BLIP_KERNEL_WIDTH / 2)
+#define BLIP_INTERP_BITS 8  // precision of the interpolation between phases
+#define BLIP_KERNEL_BITS 15 // each kernel sums to 1 << BLIP_KERNEL_BITS
+#define BLIP_BASS_SHIFT  9  // high-pass filter cutoff (~15 Hz at 48 kHz), like the output capacitor of the console
+
+// clang-format off
+/**
+ * First half of the band-limited impulse for each phase (delta position between two samples in 1/BLIP_PHASES of a
+ * sample). The second half of the impulse of phase p is the first half of phase BLIP_PHASES - p reversed.
+ * This is a sinc with a cutoff at 88% of the Nyquist frequency windowed by a Kaiser window (beta = 6) over the
+ * BLIP_KERNEL_WIDTH samples, each full impulse normalized to sum to 1 << BLIP_KERNEL_BITS.
+ */
+static const int16_t blip_kernel[BLIP_PHASES + 1][BLIP_HALF_WIDTH] = {
+    {     48,   -219,    607,  -1257,   2113,  -3001,   3678,  28830 },
+    {     51,   -224,    608,  -1240,   2048,  -2830,   3219,  28824 },
+    {     54,   -227,    607,  -1221,   1981,  -2657,   2768,  28793 },
+    {     56,   -231,    606,  -1199,   1911,  -2483,   2327,  28746 },
+    {     58,   -233,    603,  -1176,   1839,  -2308,   1896,  28682 },
+    {     60,   -236,    599,  -1151,   1765,  -2132,   1475,  28601 },
+    {     61,   -237,    594,  -1125,   1688,  -1955,   1064,  28499 },
+    {     63,   -238,    588,  -1096,   1610,  -1778,    665,  28377 },
+    {     64,   -239,    581,  -1066,   1530,  -1602,    276,  28239 },
+    {     65,   -239,    573,  -1035,   1449,  -1425,   -102,  28084 },
+    {     66,   -238,    564,  -1002,   1366,  -1250,   -468,  27910 },
+    {     67,   -237,    554,   -968,   1283,  -1076,   -822,  27718 },
+    {     67,   -236,    543,   -932,   1198,   -904,  -1164,  27513 },
+    {     67,   -234,    531,   -896,   1113,   -733,  -1495,  27287 },
+    {     68,   -231,    519,   -858,   1027,   -564,  -1812,  27044 },
+    {     68,   -229,    506,   -820,    940,   -397,  -2118,  26788 },
+    {     67,   -225,    492,   -781,    854,   -233,  -2410,  26512 },
+    {     67,   -222,    477,   -741,    767,    -72,  -2690,  26225 },
+    {     66,   -218,    462,   -700,    681,     86,  -2957,  25921 },
+    {     66,   -214,    446,   -659,    595,    241,  -3211,  25599 },
+    {     65,   -209,    430,   -617,    509,    392,  -3452,  25265 },
+    {     64,   -204,    413,   -575,    424,    539,  -3680,  24918 },
+    {     63,   -199,    396,   -533,    340,    683,  -3894,  24553 },
+    {     62,   -193,    378,   -490,    257,    822,  -4096,  24178 },
+    {     61,   -188,    360,   -448,    175,    957,  -4284,  23789 },
+    {     59,   -182,    342,   -405,     94,   1088,  -4460,  23387 },
+    {     58,   -176,    323,   -362,     14,   1214,  -4622,  22975 },
+    {     56,   -169,    305,   -320,    -64,   1335,  -4771,  22548 },
+    {     55,   -163,    286,   -278,   -140,   1452,  -4908,  22111 },
+    {     53,   -156,    267,   -236,   -215,   1563,  -5031,  21664 },
+    {     51,   -149,    248,   -195,   -288,   1669,  -5142,  21207 },
+    {     50,   -142,    229,   -154,   -359,   1770,  -5240,  20739 },
+    {     48,   -135,    209,   -114,   -428,   1865,  -5326,  20265 },
+    {     46,   -128,    190,    -74,   -495,   1955,  -5400,  19781 },
+    {     44,   -121,    171,    -35,   -559,   2039,  -5461,  19289 },
+    {     42,   -114,    153,      3,   -622,   2118,  -5511,  18790 },
+    {     40,   -107,    134,     41,   -682,   2192,  -5549,  18284 },
+    {     38,   -100,    115,     78,   -739,   2259,  -5575,  17772 },
+    {     36,    -93,     97,    113,   -794,   2321,  -5590,  17254 },
+    {     34,    -85,     79,    148,   -846,   2378,  -5594,  16731 },
+    {     32,    -78,     61,    182,   -896,   2428,  -5587,  16204 },
+    {     30,    -71,     44,    214,   -942,   2473,  -5570,  15672 },
+    {     28,    -64,     27,    246,   -987,   2513,  -5542,  15138 },
+    {     27,    -58,     10,    276,  -1028,   2547,  -5505,  14600 },
+    {     25,    -51,     -6,    305,  -1067,   2575,  -5457,  14061 },
+    {     23,    -44,    -22,    333,  -1102,   2598,  -5401,  13520 },
+    {     21,    -38,    -37,    359,  -1135,   2615,  -5335,  12977 },
+    {     19,    -31,    -52,    385,  -1165,   2627,  -5261,  12435 },
+    {     18,    -25,    -66,    409,  -1193,   2634,  -5178,  11893 },
+    {     16,    -19,    -80,    431,  -1217,   2635,  -5087,  11351 },
+    {     14,    -13,    -93,    453,  -1239,   2631,  -4989,  10811 },
+    {     13,     -7,   -106,    473,  -1257,   2623,  -4883,  10272 },
+    {     11,     -2,   -119,    491,  -1273,   2609,  -4770,   9736 },
+    {     10,      3,   -130,    508,  -1286,   2591,  -4650,   9203 },
+    {      8,      9,   -141,    524,  -1296,   2568,  -4525,   8673 },
+    {      7,     13,   -152,    539,  -1304,   2540,  -4393,   8148 },
+    {      6,     18,   -162,    552,  -1309,   2508,  -4255,   7627 },
+    {      4,     23,   -171,    563,  -1311,   2472,  -4113,   7110 },
+    {      3,     27,   -180,    574,  -1311,   2432,  -3966,   6600 },
+    {      2,     31,   -188,    582,  -1308,   2387,  -3814,   6095 },
+    {      1,     35,   -195,    590,  -1302,   2339,  -3658,   5597 },
+    {      0,     39,   -202,    596,  -1294,   2288,  -3498,   5106 },
+    {     -1,     42,   -208,    601,  -1284,   2233,  -3335,   4622 },
+    {     -2,     45,   -214,    604,  -1272,   2174,  -3169,   4146 },
+    {      0,     48,   -219,    607,  -1257,   2113,  -3001,   3678 }
+};
+// clang-format on
+
+void blip_clear(blip_t *blip) {
+    blip->offset     = 0;
+    blip->avail      = 0;
+    blip->integrator = 0;
+    memset(blip->buffer, 0, sizeof(blip->buffer));
+}
+
+void blip_set_rates(blip_t *blip, double clock_rate, double sample_rate) {
+    blip->factor = (uint64_t) ((sample_rate / clock_rate) * (1ULL << BLIP_FRAC_BITS));
+}
+
+void blip_add_delta(blip_t *blip, uint32_t clock, int32_t delta) {
+    uint64_t position = clock * blip->factor + blip->offset;
+    uint32_t phase    = (position >> (BLIP_FRAC_BITS - BLIP_PHASE_BITS)) & (BLIP_PHASES - 1);
+    int32_t *out      = &blip->buffer[blip->avail + (position >> BLIP_FRAC_BITS)];
+
+    // linear interpolation between the impulses of the 2 nearest phases: the delta is split between them
+    int32_t interp = (position >> (BLIP_FRAC_BITS - BLIP_PHASE_BITS - BLIP_INTERP_BITS)) & ((1 << BLIP_INTERP_BITS) - 1);
+    int32_t delta2 = (delta * interp) >> BLIP_INTERP_BITS;
+    int32_t delta1 = delta - delta2;
+
+    const int16_t *in       = blip_kernel[phase];
+    const int16_t *in_next  = blip_kernel[phase + 1];
+    const int16_t *rev      = blip_kernel[BLIP_PHASES - phase];
+    const int16_t *rev_next = blip_kernel[BLIP_PHASES - phase - 1];
+    for (uint8_t i = 0; i < BLIP_HALF_WIDTH; i++) {
+        out[i]                         += in[i] * delta1 + in_next[i] * delta2;
+        out[BLIP_KERNEL_WIDTH - 1 - i] += rev[i] * delta1 + rev_next[i] * delta2;
+    }
+}
+
+void blip_end_frame(blip_t *blip, uint32_t clocks) {
+    uint64_t position = clocks * blip->factor + blip->offset;
+    blip->avail += position >> BLIP_FRAC_BITS;
+    blip->offset = position & ((1ULL << BLIP_FRAC_BITS) - 1);
+}
+
+uint32_t blip_samples_avail(const blip_t *blip) {
+    return blip->avail;
+}
+
+uint32_t blip_read_samples(blip_t *blip, int16_t *out, uint32_t count, uint8_t stride) {
+    count = MIN(count, blip->avail);
+
+    int32_t sum = blip->integrator;
+    for (uint32_t i = 0; i < count; i++) {
+        sum += blip->buffer[i];
+        int32_t sample = sum >> BLIP_KERNEL_BITS;
+        if (out)
+            out[i * stride] = CLAMP(sample, INT16_MIN, INT16_MAX);
+        sum -= sample * (1 << (BLIP_KERNEL_BITS - BLIP_BASS_SHIFT));
+    }
+    blip->integrator = sum;
+
+    // move the deltas of the samples not complete yet to the start of the buffer
+    blip->avail -= count;
+    size_t remaining = blip->avail + BLIP_KERNEL_WIDTH;
+    memmove(blip->buffer, &blip->buffer[count], remaining * sizeof(*blip->buffer));
+    memset(&blip->buffer[remaining], 0, count * sizeof(*blip->buffer));
+
+    return count;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BLIP_MAX_SAMPLES  1024 // maximum number of samples a frame can produce
+#define BLIP_KERNEL_WIDTH 16   // number of output samples a single delta is spread over
+
+/**
+ * Band-limited synthesis buffer (after Shay Green's blip_buf). Instead of being sampled at the output rate, a waveform
+ * is described by the amplitude changes (deltas) it makes and the exact clock at which they happen. Each delta is
+ * added to the output samples around its position as a band-limited step (a windowed-sinc impulse that is integrated
+ * when the samples are read), so that the harmonics above the Nyquist frequency of the output rate don't alias back
+ * into the audible range.
+ *
+ * Deltas are added with a clock relative to the start of the current frame. Ending a frame makes the samples it
+ * completed available for reading and starts the next frame where it ended.
+ */
+typedef struct {
+    uint64_t factor;     // output samples per clock (32.32 fixed point)
+    uint64_t offset;     // position of the start of the current frame after the available samples (32.32 fixed point)
+    uint32_t avail;      // number of complete samples that can be read
+    int32_t  integrator; // sum of the deltas of the samples already read
+    int32_t  buffer[BLIP_MAX_SAMPLES + BLIP_KERNEL_WIDTH];
+} blip_t;
+
+/**
+ * Removes all the samples and deltas and restarts from a 0 amplitude. The rates are left untouched.
+ */
+void blip_clear(blip_t *blip);
+
+/**
+ * Sets the number of clocks per second of the deltas and the number of output samples per second. Can be changed at
+ * any time, it only affects the deltas added after the change.
+ */
+void blip_set_rates(blip_t *blip, double clock_rate, double sample_rate);
+
+/**
+ * Adds an amplitude change of `delta` at `clock` clocks after the start of the current frame. The total of the
+ * deltas must stay within the int16_t range.
+ */
+void blip_add_delta(blip_t *blip, uint32_t clock, int32_t delta);
+
+/**
+ * Ends the current frame `clocks` clocks after its start. The frame must not produce more than `BLIP_MAX_SAMPLES`
+ * samples in addition to the ones that weren't read yet.
+ */
+void blip_end_frame(blip_t *blip, uint32_t clocks);
+
+/**
+ * @returns the number of samples that can be read.
+ */
+uint32_t blip_samples_avail(const blip_t *blip);
+
+/**
+ * Reads at most `count` samples into `out`, writing one sample every `stride` int16_t (2 to interleave stereo
+ * samples). If `out` is NULL, the samples are discarded.
+ * @returns the number of samples read.
+ */
+uint32_t blip_read_samples(blip_t *blip, int16_t *out, uint32_t count, uint8_t stride);
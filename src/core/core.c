@@ -19,9 +19,11 @@ static bool set_funcs(gbmulator_t *emu, gbmulator_mode_t mode) {
         emu->load_savestate      = (load_savestate_func_t) gb_load_savestate;
         emu->get_rom_title       = (get_rom_title_func_t) gb_get_rom_title;
         emu->print_status        = (print_status_func_t) gb_print_status;
+        emu->print_stats         = (print_stats_func_t) gb_print_stats;
         emu->get_joypad_state    = (get_joypad_state_func_t) gb_get_joypad_state;
         emu->set_joypad_state    = (set_joypad_state_func_t) gb_set_joypad_state;
         emu->get_rom             = (get_rom_func_t) gb_get_rom;
+        emu->get_frame_buffers   = (get_frame_buffers_func_t) gb_get_frame_buffers;
         emu->cable.shift_bit     = (cable_shift_bit_cb_t) gb_link_shift_bit;
         emu->cable.data_received = (cable_data_received_cb_t) gb_link_data_received;
         return true;
@@ -35,9 +37,11 @@ static bool set_funcs(gbmulator_t *emu, gbmulator_mode_t mode) {
         emu->load_savestate      = (load_savestate_func_t) gba_load_savestate;
         emu->get_rom_title       = (get_rom_title_func_t) gba_get_rom_title;
         emu->print_status        = (print_status_func_t) gba_print_status;
+        emu->print_stats         = NULL;
         emu->get_joypad_state    = (get_joypad_state_func_t) gba_get_joypad_state;
         emu->set_joypad_state    = (set_joypad_state_func_t) gba_set_joypad_state;
         emu->get_rom             = (get_rom_func_t) gba_get_rom;
+        emu->get_frame_buffers   = (get_frame_buffers_func_t) gba_get_frame_buffers;
         emu->cable.shift_bit     = NULL;
         emu->cable.data_received = NULL;
         return true;
@@ -51,9 +55,11 @@ static bool set_funcs(gbmulator_t *emu, gbmulator_mode_t mode) {
         emu->load_savestate      = NULL;
         emu->get_rom_title       = NULL;
         emu->print_status        = NULL;
+        emu->print_stats         = NULL;
         emu->get_joypad_state    = NULL;
         emu->set_joypad_state    = NULL;
         emu->get_rom             = NULL;
+        emu->get_frame_buffers   = NULL;
         emu->cable.shift_bit     = (cable_shift_bit_cb_t) gbprinter_link_shift_bit;
         emu->cable.data_received = (cable_data_received_cb_t) gbprinter_link_data_received;
         return true;
@@ -62,6 +68,18 @@ static bool set_funcs(gbmulator_t *emu, gbmulator_mode_t mode) {
     }
 }
 
+static gbmulator_pixel_format_t get_supported_pixel_format(gbmulator_mode_t mode, gbmulator_pixel_format_t pixel_format) {
+    switch (mode) {
+    case GBMULATOR_MODE_GB:
+    case GBMULATOR_MODE_GBC:
+        return pixel_format;
+    case GBMULATOR_MODE_GBA:
+        return pixel_format == GBMULATOR_PIXEL_FORMAT_BGR555 ? pixel_format : GBMULATOR_PIXEL_FORMAT_RGBA8888;
+    default:
+        return GBMULATOR_PIXEL_FORMAT_RGBA8888;
+    }
+}
+
 gbmulator_t *gbmulator_init(const gbmulator_options_t *opts) {
     if (!opts)
         return NULL;
@@ -102,7 +120,7 @@ void gbmulator_quit(gbmulator_t *emu) {
     free(emu);
 }
 
-bool gbmulator_reset(gbmulator_t *emu, gbmulator_mode_t new_mode) {
+bool gbmulator_reset(gbmulator_t *emu, gbmulator_mode_t new_mode, gbmulator_pixel_format_t new_pixel_format) {
     if (!emu)
         return false;
 
@@ -115,7 +133,8 @@ bool gbmulator_reset(gbmulator_t *emu, gbmulator_mode_t new_mode) {
     uint8_t *rom_bak = xmalloc(rom_size);
     memcpy(rom_bak, rom, rom_size);
 
-    emu->opts.mode = new_mode;
+    emu->opts.mode         = new_mode;
+    emu->opts.pixel_format = get_supported_pixel_format(new_mode, new_pixel_format);
 
     size_t   save_len;
     uint8_t *save_data = emu->get_save(emu->impl, &save_len);
@@ -269,7 +288,7 @@ bool gbmulator_load_savestate(gbmulator_t *emu, uint8_t *data, size_t length) {
     case GBMULATOR_MODE_GB:
     case GBMULATOR_MODE_GBC:
         if (emu->opts.mode != savestate->mode) {
-            if (!gbmulator_reset(emu, savestate->mode))
+            if (!gbmulator_reset(emu, savestate->mode, emu->opts.pixel_format))
                 return false;
         }
         break;
@@ -292,19 +311,25 @@ void gbmulator_set_options(gbmulator_t *emu, const gbmulator_options_t *opts) {
     if (!emu)
         return;
 
-    // allow changes of mode, rom, rom_size and apu_sampling_rate only once (inside gbmulator_init())
+    // allow changes of mode, rom, rom_size, pixel_format, apu_sampling_rate and skip_boot only once (inside gbmulator_init())
     if (!emu->impl) {
         emu->opts.mode              = opts->mode;
         emu->opts.rom               = opts->rom;
         emu->opts.rom_size          = opts->rom_size;
+        emu->opts.pixel_format      = get_supported_pixel_format(opts->mode, opts->pixel_format);
         emu->opts.apu_sampling_rate = opts->apu_sampling_rate == 0 ? DEFAULT_APU_SAMPLING_RATE : opts->apu_sampling_rate;
+        emu->opts.skip_boot         = opts->skip_boot;
+    } else if (opts->palette != emu->opts.palette) {
+        gbmulator_set_palette(emu, opts->palette);
     }
 
     emu->opts.palette                  = opts->palette;
+    emu->opts.scanline_renderer        = opts->scanline_renderer;
+    emu->opts.skip_rendering           = opts->skip_rendering;
     emu->opts.apu_speed                = MAX(opts->apu_speed, 1.0f);
     emu->opts.on_new_line              = opts->on_new_line;
     emu->opts.on_new_frame             = opts->on_new_frame;
-    emu->opts.on_new_sample            = opts->on_new_sample;
+    emu->opts.on_new_samples           = opts->on_new_samples;
     emu->opts.on_accelerometer_request = opts->on_accelerometer_request;
     emu->opts.on_camera_capture_image  = opts->on_camera_capture_image;
 }
@@ -321,6 +346,11 @@ void gbmulator_print_status(gbmulator_t *emu) {
         emu->print_status(emu->impl);
 }
 
+void gbmulator_print_stats(gbmulator_t *emu) {
+    if (emu && emu->print_stats)
+        emu->print_stats(emu->impl);
+}
+
 uint16_t gbmulator_get_joypad_state(gbmulator_t *emu) {
     if (!emu)
         return 0;
@@ -340,6 +370,30 @@ uint8_t *gbmulator_get_rom(gbmulator_t *emu, size_t *rom_size) {
     return emu->get_rom(emu->impl, rom_size);
 }
 
+const uint8_t *gbmulator_acquire_frame(gbmulator_t *emu, bool *is_new) {
+    if (is_new)
+        *is_new = false;
+
+    if (!emu || !emu->get_frame_buffers)
+        return NULL;
+
+    return frame_buffers_acquire(emu->get_frame_buffers(emu->impl), is_new);
+}
+
+uint64_t gbmulator_get_frame_hash(gbmulator_t *emu) {
+    if (!emu || !emu->get_frame_buffers)
+        return 0;
+
+    return emu->get_frame_buffers(emu->impl)->hash;
+}
+
+const uint8_t *gbmulator_get_frame_dirty_lines(gbmulator_t *emu) {
+    if (!emu || !emu->get_frame_buffers)
+        return NULL;
+
+    return emu->get_frame_buffers(emu->impl)->dirty_lines;
+}
+
 void gbmulator_link_connect(gbmulator_t *emu, gbmulator_t *other, gbmulator_link_t type) {
     if (!emu)
         return;
@@ -416,6 +470,11 @@ void gbmulator_set_apu_speed(gbmulator_t *emu, float speed) {
         emu->opts.apu_speed = speed;
 }
 
+void gbmulator_set_skip_rendering(gbmulator_t *emu, bool skip_rendering) {
+    if (emu)
+        emu->opts.skip_rendering = skip_rendering;
+}
+
 // TODO maybe change this
 void gbmulator_set_palette(gbmulator_t *emu, gb_color_palette_t palette) {
     if (!emu || !emu->impl || (emu->opts.mode != GBMULATOR_MODE_GB && emu->opts.mode != GBMULATOR_MODE_GBC))
@@ -424,3 +483,15 @@ void gbmulator_set_palette(gbmulator_t *emu, gb_color_palette_t palette) {
     emu->opts.palette = palette;
     gb_set_palette(emu->impl, palette);
 }
+
+size_t gbmulator_get_pixel_size(gbmulator_pixel_format_t format) {
+    switch (format) {
+    case GBMULATOR_PIXEL_FORMAT_RGB565:
+    case GBMULATOR_PIXEL_FORMAT_BGR555:
+        return 2;
+    case GBMULATOR_PIXEL_FORMAT_INDEXED8:
+        return 1;
+    default:
+        return 4;
+    }
+}
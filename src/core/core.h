@@ -16,7 +16,7 @@ gbmulator_t *gbmulator_init(const gbmulator_options_t *opts);
 
 void gbmulator_quit(gbmulator_t *emu);
 
-bool gbmulator_reset(gbmulator_t *emu, gbmulator_mode_t new_mode);
+bool gbmulator_reset(gbmulator_t *emu, gbmulator_mode_t new_mode, gbmulator_pixel_format_t new_pixel_format);
 
 void gbmulator_rewind(gbmulator_t *emu, uint64_t frame);
 
@@ -42,12 +42,41 @@ char *gbmulator_get_rom_title(gbmulator_t *emu);
 
 void gbmulator_print_status(gbmulator_t *emu);
 
+void gbmulator_print_stats(gbmulator_t *emu);
+
 uint16_t gbmulator_get_joypad_state(gbmulator_t *emu);
 
 void gbmulator_set_joypad_state(gbmulator_t *emu, uint16_t state);
 
 uint8_t *gbmulator_get_rom(gbmulator_t *emu, size_t *rom_size);
 
+/**
+ * Acquires the last frame completed by the emulator without copying it. This can be called from another thread than
+ * the one running the emulator (but only from one thread, and never concurrently with gbmulator_reset() or
+ * gbmulator_quit()): the frames are triple buffered so the emulator never waits for it nor writes into the frame it
+ * returns.
+ * @param emu the emulator.
+ * @param is_new set to true if the frame was completed since the previous call (may be NULL).
+ * @returns the pixels of the frame in gbmulator_options_t.pixel_format, valid until the next call, or NULL if no frame
+ * has been completed yet.
+ */
+const uint8_t *gbmulator_acquire_frame(gbmulator_t *emu, bool *is_new);
+
+/**
+ * Must be called from the thread calling gbmulator_acquire_frame().
+ * @returns a hash of the pixels of the frame returned by the last call to gbmulator_acquire_frame(), or 0 if there is
+ * none. Frames with the same hash can be considered identical (to skip re-encoding a static screen, ...).
+ */
+uint64_t gbmulator_get_frame_hash(gbmulator_t *emu);
+
+/**
+ * Must be called from the thread calling gbmulator_acquire_frame().
+ * @returns one value per line (GB_SCREEN_HEIGHT or GBA_SCREEN_HEIGHT lines depending on the mode) of the frame
+ * returned by the last call to gbmulator_acquire_frame() that returned a new frame: 1 if the line differs from the same
+ * line of the previous acquired frame (or if this is the first acquired frame), 0 otherwise.
+ */
+const uint8_t *gbmulator_get_frame_dirty_lines(gbmulator_t *emu);
+
 /**
  * Connects 2 emulators through the link cable.
  * This automatically disconnects a previous link cable connection.
@@ -72,4 +101,15 @@ bool gbmulator_has_peripheral(gbmulator_t *emu, gbmulator_peripheral_t periphera
 
 void gbmulator_set_apu_speed(gbmulator_t *emu, float speed);
 
+/**
+ * Same as setting gbmulator_options_t.skip_rendering: the frames starting after this call are rendered or not depending
+ * on `skip_rendering`.
+ */
+void gbmulator_set_skip_rendering(gbmulator_t *emu, bool skip_rendering);
+
 void gbmulator_set_palette(gbmulator_t *emu, gb_color_palette_t palette);
+
+/**
+ * @returns the size in bytes of a pixel in the given format.
+ */
+size_t gbmulator_get_pixel_size(gbmulator_pixel_format_t format);
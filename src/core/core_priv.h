@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core.h"
+#include "frame_buffers.h"
 
 typedef void *(*init_func_t)(gbmulator_t *base);
 typedef void (*quit_func_t)(void *impl);
@@ -11,9 +12,11 @@ typedef gbmulator_savestate_t *(*get_savestate_func_t)(void *impl, size_t *saves
 typedef bool (*load_savestate_func_t)(void *impl, gbmulator_savestate_t *data, size_t savestate_length);
 typedef char *(*get_rom_title_func_t)(void *impl);
 typedef void (*print_status_func_t)(void *impl);
+typedef void (*print_stats_func_t)(void *impl);
 typedef uint16_t (*get_joypad_state_func_t)(void *impl);
 typedef void (*set_joypad_state_func_t)(void *impl, uint16_t state);
 typedef uint8_t *(*get_rom_func_t)(void *impl, size_t *rom_size);
+typedef frame_buffers_t *(*get_frame_buffers_func_t)(void *impl);
 
 typedef uint8_t (*cable_shift_bit_cb_t)(void *impl, uint8_t in_bit);
 typedef void (*cable_data_received_cb_t)(void *impl);
@@ -31,9 +34,11 @@ struct gbmulator_t {
     load_savestate_func_t   load_savestate;
     get_rom_title_func_t    get_rom_title;
     print_status_func_t     print_status;
+    print_stats_func_t      print_stats;
     get_joypad_state_func_t get_joypad_state;
     set_joypad_state_func_t set_joypad_state;
     get_rom_func_t          get_rom;
+    get_frame_buffers_func_t get_frame_buffers;
 
     struct {
         gbmulator_t             *other_device;
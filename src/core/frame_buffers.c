@@ -0,0 +1,116 @@
+#include <string.h>
+#include <stdatomic.h>
+
+#include "frame_buffers.h"
+
+#define FRAME_BUFFERS_NEW 0x80
+
+// the primes and the round of xxHash64
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t rotl64(uint64_t x, uint8_t r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t hash_round(uint64_t acc, uint64_t input) {
+    return rotl64(acc + input * PRIME64_2, 31) * PRIME64_1;
+}
+
+static inline uint64_t hash_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t read_u64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/**
+ * Hashes `size` bytes (a multiple of 8) with 4 independent lanes of 8 bytes like xxHash64 does so that the multiplies
+ * aren't one long dependency chain.
+ */
+static uint64_t hash_line(const uint8_t *line, size_t size) {
+    uint64_t lanes[4] = { PRIME64_1 + PRIME64_2, PRIME64_2, 0, -PRIME64_1 };
+
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+        for (uint8_t lane = 0; lane < 4; lane++)
+            lanes[lane] = hash_round(lanes[lane], read_u64(&line[i + lane * 8]));
+    for (; i < size; i += 8)
+        lanes[0] = hash_round(lanes[0], read_u64(&line[i]));
+
+    uint64_t h = rotl64(lanes[0], 1) + rotl64(lanes[1], 7) + rotl64(lanes[2], 12) + rotl64(lanes[3], 18);
+    return hash_avalanche(h + size);
+}
+
+uint8_t *frame_buffers_init(frame_buffers_t *frames, uint8_t *buffers, size_t line_size, uint8_t height) {
+    for (size_t i = 0; i < FRAME_BUFFERS_COUNT; i++)
+        frames->buffers[i] = &buffers[i * line_size * height];
+    frames->line_size = line_size;
+    frames->height    = height;
+
+    return frame_buffers_reset(frames);
+}
+
+uint8_t *frame_buffers_reset(frame_buffers_t *frames) {
+    frames->back           = 0;
+    frames->front          = 1;
+    frames->is_front_valid = 0;
+    frames->hash           = 0;
+    atomic_store(&frames->ready, 2);
+
+    return frames->buffers[frames->back];
+}
+
+uint8_t *frame_buffers_publish(frame_buffers_t *frames) {
+    // release: the pixels of the published frame are visible to the acquiring thread
+    // acquire: the acquiring thread is done reading the buffer that becomes the new back buffer
+    uint8_t ready = atomic_exchange_explicit(&frames->ready, frames->back | FRAME_BUFFERS_NEW, memory_order_acq_rel);
+    frames->back  = ready & ~FRAME_BUFFERS_NEW;
+
+    return frames->buffers[frames->back];
+}
+
+/**
+ * Finds the lines of the newly acquired front buffer that differ from the previous acquired frame and hashes the whole
+ * frame.
+ */
+static void hash_front(frame_buffers_t *frames, bool is_first_frame) {
+    const uint8_t *line = frames->buffers[frames->front];
+    uint64_t       hash = PRIME64_5;
+
+    for (uint8_t y = 0; y < frames->height; y++, line += frames->line_size) {
+        uint64_t line_hash     = hash_line(line, frames->line_size);
+        frames->dirty_lines[y] = is_first_frame || line_hash != frames->line_hashes[y];
+        frames->line_hashes[y] = line_hash;
+        hash                   = hash_round(hash, line_hash);
+    }
+
+    frames->hash = hash_avalanche(hash);
+}
+
+uint8_t *frame_buffers_acquire(frame_buffers_t *frames, bool *is_new) {
+    bool has_new_frame = atomic_load_explicit(&frames->ready, memory_order_relaxed) & FRAME_BUFFERS_NEW;
+
+    // only this thread clears FRAME_BUFFERS_NEW so the exchanged buffer is still a new frame (maybe an even newer one)
+    if (has_new_frame) {
+        uint8_t ready = atomic_exchange_explicit(&frames->ready, frames->front, memory_order_acq_rel);
+        frames->front = ready & ~FRAME_BUFFERS_NEW;
+        hash_front(frames, !frames->is_front_valid);
+        frames->is_front_valid = 1;
+    }
+
+    if (is_new)
+        *is_new = has_new_frame;
+
+    return frames->is_front_valid ? frames->buffers[frames->front] : NULL;
+}
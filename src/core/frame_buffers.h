@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define FRAME_BUFFERS_COUNT     3
+#define FRAME_BUFFERS_MAX_LINES 160 // the height of the tallest screen (GBA)
+
+/**
+ * Triple buffered frames handed off from the emulation thread to the thread displaying them without copying nor
+ * locking. The ppu renders into the back buffer and publishes it by swapping it with the ready buffer once the frame
+ * is complete. The displaying thread acquires the ready buffer by swapping it with its front buffer. Each buffer is
+ * owned by only one side at a time so a frame is never written while it is read.
+ *
+ * The acquiring thread also hashes each line of the frames it acquires to find which ones changed since the previous
+ * acquired frame, so that the emulation thread doesn't pay for it and the frames published in between don't matter.
+ */
+typedef struct {
+    uint8_t        *buffers[FRAME_BUFFERS_COUNT];
+    uint8_t         back;           // index of the buffer being rendered (only accessed by the emulation thread)
+    uint8_t         front;          // index of the buffer of the last acquired frame (only accessed by the acquiring thread)
+    uint8_t         is_front_valid; // a frame has been acquired (only accessed by the acquiring thread)
+    _Atomic uint8_t ready;          // index of the last published frame, with FRAME_BUFFERS_NEW set until it is acquired
+
+    size_t  line_size; // must be a multiple of 8
+    uint8_t height;
+
+    // the last acquired frame (only accessed by the acquiring thread)
+    uint64_t hash;
+    uint64_t line_hashes[FRAME_BUFFERS_MAX_LINES];
+    uint8_t  dirty_lines[FRAME_BUFFERS_MAX_LINES]; // 1 if the line differs from the line of the previous acquired frame
+} frame_buffers_t;
+
+/**
+ * Sets up `frames` to use `FRAME_BUFFERS_COUNT` consecutive buffers of `height` lines of `line_size` bytes starting at
+ * `buffers`.
+ * @returns the back buffer.
+ */
+uint8_t *frame_buffers_init(frame_buffers_t *frames, uint8_t *buffers, size_t line_size, uint8_t height);
+
+/**
+ * Forgets the published and acquired frames: the next acquisitions return NULL until a new frame is published.
+ * @returns the back buffer.
+ */
+uint8_t *frame_buffers_reset(frame_buffers_t *frames);
+
+/**
+ * Publishes the back buffer as the last complete frame. Only called by the emulation thread.
+ * @returns the new back buffer.
+ */
+uint8_t *frame_buffers_publish(frame_buffers_t *frames);
+
+/**
+ * Acquires the last published frame. Only called by a single thread, which may not be the emulation thread.
+ * @param is_new set to true if the frame was published since the previous call (may be NULL).
+ * @returns the frame, which stays valid and unmodified until the next call, or NULL if no frame was published yet.
+ */
+uint8_t *frame_buffers_acquire(frame_buffers_t *frames, bool *is_new);
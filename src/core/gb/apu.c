@@ -5,6 +5,10 @@
 // FIXME rare audible pops
 // TODO https://gbdev.io/pandocs/Audio.html has been rewritten since I implemented this and there are new details that should be implemented
 
+#define APU_FRAME_SEQUENCER_CYCLES 8192
+#define APU_BLIP_FRAME_CYCLES      4096              // the samples are output every APU_BLIP_FRAME_CYCLES cycles
+#define APU_MAX_SAMPLING_RATE      (GB_CPU_FREQ / 8) // so that a blip frame never exceeds BLIP_MAX_SAMPLES samples
+
 const uint8_t duty_cycles[4][8] = {
     { 0, 0, 0, 0, 0, 0, 0, 1 },
     { 1, 0, 0, 0, 0, 0, 0, 1 },
@@ -12,36 +16,54 @@ const uint8_t duty_cycles[4][8] = {
     { 0, 1, 1, 1, 1, 1, 1, 0 }
 };
 
-static void channel_step(gb_channel_t *c) {
-    c->freq_timer--;
-    if (c->freq_timer <= 0) {
-        if (c->id == APU_CHANNEL_4) {
-            uint8_t divisor = *c->NRx3 & 0x07;
-            c->freq_timer   = divisor ? divisor << 4 : 8;
-            c->freq_timer <<= (*c->NRx3 >> 4);
+// analog output of a channel DAC for each digital value (0x00 is 15 and 0x0F is -15)
+static const int8_t dac_levels[16] = { 15, 13, 11, 9, 7, 5, 3, 1, -1, -3, -5, -7, -9, -11, -13, -15 };
 
-            uint8_t xor_ret = (c->LFSR & 0x01) ^ ((c->LFSR & 0x02) >> 1);
-            c->LFSR         = (c->LFSR >> 1) | (xor_ret << 14);
+// channel 3 sample right shift for each output level of NR32 (mute, 100%, 50%, 25%)
+static const uint8_t wave_volume_shifts[4] = { 4, 0, 1, 2 };
 
-            if ((*c->NRx3 >> 3) & 0x01) {
-                RESET_BIT(c->LFSR, 6);
-                c->LFSR |= xor_ret << 6;
-            }
-            return;
-        }
+// master volume multipliers in 10.6 fixed point so that the sum of the 4 channels at full master volume
+// (4 * 15 * 8 * 4369 >> 6) maps to the full int16_t range
+static const int32_t volume_scales[8] = { 4369, 8738, 13107, 17476, 21845, 26214, 30583, 34952 };
+
+/**
+ * @returns the number of cycles until the frequency timer of `c` expires.
+ */
+static inline uint32_t channel_cycles_until_edge(gb_channel_t *c) {
+    return MAX(c->freq_timer, 1);
+}
+
+/**
+ * Advances the frequency timer of `c` by `cycles`, which must not go past its next expiration.
+ */
+static void channel_step(gb_channel_t *c, uint32_t cycles) {
+    c->freq_timer -= cycles;
+    if (c->freq_timer > 0)
+        return;
 
-        uint16_t freq = ((*c->NRx4 & 0x07) << 8) | *c->NRx3;
-        if (c->id == APU_CHANNEL_3) {
-            c->freq_timer    = (2048 - freq) * 2;
-            c->wave_position = (c->wave_position + 1) % 32;
-            return;
+    if (c->id == APU_CHANNEL_4) {
+        uint8_t divisor = *c->NRx3 & 0x07;
+        c->freq_timer   = divisor ? divisor << 4 : 8;
+        c->freq_timer <<= (*c->NRx3 >> 4);
+
+        uint8_t xor_ret = (c->LFSR & 0x01) ^ ((c->LFSR & 0x02) >> 1);
+        c->LFSR         = (c->LFSR >> 1) | (xor_ret << 14);
+
+        if ((*c->NRx3 >> 3) & 0x01) {
+            RESET_BIT(c->LFSR, 6);
+            c->LFSR |= xor_ret << 6;
         }
-        c->freq_timer    = (2048 - freq) * 4;
-        c->duty_position = (c->duty_position + 1) % 8;
+        return;
     }
 
-    uint8_t wave_pattern_duty = (*c->NRx1 & 0xC0) >> 6;
-    c->duty                   = duty_cycles[wave_pattern_duty][c->duty_position];
+    uint16_t freq = ((*c->NRx4 & 0x07) << 8) | *c->NRx3;
+    if (c->id == APU_CHANNEL_3) {
+        c->freq_timer    = (2048 - freq) * 2;
+        c->wave_position = (c->wave_position + 1) % 32;
+        return;
+    }
+    c->freq_timer    = (2048 - freq) * 4;
+    c->duty_position = (c->duty_position + 1) % 8;
 }
 
 static void channel_length(gb_t *gb, gb_channel_t *c) {
@@ -141,13 +163,18 @@ void apu_channel_trigger(gb_t *gb, gb_channel_t *c) {
         APU_DISABLE_CHANNEL(gb, c->id);
 }
 
-static float channel_dac(gb_t *gb, gb_channel_t *c) {
-    // DAC digital range from 0x00 to 0x0F is translated in analog range from 1 to -1 (0x00 is 1, 0x0F is -1)
+/**
+ * @returns the analog output of `c` in the range -15 to 15 (its DAC translates the digital 0x00 to 0x0F range into
+ * 15 to -15), or 0 if its DAC or the channel is disabled.
+ */
+static int8_t channel_dac(gb_t *gb, gb_channel_t *c) {
     switch (c->id) {
     case APU_CHANNEL_1:
     case APU_CHANNEL_2:
-        if ((*c->NRx2 >> 3) && APU_IS_CHANNEL_ENABLED(gb, c->id)) // if dac enabled and channel enabled
-            return -(((c->duty * c->envelope_volume) / 7.5f) - 1.0f);
+        if ((*c->NRx2 >> 3) && APU_IS_CHANNEL_ENABLED(gb, c->id)) { // if dac enabled and channel enabled
+            uint8_t duty = duty_cycles[(*c->NRx1 & 0xC0) >> 6][c->duty_position];
+            return dac_levels[duty * c->envelope_volume];
+        }
         break;
     case APU_CHANNEL_3:
         if ((*c->NRx0 >> 7) /*&& APU_IS_CHANNEL_ENABLED(c->id)*/) { // if dac enabled and channel enabled -- TODO check why channel 3 enabled flag is not working properly
@@ -155,106 +182,210 @@ static float channel_dac(gb_t *gb, gb_channel_t *c) {
             if (c->wave_position % 2 == 0) // TODO check if this works properly (I think it always reads the 2 nibbles as the same values)
                 sample >>= 4;
             sample &= 0x0F;
-            switch ((gb->mmu.io_registers[IO_NR32] >> 5) & 0x03) {
-            case 0:
-                sample >>= 4; // mute
-                break;
-            case 2:
-                sample >>= 1; // 50% volume
-                break;
-            case 3:
-                sample >>= 2; // 25% volume
-                break;
-            }
-            return -((sample / 7.5f) - 1.0f); // divide by 7.5 then substract 1.0 to make it between -1.0 and 1.0
+            return dac_levels[sample >> wave_volume_shifts[(gb->mmu.io_registers[IO_NR32] >> 5) & 0x03]];
         }
         break;
     case APU_CHANNEL_4:                                           // TODO works but it seems (in Tetris) this channel volume is a bit too loud
         if ((*c->NRx2 >> 3) && APU_IS_CHANNEL_ENABLED(gb, c->id)) // if dac enabled and channel enabled
-            return -(((!(c->LFSR & 0x01) * c->envelope_volume) / 7.5f) - 1.0f);
+            return dac_levels[!(c->LFSR & 0x01) * c->envelope_volume];
         break;
     }
-    return 0.0f;
+    return 0;
 }
 
-void apu_step(gb_t *gb) {
-    // TODO not sure where I saw it but apu clocking is supposed to be inferred by DIV timer?
+static void frame_sequencer_step(gb_t *gb) {
+    apu_t *apu = &gb->apu;
 
-    if (!IS_APU_ENABLED(gb))
-        return;
+    switch (apu->frame_sequencer) {
+    case 0:
+        channel_length(gb, &apu->channels[0]);
+        channel_length(gb, &apu->channels[1]);
+        channel_length(gb, &apu->channels[2]);
+        channel_length(gb, &apu->channels[3]);
+        break;
+    case 2:
+        channel_length(gb, &apu->channels[0]);
+        channel_sweep(gb, &apu->channels[0]);
+        channel_length(gb, &apu->channels[1]);
+        channel_length(gb, &apu->channels[2]);
+        channel_length(gb, &apu->channels[3]);
+        break;
+    case 4:
+        channel_length(gb, &apu->channels[0]);
+        channel_length(gb, &apu->channels[1]);
+        channel_length(gb, &apu->channels[2]);
+        channel_length(gb, &apu->channels[3]);
+        break;
+    case 6:
+        channel_length(gb, &apu->channels[0]);
+        channel_sweep(gb, &apu->channels[0]);
+        channel_length(gb, &apu->channels[1]);
+        channel_length(gb, &apu->channels[2]);
+        channel_length(gb, &apu->channels[3]);
+        break;
+    case 7:
+        channel_envelope(&apu->channels[0]);
+        channel_envelope(&apu->channels[1]);
+        channel_envelope(&apu->channels[3]);
+        break;
+    }
+    apu->frame_sequencer = (apu->frame_sequencer + 1) % 8;
+}
 
+/**
+ * Mixes the channels and adds the changes of the left and right outputs to their blips at the current clock.
+ */
+static void update_output(gb_t *gb) {
     apu_t    *apu = &gb->apu;
     gb_mmu_t *mmu = &gb->mmu;
 
-    for (uint8_t cycles = 0; cycles < 4; cycles++) { // 4 cycles per step
-        apu->frame_sequencer_cycles_count++;
-        if (apu->frame_sequencer_cycles_count >= 8192) { // 512 Hz
-            apu->frame_sequencer_cycles_count = 0;
-            switch (apu->frame_sequencer) {
-            case 0:
-                channel_length(gb, &apu->channels[0]);
-                channel_length(gb, &apu->channels[1]);
-                channel_length(gb, &apu->channels[2]);
-                channel_length(gb, &apu->channels[3]);
-                break;
-            case 2:
-                channel_length(gb, &apu->channels[0]);
-                channel_sweep(gb, &apu->channels[0]);
-                channel_length(gb, &apu->channels[1]);
-                channel_length(gb, &apu->channels[2]);
-                channel_length(gb, &apu->channels[3]);
-                break;
-            case 4:
-                channel_length(gb, &apu->channels[0]);
-                channel_length(gb, &apu->channels[1]);
-                channel_length(gb, &apu->channels[2]);
-                channel_length(gb, &apu->channels[3]);
-                break;
-            case 6:
-                channel_length(gb, &apu->channels[0]);
-                channel_sweep(gb, &apu->channels[0]);
-                channel_length(gb, &apu->channels[1]);
-                channel_length(gb, &apu->channels[2]);
-                channel_length(gb, &apu->channels[3]);
-                break;
-            case 7:
-                channel_envelope(&apu->channels[0]);
-                channel_envelope(&apu->channels[1]);
-                channel_envelope(&apu->channels[3]);
-                break;
-            }
-            apu->frame_sequencer = (apu->frame_sequencer + 1) % 8;
+    int32_t left  = 0;
+    int32_t right = 0;
+    if (IS_APU_ENABLED(gb)) {
+        uint8_t nr51 = mmu->io_registers[IO_NR51];
+        for (uint8_t i = 0; i < 4; i++) {
+            int8_t output = channel_dac(gb, &apu->channels[i]);
+            left  += CHECK_BIT(nr51, i + 4) ? output : 0;
+            right += CHECK_BIT(nr51, i) ? output : 0;
         }
 
-        channel_step(&apu->channels[0]);
-        channel_step(&apu->channels[1]);
-        channel_step(&apu->channels[2]);
-        channel_step(&apu->channels[3]);
+        // apply the master volumes (SO2 is the left output, SO1 the right one)
+        left  = (left * volume_scales[(mmu->io_registers[IO_NR50] >> 4) & 0x07]) >> 6;
+        right = (right * volume_scales[mmu->io_registers[IO_NR50] & 0x07]) >> 6;
+    }
 
-        if (gb->base->opts.apu_speed > 2.0f || !gb->base->opts.on_new_sample) // don't collect samples when emulation speed increases too much
-            continue;
+    if (left != apu->left_output) {
+        blip_add_delta(apu->left, apu->clock, left - apu->left_output);
+        apu->left_output = left;
+    }
+    if (right != apu->right_output) {
+        blip_add_delta(apu->right, apu->clock, right - apu->right_output);
+        apu->right_output = right;
+    }
+}
+
+static void set_blip_rates(gb_t *gb) {
+    apu_t *apu = &gb->apu;
+
+    apu->blip_rate  = MIN(gb->base->opts.apu_sampling_rate, APU_MAX_SAMPLING_RATE);
+    apu->blip_speed = gb->base->opts.apu_speed;
+
+    // the samples are output at the sampling rate in real time: speeding up the emulation shortens the emulated
+    // duration of each sample
+    double clock_rate = GB_CPU_FREQ * (double) apu->blip_speed;
+    blip_set_rates(apu->left, clock_rate, apu->blip_rate);
+    blip_set_rates(apu->right, clock_rate, apu->blip_rate);
+}
+
+/**
+ * Ends the current blip frame and outputs the samples it completed.
+ */
+static void end_blip_frame(gb_t *gb) {
+    apu_t *apu = &gb->apu;
+
+    blip_end_frame(apu->left, apu->clock);
+    blip_end_frame(apu->right, apu->clock);
+    apu->clock = 0;
+
+    // don't collect samples when emulation speed increases too much
+    bool     is_collecting = gb->base->opts.on_new_samples && gb->base->opts.apu_speed <= 2.0f && !gb->is_booting;
+    uint32_t count         = blip_samples_avail(apu->left);
+    int16_t  samples[BLIP_MAX_SAMPLES * 2];
+    blip_read_samples(apu->left, is_collecting ? &samples[0] : NULL, count, 2);
+    blip_read_samples(apu->right, is_collecting ? &samples[1] : NULL, count, 2);
+
+    if (is_collecting && count > 0)
+        gb->base->opts.on_new_samples(samples, count);
+
+    if (gb->base->opts.apu_speed != apu->blip_speed)
+        set_blip_rates(gb);
+}
+
+/**
+ * Runs the apu for `cycles` cycles. Instead of clocking every cycle, the channels and the frame sequencer advance in
+ * bulk to their next event (a frequency timer expiring or a frame sequencer step), which is the only time the output
+ * can change besides register writes.
+ * The frame sequencer must be in sync with DIV at the start of the run.
+ */
+static void apu_run(gb_t *gb, uint32_t cycles) {
+    apu_t *apu = &gb->apu;
+
+    if (apu->is_output_dirty) {
+        apu->is_output_dirty = 0;
+        update_output(gb);
+    }
 
-        apu->take_sample_cycles_count++;
-        if (apu->take_sample_cycles_count >= (GB_CPU_FREQ / apu->dynamic_sampling_rate) * gb->base->opts.apu_speed) {
-            apu->take_sample_cycles_count = 0;
+    while (cycles > 0) {
+        uint32_t step = MIN(cycles, APU_BLIP_FRAME_CYCLES - apu->clock);
 
-            float S01_volume = ((mmu->io_registers[IO_NR50] & 0x07) + 1) / 8.0f;        // keep it between 0.0f and 1.0f
-            float S02_volume = (((mmu->io_registers[IO_NR50] & 0x70) >> 4) + 1) / 8.0f; // keep it between 0.0f and 1.0f
-            float S01_output = ((CHECK_BIT(mmu->io_registers[IO_NR51], APU_CHANNEL_1) ? channel_dac(gb, &apu->channels[0]) : 0.0f) + (CHECK_BIT(mmu->io_registers[IO_NR51], APU_CHANNEL_2) ? channel_dac(gb, &apu->channels[1]) : 0.0f) + (CHECK_BIT(mmu->io_registers[IO_NR51], APU_CHANNEL_3) ? channel_dac(gb, &apu->channels[2]) : 0.0f) + (CHECK_BIT(mmu->io_registers[IO_NR51], APU_CHANNEL_4) ? channel_dac(gb, &apu->channels[3]) : 0.0f)) / 4.0f;
-            float S02_output = ((CHECK_BIT(mmu->io_registers[IO_NR51], APU_CHANNEL_1 + 4) ? channel_dac(gb, &apu->channels[0]) : 0.0f) + (CHECK_BIT(mmu->io_registers[IO_NR51], APU_CHANNEL_2 + 4) ? channel_dac(gb, &apu->channels[1]) : 0.0f) + (CHECK_BIT(mmu->io_registers[IO_NR51], APU_CHANNEL_3 + 4) ? channel_dac(gb, &apu->channels[2]) : 0.0f) + (CHECK_BIT(mmu->io_registers[IO_NR51], APU_CHANNEL_4 + 4) ? channel_dac(gb, &apu->channels[3]) : 0.0f)) / 4.0f;
+        if (IS_APU_ENABLED(gb)) {
+            uint32_t next_event = APU_FRAME_SEQUENCER_CYCLES - apu->frame_sequencer_cycles_count;
+            for (uint8_t i = 0; i < 4; i++)
+                next_event = MIN(next_event, channel_cycles_until_edge(&apu->channels[i]));
+            step = MIN(step, next_event);
 
-            // apply channel volume to its output
-            S01_output *= S01_volume;
-            S02_output *= S02_volume;
+            apu->frame_sequencer_cycles_count += step;
+            if (apu->frame_sequencer_cycles_count >= APU_FRAME_SEQUENCER_CYCLES) { // 512 Hz
+                apu->frame_sequencer_cycles_count = 0;
+                frame_sequencer_step(gb);
+            }
+
+            channel_step(&apu->channels[0], step);
+            channel_step(&apu->channels[1], step);
+            channel_step(&apu->channels[2], step);
+            channel_step(&apu->channels[3], step);
 
-            gb->base->opts.on_new_sample((gbmulator_apu_sample_t) { .l = S02_output * 32767, .r = S01_output * 32767 }, &apu->dynamic_sampling_rate);
+            apu->clock += step;
+            if (step == next_event)
+                update_output(gb);
+        } else {
+            apu->clock += step;
         }
+
+        cycles -= step;
+        if (apu->clock == APU_BLIP_FRAME_CYCLES)
+            end_blip_frame(gb);
+    }
+}
+
+void apu_sync(gb_t *gb) {
+    apu_t *apu = &gb->apu;
+
+    if (!apu->pending_cycles)
+        return;
+
+    // the frame sequencer is clocked by the falling edges of the bit 12 of DIV (bit 13 in double speed, as DIV
+    // increases twice as fast but not the apu): find where it was in its period when the apu was last synced, which is
+    // possible as DIV is never reset and the speed never changes without syncing the apu first
+    uint8_t  double_speed = IS_DOUBLE_SPEED(gb);
+    uint16_t div          = gb->timer.div_timer - (apu->pending_cycles << double_speed);
+    apu->frame_sequencer_cycles_count = (div & ((APU_FRAME_SEQUENCER_CYCLES << double_speed) - 1)) >> double_speed;
+
+    apu_run(gb, apu->pending_cycles);
+    apu->pending_cycles = 0;
+}
+
+void apu_on_div_write(gb_t *gb) {
+    apu_sync(gb);
+
+    // resetting DIV while the bit clocking the frame sequencer is set is a falling edge
+    if (IS_APU_ENABLED(gb) && CHECK_BIT(gb->timer.div_timer, 12 + IS_DOUBLE_SPEED(gb))) {
+        frame_sequencer_step(gb);
+        gb->apu.is_output_dirty = 1;
     }
 }
 
 void apu_reset(gb_t *gb) {
+    // the blips are allocated in gb->arena: keep them
+    blip_t *left  = gb->apu.left;
+    blip_t *right = gb->apu.right;
     memset(&gb->apu, 0, sizeof(gb->apu));
-    gb->apu.dynamic_sampling_rate = gb->base->opts.apu_sampling_rate;
+    gb->apu.left            = left;
+    gb->apu.right           = right;
+    gb->apu.is_output_dirty = 1;
+    blip_clear(left);
+    blip_clear(right);
+    set_blip_rates(gb);
 
     gb->apu.channels[0] = (gb_channel_t) {
         .NRx0 = &gb->mmu.io_registers[IO_NR10],
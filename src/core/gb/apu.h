@@ -2,6 +2,7 @@
 
 #include "gb.h"
 #include "mmu.h"
+#include "../blip.h"
 
 #define IS_APU_ENABLED(gb)                  CHECK_BIT((gb)->mmu.io_registers[IO_NR52], 7)
 #define APU_IS_CHANNEL_ENABLED(gb, channel) CHECK_BIT((gb)->mmu.io_registers[IO_NR52], (channel))
@@ -18,7 +19,6 @@ typedef enum {
 typedef struct {
     uint8_t wave_position;
     uint8_t duty_position;
-    uint8_t duty;
     int     freq_timer;
     int     length_counter;  // length module
     int     envelope_period; // envelope module
@@ -39,17 +39,37 @@ typedef struct {
 } gb_channel_t;
 
 typedef struct {
-    uint32_t take_sample_cycles_count;
-    uint32_t dynamic_sampling_rate;
+    uint32_t pending_cycles; // cycles elapsed since the apu was last synced (see apu_sync())
 
     uint8_t  frame_sequencer;
-    uint32_t frame_sequencer_cycles_count;
+    uint32_t frame_sequencer_cycles_count; // cycles since the last frame sequencer step, derived from DIV at each sync
 
     gb_channel_t channels[4];
+
+    // band-limited output
+    uint32_t clock;           // cycles since the start of the current blip frame
+    uint32_t blip_rate;       // the sampling rate the blips are set to
+    float    blip_speed;      // the apu speed the blips are set to
+    uint8_t  is_output_dirty; // a register was written since the output was last mixed
+    int32_t  left_output;     // amplitude of the left output at the current clock
+    int32_t  right_output;    // amplitude of the right output at the current clock
+    blip_t  *left;            // allocated in gb->arena
+    blip_t  *right;           // allocated in gb->arena
 } apu_t;
 
 void apu_channel_trigger(gb_t *gb, gb_channel_t *c);
 
-void apu_step(gb_t *gb);
+/**
+ * Runs the apu for the cycles elapsed since it was last synced. The apu is not stepped with the rest of the system:
+ * it only catches up when its state is accessed (its registers are read or written, DIV is reset or the speed changes)
+ * and once per frame to output its samples.
+ */
+void apu_sync(gb_t *gb);
+
+/**
+ * Syncs the apu before DIV is reset to 0 and clocks the frame sequencer if resetting DIV makes a falling edge of the
+ * bit it is clocked by.
+ */
+void apu_on_div_write(gb_t *gb);
 
 void apu_reset(gb_t *gb);
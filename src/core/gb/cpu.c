@@ -1491,6 +1491,7 @@ static void exec_opcode(gb_t *gb) {
         // TODO Halts until button press.
         CLOCK(
             // reset timer to 0
+            apu_on_div_write(gb);
             gb->timer.div_timer = 0;
             if (PREPARE_SPEED_SWITCH(gb)) {
                 // TODO this should also stop the cpu for 2050 steps (8200 cycles)
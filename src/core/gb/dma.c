@@ -98,6 +98,7 @@ static inline void oam_dma_step(gb_t *gb) {
 
     if (IS_OAM_DMA_RUNNING(mmu)) {
         // oam dma step (no need to call mmu_write_io_src() because dest can only be inside OAM and there are no access restrictions)
+        ppu_invalidate_obj_lines(gb);
         mmu->oam[mmu->oam_dma.progress] = mmu_read_io_src(gb, mmu->oam_dma.src_address + mmu->oam_dma.progress, IO_SRC_OAM_DMA);
         mmu->oam_dma.progress++;
     }
@@ -108,3 +109,8 @@ void dma_step(gb_t *gb) {
     if (gb->base->opts.mode == GBMULATOR_MODE_GBC)
         gdma_hdma_step(gb);
 }
+
+void dma_step_cgb(gb_t *gb) {
+    oam_dma_step(gb);
+    gdma_hdma_step(gb);
+}
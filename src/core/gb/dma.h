@@ -19,3 +19,8 @@ typedef enum {
 #define GBC_GDMA_HDMA_LENGTH(mmu) ((mmu)->io_registers[IO_HDMA5] & 0x7F)
 
 void dma_step(gb_t *gb);
+
+/**
+ * CGB variant of dma_step(): OAM DMA and GDMA/HDMA without testing the mode.
+ */
+void dma_step_cgb(gb_t *gb);
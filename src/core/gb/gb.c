@@ -1,6 +1,8 @@
 #include <stdlib.h>
 #include <stddef.h>
 #include <string.h>
+#include <pthread.h>
+#include <inttypes.h>
 #include <zlib.h>
 
 #include "gb_priv.h"
@@ -29,7 +31,7 @@ void gb_step(gb_t *gb) {
         // stop execution of the program while a GDMA or HDMA is active
         if (!gb->mmu.hdma.lock_cpu)
             cpu_step(gb);
-        dma_step(gb);
+        gb->funcs.dma_step(gb);
         timer_step(gb);
         link_step(gb);
     }
@@ -41,16 +43,247 @@ void gb_step(gb_t *gb) {
 
     // TODO during the time the cpu is blocked after a STOP opcode triggering a speed switch, the ppu and apu
     //      behave in a weird way: https://gbdev.io/pandocs/CGB_Registers.html?highlight=key1#ff4d--key1-cgb-mode-only-prepare-speed-switch
-    ppu_step(gb);
-    apu_step(gb);
+    gb->funcs.ppu_step(gb);
+
+    gb->apu.pending_cycles += 4; // the apu runs at the same speed in double speed mode
+    if (gb->apu.pending_cycles >= GB_CPU_CYCLES_PER_FRAME)
+        apu_sync(gb);
+}
+
+// size of a buffer in the arena, rounded up so that the next buffer starts on a new cache line
+#define ARENA_SLICE_SIZE(size) (((size) + CACHE_LINE_SIZE - 1) & ~(size_t) (CACHE_LINE_SIZE - 1))
+
+/**
+ * Allocates the large buffers (ERAM, framebuffer, camera sensor image) in a single block kept apart from gb_t so that
+ * they don't interleave with the state accessed at every step.
+ */
+static void arena_init(gb_t *gb) {
+    // only what the mode and the cartridge can access is allocated
+    size_t eram_size   = mmu_eram_size(gb);
+    size_t pixels_size = PPU_PIXELS_SIZE(gb);
+    size_t sensor_size = gb->mmu.mbc.type == CAMERA ? GB_CAMERA_SENSOR_WIDTH * GB_CAMERA_SENSOR_HEIGHT : 0;
+    size_t tiles       = (MMU_VRAM_SIZE(gb) / VRAM_BANK_SIZE) * TILE_CACHE_TILES_PER_BANK;
+    size_t rows_size   = tiles * TILE_CACHE_ROWS_PER_TILE * sizeof(*gb->ppu.tile_cache.rows);
+    size_t blip_size   = sizeof(*gb->apu.left);
+
+    size_t arena_size = ARENA_SLICE_SIZE(eram_size) + ARENA_SLICE_SIZE(FRAME_BUFFERS_COUNT * pixels_size);
+    arena_size += ARENA_SLICE_SIZE(sensor_size);
+    arena_size += ARENA_SLICE_SIZE(rows_size) + ARENA_SLICE_SIZE(tiles);
+    arena_size += ARENA_SLICE_SIZE(sizeof(*gb->ppu.obj_lines)) + 2 * ARENA_SLICE_SIZE(blip_size);
+
+    gb->arena    = xaligned_calloc(CACHE_LINE_SIZE, arena_size);
+    uint8_t *ptr = gb->arena;
+
+    gb->mmu.eram = ptr;
+    ptr += ARENA_SLICE_SIZE(eram_size);
+    gb->ppu.pixels = frame_buffers_init(&gb->frames, ptr, GB_SCREEN_WIDTH * gb->ppu.pixel_size, GB_SCREEN_HEIGHT);
+    ptr += ARENA_SLICE_SIZE(FRAME_BUFFERS_COUNT * pixels_size);
+    gb->mmu.mbc.camera.sensor_image = sensor_size ? ptr : NULL;
+    ptr += ARENA_SLICE_SIZE(sensor_size);
+    gb->ppu.tile_cache.rows = (uint16_t *) ptr;
+    ptr += ARENA_SLICE_SIZE(rows_size);
+    gb->ppu.tile_cache.is_dirty = ptr;
+    ptr += ARENA_SLICE_SIZE(tiles);
+    gb->ppu.obj_lines = (gb_obj_lines_t *) ptr;
+    ptr += ARENA_SLICE_SIZE(sizeof(*gb->ppu.obj_lines));
+    gb->apu.left = (blip_t *) ptr;
+    ptr += ARENA_SLICE_SIZE(blip_size);
+    gb->apu.right = (blip_t *) ptr;
+
+    ppu_invalidate_tiles(gb);
+    ppu_invalidate_obj_lines(gb);
+}
+
+// the boot ROM locks up if the cartridge logo is invalid: give up caching its post boot state after this many steps
+#define BOOT_MAX_STEPS (GB_CPU_STEPS_PER_FRAME * GB_FRAMES_PER_SECOND * 10)
+
+#define BOOT_SNAPSHOTS_MAX 16 // a snapshot takes about 150 KiB
+
+// range of the cartridge header read by the boot ROMs (logo, title used for the CGB compatibility palette, checksum)
+#define BOOT_HEADER_START 0x0104
+#define BOOT_HEADER_END   0x0150
+
+/**
+ * State of an instance just after its boot ROM has finished. As the post boot state only depends on the mode, the
+ * rendering options and the cartridge header, it is captured once by the first instance to boot with these parameters
+ * and restored as is by the next ones.
+ */
+typedef struct boot_snapshot_t {
+    struct boot_snapshot_t *next;
+
+    gbmulator_mode_t   mode;
+    gb_color_palette_t       palette;
+    gbmulator_pixel_format_t pixel_format;
+    bool                     scanline_renderer;
+    uint32_t                 header_crc;
+
+    gb_t     gb; // holds the VRAM and WRAM contents too
+    uint8_t *pixels;
+} boot_snapshot_t;
+
+// The snapshots are kept for the lifetime of the process as they are meant to be reused by the next instances (even
+// when they are created one after the other). The list is ordered from the most recently used and is capped to
+// BOOT_SNAPSHOTS_MAX entries: the least recently used one is freed when a new one is pushed beyond that. The mutex
+// protects the list and the snapshots it contains so that instances can be initialized from multiple threads.
+static boot_snapshot_t *boot_snapshots;
+static size_t           boot_snapshots_count;
+static pthread_mutex_t  boot_snapshots_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Must be called with the mutex held. The snapshot found is moved at the head of the list.
+ */
+static boot_snapshot_t *boot_snapshot_find(const gbmulator_options_t *opts, uint32_t header_crc) {
+    for (boot_snapshot_t **link = &boot_snapshots; *link; link = &(*link)->next) {
+        boot_snapshot_t *snapshot = *link;
+        if (snapshot->mode == opts->mode && snapshot->palette == opts->palette && snapshot->pixel_format == opts->pixel_format && snapshot->scanline_renderer == opts->scanline_renderer && snapshot->header_crc == header_crc) {
+            *link          = snapshot->next;
+            snapshot->next = boot_snapshots;
+            boot_snapshots = snapshot;
+            return snapshot;
+        }
+    }
+    return NULL;
+}
+
+static void boot_snapshot_free(boot_snapshot_t *snapshot) {
+    free(snapshot->pixels);
+    free(snapshot);
+}
+
+/**
+ * Must be called with the mutex held.
+ */
+static void boot_snapshot_push(gb_t *gb, uint32_t header_crc) {
+    boot_snapshot_t *snapshot = xaligned_calloc(alignof(boot_snapshot_t), sizeof(*snapshot));
+    snapshot->mode              = gb->base->opts.mode;
+    snapshot->palette           = gb->base->opts.palette;
+    snapshot->pixel_format      = gb->base->opts.pixel_format;
+    snapshot->scanline_renderer = gb->base->opts.scanline_renderer;
+    snapshot->header_crc        = header_crc;
+
+    memcpy(&snapshot->gb, gb, sizeof(*gb));
+    snapshot->pixels = xmalloc(PPU_PIXELS_SIZE(gb));
+    memcpy(snapshot->pixels, gb->ppu.pixels, PPU_PIXELS_SIZE(gb));
+
+    snapshot->next = boot_snapshots;
+    boot_snapshots = snapshot;
+
+    if (++boot_snapshots_count <= BOOT_SNAPSHOTS_MAX)
+        return;
+
+    // evict the least recently used snapshot
+    boot_snapshot_t **link = &boot_snapshots;
+    while ((*link)->next)
+        link = &(*link)->next;
+    boot_snapshot_free(*link);
+    *link = NULL;
+    boot_snapshots_count--;
+}
+
+static void boot_snapshot_restore(gb_t *gb, const boot_snapshot_t *snapshot) {
+    const gb_t *src = &snapshot->gb;
+
+    gb->cgb_mode_enabled = src->cgb_mode_enabled;
+    gb->cpu              = src->cpu;
+    gb->timer            = src->timer;
+    gb->link             = src->link;
+    gb->joypad           = src->joypad;
+
+    // keep this instance's buffers, only their content is restored
+    uint8_t         *pixels     = gb->ppu.pixels;
+    gb_tile_cache_t  tile_cache = gb->ppu.tile_cache;
+    gb_obj_lines_t  *obj_lines  = gb->ppu.obj_lines;
+    gb->ppu                     = src->ppu;
+    gb->ppu.pixels              = pixels;
+    gb->ppu.tile_cache          = tile_cache;
+    gb->ppu.obj_lines           = obj_lines;
+    gb->ppu.is_frame_skipped    = gb->base->opts.skip_rendering;
+
+    // only what the boot ROM changes is restored: the cartridge state (size, banking, mbc, rtc) stays this instance's
+    // as two cartridges with the same header can still differ
+    gb_mmu_t       *mmu     = &gb->mmu;
+    const gb_mmu_t *src_mmu = &src->mmu;
+    memcpy(mmu->io_registers, src_mmu->io_registers, sizeof(mmu->io_registers));
+    memcpy(mmu->hram, src_mmu->hram, sizeof(mmu->hram));
+    mmu->ie                     = src_mmu->ie;
+    mmu->vram_bank_addr_offset  = src_mmu->vram_bank_addr_offset;
+    mmu->wram_bankn_addr_offset = src_mmu->wram_bankn_addr_offset;
+    mmu->boot_finished          = src_mmu->boot_finished;
+    mmu->hdma                   = src_mmu->hdma;
+    mmu->oam_dma                = src_mmu->oam_dma;
+    memcpy(mmu->oam, src_mmu->oam, sizeof(mmu->oam));
+    memcpy(mmu->cram_bg, src_mmu->cram_bg, sizeof(mmu->cram_bg));
+    memcpy(mmu->cram_obj, src_mmu->cram_obj, sizeof(mmu->cram_obj));
+    memcpy(mmu->vram, src_mmu->vram, MMU_VRAM_SIZE(gb));
+    memcpy(mmu->wram, src_mmu->wram, MMU_WRAM_SIZE(gb));
+
+    // the channels registers must still point to this instance's io registers and the sampling is left untouched as
+    // the snapshot was taken without sound output
+    gb->apu.frame_sequencer = src->apu.frame_sequencer;
+    for (size_t i = 0; i < sizeof(gb->apu.channels) / sizeof(*gb->apu.channels); i++) {
+        gb_channel_t channel     = gb->apu.channels[i];
+        gb->apu.channels[i]      = src->apu.channels[i];
+        gb->apu.channels[i].NRx0 = channel.NRx0;
+        gb->apu.channels[i].NRx1 = channel.NRx1;
+        gb->apu.channels[i].NRx2 = channel.NRx2;
+        gb->apu.channels[i].NRx3 = channel.NRx3;
+        gb->apu.channels[i].NRx4 = channel.NRx4;
+    }
+
+    memcpy(gb->ppu.pixels, snapshot->pixels, PPU_PIXELS_SIZE(gb));
+    ppu_invalidate_tiles(gb);
+    ppu_invalidate_obj_lines(gb);
+    ppu_refresh_palettes(gb);
+}
+
+/**
+ * Brings a freshly reset instance to the state it has when its boot ROM finishes. The first instance of a given
+ * mode, rendering options and cartridge header runs the boot ROM (without calling the frame, sample, ... callbacks) and
+ * caches the resulting state so that every following instance starts from the exact same state without executing it.
+ */
+static void boot_skip(gb_t *gb, gbmulator_t *base) {
+    uint32_t header_crc = crc32(0, &gb->mmu.rom[BOOT_HEADER_START], BOOT_HEADER_END - BOOT_HEADER_START);
+
+    pthread_mutex_lock(&boot_snapshots_mutex);
+    boot_snapshot_t *snapshot = boot_snapshot_find(&base->opts, header_crc);
+    if (snapshot)
+        boot_snapshot_restore(gb, snapshot);
+    pthread_mutex_unlock(&boot_snapshots_mutex);
+    if (snapshot)
+        return;
+
+    gb->is_booting = true;
+    for (size_t steps = 0; !gb->mmu.boot_finished && steps < BOOT_MAX_STEPS; steps++)
+        gb_step(gb);
+    apu_sync(gb); // without sound output too
+    gb->is_booting = false;
+
+    // the frames of the boot ROM were never output: start without any published frame like a restored instance
+    gb->ppu.pixels = frame_buffers_reset(&gb->frames);
+
+    if (gb->mmu.boot_finished) {
+        pthread_mutex_lock(&boot_snapshots_mutex);
+        // another instance may have booted with the same parameters in the meantime
+        if (!boot_snapshot_find(&base->opts, header_crc))
+            boot_snapshot_push(gb, header_crc);
+        pthread_mutex_unlock(&boot_snapshots_mutex);
+    }
 }
 
 gb_t *gb_init(gbmulator_t *base) {
-    gb_t *gb = xcalloc(1, sizeof(*gb));
+    gb_t *gb = xaligned_calloc(alignof(gb_t), sizeof(*gb));
     gb->base = base;
 
     gb->cgb_mode_enabled = gb->base->opts.mode == GBMULATOR_MODE_GBC;
 
+    if (gb->base->opts.mode == GBMULATOR_MODE_GBC) {
+        gb->funcs.ppu_step = ppu_step_cgb;
+        gb->funcs.dma_step = dma_step_cgb;
+    } else {
+        gb->funcs.ppu_step = ppu_step;
+        gb->funcs.dma_step = dma_step;
+    }
+
     gb_set_palette(gb, gb->base->opts.palette);
 
     if (!mmu_reset(gb, base->opts.rom, base->opts.rom_size)) {
@@ -58,17 +291,24 @@ gb_t *gb_init(gbmulator_t *base) {
         return NULL;
     }
     cpu_reset(gb);
-    apu_reset(gb);
     ppu_reset(gb);
     timer_reset(gb);
     link_reset(gb);
     joypad_reset(gb);
 
+    // after the resets as they clear the structs holding the buffer pointers
+    arena_init(gb);
+    apu_reset(gb); // after arena_init() as it clears the blips
+
+    if (base->opts.skip_boot)
+        boot_skip(gb, base);
+
     return gb;
 }
 
 void gb_quit(gb_t *gb) {
     mmu_quit(gb);
+    free(gb->arena);
     free(gb);
 }
 
@@ -152,6 +392,23 @@ void gb_print_status(gb_t *gb) {
            mmu->has_rumble ? " + RUMBLE" : "");
 }
 
+#ifdef GB_PROFILE
+void gb_print_stats(gb_t *gb) {
+    gb_tile_cache_t *cache   = &gb->ppu.tile_cache;
+    uint64_t         fetches = cache->hits + cache->misses;
+
+    printf("Tile cache: %" PRIu64 " hits, %" PRIu64 " misses (%.2f%% hit rate), %" PRIu64 " invalidations\n",
+           cache->hits,
+           cache->misses,
+           fetches ? cache->hits * 100.0 / fetches : 0.0,
+           cache->invalidations);
+}
+#else
+void gb_print_stats(UNUSED gb_t *gb) {
+    // the profiling counters are only compiled with GB_PROFILE defined
+}
+#endif
+
 uint8_t gb_link_shift_bit(gb_t *gb, uint8_t in_bit) {
     uint8_t out_bit = GET_BIT(gb->mmu.io_registers[IO_SB], 7);
     gb->mmu.io_registers[IO_SB] <<= 1;
@@ -409,6 +666,10 @@ bool gb_load_savestate(gb_t *gb, gbmulator_savestate_t *savestate, size_t savest
     if (savestate->is_compressed)
         free(savestate_data);
 
+    ppu_invalidate_tiles(gb);
+    ppu_invalidate_obj_lines(gb);
+    ppu_refresh_palettes(gb);
+
     // resets apu's internal state to prevent glitchy audio if resuming from state without sound playing from state with sound playing
     apu_reset(gb);
 
@@ -425,6 +686,10 @@ uint8_t *gb_get_rom(gb_t *gb, size_t *rom_size) {
     return gb->mmu.rom;
 }
 
+frame_buffers_t *gb_get_frame_buffers(gb_t *gb) {
+    return &gb->frames;
+}
+
 uint8_t gb_has_accelerometer(gb_t *gb) {
     return gb->mmu.mbc.type == MBC7;
 }
@@ -435,4 +700,5 @@ uint8_t gb_has_camera(gb_t *gb) {
 
 void gb_set_palette(gb_t *gb, gb_color_palette_t palette) {
     gb->dmg_palette = palette;
+    ppu_refresh_palettes(gb);
 }
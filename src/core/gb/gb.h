@@ -2,6 +2,7 @@
 
 #include "../utils.h"
 #include "../core.h"
+#include "../frame_buffers.h"
 
 #define EMULATOR_NAME "GBmulator"
 
@@ -45,6 +46,8 @@ void gb_quit(gb_t *gb);
 
 void gb_print_status(gb_t *gb);
 
+void gb_print_stats(gb_t *gb);
+
 uint8_t gb_link_shift_bit(gb_t *gb, uint8_t in_bit);
 
 void gb_link_data_received(gb_t *gb);
@@ -75,6 +78,8 @@ char *gb_get_rom_title(gb_t *gb);
  */
 uint8_t *gb_get_rom(gb_t *gb, size_t *rom_size);
 
+frame_buffers_t *gb_get_frame_buffers(gb_t *gb);
+
 uint8_t gb_has_accelerometer(gb_t *gb);
 
 uint8_t gb_has_camera(gb_t *gb);
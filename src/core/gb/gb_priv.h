@@ -13,7 +13,17 @@
 
 #include "../core_priv.h"
 
+// The members are ordered so that the state accessed at every step is packed at the start of the struct (which is
+// cache line aligned) and the cold state is at the end. VRAM and WRAM are at the end of `mmu` (which follows the hot
+// state) as they are accessed at every step. The other large buffers (ERAM, framebuffer, camera sensor image, per-line
+// OAM scan results, audio output) are not part of this struct: they are allocated in `arena` (see gb_init()).
 struct gb_t {
+    // hot paths specialised at compile time for CGB mode, selected in gb_init()
+    alignas(CACHE_LINE_SIZE) struct {
+        void (*ppu_step)(gb_t *gb);
+        void (*dma_step)(gb_t *gb);
+    } funcs;
+
     const gbmulator_t *base;
 
     // this is true if CGB is in CGB mode, false if it is in DMG compatibility mode
@@ -22,13 +32,22 @@ struct gb_t {
 
     uint8_t dmg_palette;
 
-    char rom_title[17];
+    gb_cpu_t   cpu;
+    gb_timer_t timer;
+    gb_link_t  link;
+    gb_ppu_t   ppu;
 
-    gb_cpu_t    cpu;
-    gb_mmu_t    mmu;
-    gb_ppu_t    ppu;
-    apu_t       apu;
-    gb_timer_t  timer;
     gb_joypad_t joypad;
-    gb_link_t   link;
+
+    gb_mmu_t mmu; // hot members first, cold members (mbc, boot roms, ...) then VRAM and WRAM last
+
+    apu_t apu; // only accessed when it is synced except for its pending cycles (see apu_sync())
+
+    frame_buffers_t frames; // only accessed once per frame, its buffers are allocated in `arena`
+
+    bool is_booting; // set while boot_skip() runs the boot ROM: the frontend callbacks are not called
+
+    char rom_title[17];
+
+    uint8_t *arena;
 };
@@ -350,8 +350,10 @@ uint8_t mbc_read_eram(gb_t *gb, uint16_t address) {
     if (mbc->eram_enabled && !can_access_rtc) {
         if (mbc->type == MBC2) {
             // wrap around from 0xA200 to 0xBFFF (eg: address 0xA200 reads as address 0xA000)
-            return mmu->eram[mmu->eram_bank_addr + ((address - MMU_ERAM) & 0x1FF)] | 0xF0;
+            return mmu->eram[(address - MMU_ERAM) & (MBC2_RAM_SIZE - 1)] | 0xF0;
         }
+        if (mmu->eram_banks == 0)
+            return 0xFF; // the mbc can be enabled but there is no RAM in the cartridge
         return mmu->eram[mmu->eram_bank_addr + (address - MMU_ERAM)];
     }
 
@@ -397,7 +399,7 @@ void mbc_write_eram(gb_t *gb, uint16_t address, uint8_t data) {
                 // TODO accelerometer is buggy (see kirby tilt n tumble)
                 double x = 0.0f;
                 double y = 0.0f;
-                if (gb->base->opts.on_accelerometer_request)
+                if (gb->base->opts.on_accelerometer_request && !gb->is_booting)
                     gb->base->opts.on_accelerometer_request(&x, &y);
                 mbc->mbc7.accelerometer.latched_x   = 0x81D0 + (0x70 * x); // accelerometer_center + gravity * x
                 mbc->mbc7.accelerometer.latched_y   = 0x81D0 + (0x70 * y); // accelerometer_center + gravity * y
@@ -427,7 +429,10 @@ void mbc_write_eram(gb_t *gb, uint16_t address, uint8_t data) {
 
     uint8_t can_access_rtc = (mbc->type == MBC3 || mbc->type == MBC30) && mbc->mbc3.rtc_mapped; // mbc->mbc3.rtc_mapped implies that mmu->has_rtc is true
     if (mbc->eram_enabled && !can_access_rtc) {
-        mmu->eram[mmu->eram_bank_addr + (address - MMU_ERAM)] = data;
+        if (mbc->type == MBC2)
+            mmu->eram[(address - MMU_ERAM) & (MBC2_RAM_SIZE - 1)] = data; // same wrap around as reads
+        else if (mmu->eram_banks > 0) // the mbc can be enabled but there is no RAM in the cartridge
+            mmu->eram[mmu->eram_bank_addr + (address - MMU_ERAM)] = data;
     } else if (mbc->mbc3.rtc.enabled) { // mbc->mbc3.rtc.enabled implies that mmu->has_rtc is true
         switch (mbc->mbc3.rtc.reg) {
         case 0x08:
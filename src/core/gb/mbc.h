@@ -98,7 +98,7 @@ typedef struct {
         uint8_t  eram_bank;
         uint8_t  cam_regs_enabled;
         uint32_t capture_cycles_remaining;
-        uint8_t  sensor_image[GB_CAMERA_SENSOR_HEIGHT * GB_CAMERA_SENSOR_WIDTH];
+        uint8_t *sensor_image; // GB_CAMERA_SENSOR_HEIGHT * GB_CAMERA_SENSOR_WIDTH (allocated in gb->arena)
         uint8_t  regs[GB_CAMERA_N_REGS];
         uint8_t  work_regs[GB_CAMERA_N_REGS]; // registers saved for the image capture process
     } camera;
@@ -241,9 +241,7 @@ int mmu_reset(gb_t *gb, const uint8_t *rom, size_t rom_size) {
     // gb->mmu.mbc7.accelerometer.latched_y = 0x8000;
     // gb->mmu.mbc7.accelerometer.latch_ready = 1;
 
-    if (gb->mmu.mbc.type == CAMERA) {
-        memset(&gb->mmu.mbc.camera.sensor_image, 0, sizeof(gb->mmu.mbc.camera.sensor_image));
-    } else if (gb->mmu.mbc.type == MBC7) {
+    if (gb->mmu.mbc.type == MBC7) {
         gb->mmu.mbc.mbc7.accelerometer.latched_x = 0x81D0;
         gb->mmu.mbc.mbc7.accelerometer.latched_y = 0x81D0;
     }
@@ -254,6 +252,18 @@ int mmu_reset(gb_t *gb, const uint8_t *rom, size_t rom_size) {
     return 1;
 }
 
+size_t mmu_eram_size(gb_t *gb) {
+    switch (gb->mmu.mbc.type) {
+    case MBC2:
+        return MBC2_RAM_SIZE;
+    case CAMERA:
+        // the camera reads its ERAM even if the header doesn't declare it
+        return MAX(gb->mmu.eram_banks, 1) * ERAM_BANK_SIZE;
+    default:
+        return gb->mmu.eram_banks * ERAM_BANK_SIZE;
+    }
+}
+
 void mmu_quit(gb_t *gb) {
     free(gb->mmu.rom);
 }
@@ -302,6 +312,10 @@ static inline uint8_t is_vram_locked_for_cpu_write(gb_t *gb) {
 static inline uint8_t read_io_register(gb_t *gb, uint8_t io_reg_addr) {
     gb_mmu_t *mmu = &gb->mmu;
 
+    // the channels enabled flags of NR52 depend on the apu being up to date
+    if (io_reg_addr >= IO_NR10 && io_reg_addr < IO_LCDC)
+        apu_sync(gb);
+
     switch (io_reg_addr) {
     case IO_P1:
         // Reading from P1 register returns joypad input state according to its current bit 4 or 5 value
@@ -470,6 +484,12 @@ static inline uint8_t read_io_register(gb_t *gb, uint8_t io_reg_addr) {
 static inline void write_io_register(gb_t *gb, uint8_t io_reg_addr, uint8_t data) {
     gb_mmu_t *mmu = &gb->mmu;
 
+    // the apu must be up to date before the write and mixes its output again at its next sync
+    if (io_reg_addr >= IO_NR10 && io_reg_addr < IO_LCDC) {
+        apu_sync(gb);
+        gb->apu.is_output_dirty = 1;
+    }
+
     switch (io_reg_addr) {
     case IO_P1:
         // prevent writes to the lower nibble of the IO_P1 register (joypad)
@@ -485,6 +505,7 @@ static inline void write_io_register(gb_t *gb, uint8_t io_reg_addr, uint8_t data
         break;
     case IO_DIV:
         // writing to DIV resets it to 0
+        apu_on_div_write(gb);
         timer_set_div_timer(gb, 0);
         break;
     case IO_TIMA:
@@ -657,6 +678,11 @@ static inline void write_io_register(gb_t *gb, uint8_t io_reg_addr, uint8_t data
             mmu->io_registers[io_reg_addr] = data;
         break;
     case IO_LCDC: {
+        if (mmu->io_registers[io_reg_addr] != data)
+            ppu_on_raster_register_write(gb);
+        if ((mmu->io_registers[io_reg_addr] ^ data) & 0x04) // obj height change
+            ppu_invalidate_obj_lines(gb);
+
         uint8_t old_lcd_enabled        = IS_LCD_ENABLED(gb);
         mmu->io_registers[io_reg_addr] = data;
 
@@ -666,6 +692,24 @@ static inline void write_io_register(gb_t *gb, uint8_t io_reg_addr, uint8_t data
             ppu_disable_lcd(gb);
         break;
     }
+    case IO_SCY:
+    case IO_SCX:
+    case IO_WY:
+    case IO_WX:
+        if (mmu->io_registers[io_reg_addr] != data)
+            ppu_on_raster_register_write(gb);
+        mmu->io_registers[io_reg_addr] = data;
+        break;
+    case IO_BGP:
+    case IO_OBP0:
+    case IO_OBP1:
+        if (mmu->io_registers[io_reg_addr] == data)
+            break;
+        ppu_on_raster_register_write(gb);
+        mmu->io_registers[io_reg_addr] = data;
+        // BGP is the bg/win palette, OBP0 and OBP1 are the obj palettes 0 and 1
+        ppu_refresh_palette(gb, io_reg_addr != IO_BGP, io_reg_addr == IO_OBP1);
+        break;
     case IO_STAT: {
         // check for STAT interrupt only if in VBLANK, HBLANK or LY=LYC STAT bit is set
         // (not sure if the LY=LYC condition is accurate: this passes wilbertpol's stat_write_if-GS test
@@ -715,6 +759,7 @@ static inline void write_io_register(gb_t *gb, uint8_t io_reg_addr, uint8_t data
         if (gb->base->opts.mode == GBMULATOR_MODE_GBC && !mmu->boot_finished) {
             gb->cgb_mode_enabled           = !(data & 0x0C);
             mmu->io_registers[io_reg_addr] = data;
+            ppu_refresh_palettes(gb);
         }
         break;
     case IO_KEY1:
@@ -786,6 +831,7 @@ static inline void write_io_register(gb_t *gb, uint8_t io_reg_addr, uint8_t data
             uint8_t cram_address       = mmu->io_registers[IO_BGPI] & 0x3F;
             mmu->cram_bg[cram_address] = data;
             // printf("write %d in cram_bg %d\n", data, cram_address);
+            ppu_refresh_palette(gb, 0, cram_address / 8);
         }
 
         // increment BGPI address if auto increment (bit.7) of BGPI is set
@@ -809,6 +855,7 @@ static inline void write_io_register(gb_t *gb, uint8_t io_reg_addr, uint8_t data
             uint8_t cram_address        = mmu->io_registers[IO_OBPI] & 0x3F;
             mmu->cram_obj[cram_address] = data;
             // printf("write %d in cram_obj %d\n", data, cram_address);
+            ppu_refresh_palette(gb, 1, cram_address / 8);
         }
 
         // increment OBPI address if auto increment (bit.7) of OBPI is set
@@ -933,6 +980,7 @@ void mmu_write_io_src(gb_t *gb, uint16_t address, uint8_t data, gb_io_source_t i
         if (io_src == IO_SRC_CPU && is_vram_locked_for_cpu_write(gb))
             break;
         mmu->vram[mmu->vram_bank_addr_offset + address] = data;
+        ppu_invalidate_tile(gb, mmu->vram_bank_addr_offset + address);
         break;
     case MMU_ERAM:
     case MMU_ERAM + 0x1000:
@@ -953,6 +1001,7 @@ void mmu_write_io_src(gb_t *gb, uint16_t address, uint8_t data, gb_io_source_t i
         } else if (address < MMU_UNUSABLE) {
             if (io_src == IO_SRC_CPU && is_oam_locked_for_cpu_write(gb))
                 break;
+            ppu_invalidate_obj_lines(gb);
             mmu->oam[address - MMU_OAM] = data;
         } else if (address < MMU_IO) {
             // MMU_UNUSABLE memory is unusable
@@ -11,6 +11,11 @@
 #define CRAM_BG_SIZE   0x0040
 #define CRAM_OBJ_SIZE  0x0040
 
+#define MBC2_RAM_SIZE 0x0200 // MBC2 has 512 half-bytes of built-in RAM (not declared in the header's RAM size byte)
+
+#define MMU_VRAM_SIZE(gb) ((gb)->base->opts.mode == GBMULATOR_MODE_GBC ? 2 * VRAM_BANK_SIZE : VRAM_BANK_SIZE)
+#define MMU_WRAM_SIZE(gb) ((gb)->base->opts.mode == GBMULATOR_MODE_GBC ? 8 * WRAM_BANK_SIZE : 2 * WRAM_BANK_SIZE)
+
 typedef enum {
     MMU_ROM_BANK0  = 0x0000, // From cartridge, usually a fixed bank.
     MMU_ROM_BANKN  = 0x4000, // From cartridge, switchable bank via MBC (if any).
@@ -116,22 +121,28 @@ typedef enum {
     IO_SRC_GDMA_HDMA
 } gb_io_source_t;
 
+// the members are ordered from the most accessed to the least accessed: the io registers and the addressing state
+// used by each memory access come first, the rarely used cartridge related state last
 typedef struct {
-    uint8_t *dmg_boot_rom;
-    uint8_t *cgb_boot_rom;
-
-    size_t   rom_size;
-    uint8_t *rom; // max size: 8400000
-
-    uint8_t vram[2 * VRAM_BANK_SIZE];  // DMG: 1 bank / CGB: 2 banks of size 0x2000
-    uint8_t eram[16 * ERAM_BANK_SIZE]; // max 16 banks of size 0x2000
-    uint8_t wram[8 * WRAM_BANK_SIZE];  // DMG: 2 banks / CGB: 8 banks of size 0x1000 (bank 0 non switchable)
-    uint8_t oam[0xA0];
     uint8_t io_registers[0x80];
     uint8_t hram[0x7F];
     uint8_t ie;
-    uint8_t cram_bg[CRAM_BG_SIZE];   // color palette memory: 8 palettes * 4 colors per palette * 2 bytes per color = 64 bytes
-    uint8_t cram_obj[CRAM_OBJ_SIZE]; // color palette memory: 8 palettes * 4 colors per palette * 2 bytes per color = 64 bytes
+
+    // offset to add to address in vram when accessing the 0x8000-0x9FFF range (signed because it can be negative)
+    int32_t vram_bank_addr_offset;
+    // offset to add to address in wram when accessing the 0xD000-0xDFFF range (signed because it can be negative)
+    int32_t wram_bankn_addr_offset;
+
+    // address in rom that is the start of the current ROM bank when accessing the 0x0000-0x3FFF range
+    uint32_t rom_bank0_addr;
+    // address in rom that is the start of the current ROM bank when accessing the 0x4000-0x7FFF range
+    // (actually with an offset of -ROM_BANK_SIZE to avoid adding this offset to the address passed to the mmu_read() function)
+    uint32_t rom_bankn_addr;
+    // address in eram that is the start of the current ERAM bank when accessing the 0x8000-0x9FFF range
+    uint32_t eram_bank_addr;
+
+    uint8_t *rom;  // max size: 8400000
+    uint8_t *eram; // eram_banks banks of size 0x2000, see mmu_eram_size() (allocated in gb->arena)
 
     uint8_t boot_finished;
 
@@ -154,26 +165,27 @@ typedef struct {
         uint16_t src_address;
     } oam_dma;
 
-    // offset to add to address in vram when accessing the 0x8000-0x9FFF range (signed because it can be negative)
-    int32_t vram_bank_addr_offset;
-    // offset to add to address in wram when accessing the 0xD000-0xDFFF range (signed because it can be negative)
-    int32_t wram_bankn_addr_offset;
+    uint8_t oam[0xA0];
+    uint8_t cram_bg[CRAM_BG_SIZE];   // color palette memory: 8 palettes * 4 colors per palette * 2 bytes per color = 64 bytes
+    uint8_t cram_obj[CRAM_OBJ_SIZE]; // color palette memory: 8 palettes * 4 colors per palette * 2 bytes per color = 64 bytes
+
+    uint8_t *dmg_boot_rom;
+    uint8_t *cgb_boot_rom;
 
+    size_t   rom_size;
     uint16_t rom_banks;  // number of rom banks
     uint8_t  eram_banks; // number of eram banks
-    // address in rom that is the start of the current ROM bank when accessing the 0x0000-0x3FFF range
-    uint32_t rom_bank0_addr;
-    // address in rom that is the start of the current ROM bank when accessing the 0x4000-0x7FFF range
-    // (actually with an offset of -ROM_BANK_SIZE to avoid adding this offset to the address passed to the mmu_read() function)
-    uint32_t rom_bankn_addr;
-    // address in eram that is the start of the current ERAM bank when accessing the 0x8000-0x9FFF range
-    uint32_t eram_bank_addr;
 
     uint8_t has_battery;
     uint8_t has_rumble;
     uint8_t has_rtc;
 
     gb_mbc_t mbc;
+
+    // last so that they don't push the members above apart: they are accessed directly (without a pointer to load first)
+    // by the cpu reads and writes and by the ppu
+    uint8_t vram[2 * VRAM_BANK_SIZE]; // DMG: 1 bank / CGB: 2 banks of size 0x2000
+    uint8_t wram[8 * WRAM_BANK_SIZE]; // DMG: 2 banks / CGB: 8 banks of size 0x1000 (bank 0 non switchable)
 } gb_mmu_t;
 
 int parse_header_mbc_byte(uint8_t mbc_byte, uint8_t *mbc_type, uint8_t *has_eram, uint8_t *has_battery, uint8_t *has_rtc, uint8_t *has_rumble);
@@ -182,6 +194,11 @@ int validate_header_checksum(const uint8_t *rom);
 
 int mmu_reset(gb_t *gb, const uint8_t *rom, size_t rom_size);
 
+/**
+ * @returns the size of the ERAM buffer needed by the cartridge (must be called after mmu_reset()).
+ */
+size_t mmu_eram_size(gb_t *gb);
+
 void mmu_quit(gb_t *gb);
 
 uint8_t mmu_read_io_src(gb_t *gb, uint16_t address, gb_io_source_t io_src);
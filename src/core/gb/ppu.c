@@ -15,6 +15,13 @@
 
 #define SCANLINE_CYCLES 456
 
+// DRAWING mode duration bounds of the scanline renderer
+#define DRAWING_MIN_CYCLES 172
+#define DRAWING_MAX_CYCLES 289
+
+// number of frames drawn by the pixel FIFO after a raster effect before trying the scanline renderer again
+#define RASTER_EFFECT_FALLBACK_FRAMES 60
+
 #define PPU_SET_STAT_MODE(gb, new_mode) ((gb)->mmu.io_registers[IO_STAT] = ((gb)->mmu.io_registers[IO_STAT] & 0xFC) | (new_mode))
 
 #define IS_WIN_ENABLED(gb)    (CHECK_BIT((gb)->mmu.io_registers[IO_LCDC], 5))
@@ -27,21 +34,9 @@
 #define IS_INSIDE_WINDOW(gb) \
     (ppu->win_actually_enabled && (gb)->mmu.io_registers[IO_WY] <= (gb)->mmu.io_registers[IO_LY] && ppu->is_wx_triggered)
 
-#define SET_PIXEL_DMG(gb, x, y, color)                                                                               \
-    do {                                                                                                             \
-        (gb)->ppu.pixels[((y) * GB_SCREEN_WIDTH * 4) + ((x) * 4)]     = dmg_palettes[(gb)->dmg_palette][(color)][0]; \
-        (gb)->ppu.pixels[((y) * GB_SCREEN_WIDTH * 4) + ((x) * 4) + 1] = dmg_palettes[(gb)->dmg_palette][(color)][1]; \
-        (gb)->ppu.pixels[((y) * GB_SCREEN_WIDTH * 4) + ((x) * 4) + 2] = dmg_palettes[(gb)->dmg_palette][(color)][2]; \
-        (gb)->ppu.pixels[((y) * GB_SCREEN_WIDTH * 4) + ((x) * 4) + 3] = 0xFF;                                        \
-    } while (0)
-
-#define SET_PIXEL_CGB(gb, x, y, r, g, b)                                      \
-    do {                                                                      \
-        (gb)->ppu.pixels[((y) * GB_SCREEN_WIDTH * 4) + ((x) * 4)]     = (r);  \
-        (gb)->ppu.pixels[((y) * GB_SCREEN_WIDTH * 4) + ((x) * 4) + 1] = (g);  \
-        (gb)->ppu.pixels[((y) * GB_SCREEN_WIDTH * 4) + ((x) * 4) + 2] = (b);  \
-        (gb)->ppu.pixels[((y) * GB_SCREEN_WIDTH * 4) + ((x) * 4) + 3] = 0xFF; \
-    } while (0)
+#define CGB_LCD_OFF_INDEX 0xFF // GBMULATOR_PIXEL_FORMAT_INDEXED8 value of the white screen of a disabled LCD in CGB mode
+
+#define RGB_TO_BGR555(rgb) (((rgb)[0] >> 3) | (((rgb)[1] >> 3) << 5) | (((rgb)[2] >> 3) << 10))
 
 static const uint8_t dmg_palettes[PPU_COLOR_PALETTE_END][4][3] = {
     { // grayscale colors
@@ -59,7 +54,7 @@ static const uint8_t dmg_palettes[PPU_COLOR_PALETTE_END][4][3] = {
 /**
  * This sets the ppu mode and STAT mode and handles stat irq line interrupts
  */
-static inline void set_mode(gb_t *gb, uint8_t mode) {
+static ALWAYS_INLINE void set_mode(gb_t *gb, uint8_t mode, const bool is_cgb) {
     switch (mode) {
     case PPU_MODE_VBLANK:
         // if OAM stat irq is enabled while entering vblank, a stat irq can be requested depending on the stat irq line
@@ -67,7 +62,7 @@ static inline void set_mode(gb_t *gb, uint8_t mode) {
         ppu_update_stat_irq_line(gb);
         gb->ppu.mode = mode;
 
-        if (gb->base->opts.mode == GBMULATOR_MODE_GBC) {
+        if (is_cgb) {
             gb->ppu.pending_stat_mode = mode;
         } else {
             // no delay to set STAT mode bits and request VBLANK irq
@@ -88,27 +83,16 @@ static inline void set_mode(gb_t *gb, uint8_t mode) {
 /**
  * @returns dmg color after applying palette.
  */
-static inline gb_dmg_color_t dmg_get_color(gb_mmu_t *mmu, gb_pixel_t *pixel, uint8_t is_obj) {
+static inline gb_dmg_color_t dmg_get_color(gb_mmu_t *mmu, uint8_t is_obj, uint8_t palette, uint8_t color) {
     // return the color using the palette
-    uint16_t palette_address = is_obj ? IO_OBP0 + pixel->palette : IO_BGP;
-    return (mmu->io_registers[palette_address] >> (pixel->color << 1)) & 0x03;
+    uint16_t palette_address = is_obj ? IO_OBP0 + palette : IO_BGP;
+    return (mmu->io_registers[palette_address] >> (color << 1)) & 0x03;
 }
 
 /**
- * @returns cgb colors in r, g, b arguments after applying palette.
+ * @returns cgb colors in r, g, b arguments from the 15 bit `color_data` (a CRAM entry).
  */
-static inline void cgb_get_color(gb_mmu_t *mmu, gb_pixel_t *pixel, uint8_t is_obj, uint8_t *r, uint8_t *g, uint8_t *b) {
-    uint16_t color_data;
-    if (pixel) {
-        uint8_t color_address = pixel->palette * 8 + pixel->color * 2;
-        if (is_obj)
-            color_data = (mmu->cram_obj[color_address + 1] << 8) | mmu->cram_obj[color_address];
-        else
-            color_data = (mmu->cram_bg[color_address + 1] << 8) | mmu->cram_bg[color_address];
-    } else {
-        color_data = 0xFFFF;
-    }
-
+static inline void cgb_get_color(uint16_t color_data, uint8_t *r, uint8_t *g, uint8_t *b) {
     *r = color_data & 0x1F;
     *g = (color_data & 0x3E0) >> 5;
     *b = (color_data & 0x7C00) >> 10;
@@ -129,6 +113,65 @@ static inline void cgb_get_color(gb_mmu_t *mmu, gb_pixel_t *pixel, uint8_t is_ob
 #endif
 }
 
+/**
+ * @returns the color `r`, `g`, `b` (or its 15 bit value `bgr555` for GBMULATOR_PIXEL_FORMAT_BGR555, or the palette
+ *          entry `index` for GBMULATOR_PIXEL_FORMAT_INDEXED8) in the output pixel format, ready to be stored as is by
+ *          set_pixel().
+ */
+static uint32_t get_host_color(gb_t *gb, uint8_t r, uint8_t g, uint8_t b, uint16_t bgr555, uint8_t index) {
+    uint32_t host_color = 0;
+
+    switch (gb->base->opts.pixel_format) {
+    case GBMULATOR_PIXEL_FORMAT_RGBA8888:
+        memcpy(&host_color, (uint8_t[4]) { r, g, b, 0xFF }, 4);
+        break;
+    case GBMULATOR_PIXEL_FORMAT_BGRA8888:
+        memcpy(&host_color, (uint8_t[4]) { b, g, r, 0xFF }, 4);
+        break;
+    case GBMULATOR_PIXEL_FORMAT_RGB565:
+        host_color = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+        break;
+    case GBMULATOR_PIXEL_FORMAT_INDEXED8:
+        host_color = index;
+        break;
+    case GBMULATOR_PIXEL_FORMAT_BGR555:
+        host_color = bgr555 & 0x7FFF;
+        break;
+    }
+
+    return host_color;
+}
+
+static ALWAYS_INLINE void set_pixel(gb_ppu_t *ppu, uint8_t x, uint8_t y, uint32_t host_color) {
+    uint8_t *pixel = &ppu->pixels[(y * GB_SCREEN_WIDTH + x) * ppu->pixel_size];
+
+    switch (ppu->pixel_size) {
+    case 4:
+        memcpy(pixel, &host_color, 4);
+        break;
+    case 2:
+        memcpy(pixel, &(uint16_t) { host_color }, 2);
+        break;
+    default:
+        *pixel = host_color;
+        break;
+    }
+}
+
+/**
+ * Hands the completed frame off to the frontend (see gbmulator_acquire_frame()) and continues the rendering in another
+ * buffer.
+ */
+static void publish_frame(gb_t *gb) {
+    gb_ppu_t *ppu   = &gb->ppu;
+    uint8_t  *frame = ppu->pixels;
+
+    ppu->pixels = frame_buffers_publish(&gb->frames);
+
+    if (gb->base->opts.on_new_frame && !gb->is_booting)
+        gb->base->opts.on_new_frame(frame);
+}
+
 static inline uint8_t cgb_get_bg_win_tile_attributes(gb_t *gb) {
     gb_mmu_t *mmu = &gb->mmu;
     gb_ppu_t *ppu = &gb->ppu;
@@ -199,27 +242,75 @@ static inline uint16_t get_obj_tiledata_address(gb_t *gb, uint8_t is_high) {
     return 0x8000 | (actual_tile_id << 4) | (bits_3_1 << 1) | (!!is_high);
 }
 
-static inline gb_pixel_t *pixel_fifo_pop(gb_pixel_fifo_t *fifo) {
-    if (fifo->size == 0)
-        return NULL;
-    fifo->size--;
-    uint8_t old_head = fifo->head;
-    fifo->head       = (fifo->head + 1) % PIXEL_FIFO_SIZE;
-    return &fifo->pixels[old_head];
+/**
+ * @returns a byte per pixel of the FIFO (see gb_pixel_fifo_t.oam_pos): 0xFF if the pixel's bit is set in `mask`,
+ *          0x00 otherwise.
+ */
+static inline uint64_t pixel_mask_to_bytes(uint8_t mask) {
+    uint64_t bytes = (mask * 0x0101010101010101ULL) & 0x8040201008040201ULL; // byte i keeps bit i of mask
+    return (((bytes + 0x7F7F7F7F7F7F7F7FULL) & 0x8080808080808080ULL) >> 7) * 0xFF;
 }
 
-static inline void pixel_fifo_push(gb_pixel_fifo_t *fifo, gb_pixel_t *pixel) {
-    if (fifo->size == PIXEL_FIFO_SIZE)
-        return;
-    fifo->size++;
-    fifo->pixels[fifo->tail] = *pixel;
-    fifo->tail               = (fifo->tail + 1) % PIXEL_FIFO_SIZE;
+/**
+ * @returns the pixels of the FIFO (as a plane) whose oam_pos is greater than `oam_pos`.
+ */
+static inline uint8_t pixel_fifo_oam_pos_greater_than(gb_pixel_fifo_t *fifo, uint8_t oam_pos) {
+    // oam positions are < 40: each byte's bit 7 ends up set if its oam_pos >= oam_pos + 1 without borrowing
+    uint64_t greater = ((fifo->oam_pos | 0x8080808080808080ULL) - (oam_pos + 1) * 0x0101010101010101ULL) & 0x8080808080808080ULL;
+    return ((greater >> 7) * 0x0102040810204080ULL) >> 56; // gather the bit 7 of each byte
+}
+
+/**
+ * Replaces the pixels of `fifo` in `mask` by the pixels of the row of the pixel fetcher shifted left by `offset`.
+ */
+static inline void pixel_fifo_mix(gb_pixel_fifo_t *fifo, gb_ppu_t *ppu, uint8_t offset, uint8_t mask) {
+    fifo->color_low  = (fifo->color_low & ~mask) | ((ppu->pixel_fetcher.tile_low << offset) & mask);
+    fifo->color_high = (fifo->color_high & ~mask) | ((ppu->pixel_fetcher.tile_high << offset) & mask);
+    for (uint8_t i = 0; i < 3; i++)
+        fifo->palette[i] = (fifo->palette[i] & ~mask) | (CHECK_BIT(ppu->pixel_fetcher.palette, i) ? mask : 0);
+    fifo->priority = (fifo->priority & ~mask) | (ppu->pixel_fetcher.priority ? mask : 0);
+
+    uint64_t bytes_mask = pixel_mask_to_bytes(mask);
+    fifo->oam_pos       = (fifo->oam_pos & ~bytes_mask) | ((ppu->pixel_fetcher.oam_pos * 0x0101010101010101ULL) & bytes_mask);
+}
+
+/**
+ * Pops the pixel at the head of `fifo`. The FIFO must not be empty.
+ */
+static inline gb_pixel_t pixel_fifo_pop(gb_pixel_fifo_t *fifo) {
+    gb_pixel_t pixel = {
+        .color    = (fifo->color_low >> 7) | ((fifo->color_high >> 7) << 1),
+        .palette  = (fifo->palette[0] >> 7) | ((fifo->palette[1] >> 7) << 1) | ((fifo->palette[2] >> 7) << 2),
+        .priority = fifo->priority >> 7,
+        .oam_pos  = fifo->oam_pos >> 56
+    };
+
+    fifo->color_low <<= 1;
+    fifo->color_high <<= 1;
+    fifo->palette[0] <<= 1;
+    fifo->palette[1] <<= 1;
+    fifo->palette[2] <<= 1;
+    fifo->priority <<= 1;
+    fifo->oam_pos <<= 8;
+    fifo->size--;
+
+    return pixel;
 }
 
 static inline void pixel_fifo_clear(gb_pixel_fifo_t *fifo) {
-    fifo->size = 0;
-    fifo->head = 0;
-    fifo->tail = 0;
+    memset(fifo, 0, sizeof(*fifo));
+}
+
+/**
+ * @returns the pixel `i` (from left to right) of the row fetched by the pixel fetcher.
+ */
+static inline gb_pixel_t pixel_fetcher_get_pixel(gb_ppu_t *ppu, uint8_t i) {
+    return (gb_pixel_t) {
+        .color    = GET_BIT(ppu->pixel_fetcher.tile_low, 7 - i) | (GET_BIT(ppu->pixel_fetcher.tile_high, 7 - i) << 1),
+        .palette  = ppu->pixel_fetcher.palette,
+        .priority = ppu->pixel_fetcher.priority,
+        .oam_pos  = ppu->pixel_fetcher.oam_pos
+    };
 }
 
 static inline void reset_pixel_fetcher(gb_ppu_t *ppu) {
@@ -231,16 +322,6 @@ static inline void reset_pixel_fetcher(gb_ppu_t *ppu) {
     ppu->discarded_pixels                  = 0;
 }
 
-/**
- * taken from https://stackoverflow.com/a/2602885
- */
-static inline uint8_t reverse_bits_order(uint8_t b) {
-    b = (b & 0xF0) >> 4 | (b & 0x0F) << 4;
-    b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
-    b = (b & 0xAA) >> 1 | (b & 0x55) << 1;
-    return b;
-}
-
 static inline void fetch_tile_id(gb_t *gb) {
     gb_mmu_t *mmu = &gb->mmu;
     gb_ppu_t *ppu = &gb->ppu;
@@ -266,53 +347,89 @@ static inline void fetch_tile_id(gb_t *gb) {
     }
 }
 
-static inline uint8_t get_tileslice(gb_t *gb, uint16_t tiledata_address, uint8_t attributes) {
-    gb_mmu_t *mmu = &gb->mmu;
-
-    uint8_t flip_x = CHECK_BIT(attributes, 5);
-    if (gb->base->opts.mode == GBMULATOR_MODE_GBC) {
-        if (CHECK_BIT(attributes, 3)) // tile is in VRAM bank 1
-            return flip_x ? reverse_bits_order(mmu->vram[tiledata_address - MMU_VRAM + VRAM_BANK_SIZE]) : mmu->vram[tiledata_address - MMU_VRAM + VRAM_BANK_SIZE];
-        else
-            return flip_x ? reverse_bits_order(mmu->vram[tiledata_address - MMU_VRAM]) : mmu->vram[tiledata_address - MMU_VRAM];
-    } else {
-        return flip_x ? reverse_bits_order(mmu->vram[tiledata_address - MMU_VRAM]) : mmu->vram[tiledata_address - MMU_VRAM];
+static void decode_tile(gb_tile_cache_t *cache, const uint8_t *vram, uint16_t tile) {
+    // tiles of VRAM bank 1 are after those of VRAM bank 0 in the cache
+    const uint8_t *tiledata = &vram[(tile / TILE_CACHE_TILES_PER_BANK) * VRAM_BANK_SIZE + (tile % TILE_CACHE_TILES_PER_BANK) * 16];
+    uint16_t      *rows     = &cache->rows[tile * TILE_CACHE_ROWS_PER_TILE];
+
+    for (uint8_t row = 0; row < 8; row++) {
+        uint8_t low          = tiledata[row * 2];
+        uint8_t high         = tiledata[row * 2 + 1];
+        uint8_t flipped_low  = 0;
+        uint8_t flipped_high = 0;
+        for (uint8_t i = 0; i < 8; i++) {
+            flipped_low |= GET_BIT(low, i) << (7 - i);
+            flipped_high |= GET_BIT(high, i) << (7 - i);
+        }
+        rows[row * 2]     = low | (high << 8);
+        rows[row * 2 + 1] = flipped_low | (flipped_high << 8);
     }
+
+    cache->is_dirty[tile] = 0;
 }
 
-static inline void fetch_tileslice_low(gb_t *gb) {
+/**
+ * @returns the decoded row (see gb_tile_cache_t) of the tile data at `tiledata_address`, X-flipped if the attributes
+ *          say so.
+ */
+static ALWAYS_INLINE uint16_t get_tile_row(gb_t *gb, uint16_t tiledata_address, uint8_t attributes, const bool is_cgb) {
+    gb_tile_cache_t *cache = &gb->ppu.tile_cache;
+
+    uint16_t tile = (tiledata_address - MMU_VRAM) >> 4;
+    if (is_cgb && CHECK_BIT(attributes, 3)) // tile is in VRAM bank 1
+        tile += TILE_CACHE_TILES_PER_BANK;
+
+#ifdef GB_PROFILE
+    cache->misses += cache->is_dirty[tile];
+    cache->hits += !cache->is_dirty[tile];
+#endif
+    if (cache->is_dirty[tile])
+        decode_tile(cache, gb->mmu.vram, tile);
+
+    uint8_t row = (tiledata_address >> 1) & 0x07;
+    return cache->rows[tile * TILE_CACHE_ROWS_PER_TILE + row * 2 + GET_BIT(attributes, 5)];
+}
+
+static ALWAYS_INLINE void fetch_tileslice_low(gb_t *gb, const bool is_cgb) {
     gb_ppu_t *ppu = &gb->ppu;
 
-    uint8_t tileslice = 0;
+    // the fetched pixels don't affect the timings
+    if (ppu->is_frame_skipped)
+        return;
+
+    uint16_t tile_row = 0;
     switch (ppu->pixel_fetcher.mode) {
     case FETCH_BG: {
-        uint8_t  attributes       = gb->base->opts.mode == GBMULATOR_MODE_GBC ? cgb_get_bg_win_tile_attributes(gb) : 0;
+        uint8_t  attributes       = is_cgb ? cgb_get_bg_win_tile_attributes(gb) : 0;
         uint16_t tiledata_address = get_bg_tiledata_address(gb, 0, CHECK_BIT(attributes, 6));
-        tileslice                 = get_tileslice(gb, tiledata_address, attributes);
+        tile_row                  = get_tile_row(gb, tiledata_address, attributes, is_cgb);
         break;
     }
     case FETCH_WIN: {
-        uint8_t  attributes       = gb->base->opts.mode == GBMULATOR_MODE_GBC ? cgb_get_bg_win_tile_attributes(gb) : 0;
+        uint8_t  attributes       = is_cgb ? cgb_get_bg_win_tile_attributes(gb) : 0;
         uint16_t tiledata_address = get_win_tiledata_address(gb, 0, CHECK_BIT(attributes, 6));
-        tileslice                 = get_tileslice(gb, tiledata_address, attributes);
+        tile_row                  = get_tile_row(gb, tiledata_address, attributes, is_cgb);
         break;
     }
     case FETCH_OBJ: {
         uint8_t  attributes       = ppu->oam_scan.objs[ppu->pixel_fetcher.curr_oam_index].attributes;
         uint16_t tiledata_address = get_obj_tiledata_address(gb, 0);
-        tileslice                 = get_tileslice(gb, tiledata_address, attributes);
+        tile_row                  = get_tile_row(gb, tiledata_address, attributes, is_cgb);
         break;
     }
     }
 
-    for (uint8_t i = 0; i < 8; i++)
-        ppu->pixel_fetcher.pixels[i].color = GET_BIT(tileslice, 7 - i);
+    // only keep the low bitplane
+    ppu->pixel_fetcher.tile_low = tile_row;
 }
 
-static inline void fetch_tileslice_high(gb_t *gb) {
+static ALWAYS_INLINE void fetch_tileslice_high(gb_t *gb, const bool is_cgb) {
     gb_ppu_t *ppu = &gb->ppu;
 
-    uint8_t  tileslice  = 0;
+    if (ppu->is_frame_skipped)
+        return;
+
+    uint16_t tile_row   = 0;
     uint16_t palette    = 0;
     uint8_t  attributes = 0;
     uint8_t  oam_pos    = 0;
@@ -320,48 +437,47 @@ static inline void fetch_tileslice_high(gb_t *gb) {
     // leading to potential bitplane desync
     switch (ppu->pixel_fetcher.mode) {
     case FETCH_BG: {
-        if (gb->base->opts.mode == GBMULATOR_MODE_GBC) {
+        if (is_cgb) {
             attributes = cgb_get_bg_win_tile_attributes(gb);
             palette    = IS_CGB_COMPAT_MODE(gb) ? 0 : attributes & 0x07;
         } else {
             palette = 0;
         }
         uint16_t tiledata_address = get_bg_tiledata_address(gb, 1, CHECK_BIT(attributes, 6));
-        tileslice                 = get_tileslice(gb, tiledata_address, attributes);
+        tile_row                  = get_tile_row(gb, tiledata_address, attributes, is_cgb);
         break;
     }
     case FETCH_WIN: {
-        if (gb->base->opts.mode == GBMULATOR_MODE_GBC) {
+        if (is_cgb) {
             attributes = cgb_get_bg_win_tile_attributes(gb);
             palette    = IS_CGB_COMPAT_MODE(gb) ? 0 : attributes & 0x07;
         } else {
             palette = 0;
         }
         uint16_t tiledata_address = get_win_tiledata_address(gb, 1, CHECK_BIT(attributes, 6));
-        tileslice                 = get_tileslice(gb, tiledata_address, attributes);
+        tile_row                  = get_tile_row(gb, tiledata_address, attributes, is_cgb);
         break;
     }
     case FETCH_OBJ: {
         attributes                = ppu->oam_scan.objs[ppu->pixel_fetcher.curr_oam_index].attributes;
         uint16_t tiledata_address = get_obj_tiledata_address(gb, 1);
-        tileslice                 = get_tileslice(gb, tiledata_address, attributes);
+        tile_row                  = get_tile_row(gb, tiledata_address, attributes, is_cgb);
         oam_pos                   = ppu->oam_scan.objs_oam_pos[ppu->pixel_fetcher.curr_oam_index];
 
-        uint8_t is_cgb_mode = gb->base->opts.mode == GBMULATOR_MODE_GBC && !IS_CGB_COMPAT_MODE(gb);
+        uint8_t is_cgb_mode = is_cgb && !IS_CGB_COMPAT_MODE(gb);
         palette             = is_cgb_mode ? attributes & 0x07 : GET_BIT(attributes, 4);
         break;
     }
     }
 
-    for (uint8_t i = 0; i < 8; i++) {
-        ppu->pixel_fetcher.pixels[i].color |= GET_BIT(tileslice, 7 - i) << 1;
-        ppu->pixel_fetcher.pixels[i].palette    = palette;
-        ppu->pixel_fetcher.pixels[i].attributes = attributes;
-        ppu->pixel_fetcher.pixels[i].oam_pos    = oam_pos;
-    }
+    // only keep the high bitplane
+    ppu->pixel_fetcher.tile_high = tile_row >> 8;
+    ppu->pixel_fetcher.palette   = palette;
+    ppu->pixel_fetcher.priority  = GET_BIT(attributes, 7);
+    ppu->pixel_fetcher.oam_pos   = oam_pos;
 }
 
-static inline uint8_t push(gb_t *gb) {
+static ALWAYS_INLINE uint8_t push(gb_t *gb, const bool is_cgb) {
     gb_ppu_t *ppu = &gb->ppu;
 
     switch (ppu->pixel_fetcher.mode) {
@@ -370,32 +486,30 @@ static inline uint8_t push(gb_t *gb) {
         if (ppu->bg_win_fifo.size > 0)
             return 0;
 
-        for (uint8_t i = 0; i < 8; i++)
-            pixel_fifo_push(&ppu->bg_win_fifo, &ppu->pixel_fetcher.pixels[i]);
+        pixel_fifo_mix(&ppu->bg_win_fifo, ppu, 0, 0xFF);
+        ppu->bg_win_fifo.size = 8;
         ppu->pixel_fetcher.x += 8;
         break;
     case FETCH_OBJ: {
+        gb_pixel_fifo_t *fifo = &ppu->obj_fifo;
+
         // if the obj starts before the beginning of the scanline, only push the visible pixels by using an offset
-        uint8_t old_size = ppu->obj_fifo.size;
-        uint8_t offset   = 0;
+        uint8_t offset = 0;
         if (ppu->oam_scan.objs[ppu->pixel_fetcher.curr_oam_index].x < 8)
             offset = 8 - ppu->oam_scan.objs[ppu->pixel_fetcher.curr_oam_index].x;
 
-        uint8_t is_cgb_mode = gb->base->opts.mode == GBMULATOR_MODE_GBC && !CHECK_BIT(gb->mmu.io_registers[IO_OPRI], 0);
-        for (uint8_t fetcher_index = offset; fetcher_index < PIXEL_FIFO_SIZE; fetcher_index++) {
-            uint8_t fifo_index = ((fetcher_index - offset) + ppu->obj_fifo.head) % PIXEL_FIFO_SIZE;
+        uint8_t fetched  = 0xFF << offset;
+        uint8_t occupied = 0xFF00 >> fifo->size;
+        uint8_t opaque   = (ppu->pixel_fetcher.tile_low | ppu->pixel_fetcher.tile_high) << offset;
 
-            if (fetcher_index < old_size) {
-                if (ppu->pixel_fetcher.pixels[fetcher_index].color == DMG_WHITE)
-                    continue;
-                if (is_cgb_mode && ppu->pixel_fetcher.pixels[fetcher_index].oam_pos < ppu->obj_fifo.pixels[fifo_index].oam_pos)
-                    ppu->obj_fifo.pixels[fifo_index] = ppu->pixel_fetcher.pixels[fetcher_index];
-                if (ppu->obj_fifo.pixels[fifo_index].color == DMG_WHITE)
-                    ppu->obj_fifo.pixels[fifo_index] = ppu->pixel_fetcher.pixels[fetcher_index];
-            } else {
-                pixel_fifo_push(&ppu->obj_fifo, &ppu->pixel_fetcher.pixels[fetcher_index]);
-            }
-        }
+        // an opaque fetched pixel replaces a transparent pixel of the FIFO (or in CGB mode a pixel of an obj after it in
+        // the oam memory): the pixels already in the FIFO have the x priority as their obj was fetched first
+        uint8_t replaced = ~(fifo->color_low | fifo->color_high);
+        if (is_cgb && !CHECK_BIT(gb->mmu.io_registers[IO_OPRI], 0))
+            replaced |= pixel_fifo_oam_pos_greater_than(fifo, ppu->pixel_fetcher.oam_pos);
+
+        pixel_fifo_mix(fifo, ppu, offset, fetched & ((occupied & opaque & replaced) | ~occupied));
+        fifo->size = MAX(fifo->size, 8 - offset);
 
         ppu->pixel_fetcher.mode = ppu->pixel_fetcher.old_mode;
         break;
@@ -405,14 +519,14 @@ static inline uint8_t push(gb_t *gb) {
     return 1;
 }
 
-static inline gb_pixel_t *select_pixel(gb_t *gb, gb_pixel_t *bg_win_pixel, gb_pixel_t *obj_pixel) {
-    uint8_t is_cgb_mode = gb->base->opts.mode == GBMULATOR_MODE_GBC && !IS_CGB_COMPAT_MODE(gb);
+static ALWAYS_INLINE gb_pixel_t *select_pixel(gb_t *gb, gb_pixel_t *bg_win_pixel, gb_pixel_t *obj_pixel, const bool is_cgb) {
+    uint8_t is_cgb_mode = is_cgb && !IS_CGB_COMPAT_MODE(gb);
     if (is_cgb_mode) {
         if (!obj_pixel || !IS_OBJ_ENABLED(gb) || obj_pixel->color == DMG_WHITE)
             return bg_win_pixel;
         if (bg_win_pixel->color == DMG_WHITE || !IS_BG_WIN_ENABLED(gb))
             return obj_pixel;
-        if (!CHECK_BIT(bg_win_pixel->attributes, 7) && !CHECK_BIT(obj_pixel->attributes, 7))
+        if (!bg_win_pixel->priority && !obj_pixel->priority)
             return obj_pixel;
         return bg_win_pixel;
     } else {
@@ -426,7 +540,7 @@ static inline gb_pixel_t *select_pixel(gb_t *gb, gb_pixel_t *bg_win_pixel, gb_pi
         if (!IS_OBJ_ENABLED(gb))
             return bg_win_pixel;
 
-        uint8_t bg_over_obj = CHECK_BIT(obj_pixel->attributes, 7) && bg_win_pixel->color != DMG_WHITE;
+        uint8_t bg_over_obj = obj_pixel->priority && bg_win_pixel->color != DMG_WHITE;
         if (obj_pixel->color != DMG_WHITE && !bg_over_obj) // ignore transparent obj pixel and don't draw over another sprite (thus, respecting x priority)
             return obj_pixel;
         return bg_win_pixel;
@@ -434,7 +548,7 @@ static inline gb_pixel_t *select_pixel(gb_t *gb, gb_pixel_t *bg_win_pixel, gb_pi
 }
 
 // https://github.com/mattcurrie/mealybug-tearoom-tests/blob/70e88fb90b59d19dfbb9c3ac36c64105202bb1f4/the-comprehensive-game-boy-ppu-documentation.md#win_en-bit-5
-static inline gb_pixel_t *handle_window(gb_t *gb) {
+static ALWAYS_INLINE gb_pixel_t *handle_window(gb_t *gb, const bool is_cgb) {
     static gb_pixel_t glitched_pixel = { 0 };
 
     gb_mmu_t *mmu = &gb->mmu;
@@ -458,7 +572,7 @@ static inline gb_pixel_t *handle_window(gb_t *gb) {
     // https://www.reddit.com/r/EmuDev/comments/6q2tom/gb_changing_window_registers_midframe/
     // https://github.com/LIJI32/SameBoy/commit/cbbaf2ee843870d96e72380e2dedbdbda471ca76
     uint8_t wx_scx_compare = ((mmu->io_registers[IO_WX] & 7) == 7 - (mmu->io_registers[IO_SCX] & 7));
-    if (ppu->saved_wly != -1 && gb->base->opts.mode != GBMULATOR_MODE_GBC && !IS_WIN_ENABLED(gb) && ppu->is_wx_triggered && wx_scx_compare)
+    if (ppu->saved_wly != -1 && !is_cgb && !IS_WIN_ENABLED(gb) && ppu->is_wx_triggered && wx_scx_compare)
         return &glitched_pixel;
 
     if (ppu->pixel_fetcher.mode == FETCH_BG && IS_INSIDE_WINDOW(gb)) {
@@ -516,7 +630,43 @@ static inline uint8_t handle_obj(gb_t *gb) {
     return ppu->pixel_fetcher.mode == FETCH_OBJ;
 }
 
-static inline void drawing_step(gb_t *gb) {
+/**
+ * Draws the pixel at position `x` of the current line, selected between the bg/win pixel and the obj pixel (if any).
+ */
+static ALWAYS_INLINE void draw_pixel(gb_t *gb, uint8_t x, gb_pixel_t *bg_win_pixel, gb_pixel_t *obj_pixel, const bool is_cgb) {
+    gb_ppu_t *ppu = &gb->ppu;
+
+    gb_pixel_t *selected_pixel  = select_pixel(gb, bg_win_pixel, obj_pixel, is_cgb);
+    uint8_t     selected_is_obj = selected_pixel == obj_pixel;
+
+    set_pixel(ppu, x, gb->mmu.io_registers[IO_LY], ppu->host_colors[selected_is_obj][selected_pixel->palette][selected_pixel->color]);
+}
+
+/**
+ * Ends the DRAWING mode of the current line and goes into HBLANK mode.
+ */
+static ALWAYS_INLINE void end_drawing(gb_t *gb, const bool is_cgb) {
+    gb_mmu_t *mmu = &gb->mmu;
+    gb_ppu_t *ppu = &gb->ppu;
+
+    ppu->lcd_x = 0;
+
+    reset_pixel_fetcher(ppu);
+
+    pixel_fifo_clear(&ppu->bg_win_fifo);
+    pixel_fifo_clear(&ppu->obj_fifo);
+
+    ppu->oam_scan.index       = 0;
+    ppu->win_actually_enabled = 0;
+    set_mode(gb, PPU_MODE_HBLANK, is_cgb);
+    mmu->hdma.allow_hdma_block = mmu->hdma.type == HDMA && mmu->hdma.progress > 0;
+
+    // the first frame after the LCD is turned on isn't output
+    if (gb->base->opts.on_new_line && !ppu->is_frame_skipped && !ppu->is_lcd_turning_on && !gb->is_booting)
+        gb->base->opts.on_new_line(ppu->pixels, mmu->io_registers[IO_LY] + 1, GB_SCREEN_HEIGHT);
+}
+
+static ALWAYS_INLINE void drawing_step(gb_t *gb, const bool is_cgb) {
     gb_mmu_t *mmu = &gb->mmu;
     gb_ppu_t *ppu = &gb->ppu;
 
@@ -541,29 +691,33 @@ static inline void drawing_step(gb_t *gb) {
         fetch_tile_id(gb);
         break;
     case GET_TILE_SLICE_LOW:
-        fetch_tileslice_low(gb);
+        fetch_tileslice_low(gb, is_cgb);
         break;
     case GET_TILE_SLICE_HIGH:
-        fetch_tileslice_high(gb);
+        fetch_tileslice_high(gb, is_cgb);
         if (!ppu->pixel_fetcher.is_dummy_fetch_done) {
             ppu->pixel_fetcher.is_dummy_fetch_done = 1;
             ppu->pixel_fetcher.step                = 0;
         }
         break;
     case PUSH:
-        ppu->pixel_fetcher.step = push(gb) ? 0 : PUSH;
+        ppu->pixel_fetcher.step = push(gb, is_cgb) ? 0 : PUSH;
         break;
     }
 
     if (handle_obj(gb)) // pause pixel fetching while an obj fetch is in progress
         return;
 
-    gb_pixel_t *glitched_pixel = handle_window(gb);
+    gb_pixel_t *glitched_pixel = handle_window(gb, is_cgb);
 
     // 2. SHIFTING PIXELS OUT TO THE LCD
 
-    gb_pixel_t *bg_win_pixel = glitched_pixel ? glitched_pixel : pixel_fifo_pop(&ppu->bg_win_fifo);
-    if (!bg_win_pixel)
+    gb_pixel_t bg_win_pixel;
+    if (glitched_pixel)
+        bg_win_pixel = *glitched_pixel;
+    else if (ppu->bg_win_fifo.size > 0)
+        bg_win_pixel = pixel_fifo_pop(&ppu->bg_win_fifo);
+    else
         return;
 
     // discards pixels if needed, either due to SCX or window starting before screen (WX < 7)
@@ -584,21 +738,10 @@ static inline void drawing_step(gb_t *gb) {
         break;
     }
 
-    gb_pixel_t *obj_pixel       = pixel_fifo_pop(&ppu->obj_fifo);
-    gb_pixel_t *selected_pixel  = select_pixel(gb, bg_win_pixel, obj_pixel);
-    uint8_t     selected_is_obj = selected_pixel == obj_pixel;
-
-    if (gb->base->opts.mode == GBMULATOR_MODE_GBC) {
-        if (IS_CGB_COMPAT_MODE(gb))
-            selected_pixel->color = dmg_get_color(mmu, selected_pixel, selected_is_obj);
-
-        uint8_t r, g, b;
-        cgb_get_color(mmu, selected_pixel, selected_is_obj, &r, &g, &b);
-
-        SET_PIXEL_CGB(gb, ppu->lcd_x, mmu->io_registers[IO_LY], r, g, b);
-    } else {
-        SET_PIXEL_DMG(gb, ppu->lcd_x, mmu->io_registers[IO_LY], dmg_get_color(mmu, selected_pixel, selected_is_obj));
-    }
+    uint8_t    has_obj_pixel = ppu->obj_fifo.size > 0;
+    gb_pixel_t obj_pixel     = has_obj_pixel ? pixel_fifo_pop(&ppu->obj_fifo) : (gb_pixel_t) { 0 };
+    if (!ppu->is_frame_skipped)
+        draw_pixel(gb, ppu->lcd_x, &bg_win_pixel, has_obj_pixel ? &obj_pixel : NULL, is_cgb);
 
     ppu->lcd_x++;
 
@@ -607,60 +750,290 @@ static inline void drawing_step(gb_t *gb) {
         //     printf("%d in [172, 289]?\n", ppu->cycles - 80);
         // }
         // the new position is outside the screen, this scanline is done: go into HBLANK mode
-        ppu->lcd_x = 0;
+        end_drawing(gb, is_cgb);
+    }
+}
+
+/**
+ * @returns the lcd x coordinate where the window starts on the current line (it can be negative if WX < 7) or
+ *          GB_SCREEN_WIDTH if the window isn't drawn on this line.
+ */
+static inline int16_t scanline_window_start(gb_t *gb) {
+    gb_mmu_t *mmu = &gb->mmu;
 
-        reset_pixel_fetcher(ppu);
+    if (!gb->ppu.win_actually_enabled || mmu->io_registers[IO_WY] > mmu->io_registers[IO_LY] || mmu->io_registers[IO_WX] > GB_SCREEN_WIDTH + 6)
+        return GB_SCREEN_WIDTH;
+    return mmu->io_registers[IO_WX] - 7;
+}
 
-        pixel_fifo_clear(&ppu->bg_win_fifo);
-        pixel_fifo_clear(&ppu->obj_fifo);
+/**
+ * Closed form model of the DRAWING mode duration (https://gbdev.io/pandocs/Rendering.html#mode-3-length):
+ * the SCX fine scroll pixels are discarded, the window costs a fetcher restart and each obj costs 6 cycles plus up
+ * to 5 cycles waiting for the bg/win fetch of the tile it starts in (only the first obj of a tile waits).
+ */
+static uint16_t scanline_drawing_cycles(gb_t *gb) {
+    gb_mmu_t *mmu = &gb->mmu;
+    gb_ppu_t *ppu = &gb->ppu;
+
+    uint8_t  scx    = mmu->io_registers[IO_SCX];
+    int16_t  win_x  = scanline_window_start(gb);
+    uint16_t cycles = DRAWING_MIN_CYCLES + (scx & 0x07);
+
+    if (win_x < GB_SCREEN_WIDTH)
+        cycles += 6;
+
+    if (!IS_OBJ_ENABLED(gb))
+        return cycles;
+
+    uint64_t waited_tiles = 0; // bg tiles in the low 32 bits, win tiles in the high 32 bits
+    for (uint8_t i = 0; i < ppu->oam_scan.size; i++) {
+        gb_obj_t *obj = &ppu->oam_scan.objs[i];
+        if (obj->x >= GB_SCREEN_WIDTH + 8)
+            continue;
+
+        cycles += 6;
+
+        if (obj->x == 0) {
+            cycles += 5;
+            continue;
+        }
+
+        // position of the obj's first pixel relative to the start of the bg or win tiles
+        int16_t obj_lcd_x = obj->x - 8;
+        uint8_t is_in_win = obj_lcd_x >= win_x;
+        int16_t tiles_x   = is_in_win ? obj_lcd_x - win_x : obj_lcd_x + (scx & 0x07);
+        uint8_t tile      = (tiles_x + 8) / 8 + (is_in_win ? 32 : 0);
+        if (waited_tiles & ((uint64_t) 1 << tile))
+            continue;
+
+        waited_tiles |= (uint64_t) 1 << tile;
+        cycles += MAX(0, 5 - (tiles_x & 0x07));
+    }
+
+    return MIN(cycles, DRAWING_MAX_CYCLES);
+}
+
+/**
+ * Updates the window internal line counter like handle_window() would do during the DRAWING mode of the current line.
+ * @returns the lcd x coordinate where the window starts on the current line (see scanline_window_start()).
+ */
+static inline int16_t scanline_update_window(gb_t *gb) {
+    gb_mmu_t *mmu = &gb->mmu;
+    gb_ppu_t *ppu = &gb->ppu;
+
+    if (ppu->wly != -1 && !IS_WIN_ENABLED(gb)) {
+        ppu->saved_wly = ppu->wly;
+        ppu->wly       = -1;
+    }
 
-        ppu->oam_scan.index       = 0;
-        ppu->win_actually_enabled = 0;
-        set_mode(gb, PPU_MODE_HBLANK);
-        mmu->hdma.allow_hdma_block = mmu->hdma.type == HDMA && mmu->hdma.progress > 0;
+    int16_t win_x = scanline_window_start(gb);
+    if (win_x < GB_SCREEN_WIDTH) {
+        if (ppu->saved_wly != -1) {
+            ppu->wly       = ppu->saved_wly + 1;
+            ppu->saved_wly = -1;
+        } else if (ppu->wly == -1) {
+            ppu->wly = mmu->io_registers[IO_LY] - mmu->io_registers[IO_WY];
+        } else {
+            ppu->wly++;
+        }
     }
+
+    return win_x;
+}
+
+/**
+ * Runs the pixel fetcher steps for a whole tile at once: the 8 fetched pixels end up in `ppu->pixel_fetcher` (see
+ * pixel_fetcher_get_pixel()).
+ */
+static ALWAYS_INLINE void scanline_fetch(gb_t *gb, gb_pixel_fetcher_mode_t mode, uint8_t fetcher_x, const bool is_cgb) {
+    gb->ppu.pixel_fetcher.mode = mode;
+    gb->ppu.pixel_fetcher.x    = fetcher_x;
+    fetch_tile_id(gb);
+    fetch_tileslice_low(gb, is_cgb);
+    fetch_tileslice_high(gb, is_cgb);
 }
 
-static inline void oam_scan_step(gb_t *gb) {
+/**
+ * Renders the whole current line in one pass using the current registers values. This gives the same pixels as the
+ * pixel FIFO as long as the registers are not modified during the DRAWING mode.
+ */
+static ALWAYS_INLINE void render_scanline(gb_t *gb, const bool is_cgb) {
     gb_mmu_t *mmu = &gb->mmu;
     gb_ppu_t *ppu = &gb->ppu;
 
-    // it takes 2 cycles to scan one OBJ so we skip every other step
-    if (!ppu->oam_scan.step) {
-        ppu->oam_scan.step = 1;
+    if (ppu->is_frame_skipped) {
+        scanline_update_window(gb);
+        ppu->is_line_rendered = 1;
         return;
     }
 
-    gb_obj_t *obj        = (gb_obj_t *) &mmu->oam[ppu->oam_scan.index * 4];
+    gb_pixel_t bg_win_pixels[GB_SCREEN_WIDTH];
+    gb_pixel_t obj_pixels[GB_SCREEN_WIDTH];
+    uint8_t    has_obj_pixel[GB_SCREEN_WIDTH] = { 0 };
+
+    // background: the first SCX % 8 pixels of the first tile are discarded
+    uint8_t fine_scx = mmu->io_registers[IO_SCX] & 0x07;
+    for (int16_t fetcher_x = 0; fetcher_x - fine_scx < GB_SCREEN_WIDTH; fetcher_x += 8) {
+        scanline_fetch(gb, FETCH_BG, fetcher_x, is_cgb);
+        for (uint8_t i = 0; i < 8; i++) {
+            int16_t x = fetcher_x - fine_scx + i;
+            if (x >= 0 && x < GB_SCREEN_WIDTH)
+                bg_win_pixels[x] = pixel_fetcher_get_pixel(ppu, i);
+        }
+    }
+
+    // window: same wly handling as handle_window()
+    int16_t win_x = scanline_update_window(gb);
+    if (win_x < GB_SCREEN_WIDTH) {
+        for (int16_t fetcher_x = 0; win_x + fetcher_x < GB_SCREEN_WIDTH; fetcher_x += 8) {
+            scanline_fetch(gb, FETCH_WIN, fetcher_x, is_cgb);
+            for (uint8_t i = 0; i < 8; i++) {
+                int16_t x = win_x + fetcher_x + i;
+                if (x >= 0 && x < GB_SCREEN_WIDTH)
+                    bg_win_pixels[x] = pixel_fetcher_get_pixel(ppu, i);
+            }
+        }
+    }
+
+    // objs: same priority rules as push()
+    if (IS_OBJ_ENABLED(gb)) {
+        uint8_t is_cgb_mode = is_cgb && !CHECK_BIT(mmu->io_registers[IO_OPRI], 0);
+        for (uint8_t i = 0; i < ppu->oam_scan.size; i++) {
+            gb_obj_t *obj = &ppu->oam_scan.objs[i];
+            if (obj->x == 0 || obj->x >= GB_SCREEN_WIDTH + 8)
+                continue;
+
+            ppu->pixel_fetcher.curr_oam_index = i;
+            scanline_fetch(gb, FETCH_OBJ, 0, is_cgb);
+
+            for (uint8_t j = 0; j < 8; j++) {
+                int16_t x = obj->x - 8 + j;
+                if (x < 0 || x >= GB_SCREEN_WIDTH)
+                    continue;
+
+                gb_pixel_t pixel = pixel_fetcher_get_pixel(ppu, j);
+                if (!has_obj_pixel[x]) {
+                    obj_pixels[x]    = pixel;
+                    has_obj_pixel[x] = 1;
+                    continue;
+                }
+
+                if (pixel.color == DMG_WHITE)
+                    continue;
+                if (is_cgb_mode && pixel.oam_pos < obj_pixels[x].oam_pos)
+                    obj_pixels[x] = pixel;
+                if (obj_pixels[x].color == DMG_WHITE)
+                    obj_pixels[x] = pixel;
+            }
+        }
+    }
+
+    for (uint8_t x = 0; x < GB_SCREEN_WIDTH; x++)
+        draw_pixel(gb, x, &bg_win_pixels[x], has_obj_pixel[x] ? &obj_pixels[x] : NULL, is_cgb);
+
+    ppu->is_line_rendered = 1;
+}
+
+static ALWAYS_INLINE void scanline_drawing_step(gb_t *gb, const bool is_cgb) {
+    gb_ppu_t *ppu = &gb->ppu;
+
+    if (ppu->cycles < ppu->drawing_end_cycles)
+        return;
+
+    if (!ppu->is_line_rendered)
+        render_scanline(gb, is_cgb);
+    end_drawing(gb, is_cgb);
+}
+
+/**
+ * Inserts the obj at position `oam_pos` in the oam memory into the `size` objs of `objs` if it is on line `ly` and there
+ * are less than OAM_SCAN_MAX_OBJS of them.
+ */
+static inline void oam_scan_obj(gb_t *gb, gb_obj_t *objs, uint8_t *objs_oam_pos, uint8_t *size, uint8_t ly, uint8_t oam_pos) {
+    gb_obj_t *obj        = (gb_obj_t *) &gb->mmu.oam[oam_pos * 4];
     uint8_t   obj_height = IS_OBJ_TALL(gb) ? 16 : 8;
     // NOTE: obj->x != 0 condition should not be checked even if ultimate gameboy talk says it should
-    if (ppu->oam_scan.size < 10 && (obj->y <= mmu->io_registers[IO_LY] + 16) && (obj->y + obj_height > mmu->io_registers[IO_LY] + 16)) {
+    if (*size < OAM_SCAN_MAX_OBJS && (obj->y <= ly + 16) && (obj->y + obj_height > ly + 16)) {
         int8_t i;
         // if equal x: insert after so that the drawing doesn't overwrite the existing sprite (equal x -> first scanned obj priority)
-        for (i = ppu->oam_scan.size - 1; i >= 0 && ppu->oam_scan.objs[i].x > obj->x; i--) {
-            ppu->oam_scan.objs[i + 1]         = ppu->oam_scan.objs[i];
-            ppu->oam_scan.objs_oam_pos[i + 1] = ppu->oam_scan.objs_oam_pos[i];
+        for (i = *size - 1; i >= 0 && objs[i].x > obj->x; i--) {
+            objs[i + 1]         = objs[i];
+            objs_oam_pos[i + 1] = objs_oam_pos[i];
         }
-        ppu->oam_scan.objs[i + 1]         = *obj;
-        ppu->oam_scan.objs_oam_pos[i + 1] = ppu->oam_scan.index;
-        ppu->oam_scan.size++;
+        objs[i + 1]         = *obj;
+        objs_oam_pos[i + 1] = oam_pos;
+        (*size)++;
     }
+}
+
+static void build_obj_lines(gb_t *gb) {
+    gb_obj_lines_t *obj_lines = gb->ppu.obj_lines;
+
+    memset(obj_lines->sizes, 0, sizeof(obj_lines->sizes));
+
+    // same as scanning the whole oam memory for each line but only visiting the lines covered by each obj
+    uint8_t obj_height = IS_OBJ_TALL(gb) ? 16 : 8;
+    for (uint8_t oam_pos = 0; oam_pos < 40; oam_pos++) {
+        int16_t first_line = gb->mmu.oam[oam_pos * 4] - 16;
+        for (int16_t ly = MAX(first_line, 0); ly < first_line + obj_height && ly < GB_SCREEN_HEIGHT; ly++)
+            oam_scan_obj(gb, obj_lines->objs[ly], obj_lines->objs_oam_pos[ly], &obj_lines->sizes[ly], ly, oam_pos);
+    }
+
+    obj_lines->is_dirty = 0;
+}
+
+static inline void start_oam_scan(gb_t *gb, const bool is_cgb) {
+    gb_ppu_t *ppu = &gb->ppu;
+
+    ppu->oam_scan.size      = 0;
+    ppu->oam_scan.is_cached = gb->mmu.io_registers[IO_LY] < GB_SCREEN_HEIGHT;
+    set_mode(gb, PPU_MODE_OAM, is_cgb);
+}
+
+static ALWAYS_INLINE void oam_scan_step(gb_t *gb, const bool is_cgb) {
+    gb_mmu_t *mmu = &gb->mmu;
+    gb_ppu_t *ppu = &gb->ppu;
+
+    // it takes 2 cycles to scan one OBJ so we skip every other step
+    if (!ppu->oam_scan.step) {
+        ppu->oam_scan.step = 1;
+        return;
+    }
+
+    if (!ppu->oam_scan.is_cached)
+        oam_scan_obj(gb, ppu->oam_scan.objs, ppu->oam_scan.objs_oam_pos, &ppu->oam_scan.size, mmu->io_registers[IO_LY], ppu->oam_scan.index);
 
     ppu->oam_scan.step = 0;
     ppu->oam_scan.index++;
 
     // if OAM scan has ended, switch to DRAWING mode
     if (ppu->oam_scan.index == 40) {
+        if (ppu->oam_scan.is_cached) {
+            if (ppu->obj_lines->is_dirty)
+                build_obj_lines(gb);
+
+            uint8_t ly         = mmu->io_registers[IO_LY];
+            ppu->oam_scan.size = ppu->obj_lines->sizes[ly];
+            memcpy(ppu->oam_scan.objs, ppu->obj_lines->objs[ly], sizeof(ppu->oam_scan.objs));
+            memcpy(ppu->oam_scan.objs_oam_pos, ppu->obj_lines->objs_oam_pos[ly], sizeof(ppu->oam_scan.objs_oam_pos));
+        }
+
         ppu->oam_scan.step  = 0;
         ppu->oam_scan.index = 0;
 
         ppu->discarded_pixels     = 0;
         ppu->win_actually_enabled = IS_WIN_ENABLED(gb);
-        set_mode(gb, PPU_MODE_DRAWING);
+        set_mode(gb, PPU_MODE_DRAWING, is_cgb);
+
+        ppu->is_scanline_line = gb->base->opts.scanline_renderer && !ppu->raster_effect_frames;
+        if (ppu->is_scanline_line) {
+            ppu->is_line_rendered   = 0;
+            ppu->drawing_end_cycles = ppu->cycles + scanline_drawing_cycles(gb);
+        }
     }
 }
 
-static inline void hblank_step(gb_t *gb) {
+static ALWAYS_INLINE void hblank_step(gb_t *gb, const bool is_cgb) {
     gb_mmu_t *mmu = &gb->mmu;
     gb_ppu_t *ppu = &gb->ppu;
 
@@ -673,7 +1046,10 @@ static inline void hblank_step(gb_t *gb) {
     if (mmu->io_registers[IO_LY] == GB_SCREEN_HEIGHT) {
         ppu->wly       = -1;
         ppu->saved_wly = -1;
-        set_mode(gb, PPU_MODE_VBLANK);
+        set_mode(gb, PPU_MODE_VBLANK, is_cgb);
+
+        if (ppu->raster_effect_frames)
+            ppu->raster_effect_frames--;
 
         // skip first screen rendering after the LCD was just turned on
         if (ppu->is_lcd_turning_on) {
@@ -681,16 +1057,15 @@ static inline void hblank_step(gb_t *gb) {
             return;
         }
 
-        if (gb->base->opts.on_new_frame)
-            gb->base->opts.on_new_frame(ppu->pixels);
+        if (!ppu->is_frame_skipped)
+            publish_frame(gb);
     } else {
-        ppu->oam_scan.size = 0;
-        set_mode(gb, PPU_MODE_OAM);
+        start_oam_scan(gb, is_cgb);
         RESET_BIT(mmu->io_registers[IO_STAT], 2); // clear LY=LYC until ppu->cycles == 4
     }
 }
 
-static inline void vblank_step(gb_t *gb) {
+static ALWAYS_INLINE void vblank_step(gb_t *gb, const bool is_cgb) {
     gb_mmu_t *mmu = &gb->mmu;
     gb_ppu_t *ppu = &gb->ppu;
 
@@ -712,8 +1087,8 @@ static inline void vblank_step(gb_t *gb) {
         if (ppu->is_last_vblank_line && mmu->io_registers[IO_LY] == 0) {
             // we actually are on line 153 but LY reads 0
             ppu->is_last_vblank_line = 0;
-            ppu->oam_scan.size       = 0;
-            set_mode(gb, PPU_MODE_OAM);
+            ppu->is_frame_skipped    = gb->base->opts.skip_rendering;
+            start_oam_scan(gb, is_cgb);
         } else {
             mmu->io_registers[IO_LY]++; // increase on each new line
         }
@@ -728,12 +1103,14 @@ void ppu_enable_lcd(gb_t *gb) {
     ppu->mode              = PPU_MODE_OAM; // reading hblank mode but actually in OAM mode
     ppu->cycles            = 8;            // lcd is 8 cycles early when turning on
     ppu->is_lcd_turning_on = 1;
+    ppu->is_frame_skipped  = gb->base->opts.skip_rendering;
     UPDATE_STAT_LY_LYC_BIT(gb);
     ppu_update_stat_irq_line(gb);
 
     // advance oam_scan to take into account the 8 cycles early
-    ppu->oam_scan.index = 3; // 4 objects scanned
-    ppu->oam_scan.step  = 1; // scan 5th object immediately
+    ppu->oam_scan.index     = 3; // 4 objects scanned
+    ppu->oam_scan.step      = 1; // scan 5th object immediately
+    ppu->oam_scan.is_cached = 0; // the first objects are skipped
 }
 
 void ppu_disable_lcd(gb_t *gb) {
@@ -750,21 +1127,36 @@ void ppu_disable_lcd(gb_t *gb) {
 
     mmu->hdma.allow_hdma_block = mmu->hdma.type == HDMA && mmu->hdma.progress > 0;
 
+    if (ppu->is_frame_skipped)
+        return;
+
     // white screen
-    for (int x = 0; x < GB_SCREEN_WIDTH; x++) {
-        for (int y = 0; y < GB_SCREEN_HEIGHT; y++) {
-            if (gb->base->opts.mode == GBMULATOR_MODE_GBC) {
-                uint8_t r, g, b;
-                cgb_get_color(mmu, NULL, 0, &r, &g, &b);
-                SET_PIXEL_CGB(gb, x, y, r, g, b);
-            } else {
-                SET_PIXEL_DMG(gb, x, y, DMG_WHITE);
-            }
-        }
-    }
+    for (int x = 0; x < GB_SCREEN_WIDTH; x++)
+        for (int y = 0; y < GB_SCREEN_HEIGHT; y++)
+            set_pixel(ppu, x, y, ppu->lcd_off_color);
+
+    if (gb->base->opts.on_new_line && !gb->is_booting)
+        for (int y = 0; y < GB_SCREEN_HEIGHT; y++)
+            gb->base->opts.on_new_line(ppu->pixels, y + 1, GB_SCREEN_HEIGHT);
 
-    if (gb->base->opts.on_new_frame)
-        gb->base->opts.on_new_frame(gb->ppu.pixels);
+    publish_frame(gb);
+}
+
+void ppu_on_raster_register_write(gb_t *gb) {
+    gb_ppu_t *ppu = &gb->ppu;
+
+    if (!IS_LCD_ENABLED(gb) || ppu->mode != PPU_MODE_DRAWING)
+        return;
+
+    ppu->raster_effect_frames = RASTER_EFFECT_FALLBACK_FRAMES;
+
+    // the pixels left of the current position are right, the others can't be anyway
+    if (ppu->is_scanline_line && !ppu->is_line_rendered) {
+        if (gb->base->opts.mode == GBMULATOR_MODE_GBC)
+            render_scanline(gb, true);
+        else
+            render_scanline(gb, false);
+    }
 }
 
 void ppu_update_stat_irq_line(gb_t *gb) {
@@ -784,7 +1176,11 @@ void ppu_update_stat_irq_line(gb_t *gb) {
         CPU_REQUEST_INTERRUPT(gb, IRQ_STAT);
 }
 
-void ppu_step(gb_t *gb) {
+/**
+ * Body of ppu_step() and ppu_step_cgb(): `is_cgb` is a compile time constant in ppu_step_cgb() so every per-pixel
+ * mode check inlined from here is resolved at compile time instead of being tested for each dot.
+ */
+static ALWAYS_INLINE void ppu_step_template(gb_t *gb, const bool is_cgb) {
     if (!IS_LCD_ENABLED(gb))
         return;
 
@@ -811,19 +1207,22 @@ void ppu_step(gb_t *gb) {
             // Scanning OAM for (X, Y) coordinates of sprites that overlap this line
             // there is up to 40 OBJs in OAM memory and this mode takes 80 cycles: 2 cycles per OBJ to check if it should be displayed
             // put them into an array of max size 10.
-            oam_scan_step(gb);
+            oam_scan_step(gb, is_cgb);
             break;
         case PPU_MODE_DRAWING:
             // Reading OAM and VRAM to generate the picture
-            drawing_step(gb);
+            if (ppu->is_scanline_line)
+                scanline_drawing_step(gb, is_cgb);
+            else
+                drawing_step(gb, is_cgb);
             break;
         case PPU_MODE_HBLANK:
             // Horizontal blanking
-            hblank_step(gb);
+            hblank_step(gb, is_cgb);
             break;
         case PPU_MODE_VBLANK:
             // Vertical blanking
-            vblank_step(gb);
+            vblank_step(gb, is_cgb);
             break;
         }
 
@@ -831,10 +1230,97 @@ void ppu_step(gb_t *gb) {
     }
 }
 
+void ppu_step(gb_t *gb) {
+    ppu_step_template(gb, gb->base->opts.mode == GBMULATOR_MODE_GBC);
+}
+
+void ppu_step_cgb(gb_t *gb) {
+    ppu_step_template(gb, true);
+}
+
+void ppu_invalidate_tile(gb_t *gb, uint16_t vram_offset) {
+    // only the tile data blocks are cached, not the tile maps
+    if (vram_offset % VRAM_BANK_SIZE >= TILE_CACHE_TILES_PER_BANK * 16)
+        return;
+
+    gb_tile_cache_t *cache = &gb->ppu.tile_cache;
+    uint16_t         tile  = (vram_offset / VRAM_BANK_SIZE) * TILE_CACHE_TILES_PER_BANK + (vram_offset % VRAM_BANK_SIZE) / 16;
+    if (!cache->is_dirty[tile]) {
+        cache->is_dirty[tile] = 1;
+#ifdef GB_PROFILE
+        cache->invalidations++;
+#endif
+    }
+}
+
+void ppu_invalidate_obj_lines(gb_t *gb) {
+    gb_ppu_t *ppu = &gb->ppu;
+
+    ppu->obj_lines->is_dirty = 1;
+
+    if (ppu->mode != PPU_MODE_OAM || !ppu->oam_scan.is_cached)
+        return;
+
+    // an OAM scan is in progress: scan the objs it already went through (they were not modified since the scan started)
+    // and let it scan the next ones at each step
+    for (uint8_t oam_pos = 0; oam_pos < ppu->oam_scan.index; oam_pos++)
+        oam_scan_obj(gb, ppu->oam_scan.objs, ppu->oam_scan.objs_oam_pos, &ppu->oam_scan.size, gb->mmu.io_registers[IO_LY], oam_pos);
+    ppu->oam_scan.is_cached = 0;
+}
+
+void ppu_refresh_palette(gb_t *gb, uint8_t is_obj, uint8_t palette) {
+    gb_mmu_t *mmu         = &gb->mmu;
+    uint32_t *host_colors = gb->ppu.host_colors[is_obj][palette];
+
+    for (uint8_t color = 0; color < 4; color++) {
+        if (gb->base->opts.mode == GBMULATOR_MODE_GBC) {
+            // in CGB compatibility mode, the DMG palettes select the colors of the CGB palettes set by the boot ROM
+            uint8_t cgb_color     = IS_CGB_COMPAT_MODE(gb) ? dmg_get_color(mmu, is_obj, palette, color) : color;
+            uint8_t color_address = palette * 8 + cgb_color * 2;
+            uint8_t *cram         = is_obj ? mmu->cram_obj : mmu->cram_bg;
+
+            uint8_t  r, g, b;
+            uint16_t color_data = (cram[color_address + 1] << 8) | cram[color_address];
+            cgb_get_color(color_data, &r, &g, &b);
+            host_colors[color] = get_host_color(gb, r, g, b, color_data, is_obj * 32 + palette * 4 + cgb_color);
+        } else {
+            uint8_t        shade = dmg_get_color(mmu, is_obj, palette, color);
+            const uint8_t *rgb   = dmg_palettes[gb->dmg_palette][shade];
+            host_colors[color]   = get_host_color(gb, rgb[0], rgb[1], rgb[2], RGB_TO_BGR555(rgb), shade);
+        }
+    }
+}
+
+void ppu_refresh_palettes(gb_t *gb) {
+    // DMG palettes: BGP for bg/win, OBP0 and OBP1 for objs
+    uint8_t n_palettes = gb->base->opts.mode == GBMULATOR_MODE_GBC ? 8 : 2;
+    for (uint8_t palette = 0; palette < n_palettes; palette++) {
+        ppu_refresh_palette(gb, 0, palette);
+        ppu_refresh_palette(gb, 1, palette);
+    }
+
+    if (gb->base->opts.mode == GBMULATOR_MODE_GBC) {
+        uint8_t r, g, b;
+        cgb_get_color(0xFFFF, &r, &g, &b);
+        gb->ppu.lcd_off_color = get_host_color(gb, r, g, b, 0xFFFF, CGB_LCD_OFF_INDEX);
+    } else {
+        const uint8_t *rgb    = dmg_palettes[gb->dmg_palette][DMG_WHITE];
+        gb->ppu.lcd_off_color = get_host_color(gb, rgb[0], rgb[1], rgb[2], RGB_TO_BGR555(rgb), DMG_WHITE);
+    }
+}
+
+void ppu_invalidate_tiles(gb_t *gb) {
+    memset(gb->ppu.tile_cache.is_dirty, 1, (MMU_VRAM_SIZE(gb) / VRAM_BANK_SIZE) * TILE_CACHE_TILES_PER_BANK);
+}
+
 void ppu_reset(gb_t *gb) {
     memset(&gb->ppu, 0, sizeof(gb->ppu));
-    gb->ppu.wly               = -1;
-    gb->ppu.pending_stat_mode = -1;
+    gb->ppu.wly                = -1;
+    gb->ppu.pending_stat_mode  = -1;
+    gb->ppu.pixel_size         = gbmulator_get_pixel_size(gb->base->opts.pixel_format);
+    gb->ppu.is_frame_skipped   = gb->base->opts.skip_rendering;
+
+    ppu_refresh_palettes(gb);
 }
 
 #define SERIALIZED_OAM_SCAN      \
@@ -845,22 +1331,23 @@ void ppu_reset(gb_t *gb) {
     X(oam_scan.objs_oam_pos)     \
     X(oam_scan.size)             \
     X(oam_scan.index)            \
-    X(oam_scan.step)
+    X(oam_scan.step)             \
+    X(oam_scan.is_cached)
 
-#define SERIALIZED_FIFO(fifo)  \
-    Y(fifo.pixels, color)      \
-    Y(fifo.pixels, palette)    \
-    Y(fifo.pixels, attributes) \
-    Y(fifo.pixels, oam_pos)    \
-    X(fifo.size)               \
-    X(fifo.head)               \
-    X(fifo.tail)
+#define SERIALIZED_FIFO(fifo) \
+    X(fifo.color_low)         \
+    X(fifo.color_high)        \
+    X(fifo.palette)           \
+    X(fifo.priority)          \
+    X(fifo.oam_pos)           \
+    X(fifo.size)
 
 #define SERIALIZED_FETCHER               \
-    Y(pixel_fetcher.pixels, color)       \
-    Y(pixel_fetcher.pixels, palette)     \
-    Y(pixel_fetcher.pixels, attributes)  \
-    Y(pixel_fetcher.pixels, oam_pos)     \
+    X(pixel_fetcher.tile_low)            \
+    X(pixel_fetcher.tile_high)           \
+    X(pixel_fetcher.palette)             \
+    X(pixel_fetcher.priority)            \
+    X(pixel_fetcher.oam_pos)             \
     X(pixel_fetcher.mode)                \
     X(pixel_fetcher.old_mode)            \
     X(pixel_fetcher.step)                \
@@ -882,6 +1369,10 @@ void ppu_reset(gb_t *gb) {
     X(win_actually_enabled)      \
     X(is_last_vblank_line)       \
     X(stat_irq_line)             \
+    X(is_scanline_line)          \
+    X(is_line_rendered)          \
+    X(drawing_end_cycles)        \
+    X(raster_effect_frames)      \
     SERIALIZED_OAM_SCAN          \
     SERIALIZED_FIFO(bg_win_fifo) \
     SERIALIZED_FIFO(obj_fifo)    \
@@ -4,6 +4,7 @@
 #include "mmu.h"
 #include "cpu.h"
 #include "serialize.h"
+#include "../frame_buffers.h"
 
 #define PPU_STAT_GET_MODE(gb)      ((gb)->mmu.io_registers[IO_STAT] & 0x03)
 #define PPU_STAT_IS_MODE(gb, mode) (PPU_STAT_GET_MODE(gb) == (mode))
@@ -15,6 +16,8 @@
 #define IS_VBLANK_IRQ_STAT_ENABLED(gb) (CHECK_BIT((gb)->mmu.io_registers[IO_STAT], 4))
 #define IS_HBLANK_IRQ_STAT_ENABLED(gb) (CHECK_BIT((gb)->mmu.io_registers[IO_STAT], 3))
 
+#define PPU_PIXELS_SIZE(gb) (GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT * (gb)->ppu.pixel_size)
+
 #define UPDATE_STAT_LY_LYC_BIT(gb) CHANGE_BIT((gb)->mmu.io_registers[IO_STAT], 2, (gb)->mmu.io_registers[IO_LY] == (gb)->mmu.io_registers[IO_LYC])
 
 typedef enum {
@@ -25,18 +28,27 @@ typedef enum {
 } gb_ppu_mode_t;
 
 typedef struct {
-    uint8_t  color;
-    uint16_t palette;    // the address of the palette in DMG mode, the palette id in CGB mode (and CGB compatibility mode)
-    uint8_t  attributes; // obj attributes or of bg/win attributes (only in CGB mode) depending if pixel is from obj or bg/win
-    uint8_t  oam_pos;    // position of the obj in the oam memory for oam priority (only if this is an obj pixel and in CGB mode)
+    uint8_t color;
+    uint8_t palette;  // the palette id (0 or 1 for DMG objs, always 0 for DMG bg/win)
+    uint8_t priority; // bit 7 of the obj attributes or of the bg/win attributes (only in CGB mode)
+    uint8_t oam_pos;  // position of the obj in the oam memory for oam priority (only if this is an obj pixel and in CGB mode)
 } gb_pixel_t;
 
 #define PIXEL_FIFO_SIZE 8
+
+/**
+ * Pixel FIFO made of shift registers like the hardware: each plane holds one bit of every pixel, the pixel at the head
+ * of the FIFO in bit 7 and the next ones in the lower bits (the planes are 8 bits wide as the FIFOs never hold more
+ * than PIXEL_FIFO_SIZE pixels). Popping a pixel shifts every plane left and the bits past `size` are always 0 so that
+ * pixels are pushed by OR-ing them in.
+ */
 typedef struct {
-    gb_pixel_t pixels[PIXEL_FIFO_SIZE];
-    uint8_t    size;
-    uint8_t    head;
-    uint8_t    tail;
+    uint8_t  color_low;  // low bitplane of the color ids
+    uint8_t  color_high; // high bitplane of the color ids
+    uint8_t  palette[3]; // bitplanes of the palette ids
+    uint8_t  priority;   // priority bits (see gb_pixel_t)
+    uint64_t oam_pos;    // not a plane: 1 byte per pixel (the head in the most significant byte), see gb_pixel_t
+    uint8_t  size;
 } gb_pixel_fifo_t;
 
 typedef enum {
@@ -60,6 +72,41 @@ typedef struct {
     // the order of the struct members is important!
 } gb_obj_t;
 
+#define TILE_CACHE_TILES_PER_BANK 384 // tile data blocks 0, 1 and 2 (0x8000-0x97FF)
+#define TILE_CACHE_ROWS_PER_TILE  16  // 8 rows, each decoded once as is and once X-flipped
+
+/**
+ * Decoded tile data shared by the pixel FIFO fetcher and the scanline renderer. A decoded row holds its low bitplane in
+ * its low byte and its high bitplane in its high byte, with the leftmost pixel in bit 7 (the X-flipped rows are stored
+ * bit reversed). A tile is decoded the first time it is fetched after a write to its data in VRAM (by the cpu or a
+ * GDMA/HDMA).
+ */
+typedef struct {
+    uint16_t *rows;     // TILE_CACHE_ROWS_PER_TILE rows per tile, tiles of VRAM bank 1 after those of VRAM bank 0 (allocated in gb->arena)
+    uint8_t  *is_dirty; // one per tile (allocated in gb->arena)
+
+#ifdef GB_PROFILE
+    // profiling counters: hits and misses are counted for each tile row fetch (a fetch of one bitplane)
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t invalidations;
+#endif
+} gb_tile_cache_t;
+
+#define OAM_SCAN_MAX_OBJS 10
+
+/**
+ * Result of the OAM scan of every line, built at once from the OAM memory and the obj height (LCDC bit 2) the first time
+ * an OAM scan ends after one of them changed. An OAM scan uses it instead of reading the OAM memory as long as neither
+ * change while it is in progress (see ppu_invalidate_obj_lines()).
+ */
+typedef struct {
+    gb_obj_t objs[GB_SCREEN_HEIGHT][OAM_SCAN_MAX_OBJS];    // sorted like gb_ppu_t.oam_scan.objs
+    uint8_t  objs_oam_pos[GB_SCREEN_HEIGHT][OAM_SCAN_MAX_OBJS];
+    uint8_t  sizes[GB_SCREEN_HEIGHT];
+    uint8_t  is_dirty;
+} gb_obj_lines_t;
+
 typedef struct {
     uint8_t  mode;              // actual mode of the ppu (the mode reflected in the STAT io register is not always true)
     int8_t   pending_stat_mode; // when ppu changes mode, it has a 1 cycle delay before being seen in the STAT register (this is -1 if no pending stat mode)
@@ -74,19 +121,34 @@ typedef struct {
     uint8_t  is_last_vblank_line;
     uint8_t  stat_irq_line;
 
+    // scanline renderer (gbmulator_options_t.scanline_renderer)
+    uint8_t  is_scanline_line;     // the current line is rendered in one pass instead of through the pixel FIFO
+    uint8_t  is_line_rendered;     // the scanline renderer already rendered the current line
+    uint16_t drawing_end_cycles;   // value of `cycles` at which the DRAWING mode of a scanline rendered line ends
+    uint8_t  raster_effect_frames; // the pixel FIFO is used until this reaches 0 (decremented every frame)
+
+    uint8_t is_frame_skipped; // gbmulator_options_t.skip_rendering latched at the start of the current frame
+
     struct {
-        gb_obj_t objs[10];         // this is ordered on the x coord of the gb_obj_t, popping an element is just increasing the index
-        uint8_t  objs_oam_pos[10]; // objs_oam_pos[i] is objs[i]'s pos in the oam memory (used in CGB mode for OAM priority)
+        gb_obj_t objs[OAM_SCAN_MAX_OBJS];         // this is ordered on the x coord of the gb_obj_t, popping an element is just increasing the index
+        uint8_t  objs_oam_pos[OAM_SCAN_MAX_OBJS]; // objs_oam_pos[i] is objs[i]'s pos in the oam memory (used in CGB mode for OAM priority)
         uint8_t  size;
         uint8_t  index; // used in oam mode to iterate over the oam memory, in drawing mode this is the first element of the objs array
         uint8_t  step;
+        uint8_t  is_cached; // the objs are taken from obj_lines at the end of the scan instead of being read at each step
     } oam_scan;
 
     gb_pixel_fifo_t bg_win_fifo;
     gb_pixel_fifo_t obj_fifo;
 
     struct {
-        gb_pixel_t              pixels[8];
+        // fetched row (the leftmost pixel in bit 7 of the bitplanes) and its attributes
+        uint8_t tile_low;
+        uint8_t tile_high;
+        uint8_t palette;
+        uint8_t priority;
+        uint8_t oam_pos;
+
         gb_pixel_fetcher_mode_t mode;
         gb_pixel_fetcher_mode_t old_mode; // mode that the FETCH_OBJ has replaced
         gb_pixel_fetcher_step_t step;
@@ -97,7 +159,16 @@ typedef struct {
         uint8_t x; // x position of the fetcher on the scanline
     } pixel_fetcher;
 
-    uint8_t pixels[GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT * 4];
+    uint8_t *pixels;     // back buffer of `frames`: PPU_PIXELS_SIZE(gb) bytes rendered by the ppu
+    uint8_t  pixel_size; // size of a pixel in gb->base->opts.pixel_format
+
+    // colors of the bg/win (0) and obj (1) palettes, already in the output pixel format (kept up to date by
+    // ppu_refresh_palette() on each palette write)
+    uint32_t host_colors[2][8][4];
+    uint32_t lcd_off_color;
+
+    gb_tile_cache_t tile_cache;
+    gb_obj_lines_t *obj_lines; // allocated in gb->arena
 } gb_ppu_t;
 
 void ppu_enable_lcd(gb_t *gb);
@@ -106,8 +177,54 @@ void ppu_disable_lcd(gb_t *gb);
 
 void ppu_update_stat_irq_line(gb_t *gb);
 
+/**
+ * Invalidates the decoded tile containing the VRAM byte at `vram_offset` (offset inside `gb->mmu.vram`, all banks
+ * included). Must be called after each write to VRAM.
+ */
+void ppu_invalidate_tile(gb_t *gb, uint16_t vram_offset);
+
+/**
+ * Invalidates every decoded tile. Must be called after VRAM has been overwritten as a whole (savestate, ...).
+ */
+void ppu_invalidate_tiles(gb_t *gb);
+
+/**
+ * Invalidates the per-line OAM scan results. Must be called before each write to the OAM memory (by the cpu or an OAM
+ * DMA) and to the obj height (LCDC bit 2), or after the OAM memory has been overwritten as a whole (savestate, ...).
+ */
+void ppu_invalidate_obj_lines(gb_t *gb);
+
+/**
+ * Recomputes the output colors of the bg/win (`is_obj` == 0) or obj (`is_obj` == 1) palette `palette`. Must be called
+ * after each write to a register or a CRAM entry of that palette.
+ */
+void ppu_refresh_palette(gb_t *gb, uint8_t is_obj, uint8_t palette);
+
+/**
+ * Recomputes the output colors of every palette. Must be called after the palettes have been overwritten as a whole
+ * or when the palette option or the CGB compatibility mode changes.
+ */
+void ppu_refresh_palettes(gb_t *gb);
+
+/**
+ * Must be called before writing a new value to a register read during the DRAWING mode (LCDC, SCX, SCY, WX, WY, BGP,
+ * OBP0, OBP1). A write during the DRAWING mode is a raster effect that the scanline renderer can't reproduce so it
+ * renders the current line immediately and leaves the next frames to the pixel FIFO.
+ */
+void ppu_on_raster_register_write(gb_t *gb);
+
+/**
+ * Steps the ppu for 4 cycles. The mode is tested at each dot: it is used in DMG mode, use the one selected in gb_init()
+ * (`gb->funcs.ppu_step`).
+ */
 void ppu_step(gb_t *gb);
 
+/**
+ * Variant of ppu_step() specialised at compile time for CGB mode, where testing the mode at each dot is measurably
+ * slower.
+ */
+void ppu_step_cgb(gb_t *gb);
+
 void ppu_reset(gb_t *gb);
 
 SERIALIZE_FUNCTION_DECLS(ppu);
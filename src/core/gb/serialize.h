@@ -64,7 +64,7 @@
         offset += sizeof(tmp->array[i].member);                                      \
     }
 
-// serialization macros for the special cases of the mmu:
+// serialization macros for the special cases of the mmu (member is a pointer to a buffer allocated outside of the struct):
 
 #define SERIALIZED_LENGTH_COND_LITERAL(member, cond, size_literal_true, size_literal_else) \
     length += cond ? size_literal_true : size_literal_else
@@ -72,14 +72,14 @@
 #define SERIALIZE_COND_LITERAL(member, cond, size_literal_true, size_literal_else) \
     do {                                                                           \
         size_t sz = cond ? size_literal_true : size_literal_else;                  \
-        memcpy(buf + offset, &(tmp->member), sz);                                  \
+        memcpy(buf + offset, tmp->member, sz);                                     \
         offset += sz;                                                              \
     } while (0)
 
 #define UNSERIALIZE_COND_LITERAL(member, cond, size_literal_true, size_literal_else) \
     do {                                                                             \
         size_t sz = cond ? size_literal_true : size_literal_else;                    \
-        memcpy(&(tmp->member), buf + offset, sz);                                    \
+        memcpy(tmp->member, buf + offset, sz);                                       \
         offset += sz;                                                                \
     } while (0)
 
@@ -89,14 +89,14 @@
 #define SERIALIZE_FROM_MEMBER(member, size_member, multiplier) \
     do {                                                       \
         size_t sz = tmp->size_member * (multiplier);           \
-        memcpy(buf + offset, &(tmp->member), sz);              \
+        memcpy(buf + offset, tmp->member, sz);                 \
         offset += sz;                                          \
     } while (0)
 
 #define UNSERIALIZE_FROM_MEMBER(member, size_member, multiplier) \
     do {                                                         \
         size_t sz = tmp->size_member * (multiplier);             \
-        memcpy(&(tmp->member), buf + offset, sz);                \
+        memcpy(tmp->member, buf + offset, sz);                   \
         offset += sz;                                            \
     } while (0)
 
@@ -326,24 +326,28 @@ static uint16_t io_regs_read(gba_t *gba, uint16_t address) {
     // Timer Registers
     case IO_TM0CNT_L:
         LOG_DEBUG("IO_TM0CNT_L\n");
+        gba_tmr_sync(gba, 0);
         break;
     case IO_TM0CNT_H:
         LOG_DEBUG("IO_TM0CNT_H\n");
         break;
     case IO_TM1CNT_L:
         LOG_DEBUG("IO_TM1CNT_L\n");
+        gba_tmr_sync(gba, 1);
         break;
     case IO_TM1CNT_H:
         LOG_DEBUG("IO_TM1CNT_H\n");
         break;
     case IO_TM2CNT_L:
         LOG_DEBUG("IO_TM2CNT_L\n");
+        gba_tmr_sync(gba, 2);
         break;
     case IO_TM2CNT_H:
         LOG_DEBUG("IO_TM2CNT_H\n");
         break;
     case IO_TM3CNT_L:
         LOG_DEBUG("IO_TM3CNT_L\n");
+        gba_tmr_sync(gba, 3);
         break;
     case IO_TM3CNT_H:
         LOG_DEBUG("IO_TM3CNT_H\n");
@@ -804,6 +808,10 @@ static void io_regs_write(gba_t *gba, uint16_t address, uint16_t data) {
     }
 
     CHANGE_BITS(gba->bus.io[address], mask, data);
+
+    // the dma channels can only start or be cancelled when their control register is written
+    if (address == IO_DMA0CNT_H || address == IO_DMA1CNT_H || address == IO_DMA2CNT_H || address == IO_DMA3CNT_H)
+        gba_dma_check_requests(gba);
 }
 
 static uint32_t unused_read(gba_t *gba, uint8_t mode, uint32_t address) {
@@ -919,6 +927,11 @@ static void ewram_write(gba_t *gba, uint8_t mode, uint32_t address, uint32_t dat
     gba_bus_t *bus  = &gba->bus;
     uint8_t    size = ((mode >> 2) & 0x03) + 1;
 
+#ifdef GBA_JIT
+    if (gba->jit.ewram_pages[((address - BUS_EWRAM) % (BUS_EWRAM_UNUSED - BUS_EWRAM)) >> GBA_JIT_PAGE_SHIFT])
+        gba_jit_flush(gba);
+#endif
+
     switch (size) {
     case 1:
         bus->ewram[(address - BUS_EWRAM) % (BUS_EWRAM_UNUSED - BUS_EWRAM)] = data;
@@ -936,6 +949,11 @@ static void iwram_write(gba_t *gba, uint8_t mode, uint32_t address, uint32_t dat
     gba_bus_t *bus  = &gba->bus;
     uint8_t    size = ((mode >> 2) & 0x03) + 1;
 
+#ifdef GBA_JIT
+    if (gba->jit.iwram_pages[((address - BUS_IWRAM) % (BUS_IWRAM_UNUSED - BUS_IWRAM)) >> GBA_JIT_PAGE_SHIFT])
+        gba_jit_flush(gba);
+#endif
+
     switch (size) {
     case 1:
         bus->iwram[(address - BUS_IWRAM) % (BUS_IWRAM_UNUSED - BUS_IWRAM)] = data;
@@ -1,17 +1,7 @@
 #include <stdlib.h>
 
 #include "gba_priv.h"
-
-#define PIPELINE_FETCHING 0
-#define PIPELINE_DECODING 1
-
-#define CPSR_N (1 << 31) // Negative or less than
-#define CPSR_Z (1 << 30) // Zero
-#define CPSR_C (1 << 29) // Carry or borrow or extend
-#define CPSR_V (1 << 28) // Overflow
-#define CPSR_I (1 << 7)  // IRQ disable
-#define CPSR_F (1 << 6)  // FIQ disable
-#define CPSR_T (1 << 5)  // State bit
+#include "cpu_priv.h"
 
 #define CPSR_MODE_USR 0b10000 // User (usr): The normal ARM program execution state
 #define CPSR_MODE_FIQ 0b10001 // FIQ (fiq): Designed to support a data transfer or channel process
@@ -153,9 +143,7 @@ static uint8_t regs_mode_hashes[] = {
 typedef bool (*handler_t)(gba_t *gba, uint32_t instr);
 handler_t handlers[];
 
-// using double lookup tables to reduce impact on host CPU cache
-uint8_t arm_handlers[1 << 12];
-uint8_t thumb_handlers[1 << 8];
+#define HANDLER_FUNC_PTR_GENERATOR(name) name,
 
 static inline void set_flags_nz_32(gba_cpu_t *cpu, uint32_t res) {
     CPSR_CHANGE_FLAG(cpu, CPSR_N, res >> 31);
@@ -301,9 +289,10 @@ static inline void service_interrupt(gba_t *gba, uint32_t vector) {
     bank_registers(&gba->cpu, CPSR_GET_MODE(&gba->cpu), cpsr_mode);
     CPSR_SET_MODE(&gba->cpu, cpsr_mode);
 
+    // the IRQ handlers return with SUBS PC, LR, #4: in THUMB state LR must also be the next instruction + 4
     uint8_t next_instr_offset = 4;
     if (CPSR_CHECK_FLAG(&gba->cpu, CPSR_T))
-        next_instr_offset = 2;
+        next_instr_offset = vector == VECTOR_IRQ ? 0 : 2;
 
     CPSR_CHANGE_FLAG(&gba->cpu, CPSR_T, 0);
     CPSR_CHANGE_FLAG(&gba->cpu, CPSR_I, 1);
@@ -1704,42 +1693,7 @@ static bool swi_handler(gba_t *gba, uint32_t instr) {
 }
 
 static inline bool verif_cond(gba_cpu_t *cpu, cond_t cond) {
-    switch (cond) {
-    case COND_EQ:
-        return CPSR_CHECK_FLAG(cpu, CPSR_Z);
-    case COND_NE:
-        return !CPSR_CHECK_FLAG(cpu, CPSR_Z);
-    case COND_CS:
-        return CPSR_CHECK_FLAG(cpu, CPSR_C);
-    case COND_CC:
-        return !CPSR_CHECK_FLAG(cpu, CPSR_C);
-    case COND_MI:
-        return CPSR_CHECK_FLAG(cpu, CPSR_N);
-    case COND_PL:
-        return !CPSR_CHECK_FLAG(cpu, CPSR_N);
-    case COND_VS:
-        return CPSR_CHECK_FLAG(cpu, CPSR_V);
-    case COND_VC:
-        return !CPSR_CHECK_FLAG(cpu, CPSR_V);
-    case COND_HI:
-        return CPSR_CHECK_FLAG(cpu, CPSR_C) && !CPSR_CHECK_FLAG(cpu, CPSR_Z);
-    case COND_LS:
-        return !CPSR_CHECK_FLAG(cpu, CPSR_C) || CPSR_CHECK_FLAG(cpu, CPSR_Z);
-    case COND_GE:
-        return !!CPSR_CHECK_FLAG(cpu, CPSR_N) == !!CPSR_CHECK_FLAG(cpu, CPSR_V);
-    case COND_LT:
-        return !!CPSR_CHECK_FLAG(cpu, CPSR_N) != !!CPSR_CHECK_FLAG(cpu, CPSR_V);
-    case COND_GT:
-        return !(CPSR_CHECK_FLAG(cpu, CPSR_Z) || (!!CPSR_CHECK_FLAG(cpu, CPSR_N) != !!CPSR_CHECK_FLAG(cpu, CPSR_V)));
-    case COND_LE:
-        return CPSR_CHECK_FLAG(cpu, CPSR_Z) || (!!CPSR_CHECK_FLAG(cpu, CPSR_N) != !!CPSR_CHECK_FLAG(cpu, CPSR_V));
-    case COND_AL:
-    case COND_NV:
-        return true;
-    default:
-        todo("invalid condition code: 0x%02X (should never happen)", cond);
-        return false;
-    }
+    return cond_passes[cond][cpu->cpsr >> 28];
 }
 
 void gba_cpu_step(gba_t *gba) {
@@ -2540,202 +2494,10 @@ static bool thumb_bl_handler(gba_t *gba, uint32_t instr) {
     }
 }
 
-#define FOREACH_HANDLER(X)           \
-    X(not_implemented_handler)       \
-    X(and_handler)                   \
-    X(msr_handler)                   \
-    X(mrs_handler)                   \
-    X(eor_handler)                   \
-    X(sub_handler)                   \
-    X(rsb_handler)                   \
-    X(add_handler)                   \
-    X(adc_handler)                   \
-    X(sbc_handler)                   \
-    X(rsc_handler)                   \
-    X(tst_handler)                   \
-    X(teq_handler)                   \
-    X(cmp_handler)                   \
-    X(cmn_handler)                   \
-    X(orr_handler)                   \
-    X(bic_handler)                   \
-    X(mvn_handler)                   \
-    X(mov_handler)                   \
-    X(bx_handler)                    \
-    X(mul_handler)                   \
-    X(mla_handler)                   \
-    X(mull_handler)                  \
-    X(mlal_handler)                  \
-    X(swp_handler)                   \
-    X(strh_reg_handler)              \
-    X(strh_imm_handler)              \
-    X(ldrh_reg_handler)              \
-    X(ldrh_imm_handler)              \
-    X(str_handler)                   \
-    X(ldr_handler)                   \
-    X(stm_handler)                   \
-    X(ldm_handler)                   \
-    X(b_handler)                     \
-    X(bl_handler)                    \
-    X(swi_handler)                   \
-    X(thumb_lsl_handler)             \
-    X(thumb_lsr_handler)             \
-    X(thumb_asr_handler)             \
-    X(thumb_add_handler)             \
-    X(thumb_sub_handler)             \
-    X(thumb_mov_imm_handler)         \
-    X(thumb_cmp_imm_handler)         \
-    X(thumb_add_imm_handler)         \
-    X(thumb_sub_imm_handler)         \
-    X(thumb_alu_ops_handler)         \
-    X(thumb_add_hi_reg_handler)      \
-    X(thumb_cmp_hi_reg_handler)      \
-    X(thumb_mov_hi_reg_handler)      \
-    X(thumb_bx_handler)              \
-    X(thumb_pc_relative_ldr_handler) \
-    X(thumb_str_reg_handler)         \
-    X(thumb_ldr_reg_handler)         \
-    X(thumb_strh_reg_handler)        \
-    X(thumb_ldrh_reg_handler)        \
-    X(thumb_ldrh_imm_handler)        \
-    X(thumb_strh_imm_handler)        \
-    X(thumb_strh_handler)            \
-    X(thumb_ldrh_handler)            \
-    X(thumb_str_sp_handler)          \
-    X(thumb_ldr_sp_handler)          \
-    X(thumb_add_addr_handler)        \
-    X(thumb_add_sp_handler)          \
-    X(thumb_push_handler)            \
-    X(thumb_pop_handler)             \
-    X(thumb_stm_handler)             \
-    X(thumb_ldm_handler)             \
-    X(thumb_swi_handler)             \
-    X(thumb_b_cond_handler)          \
-    X(thumb_b_handler)               \
-    X(thumb_bl_handler)
-#define HANDLER_ID(name)                 name##_id
-#define HANDLER_ID_GENERATOR(name)       HANDLER_ID(name),
-#define HANDLER_FUNC_PTR_GENERATOR(name) name,
-
-typedef enum {
-    FOREACH_HANDLER(HANDLER_ID_GENERATOR)
-} handler_id_t;
-
 handler_t handlers[] = {
     FOREACH_HANDLER(HANDLER_FUNC_PTR_GENERATOR)
 };
 
-typedef struct {
-    const char match_string[33]; // '1': bit MUST be set, '0': bit MUST be reset, '*': bit can be set OR reset
-    uint8_t    handler_id;
-} decoder_rule_t;
-
-// Decoder rules definition order is important: they are matched in the order they are defined in their array
-decoder_rule_t arm_decoder_rules[] = {
-    { "____00010010____________0001____", HANDLER_ID(bx_handler)       }, // Branch and exchange
-    { "____0000000*____________1001____", HANDLER_ID(mul_handler)      }, // Multiply
-    { "____0000001*____________1001____", HANDLER_ID(mla_handler)      }, // Multiply
-    { "____00001*0*____________1001____", HANDLER_ID(mull_handler)     }, // Multiply Long
-    { "____00001*1*____________1001____", HANDLER_ID(mlal_handler)     }, // Multiply Long
-    { "____00010*00____________0000____", HANDLER_ID(mrs_handler)      }, // PSR Transfer
-    { "____00010*00____________1001____", HANDLER_ID(swp_handler)      }, // Single Data Swap
-    { "____000**0*0____________1**1____", HANDLER_ID(strh_reg_handler) }, // Halfword Data Transfer
-    { "____000**1*0____________1**1____", HANDLER_ID(strh_imm_handler) }, // Halfword Data Transfer
-    { "____000**0*1____________1**1____", HANDLER_ID(ldrh_reg_handler) }, // Halfword Data Transfer
-    { "____000**1*1____________1**1____", HANDLER_ID(ldrh_imm_handler) }, // Halfword Data Transfer
-    { "____00*0000*____________****____", HANDLER_ID(and_handler)      }, // Data processing
-    { "____00*10*10____________****____", HANDLER_ID(msr_handler)      }, // PSR Transfer
-    { "____00*0001*____________****____", HANDLER_ID(eor_handler)      }, // Data processing
-    { "____00*0010*____________****____", HANDLER_ID(sub_handler)      }, // Data processing
-    { "____00*0011*____________****____", HANDLER_ID(rsb_handler)      }, // Data processing
-    { "____00*0100*____________****____", HANDLER_ID(add_handler)      }, // Data processing
-    { "____00*0101*____________****____", HANDLER_ID(adc_handler)      }, // Data processing
-    { "____00*0110*____________****____", HANDLER_ID(sbc_handler)      }, // Data processing
-    { "____00*0111*____________****____", HANDLER_ID(rsc_handler)      }, // Data processing
-    { "____00*10001____________****____", HANDLER_ID(tst_handler)      }, // Data processing
-    { "____00*10011____________****____", HANDLER_ID(teq_handler)      }, // Data processing
-    { "____00*10101____________****____", HANDLER_ID(cmp_handler)      }, // Data processing
-    { "____00*10111____________****____", HANDLER_ID(cmn_handler)      }, // Data processing
-    { "____00*1100*____________****____", HANDLER_ID(orr_handler)      }, // Data processing
-    { "____00*1101*____________****____", HANDLER_ID(mov_handler)      }, // Data processing
-    { "____00*1110*____________****____", HANDLER_ID(bic_handler)      }, // Data processing
-    { "____00*1111*____________****____", HANDLER_ID(mvn_handler)      }, // Data processing
-    { "____01*****0____________****____", HANDLER_ID(str_handler)      }, // Single Data Transfer
-    { "____01*****1____________****____", HANDLER_ID(ldr_handler)      }, // Single Data Transfer
-    { "____100****0____________****____", HANDLER_ID(stm_handler)      }, // Block Data Transfer
-    { "____100****1____________****____", HANDLER_ID(ldm_handler)      }, // Block Data Transfer
-    { "____1010****____________****____", HANDLER_ID(b_handler)        }, // Branch
-    { "____1011****____________****____", HANDLER_ID(bl_handler)       }, // Branch
-    { "____1111****____________****____", HANDLER_ID(swi_handler)      }, // Software Interrupt
-};
-
-decoder_rule_t thumb_decoder_rules[] = {
-    { "00000***________", HANDLER_ID(thumb_lsl_handler)             }, // Move shifted register
-    { "00001***________", HANDLER_ID(thumb_lsr_handler)             }, // Move shifted register
-    { "00010***________", HANDLER_ID(thumb_asr_handler)             }, // Move shifted register
-    { "00011*0*________", HANDLER_ID(thumb_add_handler)             }, // Add/substract
-    { "00011*1*________", HANDLER_ID(thumb_sub_handler)             }, // Add/substract
-    { "00100***________", HANDLER_ID(thumb_mov_imm_handler)         }, // Move/compare/add/substract immediate
-    { "00101***________", HANDLER_ID(thumb_cmp_imm_handler)         }, // Move/compare/add/substract immediate
-    { "00110***________", HANDLER_ID(thumb_add_imm_handler)         }, // Move/compare/add/substract immediate
-    { "00111***________", HANDLER_ID(thumb_sub_imm_handler)         }, // Move/compare/add/substract immediate
-    { "01000100________", HANDLER_ID(thumb_add_hi_reg_handler)      }, // Hi register operations/branch exchange
-    { "01000101________", HANDLER_ID(thumb_cmp_hi_reg_handler)      }, // Hi register operations/branch exchange
-    { "01000110________", HANDLER_ID(thumb_mov_hi_reg_handler)      }, // Hi register operations/branch exchange
-    { "01000111________", HANDLER_ID(thumb_bx_handler)              }, // Hi register operations/branch exchange
-    { "010000**________", HANDLER_ID(thumb_alu_ops_handler)         }, // ALU operations
-    { "01001***________", HANDLER_ID(thumb_pc_relative_ldr_handler) }, // PC-relative load
-    { "01010*0*________", HANDLER_ID(thumb_str_reg_handler)         }, // Load/store with register offset
-    { "01011*0*________", HANDLER_ID(thumb_ldr_reg_handler)         }, // Load/store with register offset
-    { "0101001*________", HANDLER_ID(thumb_strh_reg_handler)        }, // Load/store with sign-extended byte/halfword
-    { "0101**1*________", HANDLER_ID(thumb_ldrh_reg_handler)        }, // Load/store with sign-extended byte/halfword
-    { "011*0***________", HANDLER_ID(thumb_strh_imm_handler)        }, // Load/store with immediate offset
-    { "011*1***________", HANDLER_ID(thumb_ldrh_imm_handler)        }, // Load/store with immediate offset
-    { "10000***________", HANDLER_ID(thumb_strh_handler)            }, // Load/store halfword
-    { "10001***________", HANDLER_ID(thumb_ldrh_handler)            }, // Load/store halfword
-    { "10010***________", HANDLER_ID(thumb_str_sp_handler)          }, // SP-relative load/store
-    { "10011***________", HANDLER_ID(thumb_ldr_sp_handler)          }, // SP-relative load/store
-    { "1010****________", HANDLER_ID(thumb_add_addr_handler)        }, // Load address
-    { "10110000________", HANDLER_ID(thumb_add_sp_handler)          }, // Add offset to stack pointer
-    { "1011010*________", HANDLER_ID(thumb_push_handler)            }, // Push/pop registers
-    { "1011110*________", HANDLER_ID(thumb_pop_handler)             }, // Push/pop registers
-    { "11000***________", HANDLER_ID(thumb_stm_handler)             }, // Multiple load/store
-    { "11001***________", HANDLER_ID(thumb_ldm_handler)             }, // Multiple load/store
-    { "11011111________", HANDLER_ID(thumb_swi_handler)             }, // Software interrupt
-    { "1101****________", HANDLER_ID(thumb_b_cond_handler)          }, // Conditonal branch
-    { "11100***________", HANDLER_ID(thumb_b_handler)               }, // Unconditional branch
-    { "1111****________", HANDLER_ID(thumb_bl_handler)              }, // Long branch with link
-};
-
-uint8_t get_handler(uint32_t instr, decoder_rule_t *decoder_rules, size_t decoder_rules_size) {
-    size_t rule_size = strnlen(decoder_rules[0].match_string, sizeof(decoder_rules[0].match_string));
-
-    for (size_t i = 0; i < decoder_rules_size; i++) {
-        decoder_rule_t *rule = &decoder_rules[i];
-
-        bool match = true;
-        for (size_t j = 0; j < rule_size && match; j++) {
-            switch (rule->match_string[rule_size - j - 1]) {
-            case '*':
-                break;
-            case '_':
-                j += 3;
-                break;
-            case '0':
-                match = GET_BIT(instr, j) == 0;
-                break;
-            case '1':
-                match = GET_BIT(instr, j) == 1;
-                break;
-            }
-        }
-
-        if (match)
-            return rule->handler_id;
-    }
-
-    return HANDLER_ID(not_implemented_handler);
-}
-
 void gba_cpu_reset(gba_t *gba) {
     memset(&gba->cpu, 0, sizeof(gba->cpu));
 
@@ -2758,24 +2520,4 @@ void gba_cpu_reset(gba_t *gba) {
     // gba->cpu.spsr[regs_mode_hashes[CPSR_GET_MODE(&gba->cpu) & 0x0F]] = 0x00000010;
 
     flush_pipeline(gba);
-
-    // generate handlers only once when initializing the first cpu instance
-    static bool handlers_generated = false;
-    if (!handlers_generated) {
-        LOG_DEBUG("Generating ARM7TDMI cpu handlers\n");
-
-        for (size_t i = 0; i < sizeof(arm_handlers) / sizeof(*arm_handlers); i++) {
-            uint8_t  hi     = (i & 0xFF0) >> 4;
-            uint8_t  lo     = (i & 0x00F);
-            uint32_t instr  = (hi << 20) | (lo << 4);
-            arm_handlers[i] = get_handler(instr, arm_decoder_rules, sizeof(arm_decoder_rules) / sizeof(*arm_decoder_rules));
-        }
-
-        for (size_t i = 0; i < sizeof(thumb_handlers) / sizeof(*thumb_handlers); i++) {
-            uint32_t instr    = i << 8;
-            thumb_handlers[i] = get_handler(instr, thumb_decoder_rules, sizeof(thumb_decoder_rules) / sizeof(*thumb_decoder_rules));
-        }
-
-        handlers_generated = true;
-    }
 }
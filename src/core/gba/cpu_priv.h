@@ -0,0 +1,98 @@
+#pragma once
+
+#include "gba.h"
+
+// The definitions of the cpu that the recompiler (jit.c) shares with the interpreter (cpu.c)
+
+#define PIPELINE_FETCHING 0
+#define PIPELINE_DECODING 1
+
+#define CPSR_N (1 << 31) // Negative or less than
+#define CPSR_Z (1 << 30) // Zero
+#define CPSR_C (1 << 29) // Carry or borrow or extend
+#define CPSR_V (1 << 28) // Overflow
+#define CPSR_I (1 << 7)  // IRQ disable
+#define CPSR_F (1 << 6)  // FIQ disable
+#define CPSR_T (1 << 5)  // State bit
+
+#define FOREACH_HANDLER(X)           \
+    X(not_implemented_handler)       \
+    X(and_handler)                   \
+    X(msr_handler)                   \
+    X(mrs_handler)                   \
+    X(eor_handler)                   \
+    X(sub_handler)                   \
+    X(rsb_handler)                   \
+    X(add_handler)                   \
+    X(adc_handler)                   \
+    X(sbc_handler)                   \
+    X(rsc_handler)                   \
+    X(tst_handler)                   \
+    X(teq_handler)                   \
+    X(cmp_handler)                   \
+    X(cmn_handler)                   \
+    X(orr_handler)                   \
+    X(bic_handler)                   \
+    X(mvn_handler)                   \
+    X(mov_handler)                   \
+    X(bx_handler)                    \
+    X(mul_handler)                   \
+    X(mla_handler)                   \
+    X(mull_handler)                  \
+    X(mlal_handler)                  \
+    X(swp_handler)                   \
+    X(strh_reg_handler)              \
+    X(strh_imm_handler)              \
+    X(ldrh_reg_handler)              \
+    X(ldrh_imm_handler)              \
+    X(str_handler)                   \
+    X(ldr_handler)                   \
+    X(stm_handler)                   \
+    X(ldm_handler)                   \
+    X(b_handler)                     \
+    X(bl_handler)                    \
+    X(swi_handler)                   \
+    X(thumb_lsl_handler)             \
+    X(thumb_lsr_handler)             \
+    X(thumb_asr_handler)             \
+    X(thumb_add_handler)             \
+    X(thumb_sub_handler)             \
+    X(thumb_mov_imm_handler)         \
+    X(thumb_cmp_imm_handler)         \
+    X(thumb_add_imm_handler)         \
+    X(thumb_sub_imm_handler)         \
+    X(thumb_alu_ops_handler)         \
+    X(thumb_add_hi_reg_handler)      \
+    X(thumb_cmp_hi_reg_handler)      \
+    X(thumb_mov_hi_reg_handler)      \
+    X(thumb_bx_handler)              \
+    X(thumb_pc_relative_ldr_handler) \
+    X(thumb_str_reg_handler)         \
+    X(thumb_ldr_reg_handler)         \
+    X(thumb_strh_reg_handler)        \
+    X(thumb_ldrh_reg_handler)        \
+    X(thumb_ldrh_imm_handler)        \
+    X(thumb_strh_imm_handler)        \
+    X(thumb_strh_handler)            \
+    X(thumb_ldrh_handler)            \
+    X(thumb_str_sp_handler)          \
+    X(thumb_ldr_sp_handler)          \
+    X(thumb_add_addr_handler)        \
+    X(thumb_add_sp_handler)          \
+    X(thumb_push_handler)            \
+    X(thumb_pop_handler)             \
+    X(thumb_stm_handler)             \
+    X(thumb_ldm_handler)             \
+    X(thumb_swi_handler)             \
+    X(thumb_b_cond_handler)          \
+    X(thumb_b_handler)               \
+    X(thumb_bl_handler)
+#define HANDLER_ID(name)           name##_id
+#define HANDLER_ID_GENERATOR(name) HANDLER_ID(name),
+
+typedef enum {
+    FOREACH_HANDLER(HANDLER_ID_GENERATOR)
+} handler_id_t;
+
+// using double lookup tables to reduce impact on host CPU cache (they are generated by src/tables/gba/cpu_tables.c)
+#include "../../../build/tables/gba/cpu_tables.h"
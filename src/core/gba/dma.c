@@ -36,7 +36,7 @@ typedef enum {
     DMA_START_SPECIAL
 } dma_start_t;
 
-static inline void check_dma_requests(gba_t *gba) {
+void gba_dma_check_requests(gba_t *gba) {
     for (uint8_t i = 0; i < GBA_DMA_CHANNEL_COUNT; i++) {
         if (!IS_DMA_ENABLED(gba, i)) {
             // disable a DMA channel if it was previously enabled and has not started yet
@@ -151,7 +151,8 @@ static inline void check_dma_requests(gba_t *gba) {
 }
 
 void gba_dma_step(gba_t *gba) {
-    check_dma_requests(gba);
+    if (!gba->dma.active_channels && !gba->dma.pending_channels)
+        return;
 
     uint8_t channel_index = 0;
 
@@ -225,6 +226,20 @@ void gba_dma_step(gba_t *gba) {
     }
 }
 
+bool gba_dma_is_idle(gba_t *gba) {
+    if (gba->dma.active_channels)
+        return false;
+
+    switch (gba->ppu.period) {
+    case GBA_PPU_PERIOD_HBLANK:
+        return !(gba->dma.pending_channels & 0x0F);
+    case GBA_PPU_PERIOD_VBLANK:
+        return !(gba->dma.pending_channels & 0xF0);
+    default:
+        return true;
+    }
+}
+
 void gba_dma_reset(gba_t *gba) {
     memset(&gba->dma, 0, sizeof(gba->dma));
 }
@@ -23,6 +23,18 @@ typedef struct {
     uint32_t data_read_latch;
 } gba_dma_t;
 
+/**
+ * Starts the channels that have just been enabled (immediately or on their trigger) and cancels the channels that have
+ * just been disabled. Must be called after each write to a DMA control register.
+ */
+void gba_dma_check_requests(gba_t *gba);
+
 void gba_dma_step(gba_t *gba);
 
+/**
+ * Returns true if gba_dma_step() won't transfer anything until a channel is started (by a register write or a change
+ * of the ppu period).
+ */
+bool gba_dma_is_idle(gba_t *gba);
+
 void gba_dma_reset(gba_t *gba);
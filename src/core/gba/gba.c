@@ -9,10 +9,26 @@ static const char *makers[] = {
 };
 
 void gba_step(gba_t *gba) {
+#ifdef GBA_JIT
+    // the translated blocks run the cpu ahead: it then waits for the other components to catch up
+    if (gba->jit.cycles_ahead) {
+        // the latch is the cpu's one again at its last cycle, before the ppu's reads of this cycle
+        if (!--gba->jit.cycles_ahead)
+            gba->bus.read_data_latch = gba->jit.read_data_latch;
+    } else if (!gba_jit_run(gba))
+        gba_cpu_step(gba);
+#else
     gba_cpu_step(gba);
+#endif
     gba_ppu_step(gba);
-    gba_tmr_step(gba);
+
+    // the components with nothing to do at each cycle (scanline periods, timers) are only run at their events
+    if (gba->scheduler.now >= gba->scheduler.next)
+        gba_scheduler_run(gba);
+
     gba_dma_step(gba);
+
+    gba->scheduler.now++;
 }
 
 gba_t *gba_init(gbmulator_t *base) {
@@ -24,15 +40,23 @@ gba_t *gba_init(gbmulator_t *base) {
         return NULL;
     }
 
+    gba_scheduler_reset(gba);
     gba_cpu_reset(gba);
     gba_ppu_reset(gba);
     gba_tmr_reset(gba);
     gba_dma_reset(gba);
 
+#ifdef GBA_JIT
+    gba_jit_init(gba);
+#endif
+
     return gba;
 }
 
 void gba_quit(gba_t *gba) {
+#ifdef GBA_JIT
+    gba_jit_quit(gba);
+#endif
     free(gba);
 }
 
@@ -114,3 +138,7 @@ uint8_t *gba_get_rom(gba_t *gba, size_t *rom_size) {
     *rom_size = gba->bus.rom_size;
     return gba->bus.rom;
 }
+
+frame_buffers_t *gba_get_frame_buffers(gba_t *gba) {
+    return &gba->ppu.frames;
+}
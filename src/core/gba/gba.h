@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../core.h"
+#include "../frame_buffers.h"
 
 #define GBA_SCREEN_WIDTH  240
 #define GBA_SCREEN_HEIGHT 160
@@ -36,3 +37,5 @@ uint8_t *gba_get_savestate(gba_t *gba, size_t *length, bool is_compressed);
 bool gba_load_savestate(gba_t *gba, uint8_t *data, size_t length);
 
 uint8_t *gba_get_rom(gba_t *gba, size_t *rom_size);
+
+frame_buffers_t *gba_get_frame_buffers(gba_t *gba);
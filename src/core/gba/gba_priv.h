@@ -6,6 +6,8 @@
 #include "ppu.h"
 #include "tmr.h"
 #include "dma.h"
+#include "scheduler.h"
+#include "jit.h"
 
 #include "../core_priv.h"
 
@@ -19,4 +21,10 @@ struct gba_t {
     gba_ppu_t ppu;
     gba_dma_t dma;
     gba_tmr_t tmr;
+
+    gba_scheduler_t scheduler;
+
+#ifdef GBA_JIT
+    gba_jit_t jit;
+#endif
 };
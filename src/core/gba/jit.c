@@ -0,0 +1,1544 @@
+#ifdef GBA_JIT
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <sys/mman.h>
+
+#include "gba_priv.h"
+#include "cpu_priv.h"
+
+#ifndef __x86_64__
+#error "the GBA recompiler (GBA_JIT) only generates x86-64 code"
+#endif
+
+#define CODE_SIZE        (16 << 20) // executable buffer size
+#define CODE_BLOCK_MAX   (64 << 10) // upper bound of the code size of one block
+#define TABLE_SIZE       (1 << 16)
+#define MAX_BLOCKS       (1 << 16)
+#define BLOCK_MAX_INSTRS 64
+#define BLOCK_MAX_FIXUPS 512
+#define RUN_MAX_CYCLES   4096 // the cpu doesn't run further ahead of the other components
+
+#define HASH(key) ((((key) >> 1) ^ ((key) >> 17)) & (TABLE_SIZE - 1))
+
+#define OFFSET(field) ((int32_t) offsetof(gba_t, field))
+#define REG_OFFSET(r) (OFFSET(cpu.regs) + (r) * (int32_t) sizeof(uint32_t))
+
+struct gba_jit_block_t {
+    uint32_t key;       // address of the first instruction (bit 0 set in THUMB state)
+    uint32_t instrs[2]; // first two instructions: they must match the pipeline of the cpu to enter the block
+    uint8_t *code;      // NULL if the first instruction can't be translated
+};
+
+// host registers: rbx holds gba, rbp the cycle budget, r15d the CPSR and rax, rcx, rdx, r11 and r14 are scratch
+typedef enum {
+    RAX,
+    RCX,
+    RDX,
+    RBX,
+    RSP,
+    RBP,
+    RSI,
+    RDI,
+    R8,
+    R9,
+    R10,
+    R11,
+    R12,
+    R13,
+    R14,
+    R15
+} host_reg_t;
+
+#define CPSR_REG R15
+#define TMP_REG  R14 // scratch register kept across the memory accesses
+
+// host registers that can hold the most used guest registers of a block
+static const uint8_t allocatable_regs[] = { RSI, RDI, R8, R9, R10, R12, R13 };
+
+typedef enum {
+    CC_O,
+    CC_NO,
+    CC_B,
+    CC_AE,
+    CC_E,
+    CC_NE,
+    CC_BE,
+    CC_A,
+    CC_S,
+    CC_NS,
+    CC_P,
+    CC_NP,
+    CC_L,
+    CC_GE,
+    CC_LE,
+    CC_G,
+    CC_ALWAYS
+} host_cond_t;
+
+typedef enum {
+    ALU_ADD,
+    ALU_OR,
+    ALU_ADC,
+    ALU_SBB,
+    ALU_AND,
+    ALU_SUB,
+    ALU_XOR,
+    ALU_CMP
+} alu_t;
+
+typedef enum {
+    SHIFT_ROL,
+    SHIFT_ROR,
+    SHIFT_RCL,
+    SHIFT_RCR,
+    SHIFT_SHL,
+    SHIFT_SHR,
+    SHIFT_SAR = 7
+} shift_t;
+
+typedef struct {
+    gba_t   *gba;
+    uint8_t *p; // write position in the code buffer
+
+    bool     thumb;
+    uint32_t start;   // address of the first instruction of the block
+    uint32_t address; // address of the instruction being translated
+    uint8_t  index;   // index of the instruction being translated in the block
+    uint8_t  count;   // number of translated instructions
+    uint8_t  max;     // maximum number of instructions to translate
+    bool     ended;   // the last translated instruction is a branch
+    uint32_t cost;    // cycles paid at the entry of the block
+
+    bool     prev_bl_prefix; // the previous instruction is the first half of a THUMB BL
+    uint32_t bl_lr;          // the LR it set
+
+    int8_t   host[16]; // host register of each guest register (-1 if it stays in gba->cpu.regs)
+    uint16_t uses[16]; // number of accesses to each guest register
+    uint16_t written;  // guest registers written by the block
+    bool     writes_flags;
+
+    uint8_t *exits[BLOCK_MAX_INSTRS + 1]; // stub of the exit before each instruction
+    struct {
+        uint8_t *rel;   // rel32 of the jump to the exit
+        uint8_t  index; // index of the instruction before which it exits
+    } fixups[BLOCK_MAX_FIXUPS];
+    size_t fixup_count;
+} jit_compiler_t;
+
+// x86-64 encoding
+
+static inline void emit8(jit_compiler_t *c, uint8_t b) {
+    *c->p++ = b;
+}
+
+static inline void emit32(jit_compiler_t *c, uint32_t v) {
+    memcpy(c->p, &v, sizeof(v));
+    c->p += sizeof(v);
+}
+
+static inline void emit64(jit_compiler_t *c, uint64_t v) {
+    memcpy(c->p, &v, sizeof(v));
+    c->p += sizeof(v);
+}
+
+static inline void patch_rel32(uint8_t *rel, const uint8_t *target) {
+    int32_t offset = target - (rel + 4);
+    memcpy(rel, &offset, sizeof(offset));
+}
+
+// REX prefix (when needed) and opcode (the ones above 0xFF are 0x0F-prefixed)
+static void emit_op(jit_compiler_t *c, bool w, uint8_t reg, uint8_t index, uint8_t rm, uint16_t op) {
+    uint8_t rex = 0x40 | (w << 3) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (rm >> 3);
+    if (rex != 0x40)
+        emit8(c, rex);
+    if (op > 0xFF)
+        emit8(c, op >> 8);
+    emit8(c, op);
+}
+
+// op reg, rm (register operands)
+static void x_rr(jit_compiler_t *c, bool w, uint16_t op, uint8_t reg, uint8_t rm) {
+    emit_op(c, w, reg, 0, rm, op);
+    emit8(c, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+// op reg, [rbx + disp]
+static void x_rm(jit_compiler_t *c, bool w, uint16_t op, uint8_t reg, int32_t disp) {
+    emit_op(c, w, reg, 0, RBX, op);
+    emit8(c, 0x80 | ((reg & 7) << 3) | RBX);
+    emit32(c, disp);
+}
+
+// op reg, [rbx + index + disp]
+static void x_rmi(jit_compiler_t *c, bool w, uint16_t op, uint8_t reg, uint8_t index, int32_t disp) {
+    emit_op(c, w, reg, index, RBX, op);
+    emit8(c, 0x84 | ((reg & 7) << 3));
+    emit8(c, ((index & 7) << 3) | RBX);
+    emit32(c, disp);
+}
+
+static void emit_mov_ri(jit_compiler_t *c, uint8_t dst, uint32_t imm) {
+    if (dst >= R8)
+        emit8(c, 0x41);
+    emit8(c, 0xB8 + (dst & 7));
+    emit32(c, imm);
+}
+
+static void emit_mov_rr(jit_compiler_t *c, uint8_t dst, uint8_t src) {
+    if (dst != src)
+        x_rr(c, false, 0x89, src, dst);
+}
+
+static void emit_alu_rr(jit_compiler_t *c, alu_t op, uint8_t dst, uint8_t src) {
+    x_rr(c, false, (op << 3) | 1, src, dst);
+}
+
+static void emit_alu_ri(jit_compiler_t *c, alu_t op, uint8_t dst, uint32_t imm) {
+    x_rr(c, false, 0x81, op, dst);
+    emit32(c, imm);
+}
+
+static void emit_shift_ri(jit_compiler_t *c, shift_t op, uint8_t dst, uint8_t amount) {
+    x_rr(c, false, 0xC1, op, dst);
+    emit8(c, amount);
+}
+
+static void emit_test_rr(jit_compiler_t *c, uint8_t a, uint8_t b) {
+    x_rr(c, false, 0x85, b, a);
+}
+
+static void emit_bt(jit_compiler_t *c, uint8_t r, uint8_t bit) {
+    x_rr(c, false, 0x0FBA, 4, r);
+    emit8(c, bit);
+}
+
+static void emit_setcc(jit_compiler_t *c, host_cond_t cc, uint8_t r8) {
+    x_rr(c, false, 0x0F90 + cc, 0, r8);
+}
+
+static void emit_load(jit_compiler_t *c, uint8_t dst, int32_t disp) {
+    x_rm(c, false, 0x8B, dst, disp);
+}
+
+static void emit_store(jit_compiler_t *c, int32_t disp, uint8_t src) {
+    x_rm(c, false, 0x89, src, disp);
+}
+
+static void emit_store_imm(jit_compiler_t *c, int32_t disp, uint32_t imm) {
+    x_rm(c, false, 0xC7, 0, disp);
+    emit32(c, imm);
+}
+
+// jump to a label patched later, returns the rel32 to patch
+static uint8_t *emit_jump(jit_compiler_t *c, host_cond_t cc) {
+    if (cc == CC_ALWAYS) {
+        emit8(c, 0xE9);
+    } else {
+        emit8(c, 0x0F);
+        emit8(c, 0x80 + cc);
+    }
+    emit32(c, 0);
+    return c->p - 4;
+}
+
+static inline void patch_here(jit_compiler_t *c, uint8_t *rel) {
+    if (rel)
+        patch_rel32(rel, c->p);
+}
+
+static void emit_jump_to(jit_compiler_t *c, const uint8_t *target) {
+    patch_rel32(emit_jump(c, CC_ALWAYS), target);
+}
+
+// exit of the block before the current instruction, which is left to the interpreter
+static void emit_side_exit(jit_compiler_t *c, host_cond_t cc) {
+    uint8_t *rel = emit_jump(c, cc);
+    if (c->fixup_count < BLOCK_MAX_FIXUPS) {
+        c->fixups[c->fixup_count].rel   = rel;
+        c->fixups[c->fixup_count].index = c->index;
+    }
+    c->fixup_count++;
+}
+
+// guest state
+
+static uint8_t instr_size(jit_compiler_t *c) {
+    return c->thumb ? 2 : 4;
+}
+
+static void load_guest(jit_compiler_t *c, uint8_t dst, uint8_t r) {
+    if (r == REG_PC) {
+        emit_mov_ri(c, dst, c->address + 2 * instr_size(c));
+        return;
+    }
+
+    c->uses[r]++;
+    if (c->host[r] >= 0)
+        emit_mov_rr(c, dst, c->host[r]);
+    else
+        emit_load(c, dst, REG_OFFSET(r));
+}
+
+static void store_guest(jit_compiler_t *c, uint8_t r, uint8_t src) {
+    c->uses[r]++;
+    c->written |= 1 << r;
+    if (c->host[r] >= 0)
+        emit_mov_rr(c, c->host[r], src);
+    else
+        emit_store(c, REG_OFFSET(r), src);
+}
+
+// stores the guest registers and the CPSR held by host registers
+static void emit_writeback(jit_compiler_t *c) {
+    for (uint8_t r = 0; r < REG_PC; r++)
+        if (c->host[r] >= 0 && CHECK_BIT(c->written, r))
+            emit_store(c, REG_OFFSET(r), c->host[r]);
+
+    if (c->writes_flags) {
+        emit_store(c, OFFSET(cpu.cpsr), CPSR_REG);
+        emit_store(c, OFFSET(cpu.spsr[0]), CPSR_REG);
+    }
+}
+
+// exits to `target` with a jump that gba_jit_run() can patch to go directly to the target's block
+static void emit_link(jit_compiler_t *c, uint32_t target) {
+    emit_writeback(c);
+
+    uint8_t *rel = emit_jump(c, CC_ALWAYS);
+    patch_here(c, rel);
+
+    // mov rax, rel; mov [link_site], rax
+    emit8(c, 0x48);
+    emit8(c, 0xB8);
+    emit64(c, (uintptr_t) rel);
+    x_rm(c, true, 0x89, RAX, OFFSET(jit.link_site));
+    emit_mov_ri(c, RAX, target);
+    emit_jump_to(c, c->gba->jit.exit);
+}
+
+// N and Z of the CPSR from eax (clobbers edx)
+static void emit_set_nz(jit_compiler_t *c) {
+    emit_alu_ri(c, ALU_AND, CPSR_REG, ~(CPSR_N | CPSR_Z));
+    emit_mov_rr(c, RDX, RAX);
+    emit_alu_ri(c, ALU_AND, RDX, CPSR_N);
+    emit_alu_rr(c, ALU_OR, CPSR_REG, RDX);
+    emit_test_rr(c, RAX, RAX);
+    emit_setcc(c, CC_E, RDX);
+    x_rr(c, false, 0x0FB6, RDX, RDX);
+    emit_shift_ri(c, SHIFT_SHL, RDX, 30);
+    emit_alu_rr(c, ALU_OR, CPSR_REG, RDX);
+    c->writes_flags = true;
+}
+
+// `flag` of the CPSR from the byte register `r8` (0 or 1)
+static void emit_set_flag(jit_compiler_t *c, uint32_t flag, uint8_t r8) {
+    x_rr(c, false, 0x0FB6, r8, r8);
+    emit_shift_ri(c, SHIFT_SHL, r8, stdc_first_trailing_one(flag) - 1);
+    emit_alu_ri(c, ALU_AND, CPSR_REG, ~flag);
+    emit_alu_rr(c, ALU_OR, CPSR_REG, r8);
+    c->writes_flags = true;
+}
+
+static void emit_set_flag_const(jit_compiler_t *c, uint32_t flag, bool value) {
+    if (value)
+        emit_alu_ri(c, ALU_OR, CPSR_REG, flag);
+    else
+        emit_alu_ri(c, ALU_AND, CPSR_REG, ~flag);
+    c->writes_flags = true;
+}
+
+// NZCV from an addition or subtraction: the result is in eax, C in r11b and V in cl
+static void emit_set_nzcv(jit_compiler_t *c) {
+    emit_set_nz(c);
+    emit_set_flag(c, CPSR_C, R11);
+    emit_set_flag(c, CPSR_V, RCX);
+}
+
+/**
+ * Emits the check of an ARM condition (see cond_passes). Returns the rel32 of the jump taken when the condition fails
+ * (NULL for AL and NV, which is treated as AL).
+ */
+static uint8_t *emit_cond(jit_compiler_t *c, uint8_t cond) {
+    static const uint8_t flag_bits[] = { 30, 30, 29, 29, 31, 31, 28, 28 };
+
+    switch (cond) {
+    case 0x0 ... 0x7:
+        emit_bt(c, CPSR_REG, flag_bits[cond]);
+        return emit_jump(c, cond & 1 ? CC_B : CC_AE);
+    case 0x8: // HI
+    case 0x9: // LS
+        emit_mov_rr(c, RAX, CPSR_REG);
+        emit_alu_ri(c, ALU_AND, RAX, CPSR_C | CPSR_Z);
+        emit_alu_ri(c, ALU_CMP, RAX, CPSR_C);
+        return emit_jump(c, cond == 0x8 ? CC_NE : CC_E);
+    case 0xA: // GE
+    case 0xB: // LT
+        emit_mov_rr(c, RAX, CPSR_REG);
+        emit_shift_ri(c, SHIFT_SHR, RAX, 3);
+        emit_alu_rr(c, ALU_XOR, RAX, CPSR_REG);
+        emit_bt(c, RAX, 28);
+        return emit_jump(c, cond == 0xA ? CC_B : CC_AE);
+    case 0xC: // GT
+    case 0xD: // LE
+        emit_mov_rr(c, RAX, CPSR_REG);
+        emit_shift_ri(c, SHIFT_SHR, RAX, 3);
+        emit_alu_rr(c, ALU_XOR, RAX, CPSR_REG);
+        emit_alu_ri(c, ALU_AND, RAX, CPSR_V);
+        emit_mov_rr(c, RDX, CPSR_REG);
+        emit_alu_ri(c, ALU_AND, RDX, CPSR_Z);
+        emit_alu_rr(c, ALU_OR, RAX, RDX);
+        return emit_jump(c, cond == 0xC ? CC_NE : CC_E);
+    default:
+        return NULL;
+    }
+}
+
+/**
+ * Shifts ecx by an immediate amount like shift_offset() does (0 meaning 32 for LSR and ASR and RRX for ROR). If
+ * `carry` is true, r11b is set to the shifter's carry out.
+ */
+static void emit_shift_imm(jit_compiler_t *c, uint8_t type, uint8_t amount, bool carry) {
+    switch (type) {
+    case 0b00: // LSL
+        if (amount == 0) {
+            if (carry) {
+                emit_bt(c, CPSR_REG, 29);
+                emit_setcc(c, CC_B, R11);
+            }
+            return;
+        }
+        emit_shift_ri(c, SHIFT_SHL, RCX, amount);
+        break;
+    case 0b01: // LSR
+        if (amount == 0) {
+            if (carry) {
+                emit_bt(c, RCX, 31);
+                emit_setcc(c, CC_B, R11);
+            }
+            emit_alu_rr(c, ALU_XOR, RCX, RCX);
+            return;
+        }
+        emit_shift_ri(c, SHIFT_SHR, RCX, amount);
+        break;
+    case 0b10: // ASR
+        if (amount == 0) {
+            if (carry) {
+                emit_bt(c, RCX, 31);
+                emit_setcc(c, CC_B, R11);
+            }
+            emit_shift_ri(c, SHIFT_SAR, RCX, 31);
+            return;
+        }
+        emit_shift_ri(c, SHIFT_SAR, RCX, amount);
+        break;
+    case 0b11: // ROR
+        if (amount == 0) {
+            // RRX: rcr ecx, 1 with the C flag
+            emit_bt(c, CPSR_REG, 29);
+            x_rr(c, false, 0xD1, SHIFT_RCR, RCX);
+        } else {
+            emit_shift_ri(c, SHIFT_ROR, RCX, amount);
+        }
+        break;
+    }
+
+    if (carry)
+        emit_setcc(c, CC_B, R11);
+}
+
+/**
+ * Emits a load or a store of `size` bytes at the address in edx. The data to store is in ecx, the loaded data is left
+ * in ecx (sign or zero-extended). The accesses outside of IWRAM, EWRAM and ROM (loads only), the misaligned ones and
+ * the stores to pages with translated code exit the block before the current instruction. The bus latches are
+ * updated like the bus does.
+ */
+static void emit_access(jit_compiler_t *c, uint8_t size, bool load, bool sign) {
+    static const struct {
+        uint8_t  region;
+        uint32_t mask;
+        int32_t  memory;
+        int32_t  pages;
+    } regions[] = {
+        { BUS_IWRAM >> 24, BUS_IWRAM_UNUSED - BUS_IWRAM - 1, OFFSET(bus.iwram), OFFSET(jit.iwram_pages) },
+        { BUS_EWRAM >> 24, BUS_EWRAM_UNUSED - BUS_EWRAM - 1, OFFSET(bus.ewram), OFFSET(jit.ewram_pages) }
+    };
+
+    uint32_t next = c->address + instr_size(c);
+    uint8_t *done[3];
+
+    if (size > 1) {
+        x_rr(c, false, 0xF7, 0, RDX); // test edx, size - 1
+        emit32(c, size - 1);
+        emit_side_exit(c, CC_NE);
+    }
+
+    emit_mov_rr(c, RAX, RDX);
+    emit_shift_ri(c, SHIFT_SHR, RAX, 24);
+
+    for (size_t i = 0; i < sizeof(regions) / sizeof(*regions); i++) {
+        emit_alu_ri(c, ALU_CMP, RAX, regions[i].region);
+        uint8_t *next_region = emit_jump(c, CC_NE);
+        emit_alu_ri(c, ALU_AND, RDX, regions[i].mask);
+
+        if (load) {
+            x_rmi(c, false, 0x8B, RCX, RDX, regions[i].memory);
+            emit_store_imm(c, OFFSET(jit.load_address), next);
+        } else {
+            emit_mov_rr(c, RAX, RDX);
+            emit_shift_ri(c, SHIFT_SHR, RAX, GBA_JIT_PAGE_SHIFT);
+            x_rmi(c, false, 0x80, 7, RAX, regions[i].pages); // cmp byte [pages + page], 0
+            emit8(c, 0);
+            emit_side_exit(c, CC_NE);
+
+            if (size == 1) {
+                x_rmi(c, false, 0x88, RCX, RDX, regions[i].memory);
+            } else if (size == 2) {
+                emit8(c, 0x66);
+                x_rmi(c, false, 0x89, RCX, RDX, regions[i].memory);
+            } else {
+                x_rmi(c, false, 0x89, RCX, RDX, regions[i].memory);
+            }
+        }
+
+        done[i] = emit_jump(c, CC_ALWAYS);
+        patch_here(c, next_region);
+    }
+
+    if (load) {
+        // ROM (see rom_read): beyond the ROM, the data comes from the address so it's left to the interpreter
+        emit_alu_ri(c, ALU_SUB, RAX, BUS_ROM0 >> 24);
+        emit_alu_ri(c, ALU_CMP, RAX, (BUS_SRAM - BUS_ROM0) >> 24);
+        emit_side_exit(c, CC_AE);
+        emit_alu_ri(c, ALU_AND, RDX, 0x01FFFFFF);
+        x_rm(c, true, 0x3B, RDX, OFFSET(bus.rom_size)); // cmp rdx, [rom_size]
+        emit_side_exit(c, CC_A);
+        x_rmi(c, false, 0x8B, RCX, RDX, OFFSET(bus.rom));
+        emit_alu_ri(c, ALU_ADD, RDX, size);
+        emit_alu_ri(c, ALU_AND, RDX, 0x01FFFFFF);
+        emit_store(c, OFFSET(bus.rom_address_latch), RDX);
+        emit_store_imm(c, OFFSET(jit.load_address), next | 1);
+        done[2] = NULL;
+    } else {
+        emit_side_exit(c, CC_ALWAYS);
+        done[2] = NULL;
+    }
+
+    for (size_t i = 0; i < 3; i++)
+        patch_here(c, done[i]);
+
+    if (load) {
+        // the data read is always a word, the latch replicates the accessed part of it
+        switch (size) {
+        case 1:
+            emit_mov_rr(c, RAX, RCX);
+            emit_mov_rr(c, R11, RCX);
+            for (uint8_t i = 0; i < 3; i++) {
+                emit_shift_ri(c, SHIFT_SHL, R11, 8);
+                emit_alu_rr(c, ALU_OR, RAX, R11);
+            }
+            emit_store(c, OFFSET(bus.read_data_latch), RAX);
+            x_rr(c, false, sign ? 0x0FBE : 0x0FB6, RCX, RCX);
+            break;
+        case 2:
+            emit_mov_rr(c, RAX, RCX);
+            emit_shift_ri(c, SHIFT_SHL, RAX, 16);
+            emit_alu_rr(c, ALU_OR, RAX, RCX);
+            emit_store(c, OFFSET(bus.read_data_latch), RAX);
+            x_rr(c, false, sign ? 0x0FBF : 0x0FB7, RCX, RCX);
+            break;
+        case 4:
+            emit_store(c, OFFSET(bus.read_data_latch), RCX);
+            break;
+        }
+    } else {
+        switch (size) {
+        case 1:
+            x_rr(c, false, 0x0FB6, RAX, RCX);
+            x_rr(c, false, 0x69, RAX, RAX); // imul eax, eax, 0x01010101
+            emit32(c, 0x01010101);
+            emit_store(c, OFFSET(bus.write_data_latch), RAX);
+            break;
+        case 2:
+            x_rr(c, false, 0x0FB7, RAX, RCX);
+            emit_mov_rr(c, R11, RAX);
+            emit_shift_ri(c, SHIFT_SHL, R11, 16);
+            emit_alu_rr(c, ALU_OR, RAX, R11);
+            emit_store(c, OFFSET(bus.write_data_latch), RAX);
+            break;
+        case 4:
+            emit_store(c, OFFSET(bus.write_data_latch), RCX);
+            break;
+        }
+    }
+}
+
+/**
+ * Emits a load or store of register `rd` at the address in edx. For a load, rd is written after the base register
+ * `rn` is written back from TMP_REG (if `writeback`), like the interpreter does.
+ */
+static void emit_transfer(jit_compiler_t *c, uint8_t rd, uint8_t rn, bool writeback, uint8_t size, bool load, bool sign) {
+    if (!load) {
+        if (rd == REG_PC)
+            emit_mov_ri(c, RCX, c->address + 12); // the stored PC is 4 bytes further
+        else
+            load_guest(c, RCX, rd);
+    }
+
+    emit_access(c, size, load, sign);
+
+    if (writeback)
+        store_guest(c, rn, TMP_REG);
+    if (load)
+        store_guest(c, rd, RCX);
+}
+
+static bool in_translated_region(gba_t *gba, uint32_t address, uint8_t size) {
+    switch (address >> 24) {
+    case BUS_EWRAM >> 24:
+    case BUS_IWRAM >> 24:
+        return true;
+    case BUS_ROM0 >> 24 ... (BUS_SRAM >> 24) - 1:
+        return (address & 0x01FFFFFF) + size <= gba->bus.rom_size;
+    default:
+        return false;
+    }
+}
+
+// instruction like it is fetched by gba_cpu_step()
+static uint32_t read_instr(gba_t *gba, uint32_t address, bool thumb) {
+    uint8_t *memory;
+    switch (address >> 24) {
+    case BUS_EWRAM >> 24:
+        memory = &gba->bus.ewram[address & (BUS_EWRAM_UNUSED - BUS_EWRAM - 1)];
+        break;
+    case BUS_IWRAM >> 24:
+        memory = &gba->bus.iwram[address & (BUS_IWRAM_UNUSED - BUS_IWRAM - 1)];
+        break;
+    default:
+        memory = &gba->bus.rom[address & 0x01FFFFFF];
+        break;
+    }
+
+    if (thumb) {
+        uint16_t instr;
+        memcpy(&instr, memory, sizeof(instr));
+        return instr;
+    }
+
+    uint32_t instr;
+    memcpy(&instr, memory, sizeof(instr));
+    return instr;
+}
+
+// ARM instructions
+
+static bool translate_data_processing(jit_compiler_t *c, uint32_t instr) {
+    bool    i  = CHECK_BIT(instr, 25);
+    bool    s  = CHECK_BIT(instr, 20);
+    uint8_t op = (instr >> 21) & 0x0F;
+    uint8_t rn = (instr >> 16) & 0x0F;
+    uint8_t rd = (instr >> 12) & 0x0F;
+
+    // shifts by a register amount and writes to PC (branches, SPSR restores) are left to the interpreter
+    if ((!i && CHECK_BIT(instr, 4)) || rd == REG_PC)
+        return false;
+
+    bool logical = op <= 0x1 || op == 0x8 || op == 0x9 || op >= 0xC;
+    bool test    = op >= 0x8 && op <= 0xB;
+    s |= test;
+
+    uint8_t *skip = emit_cond(c, instr >> 28);
+
+    // operand 2 in ecx (and the shifter carry in r11b for the logical operations that set the flags)
+    bool   const_carry = false;
+    int8_t carry_value = -1; // carry of the immediate operand, -1 if it's unchanged
+    if (i) {
+        uint8_t  rotate = ((instr >> 8) & 0x0F) << 1;
+        uint32_t imm    = instr & 0xFF;
+        uint32_t value  = rotate ? (imm >> rotate) | (imm << (32 - rotate)) : imm;
+        emit_mov_ri(c, RCX, value);
+        const_carry = true;
+        carry_value = rotate ? (int8_t) (value >> 31) : -1;
+    } else {
+        load_guest(c, RCX, instr & 0x0F);
+        emit_shift_imm(c, (instr >> 5) & 0x03, (instr >> 7) & 0x1F, logical && s);
+    }
+
+    if (op != 0xD && op != 0xF)
+        load_guest(c, RAX, rn);
+
+    switch (op) {
+    case 0x0: // AND
+    case 0x8: // TST
+        emit_alu_rr(c, ALU_AND, RAX, RCX);
+        break;
+    case 0x1: // EOR
+    case 0x9: // TEQ
+        emit_alu_rr(c, ALU_XOR, RAX, RCX);
+        break;
+    case 0x2: // SUB
+    case 0xA: // CMP
+        emit_alu_rr(c, ALU_SUB, RAX, RCX);
+        if (s) {
+            emit_setcc(c, CC_AE, R11);
+            emit_setcc(c, CC_O, RCX);
+        }
+        break;
+    case 0x3: // RSB
+        emit_alu_rr(c, ALU_SUB, RCX, RAX);
+        emit_mov_rr(c, RAX, RCX);
+        if (s) {
+            emit_setcc(c, CC_AE, R11);
+            emit_setcc(c, CC_O, RCX);
+        }
+        break;
+    case 0x4: // ADD
+    case 0xB: // CMN
+        emit_alu_rr(c, ALU_ADD, RAX, RCX);
+        if (s) {
+            emit_setcc(c, CC_B, R11);
+            emit_setcc(c, CC_O, RCX);
+        }
+        break;
+    case 0x5: // ADC
+        emit_bt(c, CPSR_REG, 29);
+        emit_alu_rr(c, ALU_ADC, RAX, RCX);
+        if (s) {
+            emit_setcc(c, CC_B, R11);
+            emit_setcc(c, CC_O, RCX);
+        }
+        break;
+    case 0x6: // SBC
+    case 0x7: // RSC
+        if (op == 0x7) {
+            emit_mov_rr(c, RDX, RAX);
+            emit_mov_rr(c, RAX, RCX);
+            emit_mov_rr(c, RCX, RDX);
+        }
+        // eax = op1 - op2 - !C (with the borrow of sbb being !C)
+        emit_mov_rr(c, RDX, RAX);
+        emit_bt(c, CPSR_REG, 29);
+        emit8(c, 0xF5); // cmc
+        emit_alu_rr(c, ALU_SBB, RAX, RCX);
+        if (s) {
+            // V is computed by SBC_SET_FLAGS from op2 + !C: ((op1 ^ (op2 + !C)) & (op1 ^ res)) >> 31
+            emit_setcc(c, CC_AE, R11);
+            emit_bt(c, CPSR_REG, 29);
+            emit8(c, 0xF5); // cmc
+            emit_alu_ri(c, ALU_ADC, RCX, 0);
+            emit_alu_rr(c, ALU_XOR, RCX, RDX);
+            emit_alu_rr(c, ALU_XOR, RDX, RAX);
+            emit_alu_rr(c, ALU_AND, RCX, RDX);
+            emit_shift_ri(c, SHIFT_SHR, RCX, 31);
+        }
+        break;
+    case 0xC: // ORR
+        emit_alu_rr(c, ALU_OR, RAX, RCX);
+        break;
+    case 0xD: // MOV
+        emit_mov_rr(c, RAX, RCX);
+        break;
+    case 0xE: // BIC
+        x_rr(c, false, 0xF7, 2, RCX); // not ecx
+        emit_alu_rr(c, ALU_AND, RAX, RCX);
+        break;
+    case 0xF: // MVN
+        emit_mov_rr(c, RAX, RCX);
+        x_rr(c, false, 0xF7, 2, RAX); // not eax
+        break;
+    }
+
+    if (s) {
+        if (logical) {
+            emit_set_nz(c);
+            if (!const_carry)
+                emit_set_flag(c, CPSR_C, R11);
+            else if (carry_value >= 0)
+                emit_set_flag_const(c, CPSR_C, carry_value);
+        } else {
+            emit_set_nzcv(c);
+        }
+    }
+
+    if (!test)
+        store_guest(c, rd, RAX);
+
+    patch_here(c, skip);
+    return true;
+}
+
+static bool translate_multiply(jit_compiler_t *c, uint32_t instr, bool accumulate) {
+    uint8_t rd = (instr >> 16) & 0x0F;
+    uint8_t rn = (instr >> 12) & 0x0F;
+    bool    s  = CHECK_BIT(instr, 20);
+
+    if (rd == REG_PC)
+        return false;
+
+    uint8_t *skip = emit_cond(c, instr >> 28);
+
+    load_guest(c, RAX, instr & 0x0F);
+    load_guest(c, RCX, (instr >> 8) & 0x0F);
+    x_rr(c, false, 0x0FAF, RAX, RCX); // imul eax, ecx
+    if (accumulate) {
+        load_guest(c, RCX, rn);
+        emit_alu_rr(c, ALU_ADD, RAX, RCX);
+    }
+    if (s)
+        emit_set_nz(c);
+    store_guest(c, rd, RAX);
+
+    patch_here(c, skip);
+    return true;
+}
+
+static bool translate_single_transfer(jit_compiler_t *c, uint32_t instr, bool load) {
+    bool    i  = CHECK_BIT(instr, 25);
+    bool    p  = CHECK_BIT(instr, 24);
+    bool    u  = CHECK_BIT(instr, 23);
+    bool    b  = CHECK_BIT(instr, 22);
+    bool    w  = CHECK_BIT(instr, 21);
+    uint8_t rn = (instr >> 16) & 0x0F;
+    uint8_t rd = (instr >> 12) & 0x0F;
+
+    bool writeback = w || !p;
+    if ((i && CHECK_BIT(instr, 4)) || (writeback && rn == REG_PC) || (load && rd == REG_PC))
+        return false;
+
+    uint8_t *skip = emit_cond(c, instr >> 28);
+
+    if (i) {
+        load_guest(c, RCX, instr & 0x0F);
+        emit_shift_imm(c, (instr >> 5) & 0x03, (instr >> 7) & 0x1F, false);
+    } else {
+        emit_mov_ri(c, RCX, instr & 0x0FFF);
+    }
+
+    load_guest(c, RDX, rn);
+    emit_mov_rr(c, TMP_REG, RDX);
+    emit_alu_rr(c, u ? ALU_ADD : ALU_SUB, TMP_REG, RCX);
+    if (p)
+        emit_mov_rr(c, RDX, TMP_REG);
+
+    emit_transfer(c, rd, rn, writeback, b ? 1 : 4, load, false);
+
+    patch_here(c, skip);
+    return true;
+}
+
+static bool translate_halfword_transfer(jit_compiler_t *c, uint32_t instr, bool imm, bool load) {
+    bool    p  = CHECK_BIT(instr, 24);
+    bool    u  = CHECK_BIT(instr, 23);
+    bool    w  = CHECK_BIT(instr, 21);
+    uint8_t sh = (instr >> 5) & 0x03;
+    uint8_t rn = (instr >> 16) & 0x0F;
+    uint8_t rd = (instr >> 12) & 0x0F;
+
+    // the interpreter only implements STRH, LDRH, LDRSB and LDRSH, and flushes the pipeline on LDRH reg with rn == PC
+    bool writeback = w || !p;
+    if ((load ? sh == 0b00 : sh != 0b01) || (load && rd == REG_PC) || (rn == REG_PC && (writeback || (load && !imm))))
+        return false;
+
+    uint8_t *skip = emit_cond(c, instr >> 28);
+
+    if (imm)
+        emit_mov_ri(c, RCX, ((instr >> 4) & 0xF0) | (instr & 0x0F));
+    else
+        load_guest(c, RCX, instr & 0x0F);
+
+    load_guest(c, RDX, rn);
+    emit_mov_rr(c, TMP_REG, RDX);
+    emit_alu_rr(c, u ? ALU_ADD : ALU_SUB, TMP_REG, RCX);
+    if (p)
+        emit_mov_rr(c, RDX, TMP_REG);
+
+    emit_transfer(c, rd, rn, writeback, sh == 0b10 ? 1 : 2, load, sh & 0b10);
+
+    patch_here(c, skip);
+    return true;
+}
+
+static bool translate_branch(jit_compiler_t *c, uint32_t instr, bool link) {
+    uint32_t offset = instr & 0x00FFFFFF;
+    if (CHECK_BIT(offset, 23))
+        offset |= 0xFF000000;
+    uint32_t target = ALIGN(c->address + 8 + (offset << 2), 2);
+
+    if (!in_translated_region(c->gba, target, 4))
+        return false;
+
+    c->ended = true;
+    c->cost += 2; // pipeline refill
+
+    uint8_t *not_taken = emit_cond(c, instr >> 28);
+
+    if (link) {
+        emit_mov_ri(c, RAX, c->address + 4);
+        store_guest(c, REG_LR, RAX);
+    }
+    emit_store_imm(c, OFFSET(jit.load_address), 0);
+    emit_link(c, target);
+
+    if (not_taken) {
+        patch_here(c, not_taken);
+        x_rr(c, true, 0x81, ALU_ADD, RBP); // the pipeline isn't refilled
+        emit32(c, 2);
+        emit_link(c, c->address + 4);
+    }
+
+    return true;
+}
+
+static bool translate_arm(jit_compiler_t *c, uint32_t instr) {
+    switch (arm_handlers[((instr & 0x0FF00000) >> 16) | ((instr & 0x000000F0) >> 4)]) {
+    case HANDLER_ID(and_handler):
+    case HANDLER_ID(eor_handler):
+    case HANDLER_ID(sub_handler):
+    case HANDLER_ID(rsb_handler):
+    case HANDLER_ID(add_handler):
+    case HANDLER_ID(adc_handler):
+    case HANDLER_ID(sbc_handler):
+    case HANDLER_ID(rsc_handler):
+    case HANDLER_ID(tst_handler):
+    case HANDLER_ID(teq_handler):
+    case HANDLER_ID(cmp_handler):
+    case HANDLER_ID(cmn_handler):
+    case HANDLER_ID(orr_handler):
+    case HANDLER_ID(mov_handler):
+    case HANDLER_ID(bic_handler):
+    case HANDLER_ID(mvn_handler):
+        return translate_data_processing(c, instr);
+    case HANDLER_ID(mul_handler):
+        return translate_multiply(c, instr, false);
+    case HANDLER_ID(mla_handler):
+        return translate_multiply(c, instr, true);
+    case HANDLER_ID(strh_reg_handler):
+        return translate_halfword_transfer(c, instr, false, false);
+    case HANDLER_ID(strh_imm_handler):
+        return translate_halfword_transfer(c, instr, true, false);
+    case HANDLER_ID(ldrh_reg_handler):
+        return translate_halfword_transfer(c, instr, false, true);
+    case HANDLER_ID(ldrh_imm_handler):
+        return translate_halfword_transfer(c, instr, true, true);
+    case HANDLER_ID(str_handler):
+        return translate_single_transfer(c, instr, false);
+    case HANDLER_ID(ldr_handler):
+        return translate_single_transfer(c, instr, true);
+    case HANDLER_ID(b_handler):
+        return translate_branch(c, instr, false);
+    case HANDLER_ID(bl_handler):
+        return translate_branch(c, instr, true);
+    default:
+        return false;
+    }
+}
+
+// THUMB instructions
+
+static void emit_thumb_transfer(jit_compiler_t *c, uint8_t rd, uint8_t size, bool load, bool sign) {
+    emit_transfer(c, rd, 0, false, size, load, sign);
+}
+
+// edx = rb + ro
+static void emit_thumb_reg_address(jit_compiler_t *c, uint16_t instr) {
+    load_guest(c, RDX, (instr >> 3) & 0x07);
+    load_guest(c, RCX, (instr >> 6) & 0x07);
+    emit_alu_rr(c, ALU_ADD, RDX, RCX);
+}
+
+// edx = rb + offset
+static void emit_thumb_imm_address(jit_compiler_t *c, uint8_t rb, uint32_t offset) {
+    load_guest(c, RDX, rb);
+    if (offset)
+        emit_alu_ri(c, ALU_ADD, RDX, offset);
+}
+
+static bool translate_thumb_alu(jit_compiler_t *c, uint16_t instr) {
+    uint8_t op = (instr >> 6) & 0x0F;
+    uint8_t rd = instr & 0x07;
+    uint8_t rs = (instr >> 3) & 0x07;
+
+    // shifts by a register amount are left to the interpreter
+    if (op == 0b0010 || op == 0b0011 || op == 0b0100 || op == 0b0111)
+        return false;
+
+    load_guest(c, RAX, rd);
+    load_guest(c, RCX, rs);
+
+    switch (op) {
+    case 0b0000: // AND
+    case 0b1000: // TST
+        emit_alu_rr(c, ALU_AND, RAX, RCX);
+        emit_set_nz(c);
+        break;
+    case 0b0001: // EOR
+        emit_alu_rr(c, ALU_XOR, RAX, RCX);
+        emit_set_nz(c);
+        break;
+    case 0b0101: // ADC
+        emit_bt(c, CPSR_REG, 29);
+        emit_alu_rr(c, ALU_ADC, RAX, RCX);
+        emit_setcc(c, CC_B, R11);
+        emit_setcc(c, CC_O, RCX);
+        emit_set_nzcv(c);
+        break;
+    case 0b0110: // SBC
+        // C and V are computed by SBC_SET_FLAGS from rs + C instead of rs + !C, V with the new C
+        emit_mov_rr(c, RDX, RAX);
+        emit_bt(c, CPSR_REG, 29);
+        emit8(c, 0xF5); // cmc
+        emit_alu_rr(c, ALU_SBB, RAX, RCX);
+        emit_mov_rr(c, R11, RCX);
+        emit_bt(c, CPSR_REG, 29);
+        x_rr(c, true, 0x81, ALU_ADC, R11); // adc r11, 0
+        emit32(c, 0);
+        x_rr(c, true, 0x39, RDX, R11); // cmp r11, rdx
+        emit_setcc(c, CC_BE, R11);
+        x_rr(c, false, 0x0FB6, R11, R11);
+        emit_alu_rr(c, ALU_ADD, RCX, R11);
+        emit_alu_rr(c, ALU_XOR, RCX, RDX);
+        emit_alu_rr(c, ALU_XOR, RDX, RAX);
+        emit_alu_rr(c, ALU_AND, RCX, RDX);
+        emit_shift_ri(c, SHIFT_SHR, RCX, 31);
+        emit_set_nzcv(c);
+        break;
+    case 0b1001: // NEG
+        emit_alu_rr(c, ALU_XOR, RAX, RAX);
+        // fallthrough
+    case 0b1010: // CMP
+        emit_alu_rr(c, ALU_SUB, RAX, RCX);
+        emit_setcc(c, CC_AE, R11);
+        emit_setcc(c, CC_O, RCX);
+        emit_set_nzcv(c);
+        break;
+    case 0b1011: // CMN
+        emit_alu_rr(c, ALU_ADD, RAX, RCX);
+        emit_setcc(c, CC_B, R11);
+        emit_setcc(c, CC_O, RCX);
+        emit_set_nzcv(c);
+        break;
+    case 0b1100: // ORR
+        emit_alu_rr(c, ALU_OR, RAX, RCX);
+        emit_set_nz(c);
+        break;
+    case 0b1101: // MUL
+        x_rr(c, false, 0x0FAF, RAX, RCX);
+        emit_set_nz(c);
+        emit_set_flag_const(c, CPSR_C, 0);
+        break;
+    case 0b1110: // BIC
+        x_rr(c, false, 0xF7, 2, RCX);
+        emit_alu_rr(c, ALU_AND, RAX, RCX);
+        emit_set_nz(c);
+        break;
+    case 0b1111: // MVN
+        emit_mov_rr(c, RAX, RCX);
+        x_rr(c, false, 0xF7, 2, RAX);
+        emit_set_nz(c);
+        break;
+    }
+
+    if (op != 0b1000 && op != 0b1010 && op != 0b1011)
+        store_guest(c, rd, RAX);
+
+    return true;
+}
+
+static bool translate_thumb_branch(jit_compiler_t *c, uint32_t target, uint8_t cond) {
+    if (cond == 0x0F || !in_translated_region(c->gba, target, 2))
+        return false;
+
+    c->ended = true;
+    c->cost += 2; // pipeline refill
+
+    uint8_t *not_taken = emit_cond(c, cond);
+
+    emit_store_imm(c, OFFSET(jit.load_address), 0);
+    emit_link(c, target);
+
+    if (not_taken) {
+        patch_here(c, not_taken);
+        x_rr(c, true, 0x81, ALU_ADD, RBP); // the pipeline isn't refilled
+        emit32(c, 2);
+        emit_link(c, c->address + 2);
+    }
+
+    return true;
+}
+
+static bool translate_thumb(jit_compiler_t *c, uint16_t instr) {
+    uint8_t rd  = instr & 0x07;
+    uint8_t rs  = (instr >> 3) & 0x07;
+    uint8_t rd8 = (instr >> 8) & 0x07;
+
+    bool prev_bl_prefix = c->prev_bl_prefix;
+    c->prev_bl_prefix   = false;
+
+    switch (thumb_handlers[instr >> 8]) {
+    case HANDLER_ID(thumb_lsl_handler):
+    case HANDLER_ID(thumb_lsr_handler):
+    case HANDLER_ID(thumb_asr_handler):
+        load_guest(c, RCX, rs);
+        emit_shift_imm(c, (instr >> 11) & 0x03, (instr >> 6) & 0x1F, true);
+        emit_mov_rr(c, RAX, RCX);
+        emit_set_nz(c);
+        emit_set_flag(c, CPSR_C, R11);
+        store_guest(c, rd, RAX);
+        return true;
+    case HANDLER_ID(thumb_add_handler):
+    case HANDLER_ID(thumb_sub_handler):
+        load_guest(c, RAX, rs);
+        if (CHECK_BIT(instr, 10))
+            emit_mov_ri(c, RCX, (instr >> 6) & 0x07);
+        else
+            load_guest(c, RCX, (instr >> 6) & 0x07);
+        if (CHECK_BIT(instr, 9)) {
+            emit_alu_rr(c, ALU_SUB, RAX, RCX);
+            emit_setcc(c, CC_AE, R11);
+        } else {
+            emit_alu_rr(c, ALU_ADD, RAX, RCX);
+            emit_setcc(c, CC_B, R11);
+        }
+        emit_setcc(c, CC_O, RCX);
+        emit_set_nzcv(c);
+        store_guest(c, rd, RAX);
+        return true;
+    case HANDLER_ID(thumb_mov_imm_handler):
+        emit_mov_ri(c, RAX, instr & 0xFF);
+        emit_set_nz(c);
+        store_guest(c, rd8, RAX);
+        return true;
+    case HANDLER_ID(thumb_cmp_imm_handler):
+    case HANDLER_ID(thumb_add_imm_handler):
+    case HANDLER_ID(thumb_sub_imm_handler): {
+        bool add = thumb_handlers[instr >> 8] == HANDLER_ID(thumb_add_imm_handler);
+        load_guest(c, RAX, rd8);
+        emit_alu_ri(c, add ? ALU_ADD : ALU_SUB, RAX, instr & 0xFF);
+        emit_setcc(c, add ? CC_B : CC_AE, R11);
+        emit_setcc(c, CC_O, RCX);
+        emit_set_nzcv(c);
+        if (thumb_handlers[instr >> 8] != HANDLER_ID(thumb_cmp_imm_handler))
+            store_guest(c, rd8, RAX);
+        return true;
+    }
+    case HANDLER_ID(thumb_alu_ops_handler):
+        return translate_thumb_alu(c, instr);
+    case HANDLER_ID(thumb_add_hi_reg_handler):
+    case HANDLER_ID(thumb_cmp_hi_reg_handler):
+    case HANDLER_ID(thumb_mov_hi_reg_handler): {
+        uint8_t rd_hd = CHECK_BIT(instr, 7) ? rd + 8 : rd;
+        uint8_t rs_hs = CHECK_BIT(instr, 6) ? rs + 8 : rs;
+        bool    cmp   = thumb_handlers[instr >> 8] == HANDLER_ID(thumb_cmp_hi_reg_handler);
+        bool    mov   = thumb_handlers[instr >> 8] == HANDLER_ID(thumb_mov_hi_reg_handler);
+
+        // writes to PC (branches) are left to the interpreter
+        if (!cmp && rd_hd == REG_PC)
+            return false;
+
+        load_guest(c, RCX, rs_hs);
+        if (mov) {
+            store_guest(c, rd_hd, RCX);
+            return true;
+        }
+
+        load_guest(c, RAX, rd_hd);
+        if (cmp) {
+            emit_alu_rr(c, ALU_SUB, RAX, RCX);
+            emit_setcc(c, CC_AE, R11);
+            emit_setcc(c, CC_O, RCX);
+            emit_set_nzcv(c);
+        } else {
+            emit_alu_rr(c, ALU_ADD, RAX, RCX);
+            store_guest(c, rd_hd, RAX);
+        }
+        return true;
+    }
+    case HANDLER_ID(thumb_pc_relative_ldr_handler):
+        emit_mov_ri(c, RDX, ((c->address + 4) & ~2) + ((instr & 0xFF) << 2));
+        emit_thumb_transfer(c, rd8, 4, true, false);
+        return true;
+    case HANDLER_ID(thumb_str_reg_handler):
+    case HANDLER_ID(thumb_ldr_reg_handler):
+        emit_thumb_reg_address(c, instr);
+        emit_thumb_transfer(c, rd, CHECK_BIT(instr, 10) ? 1 : 4, CHECK_BIT(instr, 11), false);
+        return true;
+    case HANDLER_ID(thumb_strh_reg_handler):
+        emit_thumb_reg_address(c, instr);
+        emit_thumb_transfer(c, rd, 2, false, false);
+        return true;
+    case HANDLER_ID(thumb_ldrh_reg_handler): {
+        bool h = CHECK_BIT(instr, 11);
+        emit_thumb_reg_address(c, instr);
+        emit_thumb_transfer(c, rd, h ? 2 : 1, true, CHECK_BIT(instr, 10));
+        return true;
+    }
+    case HANDLER_ID(thumb_strh_imm_handler):
+    case HANDLER_ID(thumb_ldrh_imm_handler): {
+        bool    b       = CHECK_BIT(instr, 12);
+        uint8_t offset5 = (instr >> 6) & 0x1F;
+        emit_thumb_imm_address(c, rs, b ? offset5 : offset5 << 2);
+        emit_thumb_transfer(c, rd, b ? 1 : 4, CHECK_BIT(instr, 11), false);
+        return true;
+    }
+    case HANDLER_ID(thumb_strh_handler):
+    case HANDLER_ID(thumb_ldrh_handler):
+        emit_thumb_imm_address(c, rs, ((instr >> 6) & 0x1F) << 1);
+        emit_thumb_transfer(c, rd, 2, CHECK_BIT(instr, 11), false);
+        return true;
+    case HANDLER_ID(thumb_str_sp_handler):
+    case HANDLER_ID(thumb_ldr_sp_handler):
+        emit_thumb_imm_address(c, REG_SP, (instr & 0xFF) << 2);
+        emit_thumb_transfer(c, rd8, 4, CHECK_BIT(instr, 11), false);
+        return true;
+    case HANDLER_ID(thumb_add_addr_handler):
+        if (CHECK_BIT(instr, 11)) {
+            load_guest(c, RAX, REG_SP);
+            emit_alu_ri(c, ALU_ADD, RAX, (instr & 0xFF) << 2);
+        } else {
+            emit_mov_ri(c, RAX, ((c->address + 4) & ~2) + ((instr & 0xFF) << 2));
+        }
+        store_guest(c, rd8, RAX);
+        return true;
+    case HANDLER_ID(thumb_add_sp_handler):
+        load_guest(c, RAX, REG_SP);
+        emit_alu_ri(c, CHECK_BIT(instr, 7) ? ALU_SUB : ALU_ADD, RAX, (instr & 0x7F) << 2);
+        store_guest(c, REG_SP, RAX);
+        return true;
+    case HANDLER_ID(thumb_b_cond_handler):
+        return translate_thumb_branch(c, ALIGN(c->address + 4 + ((uint32_t) (int8_t) (instr & 0xFF) << 1), 2), (instr >> 8) & 0x0F);
+    case HANDLER_ID(thumb_b_handler): {
+        uint32_t offset11 = (instr & 0x07FF) << 1;
+        if (CHECK_BIT(offset11, 11))
+            offset11 |= 0xFFFFF800;
+        return translate_thumb_branch(c, ALIGN(c->address + 4 + offset11, 2), 0x0E);
+    }
+    case HANDLER_ID(thumb_bl_handler): {
+        uint32_t offset = instr & 0x07FF;
+        if (!CHECK_BIT(instr, 11)) {
+            // first half: LR = PC + (offset << 12)
+            offset <<= 12;
+            if (offset & 0x00400000)
+                offset |= 0xFF800000;
+            c->prev_bl_prefix = true;
+            c->bl_lr          = c->address + 4 + offset;
+            emit_mov_ri(c, RAX, c->bl_lr);
+            store_guest(c, REG_LR, RAX);
+            return true;
+        }
+
+        // second half: only translated after the first one, when the target is known
+        uint32_t target = ALIGN(c->bl_lr + (offset << 1), 2);
+        if (!prev_bl_prefix || !in_translated_region(c->gba, target, 2))
+            return false;
+
+        emit_mov_ri(c, RAX, (c->address + 2) | 1);
+        store_guest(c, REG_LR, RAX);
+        return translate_thumb_branch(c, target, 0x0E);
+    }
+    default:
+        return false;
+    }
+}
+
+// blocks
+
+/**
+ * Translates the block at c->start. The first pass (with no guest register held by host registers) finds the length of
+ * the block and how much it uses each register, the second one emits the code with the registers allocated.
+ */
+static void translate_block(jit_compiler_t *c) {
+    gba_jit_t *jit   = &c->gba->jit;
+    uint8_t   *begin = c->p;
+
+    // entry: sub rbp, cost; jl no_run
+    x_rr(c, true, 0x81, ALU_SUB, RBP);
+    emit32(c, 0);
+    uint8_t *cost   = c->p - 4;
+    uint8_t *no_run = emit_jump(c, CC_L);
+
+    emit_load(c, CPSR_REG, OFFSET(cpu.cpsr));
+    for (uint8_t r = 0; r < REG_PC; r++)
+        if (c->host[r] >= 0)
+            emit_load(c, c->host[r], REG_OFFSET(r));
+
+    for (uint8_t k = 0; k < c->max && !c->ended; k++) {
+        c->address = c->start + k * instr_size(c);
+        if ((c->address >> 24) != (c->start >> 24) || !in_translated_region(c->gba, c->address, instr_size(c)))
+            break;
+        if (c->p - begin > CODE_BLOCK_MAX / 2 || c->fixup_count >= BLOCK_MAX_FIXUPS - 8)
+            break;
+
+        c->index = k;
+        uint32_t instr = read_instr(c->gba, c->address, c->thumb);
+        bool     ok    = c->thumb ? translate_thumb(c, instr) : translate_arm(c, instr);
+        if (!ok)
+            break;
+
+        c->count = k + 1;
+        c->cost++;
+    }
+
+    if (!c->ended) {
+        c->index = c->count;
+        emit_link(c, c->start + c->count * instr_size(c));
+    }
+
+    // side exits: the cycles of the instructions that didn't run are given back
+    for (size_t i = 0; i < c->fixup_count && i < BLOCK_MAX_FIXUPS; i++) {
+        uint8_t index = c->fixups[i].index;
+        if (!c->exits[index]) {
+            c->exits[index] = c->p;
+            emit_writeback(c);
+            x_rr(c, true, 0x81, ALU_ADD, RBP);
+            emit32(c, c->cost - index);
+            emit_mov_ri(c, RAX, c->start + index * instr_size(c));
+            emit_jump_to(c, jit->exit);
+        }
+        patch_rel32(c->fixups[i].rel, c->exits[index]);
+    }
+
+    patch_here(c, no_run);
+    x_rr(c, true, 0x81, ALU_ADD, RBP);
+    emit32(c, c->cost);
+    emit_mov_ri(c, RAX, c->start);
+    emit_jump_to(c, jit->exit);
+
+    memcpy(cost, &c->cost, sizeof(c->cost));
+}
+
+static void mark_pages(gba_t *gba, uint32_t start, uint32_t end) {
+    for (uint32_t address = start; address < end; address++) {
+        switch (address >> 24) {
+        case BUS_EWRAM >> 24:
+            gba->jit.ewram_pages[(address & (BUS_EWRAM_UNUSED - BUS_EWRAM - 1)) >> GBA_JIT_PAGE_SHIFT] = 1;
+            break;
+        case BUS_IWRAM >> 24:
+            gba->jit.iwram_pages[(address & (BUS_IWRAM_UNUSED - BUS_IWRAM - 1)) >> GBA_JIT_PAGE_SHIFT] = 1;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+static gba_jit_block_t *compile_block(gba_t *gba, uint32_t address, bool thumb) {
+    gba_jit_t *jit = &gba->jit;
+
+    if (jit->block_count == MAX_BLOCKS || jit->code + CODE_SIZE - jit->code_end < CODE_BLOCK_MAX)
+        gba_jit_flush(gba);
+
+    uint8_t          size  = thumb ? 2 : 4;
+    gba_jit_block_t *block = &jit->blocks[jit->block_count++];
+    block->key             = address | thumb;
+    block->instrs[0]       = read_instr(gba, address, thumb);
+    block->instrs[1]       = in_translated_region(gba, address + size, size) ? read_instr(gba, address + size, thumb) : 0;
+    block->code            = NULL;
+    jit->table[HASH(block->key)] = block;
+
+    jit_compiler_t c = { 0 };
+    c.gba   = gba;
+    c.p     = jit->code_end;
+    c.thumb = thumb;
+    c.start = address;
+    c.max   = BLOCK_MAX_INSTRS;
+    memset(c.host, -1, sizeof(c.host));
+    translate_block(&c);
+
+    if (c.count == 0)
+        return block;
+
+    // the most used registers are held by host registers
+    int8_t host[16];
+    memset(host, -1, sizeof(host));
+    for (size_t i = 0; i < sizeof(allocatable_regs); i++) {
+        int8_t best = -1;
+        for (uint8_t r = 0; r < REG_PC; r++)
+            if (host[r] < 0 && c.uses[r] > 1 && (best < 0 || c.uses[r] > c.uses[best]))
+                best = r;
+        if (best < 0)
+            break;
+        host[best] = allocatable_regs[i];
+    }
+
+    uint16_t written      = c.written;
+    bool     writes_flags = c.writes_flags;
+    uint8_t  count        = c.count;
+
+    memset(&c, 0, sizeof(c));
+    c.gba          = gba;
+    c.p            = jit->code_end;
+    c.thumb        = thumb;
+    c.start        = address;
+    c.max          = count;
+    c.written      = written;
+    c.writes_flags = writes_flags;
+    memcpy(c.host, host, sizeof(host));
+    translate_block(&c);
+
+    block->code   = jit->code_end;
+    jit->code_end = c.p;
+
+    // the writes to the instructions of the block or to the 2 following ones (that are prefetched) are checked
+    mark_pages(gba, address, address + (c.count + 2) * size);
+
+    return block;
+}
+
+static gba_jit_block_t *get_block(gba_t *gba, uint32_t address, bool thumb) {
+    uint32_t         key   = address | thumb;
+    gba_jit_block_t *block = gba->jit.table[HASH(key)];
+    if (block && block->key == key)
+        return block;
+
+    if (!in_translated_region(gba, address, thumb ? 2 : 4))
+        return NULL;
+
+    return compile_block(gba, address, thumb);
+}
+
+// instruction fetch of gba_cpu_step()
+static uint32_t fetch(gba_t *gba, bool thumb) {
+    uint32_t instr = thumb ? gba_bus_read_half(gba, gba->cpu.regs[REG_PC]) : gba_bus_read_word(gba, gba->cpu.regs[REG_PC]);
+    if (gba->cpu.regs[REG_PC] < BUS_BIOS_UNUSED)
+        gba->bus.last_fetched_bios_instr = instr;
+    return instr;
+}
+
+bool gba_jit_run(gba_t *gba) {
+    gba_jit_t *jit = &gba->jit;
+    gba_cpu_t *cpu = &gba->cpu;
+
+    if (!jit->enabled || cpu->pipeline_flush_cycles || cpu->cpsr != cpu->spsr[0] || !gba_dma_is_idle(gba))
+        return false;
+
+    if (gba->bus.io[IO_IME] && !(cpu->cpsr & CPSR_I) && (gba->bus.io[IO_IE] & gba->bus.io[IO_IF]))
+        return false;
+
+    bool     thumb = cpu->cpsr & CPSR_T;
+    uint8_t  size  = thumb ? 2 : 4;
+    uint32_t start = cpu->regs[REG_PC] - 2 * size;
+
+    gba_jit_block_t *block = get_block(gba, start, thumb);
+    if (!block || !block->code || block->instrs[0] != cpu->pipeline[PIPELINE_DECODING] || block->instrs[1] != cpu->pipeline[PIPELINE_FETCHING])
+        return false;
+
+    // the blocks must end before the next event: the cycle of the event itself can still be run
+    uint64_t until_event = gba->scheduler.next > gba->scheduler.now ? gba->scheduler.next - gba->scheduler.now : 0;
+    int64_t  budget      = until_event < RUN_MAX_CYCLES ? until_event + 1 : RUN_MAX_CYCLES;
+
+    jit->budget       = budget;
+    jit->load_address = 0;
+
+    uint32_t next;
+    for (;;) {
+        jit->link_site = NULL;
+        next           = jit->enter(gba, block->code);
+        if (!jit->link_site)
+            break;
+
+        // the exit jumps to a constant address: link it to the block there
+        uint8_t         *link_site  = jit->link_site;
+        uint32_t         generation = jit->generation;
+        gba_jit_block_t *target     = get_block(gba, next, thumb);
+        if (!target || !target->code)
+            break;
+        if (generation == jit->generation)
+            patch_rel32(link_site, target->code);
+        block = target;
+    }
+
+    int64_t cycles = budget - jit->budget;
+    if (cycles == 0)
+        return false;
+
+    // the cpu is left like the interpreter would be after running the same instructions: the pipeline is refilled
+    // and the bus latches are those of the last access (the refill or the last load)
+    uint32_t read_data_latch   = gba->bus.read_data_latch;
+    uint32_t rom_address_latch = gba->bus.rom_address_latch;
+
+    cpu->regs[REG_PC]                 = next;
+    cpu->pipeline[PIPELINE_DECODING] = fetch(gba, thumb);
+    cpu->regs[REG_PC] += size;
+    cpu->pipeline[PIPELINE_FETCHING] = fetch(gba, thumb);
+    cpu->regs[REG_PC] += size;
+
+    if ((jit->load_address & ~1) == next) {
+        gba->bus.read_data_latch = read_data_latch;
+        if (jit->load_address & 1)
+            gba->bus.rom_address_latch = rom_address_latch;
+    }
+
+    jit->cycles_ahead    = cycles - 1;
+    jit->read_data_latch = gba->bus.read_data_latch;
+    return true;
+}
+
+void gba_jit_flush(gba_t *gba) {
+    gba_jit_t *jit = &gba->jit;
+
+    memset(jit->table, 0, TABLE_SIZE * sizeof(*jit->table));
+    memset(jit->iwram_pages, 0, sizeof(jit->iwram_pages));
+    memset(jit->ewram_pages, 0, sizeof(jit->ewram_pages));
+    jit->block_count = 0;
+    jit->code_end    = jit->blocks_start;
+    jit->generation++;
+}
+
+void gba_jit_init(gba_t *gba) {
+    gba_jit_t *jit = &gba->jit;
+
+    jit->code = mmap(NULL, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (jit->code == MAP_FAILED) {
+        errnoprintf("mapping the recompiler's code buffer");
+        jit->code = NULL;
+        return;
+    }
+
+    jit->table  = xcalloc(TABLE_SIZE, sizeof(*jit->table));
+    jit->blocks = xcalloc(MAX_BLOCKS, sizeof(*jit->blocks));
+
+    jit_compiler_t c = { .gba = gba, .p = jit->code };
+
+    // uint32_t enter(gba_t *gba, const uint8_t *block_code): saves the callee-saved registers used by the blocks
+    jit->enter = (uint32_t (*)(gba_t *, const uint8_t *)) c.p;
+    emit8(&c, 0x53); // push rbx
+    emit8(&c, 0x55); // push rbp
+    for (uint8_t r = R12; r <= R15; r++) {
+        emit8(&c, 0x41);
+        emit8(&c, 0x50 + (r & 7));
+    }
+    x_rr(&c, true, 0x81, ALU_SUB, RSP); // keeps the stack aligned
+    emit32(&c, 8);
+    x_rr(&c, true, 0x89, RDI, RBX);
+    x_rm(&c, true, 0x8B, RBP, OFFSET(jit.budget));
+    x_rr(&c, false, 0xFF, 4, RSI); // jmp rsi
+
+    // exit: eax holds the address of the next instruction
+    jit->exit = c.p;
+    x_rm(&c, true, 0x89, RBP, OFFSET(jit.budget));
+    x_rr(&c, true, 0x81, ALU_ADD, RSP);
+    emit32(&c, 8);
+    for (uint8_t r = R15; r >= R12; r--) {
+        emit8(&c, 0x41);
+        emit8(&c, 0x58 + (r & 7));
+    }
+    emit8(&c, 0x5D); // pop rbp
+    emit8(&c, 0x5B); // pop rbx
+    emit8(&c, 0xC3); // ret
+
+    jit->blocks_start = c.p;
+    jit->enabled      = true;
+    gba_jit_flush(gba);
+}
+
+void gba_jit_quit(gba_t *gba) {
+    if (!gba->jit.code)
+        return;
+
+    munmap(gba->jit.code, CODE_SIZE);
+    free(gba->jit.table);
+    free(gba->jit.blocks);
+}
+
+#endif
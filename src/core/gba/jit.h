@@ -0,0 +1,57 @@
+#pragma once
+
+#include "bus.h"
+
+#ifdef GBA_JIT
+
+#define GBA_JIT_PAGE_SHIFT 6 // the writes to IWRAM/EWRAM are checked against the translated code by pages of 64 bytes
+
+typedef struct gba_jit_block_t gba_jit_block_t;
+
+/**
+ * Recompiler of the basic blocks of ARM and THUMB instructions to x86-64 code (built with -DGBA_JIT).
+ *
+ * The translated blocks run the cpu ahead of the other components for a budget of cycles that ends before the next
+ * scheduler event, so no interrupt, timer or DMA can happen while they run. They only access IWRAM, EWRAM and ROM: the
+ * other accesses (IO, VRAM...) and the instructions that aren't translated are left to the interpreter.
+ */
+typedef struct {
+    bool     enabled;         // the interpreter runs all the instructions when false
+    uint32_t cycles_ahead;    // cycles already run by the cpu that the other components haven't caught up with yet
+    uint32_t read_data_latch; // bus.read_data_latch left by the cpu (the ppu's reads change it while it catches up)
+
+    int64_t  budget;       // cycles left to the translated code
+    uint32_t load_address; // address following the last load (bit 0 set if it was from ROM), 0 after a branch
+    uint8_t *link_site;    // jump of the last exit to its target if it can be linked to the target's block
+
+    uint8_t iwram_pages[(BUS_IWRAM_UNUSED - BUS_IWRAM) >> GBA_JIT_PAGE_SHIFT]; // pages with translated code
+    uint8_t ewram_pages[(BUS_EWRAM_UNUSED - BUS_EWRAM) >> GBA_JIT_PAGE_SHIFT];
+
+    uint8_t  *code;      // executable buffer of the translated blocks
+    uint8_t  *code_end;  // end of the used part of `code`
+    uint8_t  *blocks_start; // start of the blocks in `code` (after `enter` and `exit`)
+    uint32_t (*enter)(gba_t *gba, const uint8_t *block_code);
+    uint8_t  *exit;
+
+    gba_jit_block_t **table;  // translated blocks indexed by a hash of their address
+    gba_jit_block_t  *blocks; // storage of the translated blocks
+    size_t            block_count;
+    uint32_t          generation; // incremented when all the blocks are invalidated
+} gba_jit_t;
+
+void gba_jit_init(gba_t *gba);
+
+void gba_jit_quit(gba_t *gba);
+
+/**
+ * Runs the translated blocks from the current instruction. Returns false if it can't be run by them (the interpreter
+ * must then run it), true otherwise: the cpu then is `cycles_ahead` cycles ahead of the other components.
+ */
+bool gba_jit_run(gba_t *gba);
+
+/**
+ * Invalidates all the translated blocks. Called when the cpu or the DMA write to a page with translated code.
+ */
+void gba_jit_flush(gba_t *gba);
+
+#endif
@@ -27,19 +27,32 @@
         (gba)->ppu.pixels[((y) * GBA_SCREEN_WIDTH * 4) + ((x) * 4) + 3] = 0xFF; \
     } while (0)
 
-#define SET_PIXEL_COLOR(gba, x, y, c)            \
-    do {                                         \
-        uint8_t r = c & 0x001F;                  \
-        uint8_t g = (c >> 5) & 0x001F;           \
-        uint8_t b = (c >> 10) & 0x001F;          \
-        r         = (r << 3) | (r >> 2);         \
-        g         = (g << 3) | (g >> 2);         \
-        b         = (b << 3) | (b >> 2);         \
-        SET_PIXEL_RGB((gba), (x), (y), r, g, b); \
+#define SET_PIXEL_BGR555(gba, x, y, c) \
+    memcpy(&(gba)->ppu.pixels[((y) * GBA_SCREEN_WIDTH * 2) + ((x) * 2)], &(uint16_t) { (c) & 0x7FFF }, 2)
+
+#define SET_PIXEL_COLOR(gba, x, y, c)                                          \
+    do {                                                                       \
+        if ((gba)->base->opts.pixel_format == GBMULATOR_PIXEL_FORMAT_BGR555) { \
+            SET_PIXEL_BGR555((gba), (x), (y), (c));                            \
+        } else {                                                               \
+            uint8_t r = c & 0x001F;                                            \
+            uint8_t g = (c >> 5) & 0x001F;                                     \
+            uint8_t b = (c >> 10) & 0x001F;                                    \
+            r         = (r << 3) | (r >> 2);                                   \
+            g         = (g << 3) | (g >> 2);                                   \
+            b         = (b << 3) | (b >> 2);                                   \
+            SET_PIXEL_RGB((gba), (x), (y), r, g, b);                           \
+        }                                                                      \
     } while (0)
 
 void gba_ppu_reset(gba_t *gba) {
     memset(&gba->ppu, 0, sizeof(gba->ppu));
+    gba->ppu.is_frame_skipped = gba->base->opts.skip_rendering;
+    gba->ppu.pixels           = frame_buffers_init(&gba->ppu.frames, gba->ppu.buffers, GBA_SCREEN_WIDTH * gbmulator_get_pixel_size(gba->base->opts.pixel_format), GBA_SCREEN_HEIGHT);
+
+    // the current cycle is the first one of the line
+    gba_scheduler_schedule(gba, GBA_EVENT_HBLANK, gba->scheduler.now + HDRAW_CYCLES - 1);
+    gba_scheduler_schedule(gba, GBA_EVENT_SCANLINE, gba->scheduler.now + SCANLINE_CYCLES - 1);
 }
 
 static inline uint8_t render_text_tile_8bpp(gba_t *gba, uint32_t tile_base_addr, uint16_t tile_id, uint32_t x, uint32_t y, bool flip_x, bool flip_y) {
@@ -441,109 +454,119 @@ static inline void compositing(gba_t *gba) {
     SET_PIXEL_COLOR(gba, x, y, color);
 }
 
-void gba_ppu_step(gba_t *gba) {
-    gba_ppu_t *ppu = &gba->ppu;
-
-    ppu->scanline_cycles++; // TODO at the start or end of this func?
-
-    // TODO bg state machine that emulate accurate bg vram accesses
-    // TODO obj state machine that emulate accurate obj vram accesses --> renders objs 1 line before the current line
-
+static inline void draw_bg_and_composite(gba_t *gba) {
     switch (PPU_GET_MODE(gba)) {
     case 0:
+        draw_bg_mode0(gba);
+        break;
+    case 1:
+        draw_bg_mode1(gba);
+        break;
     case 2:
-        if (gba->bus.io[IO_VCOUNT] == GBA_SCREEN_HEIGHT + VBLANK_HEIGHT - 1)
-            draw_obj(gba, 0);
-        else
-            draw_obj(gba, gba->bus.io[IO_VCOUNT] + 1);
+        draw_bg_mode2(gba);
+        break;
+    case 3:
+        draw_bg_mode3(gba);
+        break;
+    case 4:
+        draw_bg_mode4(gba);
+        break;
+    case 5:
+        draw_bg_mode5(gba);
         break;
     default:
         break;
     }
 
-    switch (ppu->period) {
-    case GBA_PPU_PERIOD_HDRAW:
+    if (CHECK_BIT(gba->bus.io[IO_GREENSWAP], 0))
+        todo("green swap");
+
+    // TODO composite step
+    compositing(gba);
+}
+
+void gba_ppu_step(gba_t *gba) {
+    gba_ppu_t *ppu = &gba->ppu;
+
+    ppu->scanline_cycles++; // TODO at the start or end of this func?
+
+    // TODO bg state machine that emulate accurate bg vram accesses
+    // TODO obj state machine that emulate accurate obj vram accesses --> renders objs 1 line before the current line
+
+    // the drawing doesn't affect the timings (the objs of the first line are drawn during the last line of the previous
+    // frame so they are always drawn in case the next frame isn't skipped)
+    if (!ppu->is_frame_skipped || gba->bus.io[IO_VCOUNT] == GBA_SCREEN_HEIGHT + VBLANK_HEIGHT - 1) {
         switch (PPU_GET_MODE(gba)) {
         case 0:
-            draw_bg_mode0(gba);
-            break;
-        case 1:
-            draw_bg_mode1(gba);
-            break;
         case 2:
-            draw_bg_mode2(gba);
-            break;
-        case 3:
-            draw_bg_mode3(gba);
-            break;
-        case 4:
-            draw_bg_mode4(gba);
-            break;
-        case 5:
-            draw_bg_mode5(gba);
+            if (gba->bus.io[IO_VCOUNT] == GBA_SCREEN_HEIGHT + VBLANK_HEIGHT - 1)
+                draw_obj(gba, 0);
+            else
+                draw_obj(gba, gba->bus.io[IO_VCOUNT] + 1);
             break;
         default:
             break;
         }
+    }
 
-        if (CHECK_BIT(gba->bus.io[IO_GREENSWAP], 0))
-            todo("green swap");
-
-        // TODO composite step
-        compositing(gba);
+    if (ppu->period == GBA_PPU_PERIOD_HDRAW && !ppu->is_frame_skipped)
+        draw_bg_and_composite(gba);
+}
 
-        // TODO  Although the drawing time is only 960 cycles (240*4), the H-Blank flag is "0" for a total of 1006 cycles.
-        // --> 1006 - 960 == 46 --> this 46 offset is the composite offset?
-        // so we enter hblank really at 1006 cycles not 960
+void gba_ppu_hblank_event(gba_t *gba) {
+    gba_ppu_t *ppu = &gba->ppu;
 
-        if (ppu->scanline_cycles >= HDRAW_CYCLES) {
-            ppu->period = GBA_PPU_PERIOD_HBLANK;
-            SET_BIT(gba->bus.io[IO_DISPSTAT], 1);
+    // TODO  Although the drawing time is only 960 cycles (240*4), the H-Blank flag is "0" for a total of 1006 cycles.
+    // --> 1006 - 960 == 46 --> this 46 offset is the composite offset?
+    // so we enter hblank really at 1006 cycles not 960
 
-            if (gba->bus.io[IO_DISPSTAT] & 0b010010)
-                CPU_REQUEST_INTERRUPT(gba, IRQ_HBLANK);
-        }
-        break;
-    case GBA_PPU_PERIOD_HBLANK:
-        if (ppu->scanline_cycles >= SCANLINE_CYCLES) {
-            ppu->scanline_cycles = 0;
+    ppu->period = GBA_PPU_PERIOD_HBLANK;
+    SET_BIT(gba->bus.io[IO_DISPSTAT], 1);
 
-            gba->bus.io[IO_VCOUNT]++;
-            CHANGE_BIT(gba->bus.io[IO_DISPSTAT], 2, gba->bus.io[IO_VCOUNT] == gba->bus.io[IO_DISPCNT] >> 8);
+    // every pixel of the line has been composited
+    if (gba->base->opts.on_new_line && !ppu->is_frame_skipped && gba->bus.io[IO_VCOUNT] < GBA_SCREEN_HEIGHT)
+        gba->base->opts.on_new_line(ppu->pixels, gba->bus.io[IO_VCOUNT] + 1, GBA_SCREEN_HEIGHT);
 
-            if (gba->bus.io[IO_DISPSTAT] & 0b100100)
-                CPU_REQUEST_INTERRUPT(gba, IRQ_VCOUNT);
+    if (gba->bus.io[IO_DISPSTAT] & 0b010010)
+        CPU_REQUEST_INTERRUPT(gba, IRQ_HBLANK);
+}
 
-            ppu->period = GBA_PPU_PERIOD_HDRAW;
-            if (gba->bus.io[IO_VCOUNT] >= GBA_SCREEN_HEIGHT) {
-                ppu->period = GBA_PPU_PERIOD_VBLANK;
-                RESET_BIT(gba->bus.io[IO_DISPSTAT], 1);
-                SET_BIT(gba->bus.io[IO_DISPSTAT], 0);
+void gba_ppu_scanline_event(gba_t *gba) {
+    gba_ppu_t *ppu = &gba->ppu;
 
-                if (gba->bus.io[IO_DISPSTAT] & 0b001001)
-                    CPU_REQUEST_INTERRUPT(gba, IRQ_VBLANK);
-            }
-        }
-        break;
-    case GBA_PPU_PERIOD_VBLANK:
-        if (ppu->scanline_cycles >= SCANLINE_CYCLES) {
-            ppu->scanline_cycles = 0;
+    ppu->scanline_cycles = 0;
 
-            gba->bus.io[IO_VCOUNT]++;
-            CHANGE_BIT(gba->bus.io[IO_DISPSTAT], 2, gba->bus.io[IO_VCOUNT] == gba->bus.io[IO_DISPCNT] >> 8);
+    gba->bus.io[IO_VCOUNT]++;
+    CHANGE_BIT(gba->bus.io[IO_DISPSTAT], 2, gba->bus.io[IO_VCOUNT] == gba->bus.io[IO_DISPCNT] >> 8);
 
-            if (gba->bus.io[IO_DISPSTAT] & 0b100100)
-                CPU_REQUEST_INTERRUPT(gba, IRQ_VCOUNT);
+    if (gba->bus.io[IO_DISPSTAT] & 0b100100)
+        CPU_REQUEST_INTERRUPT(gba, IRQ_VCOUNT);
 
-            if (gba->bus.io[IO_VCOUNT] >= GBA_SCREEN_HEIGHT + VBLANK_HEIGHT) {
-                gba->bus.io[IO_VCOUNT] = 0;
-                ppu->period            = GBA_PPU_PERIOD_HDRAW;
-                RESET_BIT(gba->bus.io[IO_DISPSTAT], 0);
+    if (ppu->period == GBA_PPU_PERIOD_HBLANK) {
+        ppu->period = GBA_PPU_PERIOD_HDRAW;
+        if (gba->bus.io[IO_VCOUNT] >= GBA_SCREEN_HEIGHT) {
+            ppu->period = GBA_PPU_PERIOD_VBLANK;
+            RESET_BIT(gba->bus.io[IO_DISPSTAT], 1);
+            SET_BIT(gba->bus.io[IO_DISPSTAT], 0);
 
-                if (gba->base->opts.on_new_frame)
-                    gba->base->opts.on_new_frame(ppu->pixels);
-            }
+            if (gba->bus.io[IO_DISPSTAT] & 0b001001)
+                CPU_REQUEST_INTERRUPT(gba, IRQ_VBLANK);
         }
-        break;
+    } else if (gba->bus.io[IO_VCOUNT] >= GBA_SCREEN_HEIGHT + VBLANK_HEIGHT) {
+        gba->bus.io[IO_VCOUNT] = 0;
+        ppu->period            = GBA_PPU_PERIOD_HDRAW;
+        RESET_BIT(gba->bus.io[IO_DISPSTAT], 0);
+
+        if (!ppu->is_frame_skipped) {
+            uint8_t *frame = ppu->pixels;
+            ppu->pixels    = frame_buffers_publish(&ppu->frames);
+            if (gba->base->opts.on_new_frame)
+                gba->base->opts.on_new_frame(frame);
+        }
+        ppu->is_frame_skipped = gba->base->opts.skip_rendering;
     }
+
+    gba_scheduler_schedule(gba, GBA_EVENT_SCANLINE, gba->scheduler.now + SCANLINE_CYCLES);
+    if (ppu->period == GBA_PPU_PERIOD_HDRAW)
+        gba_scheduler_schedule(gba, GBA_EVENT_HBLANK, gba->scheduler.now + HDRAW_CYCLES);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "gba.h"
+#include "../frame_buffers.h"
 
 #define PPU_GET_MODE(gba) ((gba)->bus.io[IO_DISPCNT] & 0x07)
 
@@ -15,13 +16,24 @@ typedef struct {
     gba_ppu_period_t period;
 
     uint8_t obj_id;
+    uint8_t is_frame_skipped; // gbmulator_options_t.skip_rendering latched at the start of the current frame
 
     uint16_t line_layers[4][GBA_SCREEN_WIDTH];
     uint16_t obj_layers[2][GBA_SCREEN_WIDTH];
 
-    uint8_t pixels[GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT * 4];
+    uint8_t        *pixels; // back buffer of `frames`
+    frame_buffers_t frames;
+    uint8_t         buffers[FRAME_BUFFERS_COUNT * GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT * 4]; // only the first half is used with GBMULATOR_PIXEL_FORMAT_BGR555
 } gba_ppu_t;
 
 void gba_ppu_reset(gba_t *gba);
 
+/**
+ * Runs the drawing of the current cycle. The changes of period are made by gba_ppu_hblank_event() and
+ * gba_ppu_scanline_event() which are called by the scheduler.
+ */
 void gba_ppu_step(gba_t *gba);
+
+void gba_ppu_hblank_event(gba_t *gba);
+
+void gba_ppu_scanline_event(gba_t *gba);
@@ -0,0 +1,123 @@
+#include "gba_priv.h"
+
+static inline bool is_before(gba_scheduler_t *scheduler, uint8_t a, uint8_t b) {
+    if (scheduler->timestamps[a] != scheduler->timestamps[b])
+        return scheduler->timestamps[a] < scheduler->timestamps[b];
+    return a < b;
+}
+
+static inline void swap(gba_scheduler_t *scheduler, uint8_t i, uint8_t j) {
+    uint8_t event                             = scheduler->heap[i];
+    scheduler->heap[i]                        = scheduler->heap[j];
+    scheduler->heap[j]                        = event;
+    scheduler->heap_index[scheduler->heap[i]] = i;
+    scheduler->heap_index[scheduler->heap[j]] = j;
+}
+
+static void sift_up(gba_scheduler_t *scheduler, uint8_t i) {
+    while (i > 0) {
+        uint8_t parent = (i - 1) / 2;
+        if (!is_before(scheduler, scheduler->heap[i], scheduler->heap[parent]))
+            break;
+        swap(scheduler, i, parent);
+        i = parent;
+    }
+}
+
+static void sift_down(gba_scheduler_t *scheduler, uint8_t i) {
+    while (true) {
+        uint8_t first = i;
+        uint8_t left  = 2 * i + 1;
+        uint8_t right = 2 * i + 2;
+
+        if (left < scheduler->size && is_before(scheduler, scheduler->heap[left], scheduler->heap[first]))
+            first = left;
+        if (right < scheduler->size && is_before(scheduler, scheduler->heap[right], scheduler->heap[first]))
+            first = right;
+        if (first == i)
+            break;
+
+        swap(scheduler, i, first);
+        i = first;
+    }
+}
+
+static inline void update_next(gba_scheduler_t *scheduler) {
+    scheduler->next = scheduler->size ? scheduler->timestamps[scheduler->heap[0]] : UINT64_MAX;
+}
+
+static void remove_at(gba_scheduler_t *scheduler, uint8_t i) {
+    scheduler->heap_index[scheduler->heap[i]] = GBA_EVENT_COUNT;
+
+    scheduler->size--;
+    if (i == scheduler->size)
+        return;
+
+    // move the last event in the hole and restore the heap order from there
+    uint8_t moved                = scheduler->heap[scheduler->size];
+    scheduler->heap[i]           = moved;
+    scheduler->heap_index[moved] = i;
+    sift_up(scheduler, i);
+    sift_down(scheduler, scheduler->heap_index[moved]);
+}
+
+void gba_scheduler_schedule(gba_t *gba, gba_event_t event, uint64_t timestamp) {
+    gba_scheduler_t *scheduler = &gba->scheduler;
+
+    scheduler->timestamps[event] = MAX(timestamp, scheduler->now);
+
+    uint8_t i = scheduler->heap_index[event];
+    if (i == GBA_EVENT_COUNT) {
+        i                            = scheduler->size++;
+        scheduler->heap[i]           = event;
+        scheduler->heap_index[event] = i;
+    }
+
+    sift_up(scheduler, i);
+    sift_down(scheduler, scheduler->heap_index[event]);
+    update_next(scheduler);
+}
+
+void gba_scheduler_cancel(gba_t *gba, gba_event_t event) {
+    gba_scheduler_t *scheduler = &gba->scheduler;
+
+    if (scheduler->heap_index[event] == GBA_EVENT_COUNT)
+        return;
+
+    remove_at(scheduler, scheduler->heap_index[event]);
+    update_next(scheduler);
+}
+
+void gba_scheduler_run(gba_t *gba) {
+    gba_scheduler_t *scheduler = &gba->scheduler;
+
+    while (scheduler->size && scheduler->timestamps[scheduler->heap[0]] <= scheduler->now) {
+        gba_event_t event = scheduler->heap[0];
+        remove_at(scheduler, 0);
+
+        switch (event) {
+        case GBA_EVENT_HBLANK:
+            gba_ppu_hblank_event(gba);
+            break;
+        case GBA_EVENT_SCANLINE:
+            gba_ppu_scanline_event(gba);
+            break;
+        case GBA_EVENT_TMR0_OVERFLOW:
+        case GBA_EVENT_TMR1_OVERFLOW:
+        case GBA_EVENT_TMR2_OVERFLOW:
+        case GBA_EVENT_TMR3_OVERFLOW:
+            gba_tmr_overflow_event(gba, event - GBA_EVENT_TMR0_OVERFLOW);
+            break;
+        default:
+            break;
+        }
+    }
+
+    update_next(scheduler);
+}
+
+void gba_scheduler_reset(gba_t *gba) {
+    memset(&gba->scheduler, 0, sizeof(gba->scheduler));
+    memset(gba->scheduler.heap_index, GBA_EVENT_COUNT, sizeof(gba->scheduler.heap_index));
+    gba->scheduler.next = UINT64_MAX;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "gba.h"
+
+/**
+ * The events of the components that don't need to be stepped at each cycle. When several events are due at the same
+ * cycle, they are handled in this order.
+ */
+typedef enum {
+    GBA_EVENT_HBLANK,   // end of the HDraw period of a scanline
+    GBA_EVENT_SCANLINE, // end of a scanline (VCount increment, start and end of VBlank)
+    GBA_EVENT_TMR0_OVERFLOW,
+    GBA_EVENT_TMR1_OVERFLOW,
+    GBA_EVENT_TMR2_OVERFLOW,
+    GBA_EVENT_TMR3_OVERFLOW,
+    GBA_EVENT_COUNT
+} gba_event_t;
+
+typedef struct {
+    uint64_t now;  // timestamp (in cycles) of the current cycle
+    uint64_t next; // timestamp of the earliest scheduled event (UINT64_MAX if there is none)
+
+    uint64_t timestamps[GBA_EVENT_COUNT];
+    uint8_t  heap[GBA_EVENT_COUNT];       // the scheduled events in a binary min-heap ordered by timestamp then event
+    uint8_t  heap_index[GBA_EVENT_COUNT]; // position of each event in `heap` (GBA_EVENT_COUNT if it isn't scheduled)
+    uint8_t  size;
+} gba_scheduler_t;
+
+void gba_scheduler_reset(gba_t *gba);
+
+/**
+ * Schedules `event` at the cycle `timestamp` (not before the current one). If it was already scheduled, it is moved.
+ */
+void gba_scheduler_schedule(gba_t *gba, gba_event_t event, uint64_t timestamp);
+
+void gba_scheduler_cancel(gba_t *gba, gba_event_t event);
+
+/**
+ * Handles the events due at the current cycle. The handlers can schedule events again.
+ */
+void gba_scheduler_run(gba_t *gba);
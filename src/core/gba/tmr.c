@@ -17,54 +17,80 @@ static const uint16_t tmrcnts_h[GBA_TMR_COUNT] = { IO_TM0CNT_H, IO_TM1CNT_H, IO_
 
 static const uint16_t freq_divider_values[GBA_TMR_COUNT] = { 1, 64, 256, 1024 };
 
-static inline void tmr_step(gba_t *gba, uint8_t channel, bool *overflow) {
-    if (!IS_TM_ENABLED(gba, channel)) {
-        *overflow = false;
-        return;
-    }
+/**
+ * @returns true if the counter of `channel` is incremented by its divider (not by the overflows of the previous timer).
+ */
+static inline bool is_tm_running(gba_t *gba, uint8_t channel, uint16_t cnt_h) {
+    return (cnt_h & TMxCNT_L_E) && !(channel != 0 && (cnt_h & TMxCNT_L_C));
+}
+
+static inline void schedule_overflow(gba_t *gba, uint8_t channel) {
+    uint64_t increments = 0x10000 - IO_TMxCNT_L(gba, channel);
+    gba_scheduler_schedule(gba, GBA_EVENT_TMR0_OVERFLOW + channel, gba->tmr.instance[channel].start + increments * gba->tmr.instance[channel].divider - 1u);
+}
 
-    bool must_increment = *overflow;
-    if (!IS_TM_COUNTUP(gba, channel))
-        must_increment = gba->tmr.instance[channel].cycle++ >= gba->tmr.instance[channel].divider;
-
-    *overflow = false;
-    if (must_increment) {
-        gba->tmr.instance[channel].cycle = 0;
-        *overflow                        = IO_TMxCNT_L(gba, channel) == 0xFFFF;
-        if (*overflow) {
-            IO_TMxCNT_L(gba, channel) = gba->tmr.instance[channel].reload;
-            if (IS_TM_IRQ(gba, channel))
-                CPU_REQUEST_INTERRUPT(gba, IRQ_TIMER0 + channel);
-        } else {
-            IO_TMxCNT_L(gba, channel)++;
-        }
+static void tmr_overflow(gba_t *gba, uint8_t channel) {
+    IO_TMxCNT_L(gba, channel) = gba->tmr.instance[channel].reload;
+    if (IS_TM_IRQ(gba, channel))
+        CPU_REQUEST_INTERRUPT(gba, IRQ_TIMER0 + channel);
+
+    // the next timer counts the overflows of this one
+    uint8_t next = channel + 1;
+    if (next < GBA_TMR_COUNT && IS_TM_ENABLED(gba, next) && IS_TM_COUNTUP(gba, next)) {
+        if (IO_TMxCNT_L(gba, next) == 0xFFFF)
+            tmr_overflow(gba, next);
+        else
+            IO_TMxCNT_L(gba, next)++;
     }
 }
 
+void gba_tmr_sync(gba_t *gba, uint8_t channel) {
+    if (!is_tm_running(gba, channel, IO_TMxCNT_H(gba, channel)))
+        return;
+
+    // the counter can't overflow here: its overflow event is handled first
+    uint64_t increments = (gba->scheduler.now - gba->tmr.instance[channel].start) / gba->tmr.instance[channel].divider;
+    IO_TMxCNT_L(gba, channel) += increments;
+    gba->tmr.instance[channel].start += increments * gba->tmr.instance[channel].divider;
+}
+
+void gba_tmr_overflow_event(gba_t *gba, uint8_t channel) {
+    tmr_overflow(gba, channel);
+
+    gba->tmr.instance[channel].start = gba->scheduler.now + 1;
+    schedule_overflow(gba, channel);
+}
+
 void gba_tmr_set(gba_t *gba, uint16_t data, uint8_t channel) {
     // Note: When simultaneously changing the start bit from 0 to 1, and setting the reload value at the same time
     // (by a single 32bit I/O operation), then the newly written reload value is recognized as new counter value.
     // --> this is implicitly implemented because 32 bit writes in IO registers is done LSB first
 
-    bool is_enable_rising  = !(IO_TMxCNT_H(gba, channel) & TMxCNT_L_E) && (data & TMxCNT_L_E);
-    bool is_enable_falling = (IO_TMxCNT_H(gba, channel) & TMxCNT_L_E) && !(data & TMxCNT_L_E);
+    bool was_running = is_tm_running(gba, channel, IO_TMxCNT_H(gba, channel));
+    gba_tmr_sync(gba, channel);
+
+    bool is_enable_rising = !(IO_TMxCNT_H(gba, channel) & TMxCNT_L_E) && (data & TMxCNT_L_E);
     if (is_enable_rising) {
-        gba->tmr.instance[channel].cycle = 0;
-        IO_TMxCNT_L(gba, channel)        = gba->tmr.instance[channel].reload;
+        IO_TMxCNT_L(gba, channel) = gba->tmr.instance[channel].reload;
 
-        for (uint8_t i = channel + 1; IS_TM_COUNTUP(gba, i) && i < GBA_TMR_COUNT; i++)
+        for (uint8_t i = channel + 1; i < GBA_TMR_COUNT && IS_TM_COUNTUP(gba, i); i++)
             IO_TMxCNT_L(gba, i) = gba->tmr.instance[i].reload;
-    } else if (is_enable_falling) {
-        gba->tmr.instance[channel].cycle = 0;
     }
 
     gba->tmr.instance[channel].divider = freq_divider_values[data & TMxCNT_L_F];
-}
 
-void gba_tmr_step(gba_t *gba) {
-    bool overflow = false;
-    for (uint8_t i = 0; i < GBA_TMR_COUNT; i++)
-        tmr_step(gba, i, &overflow);
+    if (!is_tm_running(gba, channel, data)) {
+        gba_scheduler_cancel(gba, GBA_EVENT_TMR0_OVERFLOW + channel);
+        return;
+    }
+
+    // keep the cycles elapsed since the last increment if the timer was already running
+    if (is_enable_rising || !was_running)
+        gba->tmr.instance[channel].start = gba->scheduler.now;
+    else
+        gba->tmr.instance[channel].start = gba->scheduler.now - MIN(gba->scheduler.now - gba->tmr.instance[channel].start, gba->tmr.instance[channel].divider - 1u);
+
+    schedule_overflow(gba, channel);
 }
 
 void gba_tmr_reset(gba_t *gba) {
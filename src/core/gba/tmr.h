@@ -6,7 +6,7 @@
 
 typedef struct {
     struct {
-        uint32_t cycle;
+        uint64_t start; // when the counter was last in phase with its divider (see gba_tmr_sync())
         uint16_t reload;
         uint16_t divider;
     } instance[GBA_TMR_COUNT];
@@ -14,6 +14,12 @@ typedef struct {
 
 void gba_tmr_set(gba_t *gba, uint16_t data, uint8_t channel);
 
-void gba_tmr_step(gba_t *gba);
+/**
+ * Updates the counter of `channel` to the current cycle. The counters aren't incremented at each cycle: they are only
+ * caught up when they are read or reconfigured, and their overflows are events of the scheduler.
+ */
+void gba_tmr_sync(gba_t *gba, uint8_t channel);
+
+void gba_tmr_overflow_event(gba_t *gba, uint8_t channel);
 
 void gba_tmr_reset(gba_t *gba);
@@ -25,17 +25,20 @@ typedef struct __attribute__((packed)) {
     uint8_t data[];
 } gbmulator_savestate_t;
 
-typedef struct {
-    int16_t l;
-    int16_t r;
-} gbmulator_apu_sample_t;
-
 typedef enum {
     PPU_COLOR_PALETTE_GRAY,
     PPU_COLOR_PALETTE_ORIG,
     PPU_COLOR_PALETTE_END
 } gb_color_palette_t; // TODO rename?
 
+typedef enum {
+    GBMULATOR_PIXEL_FORMAT_RGBA8888, // 4 bytes per pixel: R, G, B, A in this order in memory
+    GBMULATOR_PIXEL_FORMAT_BGRA8888, // 4 bytes per pixel: B, G, R, A in this order in memory
+    GBMULATOR_PIXEL_FORMAT_RGB565,   // 2 bytes per pixel (native endianness): R in the 5 upper bits, B in the 5 lower bits
+    GBMULATOR_PIXEL_FORMAT_INDEXED8, // 1 byte per pixel: the DMG shade (0-3) in DMG mode, in CGB mode the bg (0-31) or obj (32-63) palette entry (palette * 4 + color) and 0xFF when the LCD is off
+    GBMULATOR_PIXEL_FORMAT_BGR555,   // 2 bytes per pixel (native endianness): the raw 15 bit CGB/GBA color (R in the 5 lower bits, bit 15 unused), without color correction (DMG shades are rounded down to 5 bits)
+} gbmulator_pixel_format_t;
+
 typedef enum {
     GBMULATOR_JOYPAD_A,
     GBMULATOR_JOYPAD_B,
@@ -50,9 +53,19 @@ typedef enum {
     GBMULATOR_JOYPAD_END,
 } gbmulator_joypad_t;
 
+/**
+ * The first `current_height` lines of the `total_height` lines of `pixels` are complete. For the GB/GBC/GBA ppus,
+ * `pixels` is the frame being rendered: its lines can be displayed as soon as they are drawn (beam racing) but it is
+ * only valid during the call.
+ */
 typedef void (*gbmulator_new_line_cb_t)(const uint8_t *pixels, size_t current_height, size_t total_height);
 typedef void (*gbmulator_new_frame_cb_t)(const uint8_t *pixels);
-typedef void (*gbmulator_new_sample_cb_t)(const gbmulator_apu_sample_t sample, uint32_t *dynamic_sampling_rate);
+/**
+ * `count` new stereo samples are available in `samples`, interleaved (left then right) and only valid during the call.
+ * They are always output at the `apu_sampling_rate` given to gbmulator_init(): adapting them to the rate they are
+ * played at is up to the frontend.
+ */
+typedef void (*gbmulator_new_samples_cb_t)(const int16_t *samples, size_t count);
 typedef void (*gbmulator_accelerometer_request_cb_t)(double *x, double *y);
 typedef bool (*gbmulator_camera_capture_image_cb_t)(uint8_t *image);
 
@@ -78,13 +91,17 @@ typedef struct {
     uint8_t         *rom;      // TODO this with gbmulator_get_options is ambiguous because it may be invalid after init: use gbmulator_get_rom
     size_t           rom_size; // TODO this with gbmulator_get_options is ambiguous because it may be invalid after init: use gbmulator_get_rom
 
-    gb_color_palette_t palette;
-    float              apu_speed;
-    uint32_t           apu_sampling_rate;
-
-    gbmulator_new_line_cb_t              on_new_line;              // TODO for now only used by gbprinter but it should be available or gb/gbc/gba
-    gbmulator_new_frame_cb_t             on_new_frame;             // the function called whenever the ppu has finished rendering a new frame
-    gbmulator_new_sample_cb_t            on_new_sample;            // the function called whenever a new audio sample is produced by the apu
+    gb_color_palette_t       palette;
+    gbmulator_pixel_format_t pixel_format; // format of the pixels given to on_new_frame (GBA games only support RGBA8888 and BGR555)
+    float                    apu_speed;
+    uint32_t                 apu_sampling_rate;
+    bool                     skip_boot;         // start GB/GBC games in their post boot ROM state (see gb_init())
+    bool                     scanline_renderer; // render GB/GBC scanlines in one pass instead of emulating the pixel FIFO (falls back to the pixel FIFO on raster effects)
+    bool                     skip_rendering;    // don't generate the pixels of the frames starting from now on (the ppu timings stay exact and they are neither given to on_new_frame nor published)
+
+    gbmulator_new_line_cb_t              on_new_line;              // the function called whenever the ppu has finished drawing a visible line (with the frame being rendered, see gbmulator_new_line_cb_t) or the printer has printed new lines
+    gbmulator_new_frame_cb_t             on_new_frame;             // the function called whenever the ppu has finished rendering a new frame (on the emulation thread, see also gbmulator_acquire_frame())
+    gbmulator_new_samples_cb_t           on_new_samples;           // the function called whenever a block of audio samples is produced by the apu
     gbmulator_accelerometer_request_cb_t on_accelerometer_request; // the function called whenever the MBC7 latches accelerometer data
     gbmulator_camera_capture_image_cb_t  on_camera_capture_image;  // the function called whenever the CAMERA requests image data
 } gbmulator_options_t;
@@ -28,3 +28,13 @@ void *xrealloc(void *ptr, size_t size) {
     }
     return new_ptr;
 }
+
+void *xaligned_calloc(size_t alignment, size_t size) {
+    void *ptr;
+    // aligned_alloc() requires the size to be a multiple of the alignment
+    if (!(ptr = aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1)))) {
+        errnoprintf("aligned_alloc");
+        exit(EXIT_FAILURE);
+    }
+    return memset(ptr, 0, size);
+}
@@ -7,9 +7,11 @@
 #include <time.h>
 
 #ifdef __GNUC__
-#define UNUSED __attribute__((unused))
+#define UNUSED        __attribute__((unused))
+#define ALWAYS_INLINE inline __attribute__((always_inline))
 #else
 #define UNUSED
+#define ALWAYS_INLINE inline
 #endif
 
 #define CHECK_BIT(var, pos)           ((var) & (1 << (pos)))
@@ -22,6 +24,8 @@
 
 #define ALIGN(x, n) ((x) & (~((n) - 1)))
 
+#define CACHE_LINE_SIZE 64
+
 #ifndef MIN
 #define MIN(x, y) ((x) < (y) ? (x) : (y))
 #endif
@@ -86,3 +90,9 @@ void *xmalloc(size_t size);
 void *xcalloc(size_t nmemb, size_t size);
 
 void *xrealloc(void *ptr, size_t size);
+
+/**
+ * Like xcalloc but the returned pointer is aligned to `alignment` (which must be a power of 2).
+ * The memory is freed with free().
+ */
+void *xaligned_calloc(size_t alignment, size_t size);
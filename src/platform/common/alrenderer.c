@@ -1,49 +1,239 @@
 #include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
 #include <AL/al.h>
 #include <AL/alc.h>
 
+#include "alrenderer.h"
+#include "audio_ring.h"
+#include "resampler.h"
 #include "../../core/core.h"
 
 #define AL_ERROR() alGetError() != AL_NO_ERROR
 
-#define N_BUFFERS 8
-#define N_SAMPLES 1024 // higher value reduces pitch variations, especially after init_buffers (best: 1024, min where is still good enough: 512)
-
-#define DRC_TARGET_QUEUE_SIZE ((N_BUFFERS / 4) * N_SAMPLES)
-#define DRC_MAX_FREQ_DIFF     0.02
-#define DRC_ALPHA             0.1
-
+#define N_BUFFERS 4
+
+// the total latency (the samples in the ring and in the queued buffers) adapts to the underruns between these bounds
+#define LATENCY_MIN_MS         20
+#define LATENCY_MAX_MS         40
+#define LATENCY_STEP_MS        5
+#define LATENCY_ADAPT_MS       1000 // the latency is increased after each period of this length with underruns...
+#define LATENCY_DECREASE_COUNT 10   // ...and decreased after this many periods without underruns
+#define RING_BUFFERS           2    // the dynamic rate control keeps this many buffers worth of samples in the ring
+#define RING_MS                250  // capacity of the ring
+#define IDLE_MS                100  // the source starving for longer than this isn't an underrun but a pause of the emulation
+
+#define LATENCY_HISTOGRAM_BINS   256
+#define LATENCY_HISTOGRAM_BIN_MS 0.5
+
+#define DRC_PERIOD_MS     10 // the resampling ratio is updated each time this many samples are queued
+#define DRC_MAX_FREQ_DIFF 0.02
+#define DRC_ALPHA         0.1
+
+/**
+ * The emulation thread writes the samples in the ring (alrenderer_queue_samples()). The audio thread pulls them from
+ * the ring to refill the buffers of the source as soon as it has played them. The source is only used with the mutex
+ * held, the ring and the statistics are lock-free.
+ */
 typedef struct {
-    ALCdevice             *device;
-    ALCcontext            *context;
-    ALuint                 source;
-    ALint                  sampling_rate;
-    ALuint                 buffers[N_BUFFERS];
-    gbmulator_apu_sample_t samples[N_SAMPLES];
-    ALsizei                samples_count;
-    float                  sound_level;
-    ALboolean              drc_enabled;
-    int                    ewma_queue_size;
+    ALCdevice   *device;
+    ALCcontext  *context;
+    ALuint       source;
+    ALint        sampling_rate;
+    ALuint       buffers[N_BUFFERS];
+    ALsizei      buffer_sizes[N_BUFFERS]; // number of stereo samples of each queued buffer (audio thread)
+    int16_t     *buffer_samples;          // the samples of the buffer being refilled (audio thread)
+    audio_ring_t ring;
+
+    // emulation thread
+    resampler_t *resampler;
+    ALsizei      input_sampling_rate;
+    float        sound_level;
+    ALboolean    drc_enabled;
+    double       ewma_latency;  // in samples
+    size_t       drc_countdown; // samples to queue until the next update of the resampling ratio
+
+    // audio thread
+    uint8_t  free_buffers[N_BUFFERS]; // indexes of the buffers that aren't queued
+    uint8_t  free_buffers_count;
+    bool     is_starved;      // the source has played all its buffers
+    uint64_t starved_time;    // when the source was found starved (in ms)
+    size_t   adapt_countdown; // samples to submit until the next adaptation of the latency
+    uint32_t adapt_underruns; // underruns since the last adaptation of the latency
+    uint32_t calm_periods;    // consecutive adaptation periods without underruns
+
+    pthread_t       thread;
+    pthread_mutex_t mutex;
+    bool            has_thread;
+    atomic_bool     is_running;
+
+    _Atomic uint32_t latency_ms;     // target total latency
+    _Atomic size_t   queued_samples; // samples of the buffers queued to the source
+
+    _Atomic uint32_t underruns;
+    _Atomic uint32_t overruns;
+    _Atomic uint32_t latency_histogram[LATENCY_HISTOGRAM_BINS];
 } alrenderer_t;
 
 static alrenderer_t alr;
 
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000ULL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @returns the number of stereo samples of a buffer for the current target latency.
+ */
+static inline ALsizei get_buffer_size(void) {
+    return alr.sampling_rate * atomic_load_explicit(&alr.latency_ms, memory_order_relaxed) / 1000 / (N_BUFFERS + RING_BUFFERS);
+}
+
 static inline void init_buffers(void) {
     // fill buffers with empty data to tell the source what format and sampling_rate they are using
     // (if we don't do this, queueing other data will fail until the queue has been emptied and we don't want this)
     alGenBuffers(N_BUFFERS, alr.buffers);
-    for (int i = 0; i < N_BUFFERS; i++)
+    for (int i = 0; i < N_BUFFERS; i++) {
         alBufferData(alr.buffers[i], AL_FORMAT_STEREO16, NULL, 0, alr.sampling_rate);
+        alr.buffer_sizes[i] = 0;
+    }
 
     // queue and play all the empty buffers (they will be marked as processed immediately but it simplifies the audio queueing logic)
     alSourceQueueBuffers(alr.source, N_BUFFERS, alr.buffers);
     alSourcePlay(alr.source);
 
-    alr.samples_count   = 0;
-    alr.ewma_queue_size = DRC_TARGET_QUEUE_SIZE; // init at DRC_TARGET_QUEUE_SIZE to avoid high pitch variations at the beginning
+    audio_ring_clear(&alr.ring);
+    atomic_store(&alr.queued_samples, 0);
+    alr.free_buffers_count = 0;
+    alr.is_starved         = true; // not an underrun when the first samples are queued
+    alr.starved_time       = 0;
+    alr.ewma_latency       = alr.sampling_rate * atomic_load(&alr.latency_ms) / 1000.0; // avoid high pitch variations at the beginning
+}
+
+static void record_latency(size_t latency) {
+    double ms  = latency * 1000.0 / alr.sampling_rate;
+    int    bin = MIN(ms / LATENCY_HISTOGRAM_BIN_MS, LATENCY_HISTOGRAM_BINS - 1);
+    atomic_fetch_add_explicit(&alr.latency_histogram[bin], 1, memory_order_relaxed);
+}
+
+/**
+ * Adapts the target latency to the underruns each LATENCY_ADAPT_MS of submitted samples.
+ */
+static void adapt_latency(ALsizei submitted) {
+    if (alr.adapt_countdown > (size_t) submitted) {
+        alr.adapt_countdown -= submitted;
+        return;
+    }
+    alr.adapt_countdown = alr.sampling_rate * LATENCY_ADAPT_MS / 1000;
+
+    uint32_t latency = atomic_load_explicit(&alr.latency_ms, memory_order_relaxed);
+    if (alr.adapt_underruns > 0) {
+        latency          = MIN(latency + LATENCY_STEP_MS, LATENCY_MAX_MS);
+        alr.calm_periods = 0;
+    } else if (++alr.calm_periods >= LATENCY_DECREASE_COUNT) {
+        latency          = MAX(latency - LATENCY_STEP_MS, LATENCY_MIN_MS);
+        alr.calm_periods = 0;
+    }
+    atomic_store_explicit(&alr.latency_ms, latency, memory_order_relaxed);
+    alr.adapt_underruns = 0;
+}
+
+static void count_underrun(void) {
+    atomic_fetch_add_explicit(&alr.underruns, 1, memory_order_relaxed);
+    alr.adapt_underruns++;
+}
+
+/**
+ * Refills the buffers the source has played with the samples of the ring. Called with the mutex held.
+ */
+static void pull_samples(void) {
+    ALint processed;
+    alGetSourcei(alr.source, AL_BUFFERS_PROCESSED, &processed);
+    if (AL_ERROR()) {
+        eprintf("Error checking source state\n");
+        return;
+    }
+
+    while (processed-- > 0) {
+        ALuint buffer;
+        alSourceUnqueueBuffers(alr.source, 1, &buffer);
+        if (AL_ERROR()) {
+            eprintf("Error unqueueing buffer\n");
+            return;
+        }
+
+        int i = 0;
+        while (i < N_BUFFERS - 1 && alr.buffers[i] != buffer)
+            i++;
+        atomic_fetch_sub_explicit(&alr.queued_samples, alr.buffer_sizes[i], memory_order_relaxed);
+        alr.free_buffers[alr.free_buffers_count++] = i;
+    }
+
+    // queue what the ring has (even less than a buffer) instead of waiting for it and letting the source starve
+    while (alr.free_buffers_count > 0) {
+        ALsizei size = audio_ring_read(&alr.ring, alr.buffer_samples, get_buffer_size());
+        if (size == 0)
+            break;
+
+        uint8_t i = alr.free_buffers[alr.free_buffers_count - 1];
+        alBufferData(alr.buffers[i], AL_FORMAT_STEREO16, alr.buffer_samples, size * 2 * sizeof(*alr.buffer_samples), alr.sampling_rate);
+        alSourceQueueBuffers(alr.source, 1, &alr.buffers[i]);
+        if (AL_ERROR()) {
+            eprintf("Error buffering data\n");
+            return;
+        }
+        alr.free_buffers_count--;
+        alr.buffer_sizes[i] = size;
+
+        size_t queued = atomic_fetch_add_explicit(&alr.queued_samples, size, memory_order_relaxed) + size;
+        record_latency(queued + audio_ring_count(&alr.ring));
+        adapt_latency(size);
+    }
+
+    ALint state;
+    alGetSourcei(alr.source, AL_SOURCE_STATE, &state);
+    if (AL_ERROR()) {
+        eprintf("Error getting source state\n");
+        return;
+    }
+
+    // the source stops when it has played all its buffers
+    if (state == AL_STOPPED && !alr.is_starved) {
+        alr.is_starved   = true;
+        alr.starved_time = now_ms();
+    }
+
+    if (alr.is_starved && alr.free_buffers_count < N_BUFFERS) {
+        // a short silence is an underrun, a long one means that the emulation had stopped outputting samples (paused, no
+        // game loaded, ...)
+        if (now_ms() - alr.starved_time < IDLE_MS)
+            count_underrun();
+        alr.is_starved = false;
+
+        alSourcePlay(alr.source);
+        if (AL_ERROR())
+            eprintf("Error restarting playback\n");
+    }
+}
+
+static void *audio_thread(void *arg) {
+    while (atomic_load(&alr.is_running)) {
+        pthread_mutex_lock(&alr.mutex);
+        pull_samples();
+        pthread_mutex_unlock(&alr.mutex);
+
+        // wake up twice per buffer so that the source never waits long for a refill
+        uint64_t        buffer_ns = get_buffer_size() * 1000000000ULL / alr.sampling_rate;
+        struct timespec sleep     = { .tv_sec = 0, .tv_nsec = buffer_ns / 2 };
+        nanosleep(&sleep, NULL);
+    }
+
+    return NULL;
 }
 
-ALboolean alrenderer_init(ALuint sampling_freq) {
+ALboolean alrenderer_init(ALsizei sampling_freq, ALsizei input_sampling_rate) {
     memset(&alr, 0, sizeof(alr));
 
     // Ouverture du device
@@ -76,14 +266,30 @@ ALboolean alrenderer_init(ALuint sampling_freq) {
 
     // printf("OpenAL version %s\n", alGetString(AL_VERSION));
 
+    atomic_init(&alr.latency_ms, LATENCY_MIN_MS);
+    alr.adapt_countdown = alr.sampling_rate * LATENCY_ADAPT_MS / 1000;
+    alr.buffer_samples  = xmalloc(alr.sampling_rate * LATENCY_MAX_MS / 1000 / (N_BUFFERS + RING_BUFFERS) * 2 * sizeof(*alr.buffer_samples));
+    audio_ring_init(&alr.ring, alr.sampling_rate * RING_MS / 1000);
+
+    alr.input_sampling_rate = input_sampling_rate;
+    alr.resampler           = resampler_init(input_sampling_rate, alr.sampling_rate);
+
     alGenSources(1, &alr.source);
     init_buffers();
 
     alr.drc_enabled = AL_TRUE;
+
+    // without threads (web), the buffers are refilled by the emulation thread each time it outputs samples
+    pthread_mutex_init(&alr.mutex, NULL);
+    atomic_store(&alr.is_running, true);
+    alr.has_thread = !pthread_create(&alr.thread, NULL, audio_thread, NULL);
+
     return AL_TRUE;
 }
 
 void alrenderer_clear_queue(void) {
+    pthread_mutex_lock(&alr.mutex);
+
     alSourceStop(alr.source);
 
     ALint processed;
@@ -98,14 +304,24 @@ void alrenderer_clear_queue(void) {
     }
 
     init_buffers();
+    resampler_clear(alr.resampler);
+
+    pthread_mutex_unlock(&alr.mutex);
 }
 
 void alrenderer_quit(void) {
+    if (alr.has_thread) {
+        atomic_store(&alr.is_running, false);
+        pthread_join(alr.thread, NULL);
+        alr.has_thread = false;
+    }
+
     if (alr.source != 0) {
         alrenderer_clear_queue();
 
         alDeleteSources(1, &alr.source);
         alr.source = 0;
+        pthread_mutex_destroy(&alr.mutex);
     }
 
     if (alr.context) {
@@ -118,118 +334,130 @@ void alrenderer_quit(void) {
         alr.device = NULL;
     }
 
+    audio_ring_quit(&alr.ring);
+    resampler_quit(alr.resampler);
+    alr.resampler = NULL;
+    free(alr.buffer_samples);
+    alr.buffer_samples = NULL;
+
     alr.sampling_rate = 0;
 }
 
 void alrenderer_pause(void) {
+    pthread_mutex_lock(&alr.mutex);
     alSourcePause(alr.source);
+    pthread_mutex_unlock(&alr.mutex);
 }
 
 void alrenderer_play(void) {
+    pthread_mutex_lock(&alr.mutex);
     alSourcePlay(alr.source);
+    pthread_mutex_unlock(&alr.mutex);
 }
 
 ALint alrenderer_get_sampling_rate(void) {
     return alr.sampling_rate;
 }
 
-static inline ALuint alrenderer_get_queue_size(void) {
-    // Get the number of all attached buffers
-    ALint queued;
-    alGetSourcei(alr.source, AL_BUFFERS_QUEUED, &queued);
-    if (AL_ERROR())
-        queued = 0;
-
-    // Get the number of all processed buffers (ready to be detached)
-    ALint processed;
-    alGetSourcei(alr.source, AL_BUFFERS_PROCESSED, &processed);
-    if (AL_ERROR())
-        processed = 0;
-
-    return (queued - processed) * sizeof(alr.samples) + alr.samples_count * sizeof(*alr.samples);
-}
-
 void alrenderer_enable_dynamic_rate_control(ALboolean enabled) {
     alr.drc_enabled = enabled;
 }
 
-static inline uint32_t dynamic_rate_control(void) {
+/**
+ * @returns the resampling ratio that keeps the latency at its target.
+ */
+static inline double dynamic_rate_control(void) {
     // https://github.com/kevinbchen/nes-emu/blob/a993b0a5c080bc689de5f41e1e492e9e219e14e6/src/audio.cpp#L39
-    int queue_size      = alrenderer_get_queue_size() / sizeof(gbmulator_apu_sample_t);
-    alr.ewma_queue_size = queue_size * DRC_ALPHA + alr.ewma_queue_size * (1.0 - DRC_ALPHA);
-
-    // Adjust sample frequency to try and maintain a constant queue size
-    double diff        = (alr.ewma_queue_size - DRC_TARGET_QUEUE_SIZE) / (double) DRC_TARGET_QUEUE_SIZE;
-    int    sample_rate = alr.sampling_rate * (1.0 - CLAMP(diff, -1.0, 1.0) * (DRC_MAX_FREQ_DIFF));
+    double target    = alr.sampling_rate * atomic_load_explicit(&alr.latency_ms, memory_order_relaxed) / 1000.0;
+    size_t latency   = audio_ring_count(&alr.ring) + atomic_load_explicit(&alr.queued_samples, memory_order_relaxed);
+    alr.ewma_latency = latency * DRC_ALPHA + alr.ewma_latency * (1.0 - DRC_ALPHA);
 
-    // double fill_level = queue_size / (double) (N_SAMPLES * N_BUFFERS);
-    // printf("fill_level=%lf dynamic_frequency=%d (sampling_rate=%d) DRC_TARGET_QUEUE_SIZE=%d queue_size=%d ewma_queue_size=%d\n",
-    //         fill_level, (ALsizei) sample_rate, sampling_rate, DRC_TARGET_QUEUE_SIZE, queue_size, ewma_queue_size);
-
-    return sample_rate;
+    // Adjust the resampling ratio to try and maintain a constant latency
+    double diff = (alr.ewma_latency - target) / target;
+    return (double) alr.sampling_rate / alr.input_sampling_rate * (1.0 - CLAMP(diff, -1.0, 1.0) * DRC_MAX_FREQ_DIFF);
 }
 
-void alrenderer_queue_sample(const gbmulator_apu_sample_t sample, uint32_t *dynamic_sampling_rate) {
-    alr.samples[alr.samples_count++] = (gbmulator_apu_sample_t) { .l = sample.l * alr.sound_level, .r = sample.r * alr.sound_level };
-
-    if (alr.samples_count < N_SAMPLES)
-        return;
-    alr.samples_count = 0;
-
-    ALint processed;
-    alGetSourcei(alr.source, AL_BUFFERS_PROCESSED, &processed);
-    if (AL_ERROR()) {
-        eprintf("Error checking source state\n");
-        return;
+void alrenderer_queue_samples(const int16_t *samples, size_t count) {
+    int16_t block[1024 * 2];
+    size_t  block_count = sizeof(block) / sizeof(*block) / 2;
+    bool    is_overrun  = false;
+
+    while (count > 0) {
+        size_t n = MIN(count, block_count);
+        for (size_t i = 0; i < n * 2; i++)
+            block[i] = samples[i] * alr.sound_level;
+        resampler_put_samples(alr.resampler, block, n);
+
+        // drop the samples that don't fit in the ring
+        size_t resampled;
+        while ((resampled = resampler_receive_samples(alr.resampler, block, block_count)) > 0)
+            is_overrun |= audio_ring_write(&alr.ring, block, resampled) < resampled;
+
+        samples += n * 2;
+        count   -= n;
+
+        if (alr.drc_countdown > n) {
+            alr.drc_countdown -= n;
+        } else {
+            alr.drc_countdown = alr.input_sampling_rate * DRC_PERIOD_MS / 1000;
+            resampler_set_ratio(alr.resampler, alr.drc_enabled ? dynamic_rate_control() : (double) alr.sampling_rate / alr.input_sampling_rate);
+        }
     }
 
-    if (processed <= 0)
-        return; // drop these samples if the audio queue is full
+    if (is_overrun)
+        atomic_fetch_add_explicit(&alr.overruns, 1, memory_order_relaxed);
 
-    ALuint recycled_buffer;
-    alSourceUnqueueBuffers(alr.source, 1, &recycled_buffer);
-    if (AL_ERROR()) {
-        eprintf("Error unqueueing buffer\n");
-        return;
+    if (!alr.has_thread) {
+        pthread_mutex_lock(&alr.mutex);
+        pull_samples();
+        pthread_mutex_unlock(&alr.mutex);
     }
+}
 
-    alBufferData(recycled_buffer, AL_FORMAT_STEREO16, alr.samples, sizeof(alr.samples), alr.sampling_rate);
-    alSourceQueueBuffers(alr.source, 1, &recycled_buffer);
-    if (AL_ERROR()) {
-        eprintf("Error buffering data\n");
-        return;
+void alrenderer_set_level(float level) {
+    alr.sound_level = CLAMP(level, 0.0f, 1.0f);
+}
+
+/**
+ * @returns the latency under which `percentile` percent of the recorded latencies are.
+ */
+static float get_latency_percentile(const uint32_t *histogram, uint64_t total, double percentile) {
+    uint64_t threshold = total * percentile / 100.0;
+    uint64_t sum       = 0;
+
+    for (int i = 0; i < LATENCY_HISTOGRAM_BINS; i++) {
+        sum += histogram[i];
+        if (sum > threshold)
+            return (i + 1) * LATENCY_HISTOGRAM_BIN_MS;
     }
 
-    if (alr.drc_enabled)
-        *dynamic_sampling_rate = dynamic_rate_control(); // TODO takes time to stabilize itself at the beginning and this is noticeable
+    return LATENCY_HISTOGRAM_BINS * LATENCY_HISTOGRAM_BIN_MS;
+}
 
-    ALint state;
-    alGetSourcei(alr.source, AL_SOURCE_STATE, &state);
-    if (AL_ERROR()) {
-        eprintf("Error getting source state\n");
-        return;
+float alrenderer_get_missing_ms(void) {
+    if (!alr.has_thread) {
+        // the buffers played since the emulation last output samples are still counted as queued
+        pthread_mutex_lock(&alr.mutex);
+        pull_samples();
+        pthread_mutex_unlock(&alr.mutex);
     }
 
-    // Make sure the source hasn't underrun
-    if (state != AL_PLAYING && state != AL_PAUSED) {
-        // If no buffers are queued, playback is finished
-        ALint queued;
-        alGetSourcei(alr.source, AL_BUFFERS_QUEUED, &queued);
-        if (AL_ERROR()) {
-            eprintf("Error getting queued buffers\n");
-            return;
-        } else if (queued == 0) {
-            return;
-        }
+    size_t latency = audio_ring_count(&alr.ring) + atomic_load_explicit(&alr.queued_samples, memory_order_relaxed);
+    return atomic_load_explicit(&alr.latency_ms, memory_order_relaxed) - latency * 1000.0f / alr.sampling_rate;
+}
 
-        alSourcePlay(alr.source);
-        if (AL_ERROR()) {
-            eprintf("Error restarting playback\n");
-            return;
-        }
+void alrenderer_get_stats(alrenderer_stats_t *stats) {
+    uint32_t histogram[LATENCY_HISTOGRAM_BINS];
+    uint64_t total = 0;
+    for (int i = 0; i < LATENCY_HISTOGRAM_BINS; i++) {
+        histogram[i] = atomic_load_explicit(&alr.latency_histogram[i], memory_order_relaxed);
+        total       += histogram[i];
     }
-}
 
-void alrenderer_set_level(float level) {
-    alr.sound_level = CLAMP(level, 0.0f, 1.0f);
+    stats->underruns      = atomic_load_explicit(&alr.underruns, memory_order_relaxed);
+    stats->overruns       = atomic_load_explicit(&alr.overruns, memory_order_relaxed);
+    stats->latency_ms     = atomic_load_explicit(&alr.latency_ms, memory_order_relaxed);
+    stats->latency_p50_ms = get_latency_percentile(histogram, total, 50.0);
+    stats->latency_p95_ms = get_latency_percentile(histogram, total, 95.0);
+    stats->latency_p99_ms = get_latency_percentile(histogram, total, 99.0);
 }
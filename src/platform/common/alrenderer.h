@@ -4,10 +4,21 @@
 
 #include "../../core/core.h"
 
+typedef struct {
+    uint32_t underruns;      // times the audio device ran out of samples while the emulation was outputting them
+    uint32_t overruns;       // blocks of samples partially dropped because the emulation outputs them too fast
+    float    latency_ms;     // current target latency, adapted to the underruns
+    float    latency_p50_ms; // percentiles of the latency (of the samples between the emulation and the audio device)
+    float    latency_p95_ms;
+    float    latency_p99_ms;
+} alrenderer_stats_t;
+
 /**
  * @param sampling_rate If > 0, this sets the sampling rate of the audio. It is detected automatically if set to 0.
+ * @param input_sampling_rate the sampling rate of the samples given to alrenderer_queue_samples(), which are resampled
+ * to the sampling rate of the audio.
  */
-ALboolean alrenderer_init(ALsizei sampling_rate);
+ALboolean alrenderer_init(ALsizei sampling_rate, ALsizei input_sampling_rate);
 
 ALint alrenderer_get_sampling_rate(void);
 
@@ -17,10 +28,24 @@ void alrenderer_quit(void);
 
 void alrenderer_enable_dynamic_rate_control(ALboolean enabled);
 
-void alrenderer_queue_sample(const gbmulator_apu_sample_t sample, uint32_t *dynamic_sampling_rate);
+/**
+ * Queues `count` interleaved stereo samples for playback (see gbmulator_new_samples_cb_t).
+ */
+void alrenderer_queue_samples(const int16_t *samples, size_t count);
 
 void alrenderer_pause(void);
 
 void alrenderer_play(void);
 
 void alrenderer_set_level(float level);
+
+/**
+ * @returns the duration of the samples missing to reach the target latency (negative if there are more), which is
+ * how much audio should be produced to keep the audio device fed without adding latency.
+ */
+float alrenderer_get_missing_ms(void);
+
+/**
+ * Gets the underruns, overruns and latency percentiles since alrenderer_init(). Can be called from any thread.
+ */
+void alrenderer_get_stats(alrenderer_stats_t *stats);
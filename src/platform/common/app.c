@@ -1,11 +1,13 @@
 #include <stdio.h>
 #include <unistd.h>
+#include <time.h>
 
 #include "app.h"
 #include "utils.h"
 #include "link.h"
 #include "glrenderer.h"
 #include "alrenderer.h"
+#include "timestretch.h"
 
 #include "../../core/core.h"
 
@@ -15,12 +17,28 @@
 
 #define MAX_TOUCHES 32
 
+// with beam racing, the lines of the frame being emulated are uploaded by bands of this many lines
+#define BEAM_RACING_BAND_HEIGHT 16
+
+#define STRETCHED_SAMPLES_BLOCK 1024
+
+// the apu always outputs its samples at this rate (exactly 64 samples per 4096 cycles), alrenderer resamples them to
+// the rate of the audio device
+#define APU_SAMPLING_RATE (GB_CPU_FREQ / 64)
+
+// with audio pacing, at most this many emulated frames are run per app frame: a host too slow to emulate in real time
+// slows the emulation down instead of freezing the gui trying to catch up
+#define MAX_CATCHUP_FRAMES 3
+
 static struct {
     bool                  is_paused;
     bool                  is_rewinding;
     uint32_t              steps_per_frame;
+    uint32_t              steps_per_emu_frame;
+    size_t                beam_racing_height; // lines of the frame being emulated already uploaded (config.beam_racing)
     glrenderer_t         *renderer;
     glrenderer_t         *printer_renderer;
+    timestretch_t        *stretcher; // compresses the audio in time at fast-forward speeds, keeping its pitch
     uint16_t              joypad_state;
     gbmulator_t          *emu;
     gbmulator_t          *linked_emu;
@@ -40,24 +58,126 @@ static struct {
         int      row_stride;
         int      rotation;
     } camera;
+
+    struct {
+        uint64_t last_frame_ns;   // when app_run_frame() was last called (0 if it wasn't since the last pause)
+        double   pending_samples; // samples of the steps run that the apu hasn't output yet (see get_paced_steps())
+        double   remaining_steps; // fraction of a step left to run by the time based pacing
+        uint32_t slow_frames;
+        uint32_t frame_time_histogram[APP_FRAME_TIME_BINS];
+    } pacing;
 } app;
 
+/**
+ * The apu runs at normal speed, even when the emulation is sped up, so that the pitch of its samples doesn't change.
+ * The samples are then produced faster than they are played and the stretcher compresses them in time.
+ */
+static void on_new_samples(const int16_t *samples, size_t count) {
+    app.pacing.pending_samples = MAX(app.pacing.pending_samples - count, 0.0);
+
+    if (app.config.speed <= 1.0f || app.linked_emu) {
+        alrenderer_queue_samples(samples, count);
+        return;
+    }
+
+    timestretch_put_samples(app.stretcher, samples, count);
+
+    int16_t stretched[STRETCHED_SAMPLES_BLOCK * 2];
+    size_t  stretched_count;
+    while ((stretched_count = timestretch_receive_samples(app.stretcher, stretched, STRETCHED_SAMPLES_BLOCK)) > 0)
+        alrenderer_queue_samples(stretched, stretched_count);
+}
+
 static void set_steps_per_frame(void) {
-    float speed = app.linked_emu ? 1.0f : app.config.speed;
+    float    speed               = app.linked_emu ? 1.0f : app.config.speed;
+    uint32_t steps_per_emu_frame = 0;
 
     switch (app.config.mode) {
     case GBMULATOR_MODE_GB:
     case GBMULATOR_MODE_GBC:
-        app.steps_per_frame = GB_CPU_STEPS_PER_FRAME * speed;
+        steps_per_emu_frame = GB_CPU_STEPS_PER_FRAME;
         break;
     case GBMULATOR_MODE_GBA:
-        app.steps_per_frame = GBA_CPU_STEPS_PER_FRAME * speed;
+        steps_per_emu_frame = GBA_CPU_STEPS_PER_FRAME;
         break;
     case GBMULATOR_MODE_GBPRINTER:
     default:
-        app.steps_per_frame = 0;
         break;
     }
+
+    app.steps_per_emu_frame = steps_per_emu_frame;
+    app.steps_per_frame     = steps_per_emu_frame * speed;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @returns true if the emulation follows the consumption of its samples by the audio device. This needs samples that
+ * are played at the speed they are emulated: the GB APU without fast-forward.
+ */
+static bool is_audio_master(void) {
+    return app.config.audio_pacing && app.config.mode != GBMULATOR_MODE_GBA && app.config.speed <= 1.0f && !app.linked_emu;
+}
+
+/**
+ * @returns the number of steps to run in an app frame with audio pacing.
+ */
+static uint32_t get_paced_steps(uint64_t elapsed_ns) {
+    double steps_per_ms = app.steps_per_emu_frame * app_get_fps() / 1000.0;
+    double steps;
+
+    if (is_audio_master()) {
+        // run the emulation until it has produced enough samples to keep the audio device fed, without counting the
+        // samples of the steps already run that the apu hasn't output yet (it outputs them at least once per frame)
+        double missing_ms = alrenderer_get_missing_ms() - app.pacing.pending_samples * 1000.0 / APU_SAMPLING_RATE;
+        steps             = MAX(missing_ms, 0.0) * steps_per_ms;
+    } else {
+        // without samples to follow (no apu or time-stretched samples), follow the time elapsed since the last frame
+        steps = app.pacing.remaining_steps + elapsed_ns / 1000000.0 * steps_per_ms * app.config.speed;
+    }
+
+    double max_steps = (double) MAX_CATCHUP_FRAMES * app.steps_per_frame;
+    if (steps > max_steps) {
+        // the host is too slow: drop what's left to catch up instead of accumulating it
+        app.pacing.slow_frames++;
+        steps = max_steps;
+    }
+
+    app.pacing.remaining_steps = is_audio_master() ? 0.0 : steps - (uint32_t) steps;
+    return steps;
+}
+
+static void record_frame_time(uint64_t elapsed_ns) {
+    size_t bin = MIN(elapsed_ns / (1000000.0 * APP_FRAME_TIME_BIN_MS), APP_FRAME_TIME_BINS - 1);
+    app.pacing.frame_time_histogram[bin]++;
+}
+
+/**
+ * GBC and GBA colors are given raw to the renderer which converts them in its shader (halving the upload size).
+ * DMG colors are kept as is so that the palettes are displayed exactly.
+ */
+static gbmulator_pixel_format_t get_pixel_format(gbmulator_mode_t mode) {
+    return mode == GBMULATOR_MODE_GB ? GBMULATOR_PIXEL_FORMAT_RGBA8888 : GBMULATOR_PIXEL_FORMAT_BGR555;
+}
+
+static void update_screen_format(void) {
+    gbmulator_options_t opts;
+    gbmulator_get_options(app.emu, &opts);
+
+    glrenderer_color_correction_t color_correction = GLRENDERER_COLOR_CORRECTION_NONE;
+#ifndef DISABLE_COLOR_CORRECTION
+    if (opts.mode == GBMULATOR_MODE_GBC)
+        color_correction = GLRENDERER_COLOR_CORRECTION_CGB;
+#endif
+
+    if (opts.pixel_format == GBMULATOR_PIXEL_FORMAT_BGR555)
+        glrenderer_set_screen_format(app.renderer, GLRENDERER_SCREEN_FORMAT_BGR555, color_correction);
+    else
+        glrenderer_set_screen_format(app.renderer, GLRENDERER_SCREEN_FORMAT_RGBA8888, color_correction);
 }
 
 static gbmulator_joypad_t app_keycode_to_joypad(unsigned int keycode) {
@@ -147,7 +267,7 @@ static inline void apply_config(void) {
 
     app_set_speed(app.config.speed);
 
-    alrenderer_enable_dynamic_rate_control(app.config.sound_drc);
+    alrenderer_enable_dynamic_rate_control(app.config.sound_drc && !is_audio_master());
     app_set_sound(app.config.sound);
 
     app_set_touchscreen_mode(app.config.enable_joypad);
@@ -180,7 +300,8 @@ __attribute_used__ void app_init(void) {
 
     app.renderer = glrenderer_init(screen_w, screen_h, 0);
 
-    alrenderer_init(0);
+    alrenderer_init(0, APU_SAMPLING_RATE);
+    app.stretcher = timestretch_init(APU_SAMPLING_RATE);
 
     apply_config();
 
@@ -222,6 +343,7 @@ __attribute_used__ void app_quit(void) {
 
     config_save_to_file(&app.config, get_config_path());
 
+    timestretch_quit(app.stretcher);
     alrenderer_quit();
     glrenderer_quit(app.renderer);
 }
@@ -232,15 +354,27 @@ __attribute_used__ void app_reset(void) {
 
     save_battery_to_file(app.emu, get_save_path(gbmulator_get_rom_title(app.emu)));
 
-    gbmulator_reset(app.emu, app.config.mode);
+    gbmulator_reset(app.emu, app.config.mode, get_pixel_format(app.config.mode));
+    update_screen_format();
     gbmulator_print_status(app.emu);
     alrenderer_clear_queue();
+    timestretch_clear(app.stretcher);
+    app.pacing.pending_samples = 0.0;
 }
 
 __attribute_used__ void app_run_frame(void) {
     if (app.is_paused)
         return;
 
+    uint64_t now        = now_ns();
+    uint64_t elapsed_ns = app.pacing.last_frame_ns ? now - app.pacing.last_frame_ns : 1000000000ULL / app_get_fps();
+    if (app.pacing.last_frame_ns)
+        record_frame_time(elapsed_ns);
+    app.pacing.last_frame_ns = now;
+
+    // the dynamic rate control would fight the audio pacing
+    alrenderer_enable_dynamic_rate_control(app.config.sound_drc && !is_audio_master());
+
     if (app.is_rewinding) {
         gbmulator_rewind(app.emu, -1);
     } else {
@@ -257,11 +391,34 @@ __attribute_used__ void app_run_frame(void) {
             }
         }
 
-        gbmulator_run_steps(app.emu, app.steps_per_frame);
+        // the linked emulators exchange their joypad once per frame of the emulated system: they run at a fixed pace
+        uint32_t steps = app.config.audio_pacing && !app.linked_emu ? get_paced_steps(elapsed_ns) : app.steps_per_frame;
+
+        // only the last emulated frame of each app frame is displayed: the frames starting before the last 2 frames worth of
+        // steps (enough to start a frame in GBC double speed mode too) don't need to be rendered
+        uint32_t skipped_steps = steps > 2 * app.steps_per_emu_frame ? steps - 2 * app.steps_per_emu_frame : 0;
+        if (skipped_steps) {
+            gbmulator_set_skip_rendering(app.emu, true);
+            gbmulator_run_steps(app.emu, skipped_steps);
+            gbmulator_set_skip_rendering(app.emu, false);
+        }
+        gbmulator_run_steps(app.emu, steps - skipped_steps);
+
+        // the apu outputs its samples at most one frame after their steps are run
+        double max_pending_samples = 2.0 * APU_SAMPLING_RATE / app_get_fps();
+        app.pacing.pending_samples += (double) steps * APU_SAMPLING_RATE / ((double) app.steps_per_emu_frame * app_get_fps());
+        app.pacing.pending_samples  = MIN(app.pacing.pending_samples, max_pending_samples);
     }
 }
 
 __attribute_used__ void app_render(void) {
+    // only the lines of the last frame emulated since the previous render (there can be several of them when fast
+    // forwarding) that changed are uploaded
+    bool           is_new;
+    const uint8_t *pixels = gbmulator_acquire_frame(app.emu, &is_new);
+    if (is_new && !app.config.beam_racing)
+        glrenderer_update_screen_rows(app.renderer, pixels, gbmulator_get_frame_dirty_lines(app.emu));
+
     glrenderer_render(app.renderer);
 }
 
@@ -395,8 +552,21 @@ static bool on_camera_capture_image(uint8_t *pixels) {
     return true;
 }
 
-static void on_new_frame_cb(const uint8_t *pixels) {
-    glrenderer_update_screen(app.renderer, pixels);
+/**
+ * Beam racing: uploads the lines as soon as they are emulated so that they are displayed by the next render even if
+ * their frame isn't finished. This reduces the latency by up to a frame at the cost of showing the top of a frame with
+ * the bottom of the previous one.
+ */
+static void on_new_line_cb(const uint8_t *pixels, size_t current_height, size_t total_height) {
+    // a new frame started
+    if (current_height <= app.beam_racing_height)
+        app.beam_racing_height = 0;
+
+    if (current_height - app.beam_racing_height < BEAM_RACING_BAND_HEIGHT && current_height < total_height)
+        return;
+
+    glrenderer_update_screen_band(app.renderer, pixels, app.beam_racing_height, current_height - app.beam_racing_height);
+    app.beam_racing_height = current_height;
 }
 
 __attribute_used__ bool app_load_cartridge(uint8_t *rom, size_t rom_size) {
@@ -407,11 +577,12 @@ __attribute_used__ bool app_load_cartridge(uint8_t *rom, size_t rom_size) {
         .rom                     = rom,
         .rom_size                = rom_size,
         .mode                    = app.config.mode,
-        .on_new_sample           = alrenderer_queue_sample,
-        .on_new_frame            = on_new_frame_cb,
+        .pixel_format            = get_pixel_format(app.config.mode),
+        .on_new_samples          = on_new_samples,
+        .on_new_line             = app.config.beam_racing ? on_new_line_cb : NULL,
         .on_camera_capture_image = on_camera_capture_image,
-        .apu_speed               = app.config.speed,
-        .apu_sampling_rate       = alrenderer_get_sampling_rate(),
+        .apu_speed               = 1.0f, // see on_new_samples()
+        .apu_sampling_rate       = APU_SAMPLING_RATE,
         .palette                 = app.config.color_palette
     };
     gbmulator_t *new_emu = gbmulator_init(&opts);
@@ -420,6 +591,7 @@ __attribute_used__ bool app_load_cartridge(uint8_t *rom, size_t rom_size) {
             opts.mode = GBMULATOR_MODE_GBC;
         else
             opts.mode = GBMULATOR_MODE_GBA;
+        opts.pixel_format = get_pixel_format(opts.mode);
 
         new_emu = gbmulator_init(&opts);
         if (!new_emu)
@@ -434,7 +606,10 @@ __attribute_used__ bool app_load_cartridge(uint8_t *rom, size_t rom_size) {
         gbmulator_quit(app.emu);
     }
     app.emu = new_emu;
+    update_screen_format();
     alrenderer_clear_queue();
+    timestretch_clear(app.stretcher);
+    app.pacing.pending_samples = 0.0;
 
     load_battery_from_file(app.emu, get_save_path(gbmulator_get_rom_title(app.emu)));
 
@@ -444,7 +619,8 @@ __attribute_used__ bool app_load_cartridge(uint8_t *rom, size_t rom_size) {
 }
 
 __attribute_used__ void app_set_pause(bool is_paused) {
-    app.is_paused = is_paused;
+    app.is_paused            = is_paused;
+    app.pacing.last_frame_ns = 0;
 
     if (app.is_paused)
         alrenderer_pause();
@@ -459,7 +635,34 @@ __attribute_used__ void app_set_sound(float value) {
 
 __attribute_used__ void app_set_drc(bool is_enabled) {
     app.config.sound_drc = is_enabled;
-    alrenderer_enable_dynamic_rate_control(app.config.sound_drc);
+    alrenderer_enable_dynamic_rate_control(app.config.sound_drc && !is_audio_master());
+}
+
+__attribute_used__ void app_set_audio_pacing(bool is_enabled) {
+    app.config.audio_pacing    = is_enabled;
+    app.pacing.last_frame_ns   = 0;
+    app.pacing.remaining_steps = 0.0;
+    alrenderer_enable_dynamic_rate_control(app.config.sound_drc && !is_audio_master());
+}
+
+__attribute_used__ void app_set_beam_racing(bool is_enabled) {
+    app.config.beam_racing = is_enabled;
+    app.beam_racing_height = 0;
+
+    if (!app.emu)
+        return;
+
+    gbmulator_options_t opts;
+    gbmulator_get_options(app.emu, &opts);
+    opts.on_new_line = is_enabled ? on_new_line_cb : NULL;
+    gbmulator_set_options(app.emu, &opts);
+
+    // the frames acquired during beam racing weren't uploaded: upload the last one as a whole to start from it again
+    if (!is_enabled) {
+        const uint8_t *pixels = gbmulator_acquire_frame(app.emu, NULL);
+        if (pixels)
+            glrenderer_update_screen(app.renderer, pixels);
+    }
 }
 
 __attribute_used__ gbmulator_mode_t app_get_mode(void) {
@@ -494,7 +697,13 @@ __attribute_used__ bool app_set_mode(gbmulator_mode_t mode) {
 __attribute_used__ void app_set_speed(float value) {
     app.config.speed = CLAMP(value, 1.0f, APP_MAX_SPEED);
     set_steps_per_frame();
-    gbmulator_set_apu_speed(app.emu, app.config.speed);
+
+    if (!app.stretcher)
+        return; // the config can be loaded before app_init()
+
+    timestretch_set_ratio(app.stretcher, app.config.speed);
+    if (app.config.speed <= 1.0f)
+        timestretch_clear(app.stretcher); // don't play what's left of the previous fast-forward at the next one
 }
 
 __attribute_used__ void app_set_palette(gb_color_palette_t value) {
@@ -563,6 +772,37 @@ __attribute_used__ uint32_t app_get_fps(void) {
     }
 }
 
+__attribute_used__ void app_get_audio_stats(alrenderer_stats_t *stats) {
+    alrenderer_get_stats(stats);
+}
+
+/**
+ * @returns the frame time under which `percentile` percent of the frames are.
+ */
+static float get_frame_time_percentile(const app_pacing_stats_t *stats, float percentile) {
+    uint32_t threshold = stats->frames * percentile / 100.0f;
+    uint32_t sum       = 0;
+    for (size_t i = 0; i < APP_FRAME_TIME_BINS; i++) {
+        sum += stats->frame_time_histogram[i];
+        if (sum > threshold)
+            return (i + 1) * APP_FRAME_TIME_BIN_MS;
+    }
+    return APP_FRAME_TIME_BINS * APP_FRAME_TIME_BIN_MS;
+}
+
+__attribute_used__ void app_get_pacing_stats(app_pacing_stats_t *stats) {
+    memcpy(stats->frame_time_histogram, app.pacing.frame_time_histogram, sizeof(stats->frame_time_histogram));
+    stats->slow_frames = app.pacing.slow_frames;
+
+    stats->frames = 0;
+    for (size_t i = 0; i < APP_FRAME_TIME_BINS; i++)
+        stats->frames += stats->frame_time_histogram[i];
+
+    stats->frame_time_p50_ms = get_frame_time_percentile(stats, 50.0f);
+    stats->frame_time_p95_ms = get_frame_time_percentile(stats, 95.0f);
+    stats->frame_time_p99_ms = get_frame_time_percentile(stats, 99.0f);
+}
+
 __attribute_used__ const char *app_get_rom_title(void) {
     return gbmulator_get_rom_title(app.emu);
 }
@@ -729,8 +969,6 @@ __attribute_used__ bool app_link_start(bool is_server) {
     if (app.sfd >= 0 && link_init_transfer(app.sfd, app.emu, &new_linked_emu)) {
         app.linked_emu = new_linked_emu;
         set_steps_per_frame();
-
-        gbmulator_set_apu_speed(app.emu, 1.0f);
         return true;
     } else {
         app.sfd = -1; // closed by link_init_transfer in case of error
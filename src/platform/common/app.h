@@ -1,9 +1,22 @@
 #pragma once
 
 #include "config.h"
+#include "alrenderer.h"
 
 #define APP_MAX_SPEED 8.0f
 
+#define APP_FRAME_TIME_BINS   128
+#define APP_FRAME_TIME_BIN_MS 0.5f
+
+typedef struct {
+    uint32_t frame_time_histogram[APP_FRAME_TIME_BINS]; // times between 2 app_run_frame() (the last bin has the longer ones)
+    uint32_t frames;
+    float    frame_time_p50_ms;
+    float    frame_time_p95_ms;
+    float    frame_time_p99_ms;
+    uint32_t slow_frames; // frames that couldn't catch up with the audio or the time elapsed (host too slow)
+} app_pacing_stats_t;
+
 typedef void (*printer_new_line_cb_t)(size_t current_height, size_t total_height);
 
 void app_init(void);
@@ -15,6 +28,11 @@ void app_quit(void);
 
 void app_reset(void);
 
+/**
+ * Runs one frame of the emulated system at the frame rate given by app_get_fps(). With config.audio_pacing, this
+ * instead runs as many steps as needed to keep the audio device fed (or to follow the time elapsed since the last call
+ * when the audio can't be followed) and should be called at each vsync of the display.
+ */
 void app_run_frame(void);
 
 void app_render(void);
@@ -41,6 +59,10 @@ void app_set_sound(float value);
 
 void app_set_drc(bool is_enabled);
 
+void app_set_audio_pacing(bool is_enabled);
+
+void app_set_beam_racing(bool is_enabled);
+
 gbmulator_mode_t app_get_mode(void);
 
 bool app_set_mode(gbmulator_mode_t mode);
@@ -63,6 +85,10 @@ void app_load_state(int slot);
 
 uint32_t app_get_fps(void);
 
+void app_get_audio_stats(alrenderer_stats_t *stats);
+
+void app_get_pacing_stats(app_pacing_stats_t *stats);
+
 const char *app_get_rom_title(void);
 
 void app_set_touchscreen_mode(bool enable);
@@ -0,0 +1,66 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#include "audio_ring.h"
+#include "../../core/core.h"
+
+void audio_ring_init(audio_ring_t *ring, size_t capacity) {
+    ring->capacity = 1;
+    while (ring->capacity < capacity)
+        ring->capacity <<= 1;
+
+    ring->samples = xmalloc(ring->capacity * 2 * sizeof(*ring->samples));
+    atomic_init(&ring->write_index, 0);
+    atomic_init(&ring->read_index, 0);
+}
+
+void audio_ring_quit(audio_ring_t *ring) {
+    free(ring->samples);
+    ring->samples = NULL;
+}
+
+size_t audio_ring_write(audio_ring_t *ring, const int16_t *samples, size_t count) {
+    size_t write_index = atomic_load_explicit(&ring->write_index, memory_order_relaxed);
+    // acquire: the consumer is done reading the samples before read_index, which can be overwritten
+    size_t read_index = atomic_load_explicit(&ring->read_index, memory_order_acquire);
+
+    count        = MIN(count, ring->capacity - (write_index - read_index));
+    size_t start = write_index & (ring->capacity - 1);
+    size_t first = MIN(count, ring->capacity - start);
+    memcpy(&ring->samples[start * 2], samples, first * 2 * sizeof(*samples));
+    memcpy(ring->samples, &samples[first * 2], (count - first) * 2 * sizeof(*samples));
+
+    // release: the written samples are visible to the consumer
+    atomic_store_explicit(&ring->write_index, write_index + count, memory_order_release);
+    return count;
+}
+
+size_t audio_ring_read(audio_ring_t *ring, int16_t *samples, size_t count) {
+    size_t read_index = atomic_load_explicit(&ring->read_index, memory_order_relaxed);
+    // acquire: the samples written before write_index are visible
+    size_t write_index = atomic_load_explicit(&ring->write_index, memory_order_acquire);
+
+    count        = MIN(count, write_index - read_index);
+    size_t start = read_index & (ring->capacity - 1);
+    size_t first = MIN(count, ring->capacity - start);
+    memcpy(samples, &ring->samples[start * 2], first * 2 * sizeof(*samples));
+    memcpy(&samples[first * 2], ring->samples, (count - first) * 2 * sizeof(*samples));
+
+    // release: the producer can overwrite the samples read
+    atomic_store_explicit(&ring->read_index, read_index + count, memory_order_release);
+    return count;
+}
+
+void audio_ring_clear(audio_ring_t *ring) {
+    size_t write_index = atomic_load_explicit(&ring->write_index, memory_order_acquire);
+    atomic_store_explicit(&ring->read_index, write_index, memory_order_release);
+}
+
+size_t audio_ring_count(audio_ring_t *ring) {
+    size_t read_index  = atomic_load_explicit(&ring->read_index, memory_order_acquire);
+    size_t write_index = atomic_load_explicit(&ring->write_index, memory_order_acquire);
+
+    // the read index is loaded first so that it can't be ahead of the write index
+    return write_index - read_index;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Lock-free single producer single consumer ring buffer of interleaved stereo samples. The emulation thread writes the
+ * samples of the apu in it and the audio thread reads them at the rate of the audio device without ever waiting for
+ * each other. Each index is only written by its side: the ring is empty when they are equal and full when they are
+ * `capacity` samples apart.
+ */
+typedef struct {
+    int16_t       *samples;
+    size_t         capacity;    // in stereo samples, a power of 2
+    _Atomic size_t write_index; // number of samples written since the ring was created (only written by the producer)
+    _Atomic size_t read_index;  // number of samples read since the ring was created (only written by the consumer)
+} audio_ring_t;
+
+/**
+ * @param capacity the minimum number of stereo samples the ring can hold (rounded up to a power of 2).
+ */
+void audio_ring_init(audio_ring_t *ring, size_t capacity);
+
+void audio_ring_quit(audio_ring_t *ring);
+
+/**
+ * Writes up to `count` stereo samples in the ring. Only called by the producer.
+ * @returns the number of samples written, which is less than `count` if the ring is full.
+ */
+size_t audio_ring_write(audio_ring_t *ring, const int16_t *samples, size_t count);
+
+/**
+ * Reads up to `count` stereo samples from the ring. Only called by the consumer.
+ * @returns the number of samples read, which is less than `count` if the ring is empty.
+ */
+size_t audio_ring_read(audio_ring_t *ring, int16_t *samples, size_t count);
+
+/**
+ * Discards the samples in the ring. Only called by the consumer.
+ */
+void audio_ring_clear(audio_ring_t *ring);
+
+/**
+ * @returns the number of samples in the ring. It may be outdated as soon as it is returned if it isn't called by the
+ * producer nor the consumer.
+ */
+size_t audio_ring_count(audio_ring_t *ring);
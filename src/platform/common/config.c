@@ -7,7 +7,7 @@
 #include "../../core/core.h"
 
 static void parse_config_line(config_t *config, const char *line) {
-    uint8_t color_palette, sound_drc, enable_joypad;
+    uint8_t color_palette, sound_drc, audio_pacing, enable_joypad, beam_racing;
     float   speed, sound, joypad_opacity;
     char    link_host[INET6_ADDRSTRLEN], link_port[6];
     uint8_t mode;
@@ -46,10 +46,18 @@ static void parse_config_line(config_t *config, const char *line) {
         config->sound_drc = sound_drc;
         return;
     }
+    if (sscanf(line, "audio_pacing=%hhu", &audio_pacing)) {
+        config->audio_pacing = audio_pacing;
+        return;
+    }
     if (sscanf(line, "enable_joypad=%hhu", &enable_joypad)) {
         config->enable_joypad = enable_joypad;
         return;
     }
+    if (sscanf(line, "beam_racing=%hhu", &beam_racing)) {
+        config->beam_racing = beam_racing;
+        return;
+    }
     if (sscanf(line, "color_palette=%hhu", &color_palette)) {
         if (color_palette < PPU_COLOR_PALETTE_END)
             config->color_palette = color_palette;
@@ -166,62 +174,64 @@ void config_load_from_string(config_t *config, const char *buf) {
 }
 
 char *config_save_to_string(config_t *config) {
-    static char config_str[512];
+    static char config_str[1024];
 
-    snprintf(config_str, 512,
-             "mode=%d\nspeed=%.1f\nsound=%.2f\njoypad_opacity=%.2f\nsound_drc=%d\nenable_joypad=%d\ncolor_palette=%d\nlink_host=%s\nlink_port=%s\n",
+    snprintf(config_str, sizeof(config_str),
+             "mode=%d\nspeed=%.1f\nsound=%.2f\njoypad_opacity=%.2f\nsound_drc=%d\naudio_pacing=%d\nenable_joypad=%d\nbeam_racing=%d\ncolor_palette=%d\nlink_host=%s\nlink_port=%s\n",
              config->mode,
              config->speed,
              config->sound,
              config->joypad_opacity,
              config->sound_drc,
+             config->audio_pacing,
              config->enable_joypad,
+             config->beam_racing,
              config->color_palette,
              config->link_host,
              config->link_port);
 
     // separate snprintfs because key_parser() can return a pointer which contents get overwritten at each call
     size_t len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "keyboard_right=%u\n", config->keybindings[GBMULATOR_JOYPAD_RIGHT]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "keyboard_right=%u\n", config->keybindings[GBMULATOR_JOYPAD_RIGHT]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "keyboard_left=%u\n", config->keybindings[GBMULATOR_JOYPAD_LEFT]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "keyboard_left=%u\n", config->keybindings[GBMULATOR_JOYPAD_LEFT]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "keyboard_up=%u\n", config->keybindings[GBMULATOR_JOYPAD_UP]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "keyboard_up=%u\n", config->keybindings[GBMULATOR_JOYPAD_UP]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "keyboard_down=%u\n", config->keybindings[GBMULATOR_JOYPAD_DOWN]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "keyboard_down=%u\n", config->keybindings[GBMULATOR_JOYPAD_DOWN]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "keyboard_a=%u\n", config->keybindings[GBMULATOR_JOYPAD_A]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "keyboard_a=%u\n", config->keybindings[GBMULATOR_JOYPAD_A]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "keyboard_b=%u\n", config->keybindings[GBMULATOR_JOYPAD_B]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "keyboard_b=%u\n", config->keybindings[GBMULATOR_JOYPAD_B]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "keyboard_select=%u\n", config->keybindings[GBMULATOR_JOYPAD_SELECT]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "keyboard_select=%u\n", config->keybindings[GBMULATOR_JOYPAD_SELECT]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "keyboard_start=%u\n", config->keybindings[GBMULATOR_JOYPAD_START]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "keyboard_start=%u\n", config->keybindings[GBMULATOR_JOYPAD_START]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "keyboard_l=%u\n", config->keybindings[GBMULATOR_JOYPAD_L]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "keyboard_l=%u\n", config->keybindings[GBMULATOR_JOYPAD_L]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "keyboard_r=%u\n", config->keybindings[GBMULATOR_JOYPAD_R]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "keyboard_r=%u\n", config->keybindings[GBMULATOR_JOYPAD_R]);
     len = strlen(config_str);
 
-    snprintf(&config_str[len], 512 - len, "gamepad_right=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_RIGHT]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "gamepad_right=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_RIGHT]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "gamepad_left=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_LEFT]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "gamepad_left=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_LEFT]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "gamepad_up=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_UP]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "gamepad_up=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_UP]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "gamepad_down=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_DOWN]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "gamepad_down=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_DOWN]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "gamepad_a=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_A]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "gamepad_a=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_A]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "gamepad_b=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_B]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "gamepad_b=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_B]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "gamepad_select=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_SELECT]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "gamepad_select=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_SELECT]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "gamepad_start=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_START]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "gamepad_start=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_START]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "gamepad_l=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_L]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "gamepad_l=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_L]);
     len = strlen(config_str);
-    snprintf(&config_str[len], 512 - len, "gamepad_r=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_R]);
+    snprintf(&config_str[len], sizeof(config_str) - len, "gamepad_r=%u\n", config->gamepad_bindings[GBMULATOR_JOYPAD_R]);
 
     return config_str;
 }
@@ -15,7 +15,9 @@ typedef struct {
     float              sound;
     float              joypad_opacity;
     uint8_t            sound_drc;
+    uint8_t            audio_pacing; // the emulation is run as fast as the audio device plays its samples (see app_run_frame())
     uint8_t            enable_joypad;
+    uint8_t            beam_racing;
     char               link_host[INET6_ADDRSTRLEN];
     char               link_port[6];
 
@@ -11,10 +11,10 @@
 
 static const char *vertex_shader_source =
     "#version 300 es\n"
-    "in vec2 position;\n"
-    "in vec2 tex_coord;\n"
-    "in float tint;\n"
-    "in float alpha;\n"
+    "layout(location = 0) in vec2 position;\n"
+    "layout(location = 1) in vec2 tex_coord;\n"
+    "layout(location = 2) in float tint;\n"
+    "layout(location = 3) in float alpha;\n"
     "out vec2 v_tex_coord;\n"
     "out float v_tint;\n"
     "out float v_alpha;\n"
@@ -39,6 +39,28 @@ static const char *fragment_shader_source =
     "    color = vec4(color.rgb * v_tint, color.a * v_alpha);\n"
     "}\n";
 
+// decodes the GLRENDERER_SCREEN_FORMAT_BGR555 screen texture: the integer math is the same as the CPU path (see
+// cgb_get_color() in src/core/gb/ppu.c and SET_PIXEL_COLOR in src/core/gba/ppu.c) so both give the exact same colors
+static const char *screen_bgr555_fragment_shader_source =
+    "#version 300 es\n"
+    "precision highp float;\n"
+    "precision highp usampler2D;\n"
+    "in vec2 v_tex_coord;\n"
+    "in float v_tint;\n"
+    "in float v_alpha;\n"
+    "out vec4 color;\n"
+    "uniform usampler2D tex;\n"
+    "uniform int color_correction;\n"
+    "void main() {\n"
+    "    uint c = texture(tex, v_tex_coord).r;\n"
+    "    uvec3 rgb = uvec3(c, c >> 5u, c >> 10u) & 0x1Fu;\n"
+    "    if (color_correction == 1)\n"
+    "        rgb = min(uvec3(26u * rgb.r + 4u * rgb.g + 2u * rgb.b, 24u * rgb.g + 8u * rgb.b, 6u * rgb.r + 4u * rgb.g + 22u * rgb.b), 960u) >> 2u;\n"
+    "    else\n"
+    "        rgb = (rgb << 3u) | (rgb >> 2u);\n"
+    "    color = vec4((vec3(rgb) / 255.0) * v_tint, v_alpha);\n"
+    "}\n";
+
 typedef struct {
     uint32_t x;
     uint32_t y;
@@ -47,9 +69,12 @@ typedef struct {
 } rect_t;
 
 struct glrenderer_t {
-    GLuint  screen_tex;
-    GLsizei screen_tex_w;
-    GLsizei screen_tex_h;
+    GLuint                        screen_tex;
+    GLsizei                       screen_tex_w;
+    GLsizei                       screen_tex_h;
+    glrenderer_screen_format_t    screen_format;
+    glrenderer_color_correction_t color_correction;
+    bool                          is_screen_tex_filled; // the screen texture holds a whole frame since its (re)allocation
 
     GLuint vao; // Vertex Array Object
     GLuint vbo; // Vertex Buffer Object
@@ -57,6 +82,9 @@ struct glrenderer_t {
 
     GLint u_tex;
     GLint u_proj;
+    GLint u_screen_tex;
+    GLint u_screen_proj;
+    GLint u_screen_color_correction;
 
     GLuint  btn_atlas_tex;
     GLsizei btn_atlas_tex_w;
@@ -75,8 +103,9 @@ struct glrenderer_t {
     GLfloat clear_b;
 };
 
-static GLuint shader_program             = 0;
-static size_t shader_program_ref_counter = 0;
+static GLuint shader_program               = 0;
+static GLuint screen_bgr555_shader_program = 0;
+static size_t shader_program_ref_counter   = 0;
 
 static rect_t btn_atlas_regions[] = {
     [GLRENDERER_OBJ_ID_A]               = { .x = 48, .y = 16, .w = 16, .h = 16 },
@@ -178,6 +207,21 @@ static GLuint create_texture(GLsizei width, GLsizei height, const GLvoid *pixels
     return texture_id;
 }
 
+/**
+ * (Re)allocates the screen texture storage for the current screen size and format.
+ */
+static void alloc_screen_texture(glrenderer_t *renderer) {
+    renderer->is_screen_tex_filled = false;
+
+    glBindTexture(GL_TEXTURE_2D, renderer->screen_tex);
+    // NULL as pixel data: opengl allocates texture but doesn't copy any pixel data
+    if (renderer->screen_format == GLRENDERER_SCREEN_FORMAT_BGR555)
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, renderer->screen_tex_w, renderer->screen_tex_h, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, NULL);
+    else
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, renderer->screen_tex_w, renderer->screen_tex_h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
 static void create_buffers(glrenderer_t *renderer) {
     glGenVertexArrays(1, &renderer->vao);
     glGenBuffers(1, &renderer->vbo);
@@ -260,6 +304,8 @@ glrenderer_t *glrenderer_init(GLsizei screen_w, GLsizei screen_h, uint32_t visib
 
     if (!shader_program)
         shader_program = create_shader_program(vertex_shader_source, fragment_shader_source);
+    if (!screen_bgr555_shader_program)
+        screen_bgr555_shader_program = create_shader_program(vertex_shader_source, screen_bgr555_fragment_shader_source);
     shader_program_ref_counter++;
 
     glrenderer_t *renderer = calloc(1, sizeof(*renderer));
@@ -277,6 +323,14 @@ glrenderer_t *glrenderer_init(GLsizei screen_w, GLsizei screen_h, uint32_t visib
     if (renderer->visible_btns_mask)
         create_buttons(renderer);
 
+    glUseProgram(screen_bgr555_shader_program);
+
+    renderer->u_screen_tex = glGetUniformLocation(screen_bgr555_shader_program, "tex");
+    glUniform1i(renderer->u_screen_tex, 0);
+
+    renderer->u_screen_proj             = glGetUniformLocation(screen_bgr555_shader_program, "proj");
+    renderer->u_screen_color_correction = glGetUniformLocation(screen_bgr555_shader_program, "color_correction");
+
     glUseProgram(shader_program);
 
     renderer->u_tex = glGetUniformLocation(shader_program, "tex");
@@ -320,7 +374,9 @@ void glrenderer_quit(glrenderer_t *renderer) {
 
         if (shader_program_ref_counter == 0) {
             glDeleteProgram(shader_program);
-            shader_program = 0;
+            glDeleteProgram(screen_bgr555_shader_program);
+            shader_program               = 0;
+            screen_bgr555_shader_program = 0;
         }
     }
 
@@ -334,16 +390,24 @@ void glrenderer_render(glrenderer_t *renderer) {
     glClearColor(renderer->clear_r, renderer->clear_g, renderer->clear_b, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
-    // Call to glUseProgram useless as only one program is ever used in the lifespan of a glrenderer_t instance
-    // and it was already called int glrenderer_init()
+    // shader_program is the one in use outside of this function (it was set in glrenderer_init()): the screen may need
+    // another one depending on its format
 
     glBindVertexArray(renderer->vao);
     glBindBuffer(GL_ARRAY_BUFFER, renderer->vbo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->ebo);
 
+    if (renderer->screen_format == GLRENDERER_SCREEN_FORMAT_BGR555) {
+        glUseProgram(screen_bgr555_shader_program);
+        glUniform1i(renderer->u_screen_color_correction, renderer->color_correction);
+    }
+
     glBindTexture(GL_TEXTURE_2D, renderer->screen_tex);
     glDrawElements(GL_TRIANGLE_STRIP, VERTEX_INDICES_OBJ_STRIDE, GL_UNSIGNED_SHORT, (GLvoid *) (GLRENDERER_OBJ_ID_SCREEN * VERTEX_INDICES_OBJ_STRIDE * sizeof(*vertex_indices)));
 
+    if (renderer->screen_format == GLRENDERER_SCREEN_FORMAT_BGR555)
+        glUseProgram(shader_program);
+
     if (renderer->visible_btns_mask) {
         glBindTexture(GL_TEXTURE_2D, renderer->btn_atlas_tex);
         glDrawElements(GL_TRIANGLE_STRIP, (sizeof(vertex_indices) / sizeof(*vertex_indices)) - VERTEX_INDICES_OBJ_STRIDE, GL_UNSIGNED_SHORT, 0);
@@ -356,26 +420,86 @@ void glrenderer_render(glrenderer_t *renderer) {
     glBindVertexArray(0);
 }
 
+/**
+ * Uploads the rows [y, y + h) of `pixels` (a whole screen) into the screen texture, which must be bound.
+ */
+static void upload_screen_rows(glrenderer_t *renderer, const uint8_t *pixels, GLint y, GLsizei h) {
+    if (renderer->screen_format == GLRENDERER_SCREEN_FORMAT_BGR555) {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, renderer->screen_tex_w, h, GL_RED_INTEGER, GL_UNSIGNED_SHORT, &pixels[y * renderer->screen_tex_w * 2]);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, renderer->screen_tex_w, h, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[y * renderer->screen_tex_w * 4]);
+    }
+}
+
 void glrenderer_update_screen(glrenderer_t *renderer, const GLvoid *pixels) {
     if (!renderer)
         return;
 
     glBindTexture(GL_TEXTURE_2D, renderer->screen_tex);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, renderer->screen_tex_w, renderer->screen_tex_h, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    upload_screen_rows(renderer, pixels, 0, renderer->screen_tex_h);
     glBindTexture(GL_TEXTURE_2D, 0);
+
+    renderer->is_screen_tex_filled = true;
 }
 
-void glrenderer_resize_screen(glrenderer_t *renderer, GLsizei width, GLsizei height) {
-    if (!renderer || (width == renderer->screen_tex_w && height == renderer->screen_tex_h))
+void glrenderer_update_screen_band(glrenderer_t *renderer, const GLvoid *pixels, GLint y, GLsizei h) {
+    if (!renderer || h <= 0)
         return;
 
     glBindTexture(GL_TEXTURE_2D, renderer->screen_tex);
-    // NULL as pixel data: opengl allocates texture but doesn't copy any pixel data
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    upload_screen_rows(renderer, pixels, y, h);
     glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void glrenderer_update_screen_rows(glrenderer_t *renderer, const GLvoid *pixels, const uint8_t *dirty_rows) {
+    if (!renderer)
+        return;
+
+    // the rows that didn't change must already be in the texture
+    if (!renderer->is_screen_tex_filled) {
+        glrenderer_update_screen(renderer, pixels);
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, renderer->screen_tex);
+    // one upload per run of consecutive dirty rows
+    for (GLint y = 0; y < renderer->screen_tex_h;) {
+        if (!dirty_rows[y]) {
+            y++;
+            continue;
+        }
+
+        GLint start = y;
+        while (y < renderer->screen_tex_h && dirty_rows[y])
+            y++;
+        upload_screen_rows(renderer, pixels, start, y - start);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void glrenderer_resize_screen(glrenderer_t *renderer, GLsizei width, GLsizei height) {
+    if (!renderer || (width == renderer->screen_tex_w && height == renderer->screen_tex_h))
+        return;
 
     renderer->screen_tex_w = width;
     renderer->screen_tex_h = height;
+
+    alloc_screen_texture(renderer);
+}
+
+void glrenderer_set_screen_format(glrenderer_t *renderer, glrenderer_screen_format_t format, glrenderer_color_correction_t color_correction) {
+    if (!renderer)
+        return;
+
+    renderer->color_correction = color_correction;
+
+    if (format == renderer->screen_format)
+        return;
+
+    renderer->screen_format = format;
+    alloc_screen_texture(renderer);
 }
 
 static inline void update_orthographic_proj(glrenderer_t *renderer, GLfloat left, GLfloat right, GLfloat bottom, GLfloat top, GLfloat near, GLfloat far) {
@@ -389,6 +513,10 @@ static inline void update_orthographic_proj(glrenderer_t *renderer, GLfloat left
     // clang-format on
 
     glUniformMatrix4fv(renderer->u_proj, 1, GL_FALSE, proj_data);
+
+    glUseProgram(screen_bgr555_shader_program);
+    glUniformMatrix4fv(renderer->u_screen_proj, 1, GL_FALSE, proj_data);
+    glUseProgram(shader_program);
 }
 
 static inline void update_vertices(glrenderer_t *renderer, GLint obj_id, rect_t *coords) {
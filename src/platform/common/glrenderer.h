@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdint.h>
 #include <GLES3/gl3.h>
 
 typedef struct glrenderer_t glrenderer_t;
@@ -24,6 +25,16 @@ typedef enum {
     GLRENDERER_OBJ_ID_SCREEN // must be the last element of this enum
 } glrenderer_obj_id_t;
 
+typedef enum {
+    GLRENDERER_SCREEN_FORMAT_RGBA8888,
+    GLRENDERER_SCREEN_FORMAT_BGR555 // 16 bit pixels holding a raw 15 bit color, converted (and color corrected) by the screen shader
+} glrenderer_screen_format_t;
+
+typedef enum {
+    GLRENDERER_COLOR_CORRECTION_NONE,
+    GLRENDERER_COLOR_CORRECTION_CGB // same as the CPU color correction of the CGB ppu (only applies to GLRENDERER_SCREEN_FORMAT_BGR555)
+} glrenderer_color_correction_t;
+
 glrenderer_t *glrenderer_init(GLsizei screen_w, GLsizei screen_h, uint32_t visible_btns_mask);
 
 void glrenderer_quit(glrenderer_t *renderer);
@@ -32,8 +43,21 @@ void glrenderer_render(glrenderer_t *renderer);
 
 void glrenderer_update_screen(glrenderer_t *renderer, const GLvoid *pixels);
 
+/**
+ * Same as glrenderer_update_screen() but only uploads the rows [y, y + h).
+ */
+void glrenderer_update_screen_band(glrenderer_t *renderer, const GLvoid *pixels, GLint y, GLsizei h);
+
+/**
+ * Same as glrenderer_update_screen() but only uploads the rows `y` for which `dirty_rows[y]` is not 0 (the whole screen
+ * if the texture wasn't filled since its last (re)allocation).
+ */
+void glrenderer_update_screen_rows(glrenderer_t *renderer, const GLvoid *pixels, const uint8_t *dirty_rows);
+
 void glrenderer_resize_screen(glrenderer_t *renderer, GLsizei width, GLsizei height);
 
+void glrenderer_set_screen_format(glrenderer_t *renderer, glrenderer_screen_format_t format, glrenderer_color_correction_t color_correction);
+
 void glrenderer_resize_viewport(glrenderer_t *renderer, GLsizei width, GLsizei height);
 
 glrenderer_obj_id_t glrenderer_get_obj_at_coord(glrenderer_t *renderer, uint32_t x, uint32_t y);
@@ -0,0 +1,260 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "resampler.h"
+#include "../../core/core.h"
+
+#define TAPS        64    // length of the filter in input samples, multiple of 8
+#define PHASES      256   // number of fractional positions the filter is precomputed for
+#define CUTOFF      0.91  // cutoff frequency of the filter relative to the nyquist frequency of the lowest rate
+#define KAISER_BETA 9.0   // the stopband attenuation of the kaiser window (about 90 dB)
+#define RATIO_GLIDE 0.001 // part of the distance to its target the ratio covers at each output sample
+
+/**
+ * Filters the TAPS samples of `left` and `right` with the coefficients `c0 + frac * (c1 - c0)`.
+ */
+typedef void (*filter_kernel_t)(const float *left, const float *right, const float *c0, const float *c1, float frac, float *output);
+
+struct resampler_t {
+    filter_kernel_t kernel;
+    float          *filter; // the coefficients for each of the PHASES + 1 fractional positions (TAPS each)
+
+    double step;        // input samples per output sample
+    double target_step; // the step the ratio glides to
+    double position;    // position of the next output sample in the input
+
+    // samples not consumed yet, deinterleaved (the first TAPS / 2 - 1 are the history before the next output sample)
+    float *left;
+    float *right;
+    size_t count;
+    size_t capacity;
+};
+
+#if defined(__x86_64__) || defined(__i386__)
+// AVX2 isn't enabled by the compiler flags: this is selected at runtime if the cpu supports it
+__attribute__((target("avx2,fma"))) static void filter_avx2(const float *left, const float *right, const float *c0, const float *c1, float frac, float *output) {
+    __m256 f         = _mm256_set1_ps(frac);
+    __m256 acc_left  = _mm256_setzero_ps();
+    __m256 acc_right = _mm256_setzero_ps();
+    for (size_t i = 0; i < TAPS; i += 8) {
+        __m256 a  = _mm256_loadu_ps(&c0[i]);
+        __m256 c  = _mm256_fmadd_ps(f, _mm256_sub_ps(_mm256_loadu_ps(&c1[i]), a), a);
+        acc_left  = _mm256_fmadd_ps(_mm256_loadu_ps(&left[i]), c, acc_left);
+        acc_right = _mm256_fmadd_ps(_mm256_loadu_ps(&right[i]), c, acc_right);
+    }
+
+    // the left sums in the low lanes and the right sums in the high lanes
+    __m256 sums = _mm256_hadd_ps(acc_left, acc_right);
+    sums        = _mm256_hadd_ps(sums, sums);
+    __m128 lanes = _mm_add_ps(_mm256_castps256_ps128(sums), _mm256_extractf128_ps(sums, 1));
+    output[0]    = _mm_cvtss_f32(lanes);
+    output[1]    = _mm_cvtss_f32(_mm_shuffle_ps(lanes, lanes, 1));
+}
+#endif
+
+#if defined(__SSE2__)
+static void filter_sse2(const float *left, const float *right, const float *c0, const float *c1, float frac, float *output) {
+    __m128 f         = _mm_set1_ps(frac);
+    __m128 acc_left  = _mm_setzero_ps();
+    __m128 acc_right = _mm_setzero_ps();
+    for (size_t i = 0; i < TAPS; i += 4) {
+        __m128 a  = _mm_loadu_ps(&c0[i]);
+        __m128 c  = _mm_add_ps(a, _mm_mul_ps(f, _mm_sub_ps(_mm_loadu_ps(&c1[i]), a)));
+        acc_left  = _mm_add_ps(acc_left, _mm_mul_ps(_mm_loadu_ps(&left[i]), c));
+        acc_right = _mm_add_ps(acc_right, _mm_mul_ps(_mm_loadu_ps(&right[i]), c));
+    }
+
+    float lanes_left[4];
+    float lanes_right[4];
+    _mm_storeu_ps(lanes_left, acc_left);
+    _mm_storeu_ps(lanes_right, acc_right);
+    output[0] = lanes_left[0] + lanes_left[1] + lanes_left[2] + lanes_left[3];
+    output[1] = lanes_right[0] + lanes_right[1] + lanes_right[2] + lanes_right[3];
+}
+#elif defined(__ARM_NEON)
+static void filter_neon(const float *left, const float *right, const float *c0, const float *c1, float frac, float *output) {
+    float32x4_t acc_left  = vdupq_n_f32(0.0f);
+    float32x4_t acc_right = vdupq_n_f32(0.0f);
+    for (size_t i = 0; i < TAPS; i += 4) {
+        float32x4_t a = vld1q_f32(&c0[i]);
+        float32x4_t c = vmlaq_n_f32(a, vsubq_f32(vld1q_f32(&c1[i]), a), frac);
+        acc_left      = vmlaq_f32(acc_left, vld1q_f32(&left[i]), c);
+        acc_right     = vmlaq_f32(acc_right, vld1q_f32(&right[i]), c);
+    }
+
+    float lanes_left[4];
+    float lanes_right[4];
+    vst1q_f32(lanes_left, acc_left);
+    vst1q_f32(lanes_right, acc_right);
+    output[0] = lanes_left[0] + lanes_left[1] + lanes_left[2] + lanes_left[3];
+    output[1] = lanes_right[0] + lanes_right[1] + lanes_right[2] + lanes_right[3];
+}
+#else
+static void filter_scalar(const float *left, const float *right, const float *c0, const float *c1, float frac, float *output) {
+    float sum_left  = 0.0f;
+    float sum_right = 0.0f;
+    for (size_t i = 0; i < TAPS; i++) {
+        float c    = c0[i] + frac * (c1[i] - c0[i]);
+        sum_left  += left[i] * c;
+        sum_right += right[i] * c;
+    }
+
+    output[0] = sum_left;
+    output[1] = sum_right;
+}
+#endif
+
+static filter_kernel_t select_kernel(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return filter_avx2;
+#endif
+
+#if defined(__SSE2__)
+    return filter_sse2;
+#elif defined(__ARM_NEON)
+    return filter_neon;
+#else
+    return filter_scalar;
+#endif
+}
+
+/**
+ * @returns the modified bessel function of the first kind of order 0 at `x`.
+ */
+static double bessel_i0(double x) {
+    double sum  = 1.0;
+    double term = 1.0;
+    for (int k = 1; term > sum * 1e-12; k++) {
+        term *= (x * x / 4.0) / ((double) k * k);
+        sum  += term;
+    }
+    return sum;
+}
+
+/**
+ * Computes the kaiser windowed sinc low-pass filter with a cutoff frequency `cutoff` (relative to the input rate) at
+ * each fractional position. Each one is normalized to a gain of 1 at DC.
+ */
+static void init_filter(float *filter, double cutoff) {
+    for (size_t phase = 0; phase <= PHASES; phase++) {
+        float *coefficients = &filter[phase * TAPS];
+        double sum          = 0.0;
+
+        for (size_t i = 0; i < TAPS; i++) {
+            // distance of the input sample to the output sample
+            double x      = (double) i - (TAPS / 2 - 1) - (double) phase / PHASES;
+            double w      = x / (TAPS / 2);
+            double window = bessel_i0(KAISER_BETA * sqrt(MAX(1.0 - w * w, 0.0))) / bessel_i0(KAISER_BETA);
+            double sinc   = x == 0.0 ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+
+            coefficients[i] = sinc * window;
+            sum            += coefficients[i];
+        }
+
+        for (size_t i = 0; i < TAPS; i++)
+            coefficients[i] /= sum;
+    }
+}
+
+static inline int16_t to_int16(float sample) {
+    sample += sample < 0.0f ? -0.5f : 0.5f;
+    return CLAMP(sample, (float) INT16_MIN, (float) INT16_MAX);
+}
+
+resampler_t *resampler_init(uint32_t input_rate, uint32_t output_rate) {
+    resampler_t *resampler = xcalloc(1, sizeof(*resampler));
+
+    resampler->kernel = select_kernel();
+    resampler->filter = xmalloc((PHASES + 1) * TAPS * sizeof(*resampler->filter));
+    init_filter(resampler->filter, CUTOFF * MIN(input_rate, output_rate) / 2.0 / input_rate);
+
+    resampler->capacity = TAPS * 4;
+    resampler->left     = xmalloc(resampler->capacity * sizeof(*resampler->left));
+    resampler->right    = xmalloc(resampler->capacity * sizeof(*resampler->right));
+
+    resampler_set_ratio(resampler, (double) output_rate / input_rate);
+    resampler->step = resampler->target_step;
+    resampler_clear(resampler);
+
+    return resampler;
+}
+
+void resampler_quit(resampler_t *resampler) {
+    if (!resampler)
+        return;
+
+    free(resampler->filter);
+    free(resampler->left);
+    free(resampler->right);
+    free(resampler);
+}
+
+void resampler_clear(resampler_t *resampler) {
+    // silence before the first sample
+    resampler->count    = TAPS / 2 - 1;
+    resampler->position = TAPS / 2 - 1;
+    memset(resampler->left, 0, resampler->count * sizeof(*resampler->left));
+    memset(resampler->right, 0, resampler->count * sizeof(*resampler->right));
+}
+
+void resampler_set_ratio(resampler_t *resampler, double ratio) {
+    resampler->target_step = 1.0 / ratio;
+}
+
+void resampler_put_samples(resampler_t *resampler, const int16_t *samples, size_t count) {
+    if (resampler->count + count > resampler->capacity) {
+        resampler->capacity = resampler->count + count;
+        resampler->left     = xrealloc(resampler->left, resampler->capacity * sizeof(*resampler->left));
+        resampler->right    = xrealloc(resampler->right, resampler->capacity * sizeof(*resampler->right));
+    }
+
+    float *left  = &resampler->left[resampler->count];
+    float *right = &resampler->right[resampler->count];
+    for (size_t i = 0; i < count; i++) {
+        left[i]  = samples[i * 2];
+        right[i] = samples[i * 2 + 1];
+    }
+    resampler->count += count;
+}
+
+size_t resampler_receive_samples(resampler_t *resampler, int16_t *samples, size_t count) {
+    size_t received = 0;
+
+    for (; received < count; received++) {
+        size_t index = resampler->position;
+        if (index + TAPS / 2 >= resampler->count)
+            break;
+
+        double phase     = (resampler->position - index) * PHASES;
+        size_t phase_idx = phase;
+        size_t start     = index - (TAPS / 2 - 1);
+
+        float output[2];
+        resampler->kernel(&resampler->left[start], &resampler->right[start], &resampler->filter[phase_idx * TAPS],
+                          &resampler->filter[(phase_idx + 1) * TAPS], phase - phase_idx, output);
+        samples[received * 2]     = to_int16(output[0]);
+        samples[received * 2 + 1] = to_int16(output[1]);
+
+        resampler->step     += (resampler->target_step - resampler->step) * RATIO_GLIDE;
+        resampler->position += resampler->step;
+    }
+
+    // discard the samples that are before the history of the next output sample
+    size_t consumed      = MIN((size_t) resampler->position - (TAPS / 2 - 1), resampler->count);
+    resampler->count    -= consumed;
+    resampler->position -= consumed;
+    memmove(resampler->left, &resampler->left[consumed], resampler->count * sizeof(*resampler->left));
+    memmove(resampler->right, &resampler->right[consumed], resampler->count * sizeof(*resampler->right));
+
+    return received;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Sampling rate conversion of interleaved stereo samples with a polyphase FIR filter: a windowed sinc is precomputed
+ * for a few hundred fractional positions between two input samples and each output sample is filtered with the
+ * interpolation of the two nearest ones.
+ * The ratio between the output and the input rates can be any real number and changed at any time: it glides to its
+ * new value so that adjusting it continuously (dynamic rate control) doesn't make audible steps in the pitch.
+ */
+typedef struct resampler_t resampler_t;
+
+/**
+ * @param input_rate the sampling rate of the samples given to the resampler.
+ * @param output_rate the nominal sampling rate of the samples received from the resampler, which sets the cutoff
+ * frequency of its filter.
+ */
+resampler_t *resampler_init(uint32_t input_rate, uint32_t output_rate);
+
+void resampler_quit(resampler_t *resampler);
+
+/**
+ * Forgets the samples given to the resampler that weren't received yet.
+ */
+void resampler_clear(resampler_t *resampler);
+
+/**
+ * @param ratio the output rate divided by the input rate, reached progressively.
+ */
+void resampler_set_ratio(resampler_t *resampler, double ratio);
+
+/**
+ * Gives `count` interleaved stereo samples to the resampler.
+ */
+void resampler_put_samples(resampler_t *resampler, const int16_t *samples, size_t count);
+
+/**
+ * Resamples the samples given to the resampler into up to `count` interleaved stereo samples written in `samples`.
+ * @returns the number of samples written, which is less than `count` only if there aren't enough samples to resample
+ * yet.
+ */
+size_t resampler_receive_samples(resampler_t *resampler, int16_t *samples, size_t count);
@@ -0,0 +1,219 @@
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "timestretch.h"
+#include "../../core/core.h"
+
+// lengths in ms, tuned for fast-forward ratios (2x to 8x)
+#define SEGMENT_MS 40 // length of the segments taken from the input
+#define OVERLAP_MS 8  // length of the crossfade between two segments
+#define SEEK_MS    15 // length of the window after the nominal position of a segment where it is searched
+
+struct timestretch_t {
+    float  ratio;
+    double skip_remainder; // fractional part of the input samples skipped after the last segment
+
+    size_t segment_length;
+    size_t overlap_length; // multiple of 4
+    size_t seek_length;
+
+    int16_t *input; // interleaved stereo samples not consumed yet
+    size_t   input_count;
+    size_t   input_capacity;
+
+    int16_t *tail; // the overlap_length samples following the last segment in the input
+    bool     has_tail;
+
+    int16_t *output; // the last stretched segment (segment_length - overlap_length samples)
+    size_t   output_count;
+    size_t   output_index;
+
+    float *reference; // mono tail
+    float *window;    // mono seek window (seek_length + overlap_length samples)
+};
+
+/**
+ * @returns the dot product of the `n` first elements of `a` and `b`.
+ */
+static float dot_product(const float *a, const float *b, size_t n) {
+    float  sum = 0.0f;
+    size_t i   = 0;
+
+#if defined(__SSE__)
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&a[i]), _mm_loadu_ps(&b[i])));
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, acc);
+    sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(__ARM_NEON)
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; i + 4 <= n; i += 4)
+        acc = vmlaq_f32(acc, vld1q_f32(&a[i]), vld1q_f32(&b[i]));
+
+    float lanes[4];
+    vst1q_f32(lanes, acc);
+    sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#endif
+
+    for (; i < n; i++)
+        sum += a[i] * b[i];
+
+    return sum;
+}
+
+static inline void to_mono(float *dst, const int16_t *src, size_t count) {
+    for (size_t i = 0; i < count; i++)
+        dst[i] = (src[i * 2] + src[i * 2 + 1]) / 65536.0f;
+}
+
+/**
+ * @returns the offset in the seek window of the input where the waveform best continues the tail of the last segment
+ * (the maximum of their normalized cross-correlation).
+ */
+static size_t seek_best_offset(timestretch_t *stretcher) {
+    size_t overlap = stretcher->overlap_length;
+
+    to_mono(stretcher->reference, stretcher->tail, overlap);
+    to_mono(stretcher->window, stretcher->input, stretcher->seek_length + overlap);
+
+    double energy = 0.0;
+    for (size_t i = 0; i < overlap; i++)
+        energy += stretcher->window[i] * stretcher->window[i];
+
+    size_t best_offset = 0;
+    double best_score  = -DBL_MAX;
+    for (size_t offset = 0; offset < stretcher->seek_length; offset++) {
+        // the square of the normalized correlation, with its sign, to avoid a square root
+        double correlation = dot_product(stretcher->reference, &stretcher->window[offset], overlap);
+        double score       = correlation * (correlation < 0 ? -correlation : correlation) / (energy + 1e-9);
+        if (score > best_score) {
+            best_score  = score;
+            best_offset = offset;
+        }
+
+        float leaving  = stretcher->window[offset];
+        float entering = stretcher->window[offset + overlap];
+        energy        += entering * entering - leaving * leaving;
+    }
+
+    return best_offset;
+}
+
+/**
+ * Stretches the next segment of the input into the output.
+ * @returns false if there aren't enough input samples to do it yet.
+ */
+static bool stretch_segment(timestretch_t *stretcher) {
+    size_t segment = stretcher->segment_length;
+    size_t overlap = stretcher->overlap_length;
+
+    // the output advances by (segment - overlap) samples and the input by ratio times as many
+    double skip       = stretcher->skip_remainder + stretcher->ratio * (segment - overlap);
+    size_t skip_count = skip;
+    if (stretcher->input_count < MAX(stretcher->seek_length + segment, skip_count))
+        return false;
+
+    size_t offset = 0;
+    if (stretcher->has_tail) {
+        offset = seek_best_offset(stretcher);
+
+        const int16_t *in = &stretcher->input[offset * 2];
+        for (size_t i = 0; i < overlap * 2; i++) {
+            int32_t fade_in      = i / 2;
+            stretcher->output[i] = (stretcher->tail[i] * (int32_t) (overlap - fade_in) + in[i] * fade_in) / (int32_t) overlap;
+        }
+        memcpy(&stretcher->output[overlap * 2], &in[overlap * 2], (segment - 2 * overlap) * 2 * sizeof(*in));
+    } else {
+        memcpy(stretcher->output, stretcher->input, (segment - overlap) * 2 * sizeof(*stretcher->input));
+    }
+    stretcher->output_count = segment - overlap;
+    stretcher->output_index = 0;
+
+    memcpy(stretcher->tail, &stretcher->input[(offset + segment - overlap) * 2], overlap * 2 * sizeof(*stretcher->tail));
+    stretcher->has_tail = true;
+
+    stretcher->skip_remainder = skip - skip_count;
+    stretcher->input_count   -= skip_count;
+    memmove(stretcher->input, &stretcher->input[skip_count * 2], stretcher->input_count * 2 * sizeof(*stretcher->input));
+
+    return true;
+}
+
+timestretch_t *timestretch_init(uint32_t sampling_rate) {
+    timestretch_t *stretcher = xcalloc(1, sizeof(*stretcher));
+
+    stretcher->overlap_length = MAX(sampling_rate * OVERLAP_MS / 1000 / 4 * 4, 4u);
+    stretcher->segment_length = MAX(sampling_rate * SEGMENT_MS / 1000, 2 * stretcher->overlap_length);
+    stretcher->seek_length    = MAX(sampling_rate * SEEK_MS / 1000, 1u);
+
+    stretcher->tail      = xmalloc(stretcher->overlap_length * 2 * sizeof(*stretcher->tail));
+    stretcher->output    = xmalloc((stretcher->segment_length - stretcher->overlap_length) * 2 * sizeof(*stretcher->output));
+    stretcher->reference = xmalloc(stretcher->overlap_length * sizeof(*stretcher->reference));
+    stretcher->window    = xmalloc((stretcher->seek_length + stretcher->overlap_length) * sizeof(*stretcher->window));
+
+    stretcher->input_capacity = stretcher->seek_length + stretcher->segment_length;
+    stretcher->input          = xmalloc(stretcher->input_capacity * 2 * sizeof(*stretcher->input));
+
+    timestretch_set_ratio(stretcher, 1.0f);
+
+    return stretcher;
+}
+
+void timestretch_quit(timestretch_t *stretcher) {
+    if (!stretcher)
+        return;
+
+    free(stretcher->input);
+    free(stretcher->tail);
+    free(stretcher->output);
+    free(stretcher->reference);
+    free(stretcher->window);
+    free(stretcher);
+}
+
+void timestretch_clear(timestretch_t *stretcher) {
+    stretcher->input_count    = 0;
+    stretcher->output_count   = 0;
+    stretcher->output_index   = 0;
+    stretcher->skip_remainder = 0.0;
+    stretcher->has_tail       = false;
+}
+
+void timestretch_set_ratio(timestretch_t *stretcher, float ratio) {
+    stretcher->ratio = CLAMP(ratio, 1.0f, TIMESTRETCH_MAX_RATIO);
+}
+
+void timestretch_put_samples(timestretch_t *stretcher, const int16_t *samples, size_t count) {
+    if (stretcher->input_count + count > stretcher->input_capacity) {
+        stretcher->input_capacity = stretcher->input_count + count;
+        stretcher->input          = xrealloc(stretcher->input, stretcher->input_capacity * 2 * sizeof(*stretcher->input));
+    }
+
+    memcpy(&stretcher->input[stretcher->input_count * 2], samples, count * 2 * sizeof(*samples));
+    stretcher->input_count += count;
+}
+
+size_t timestretch_receive_samples(timestretch_t *stretcher, int16_t *samples, size_t count) {
+    size_t received = 0;
+
+    while (received < count) {
+        if (stretcher->output_index == stretcher->output_count && !stretch_segment(stretcher))
+            break;
+
+        size_t n = MIN(count - received, stretcher->output_count - stretcher->output_index);
+        memcpy(&samples[received * 2], &stretcher->output[stretcher->output_index * 2], n * 2 * sizeof(*samples));
+        received                += n;
+        stretcher->output_index += n;
+    }
+
+    return received;
+}
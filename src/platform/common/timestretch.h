@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TIMESTRETCH_MAX_RATIO 8.0f
+
+/**
+ * Time-stretching of interleaved stereo samples that keeps their pitch (WSOLA: waveform similarity overlap-add).
+ * The input is cut in overlapping segments, each one taken around its nominal position in the input at the position
+ * that best continues the waveform of the previous segment, and crossfaded together. Playing `ratio` seconds of input
+ * in one second this way doesn't shift its pitch like resampling it does.
+ */
+typedef struct timestretch_t timestretch_t;
+
+/**
+ * @param sampling_rate the sampling rate of the samples, which sets the length of the segments.
+ */
+timestretch_t *timestretch_init(uint32_t sampling_rate);
+
+void timestretch_quit(timestretch_t *stretcher);
+
+/**
+ * Forgets the samples given to the stretcher that weren't received yet.
+ */
+void timestretch_clear(timestretch_t *stretcher);
+
+/**
+ * @param ratio the duration of the input divided by the duration of the output, clamped between 1.0f and
+ * TIMESTRETCH_MAX_RATIO.
+ */
+void timestretch_set_ratio(timestretch_t *stretcher, float ratio);
+
+/**
+ * Gives `count` interleaved stereo samples to the stretcher.
+ */
+void timestretch_put_samples(timestretch_t *stretcher, const int16_t *samples, size_t count);
+
+/**
+ * Stretches the samples given to the stretcher into up to `count` interleaved stereo samples written in `samples`.
+ * @returns the number of samples written, which is less than `count` only if there aren't enough samples to stretch
+ * yet.
+ */
+size_t timestretch_receive_samples(timestretch_t *stretcher, int16_t *samples, size_t count);
@@ -34,6 +34,7 @@ static const config_t default_config = {
     .color_palette  = PPU_COLOR_PALETTE_ORIG,
     .sound          = 1.0f,
     .sound_drc      = 1,
+    .audio_pacing   = 0,
     .speed          = 1.0f,
     .joypad_opacity = 1.0f,
     .enable_joypad  = 0,
@@ -124,6 +125,7 @@ static AdwDialog      *restart_dialog, *printer_dialog, *preferences_dialog;
 static GtkAdjustment  *printer_scroll_adj;
 static GtkFileDialog  *open_rom_dialog, *save_printer_image_dialog;
 static guint           loop_source = 0;
+static gboolean        loop_source_is_tick; // the loop is a tick callback of emu_gl_area instead of a timeout source
 
 static bool     printer_window_allowed_to_close = FALSE;
 static gboolean printer_save_dialog_resume_loop = FALSE;
@@ -243,18 +245,35 @@ static int gamepad_button_name_parser(const char *button_name) {
     return 0;
 }
 
+static gboolean tick_func(GtkWidget *widget, GdkFrameClock *frame_clock, gpointer user_data) {
+    return loop_func(user_data);
+}
+
 void start_loop(void) {
     if (loop_source > 0 || link_task)
         return;
     app_set_pause(false);
-    loop_source = g_timeout_add(1000 / 60, G_SOURCE_FUNC(loop_func), NULL);
+
+    config_t config;
+    app_get_config(&config);
+
+    // with audio pacing, app_run_frame() runs as long as the audio needs: call it at each vsync of the display
+    loop_source_is_tick = config.audio_pacing;
+    if (loop_source_is_tick)
+        loop_source = gtk_widget_add_tick_callback(emu_gl_area, tick_func, NULL, NULL);
+    else
+        loop_source = g_timeout_add(1000 / 60, G_SOURCE_FUNC(loop_func), NULL);
 }
 
 void stop_loop(void) {
     if (loop_source == 0 || link_task)
         return;
     app_set_pause(true);
-    g_source_remove(loop_source);
+
+    if (loop_source_is_tick)
+        gtk_widget_remove_tick_callback(emu_gl_area, loop_source);
+    else
+        g_source_remove(loop_source);
     loop_source = 0;
 }
 
@@ -569,6 +588,16 @@ static void set_sound_drc(AdwSwitchRow *self, gpointer user_data) {
     app_set_drc(adw_switch_row_get_active(self));
 }
 
+static void set_audio_pacing(AdwSwitchRow *self, gpointer user_data) {
+    app_set_audio_pacing(adw_switch_row_get_active(self));
+
+    // restart the loop to switch between a timeout and a tick callback
+    if (loop_source > 0 && !link_task) {
+        stop_loop();
+        start_loop();
+    }
+}
+
 static void set_palette(AdwComboRow *self, GParamSpec *pspec, gpointer user_data) {
     app_set_palette(adw_combo_row_get_selected(self));
 }
@@ -1059,6 +1088,10 @@ static void activate_cb(GtkApplication *app) {
     adw_switch_row_set_active(ADW_SWITCH_ROW(widget), config.sound_drc);
     g_signal_connect(widget, "notify::active", G_CALLBACK(set_sound_drc), NULL);
 
+    widget = GTK_WIDGET(gtk_builder_get_object(builder, "pref_audio_pacing"));
+    adw_switch_row_set_active(ADW_SWITCH_ROW(widget), config.audio_pacing);
+    g_signal_connect(widget, "notify::active", G_CALLBACK(set_audio_pacing), NULL);
+
     speed_slider_container          = GTK_WIDGET(gtk_builder_get_object(builder, "pref_speed_container"));
     widget                          = GTK_WIDGET(gtk_builder_get_object(builder, "pref_speed"));
     GtkAdjustment *speed_adjustment = gtk_adjustment_new(config.speed, 1.0, APP_MAX_SPEED, 0.5, 1, 0.0);
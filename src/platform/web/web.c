@@ -15,6 +15,7 @@ static const config_t default_config = {
     .sound          = 0.25f,
     .speed          = 1.0f,
     .sound_drc      = true,
+    .audio_pacing   = false,
     .joypad_opacity = 1.0f,
 
     // clang-format off
@@ -49,10 +50,15 @@ EMSCRIPTEN_KEEPALIVE void set_pause(uint8_t value) {
 
     app_set_pause(value);
 
+    config_t config;
+    app_get_config(&config);
+
+    // with audio pacing, app_run_frame() runs as long as the audio needs: requestAnimationFrame (fps of 0) calls it at
+    // each vsync of the display
     if (value)
         emscripten_cancel_main_loop();
     else
-        emscripten_set_main_loop(loop_func, app_get_fps(), 0);
+        emscripten_set_main_loop(loop_func, config.audio_pacing ? 0 : app_get_fps(), 0);
 
     // clang-format off
     EM_ASM({
@@ -0,0 +1,192 @@
+/**
+ * Generates the decoding tables of the GBA cpu (src/core/gba/cpu.c) so they are constant data of the core instead of
+ * being built at runtime.
+ *
+ * usage: ./cpu_tables > cpu_tables.h
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define GET_BIT(var, pos) (((var) >> (pos)) & 1)
+
+typedef struct {
+    const char match_string[33]; // '1': bit MUST be set, '0': bit MUST be reset, '*': bit can be set OR reset
+    const char *handler;
+} decoder_rule_t;
+
+// Decoder rules definition order is important: they are matched in the order they are defined in their array
+static const decoder_rule_t arm_decoder_rules[] = {
+    { "____00010010____________0001____", "bx_handler"       }, // Branch and exchange
+    { "____0000000*____________1001____", "mul_handler"      }, // Multiply
+    { "____0000001*____________1001____", "mla_handler"      }, // Multiply
+    { "____00001*0*____________1001____", "mull_handler"     }, // Multiply Long
+    { "____00001*1*____________1001____", "mlal_handler"     }, // Multiply Long
+    { "____00010*00____________0000____", "mrs_handler"      }, // PSR Transfer
+    { "____00010*00____________1001____", "swp_handler"      }, // Single Data Swap
+    { "____000**0*0____________1**1____", "strh_reg_handler" }, // Halfword Data Transfer
+    { "____000**1*0____________1**1____", "strh_imm_handler" }, // Halfword Data Transfer
+    { "____000**0*1____________1**1____", "ldrh_reg_handler" }, // Halfword Data Transfer
+    { "____000**1*1____________1**1____", "ldrh_imm_handler" }, // Halfword Data Transfer
+    { "____00*0000*____________****____", "and_handler"      }, // Data processing
+    { "____00*10*10____________****____", "msr_handler"      }, // PSR Transfer
+    { "____00*0001*____________****____", "eor_handler"      }, // Data processing
+    { "____00*0010*____________****____", "sub_handler"      }, // Data processing
+    { "____00*0011*____________****____", "rsb_handler"      }, // Data processing
+    { "____00*0100*____________****____", "add_handler"      }, // Data processing
+    { "____00*0101*____________****____", "adc_handler"      }, // Data processing
+    { "____00*0110*____________****____", "sbc_handler"      }, // Data processing
+    { "____00*0111*____________****____", "rsc_handler"      }, // Data processing
+    { "____00*10001____________****____", "tst_handler"      }, // Data processing
+    { "____00*10011____________****____", "teq_handler"      }, // Data processing
+    { "____00*10101____________****____", "cmp_handler"      }, // Data processing
+    { "____00*10111____________****____", "cmn_handler"      }, // Data processing
+    { "____00*1100*____________****____", "orr_handler"      }, // Data processing
+    { "____00*1101*____________****____", "mov_handler"      }, // Data processing
+    { "____00*1110*____________****____", "bic_handler"      }, // Data processing
+    { "____00*1111*____________****____", "mvn_handler"      }, // Data processing
+    { "____01*****0____________****____", "str_handler"      }, // Single Data Transfer
+    { "____01*****1____________****____", "ldr_handler"      }, // Single Data Transfer
+    { "____100****0____________****____", "stm_handler"      }, // Block Data Transfer
+    { "____100****1____________****____", "ldm_handler"      }, // Block Data Transfer
+    { "____1010****____________****____", "b_handler"        }, // Branch
+    { "____1011****____________****____", "bl_handler"       }, // Branch
+    { "____1111****____________****____", "swi_handler"      }, // Software Interrupt
+};
+
+static const decoder_rule_t thumb_decoder_rules[] = {
+    { "00000***________", "thumb_lsl_handler"             }, // Move shifted register
+    { "00001***________", "thumb_lsr_handler"             }, // Move shifted register
+    { "00010***________", "thumb_asr_handler"             }, // Move shifted register
+    { "00011*0*________", "thumb_add_handler"             }, // Add/substract
+    { "00011*1*________", "thumb_sub_handler"             }, // Add/substract
+    { "00100***________", "thumb_mov_imm_handler"         }, // Move/compare/add/substract immediate
+    { "00101***________", "thumb_cmp_imm_handler"         }, // Move/compare/add/substract immediate
+    { "00110***________", "thumb_add_imm_handler"         }, // Move/compare/add/substract immediate
+    { "00111***________", "thumb_sub_imm_handler"         }, // Move/compare/add/substract immediate
+    { "01000100________", "thumb_add_hi_reg_handler"      }, // Hi register operations/branch exchange
+    { "01000101________", "thumb_cmp_hi_reg_handler"      }, // Hi register operations/branch exchange
+    { "01000110________", "thumb_mov_hi_reg_handler"      }, // Hi register operations/branch exchange
+    { "01000111________", "thumb_bx_handler"              }, // Hi register operations/branch exchange
+    { "010000**________", "thumb_alu_ops_handler"         }, // ALU operations
+    { "01001***________", "thumb_pc_relative_ldr_handler" }, // PC-relative load
+    { "01010*0*________", "thumb_str_reg_handler"         }, // Load/store with register offset
+    { "01011*0*________", "thumb_ldr_reg_handler"         }, // Load/store with register offset
+    { "0101001*________", "thumb_strh_reg_handler"        }, // Load/store with sign-extended byte/halfword
+    { "0101**1*________", "thumb_ldrh_reg_handler"        }, // Load/store with sign-extended byte/halfword
+    { "011*0***________", "thumb_strh_imm_handler"        }, // Load/store with immediate offset
+    { "011*1***________", "thumb_ldrh_imm_handler"        }, // Load/store with immediate offset
+    { "10000***________", "thumb_strh_handler"            }, // Load/store halfword
+    { "10001***________", "thumb_ldrh_handler"            }, // Load/store halfword
+    { "10010***________", "thumb_str_sp_handler"          }, // SP-relative load/store
+    { "10011***________", "thumb_ldr_sp_handler"          }, // SP-relative load/store
+    { "1010****________", "thumb_add_addr_handler"        }, // Load address
+    { "10110000________", "thumb_add_sp_handler"          }, // Add offset to stack pointer
+    { "1011010*________", "thumb_push_handler"            }, // Push/pop registers
+    { "1011110*________", "thumb_pop_handler"             }, // Push/pop registers
+    { "11000***________", "thumb_stm_handler"             }, // Multiple load/store
+    { "11001***________", "thumb_ldm_handler"             }, // Multiple load/store
+    { "11011111________", "thumb_swi_handler"             }, // Software interrupt
+    { "1101****________", "thumb_b_cond_handler"          }, // Conditonal branch
+    { "11100***________", "thumb_b_handler"               }, // Unconditional branch
+    { "1111****________", "thumb_bl_handler"              }, // Long branch with link
+};
+
+static const char *cond_names[] = { "EQ", "NE", "CS", "CC", "MI", "PL", "VS", "VC", "HI", "LS", "GE", "LT", "GT", "LE", "AL", "NV" };
+
+static const char *get_handler(uint32_t instr, const decoder_rule_t *decoder_rules, size_t decoder_rules_size) {
+    size_t rule_size = strlen(decoder_rules[0].match_string);
+
+    for (size_t i = 0; i < decoder_rules_size; i++) {
+        const decoder_rule_t *rule = &decoder_rules[i];
+
+        bool match = true;
+        for (size_t j = 0; j < rule_size && match; j++) {
+            switch (rule->match_string[rule_size - j - 1]) {
+            case '*':
+                break;
+            case '_':
+                j += 3;
+                break;
+            case '0':
+                match = GET_BIT(instr, j) == 0;
+                break;
+            case '1':
+                match = GET_BIT(instr, j) == 1;
+                break;
+            }
+        }
+
+        if (match)
+            return rule->handler;
+    }
+
+    return "not_implemented_handler";
+}
+
+static bool cond_passes(uint8_t cond, bool n, bool z, bool c, bool v) {
+    switch (cond) {
+    case 0x0: // EQ
+        return z;
+    case 0x1: // NE
+        return !z;
+    case 0x2: // CS
+        return c;
+    case 0x3: // CC
+        return !c;
+    case 0x4: // MI
+        return n;
+    case 0x5: // PL
+        return !n;
+    case 0x6: // VS
+        return v;
+    case 0x7: // VC
+        return !v;
+    case 0x8: // HI
+        return c && !z;
+    case 0x9: // LS
+        return !c || z;
+    case 0xA: // GE
+        return n == v;
+    case 0xB: // LT
+        return n != v;
+    case 0xC: // GT
+        return !z && n == v;
+    case 0xD: // LE
+        return z || n != v;
+    default: // AL (NV is treated as AL)
+        return true;
+    }
+}
+
+int main(void) {
+    printf("// Generated by src/tables/gba/cpu_tables.c: do not edit\n\n");
+
+    printf("// handler of the ARM instructions indexed by their bits 27-20 and 7-4\n");
+    printf("static const uint8_t arm_handlers[1 << 12] = {\n");
+    for (uint32_t i = 0; i < 1 << 12; i++) {
+        uint32_t instr = ((i & 0xFF0) << 16) | ((i & 0x00F) << 4);
+        printf("    [0x%03X] = HANDLER_ID(%s),\n", i, get_handler(instr, arm_decoder_rules, sizeof(arm_decoder_rules) / sizeof(*arm_decoder_rules)));
+    }
+    printf("};\n\n");
+
+    printf("// handler of the THUMB instructions indexed by their bits 15-8\n");
+    printf("static const uint8_t thumb_handlers[1 << 8] = {\n");
+    for (uint32_t i = 0; i < 1 << 8; i++)
+        printf("    [0x%02X] = HANDLER_ID(%s),\n", i, get_handler(i << 8, thumb_decoder_rules, sizeof(thumb_decoder_rules) / sizeof(*thumb_decoder_rules)));
+    printf("};\n\n");
+
+    printf("// whether a condition passes indexed by the condition and by the NZCV flags (bits 31-28 of the CPSR)\n");
+    printf("static const bool cond_passes[16][16] = {\n");
+    for (uint8_t cond = 0; cond < 16; cond++) {
+        printf("    {");
+        for (uint8_t nzcv = 0; nzcv < 16; nzcv++)
+            printf(" %d,", cond_passes(cond, GET_BIT(nzcv, 3), GET_BIT(nzcv, 2), GET_BIT(nzcv, 1), GET_BIT(nzcv, 0)));
+        printf(" }, // %s\n", cond_names[cond]);
+    }
+    printf("};\n");
+
+    return 0;
+}
@@ -0,0 +1,215 @@
+/**
+ * Spectral test of the band-limited audio output of the GB APU.
+ * A generated ROM plays a square wave on channel 2 for each tested frequency. The spectrum of the output is compared to
+ * the spectrum of the same square wave point-sampled at the output rate, which is what the APU used to output.
+ * Every frequency bin that isn't a harmonic of the square wave is aliasing (or noise): its power relative to the
+ * power of the harmonics in the audible range must be low and much lower than with point-sampling.
+ *
+ * usage: ./apu_test [sampling_rate]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "../core/core.h"
+#include "../core/utils.h"
+
+#define DEFAULT_SAMPLING_RATE 48000
+#define SETTLE_SAMPLES        4096  // skipped to let the high-pass filter settle
+#define FFT_SIZE              32768 // power of 2
+#define HARMONIC_BINS         8     // bins around a harmonic that belong to it (the Hann window leaks over a few bins)
+#define LOWEST_FREQ           30.0
+#define HIGHEST_FREQ          20000.0
+#define MAX_ALIASING_DB       -55.0 // maximum aliasing to harmonics power ratio
+#define MIN_IMPROVEMENT_DB    20.0  // minimum aliasing reduction compared to point-sampling
+
+#define ROM_SIZE 0x8000
+
+// the channel 2 frequency register values of the tested tones (131072 / (2048 - x) Hz)
+static const uint16_t tones[] = { 1798, 1923, 2000, 2024 };
+
+static int16_t samples[SETTLE_SAMPLES + FFT_SIZE];
+static size_t  samples_count;
+
+static void on_new_samples(const int16_t *new_samples, size_t count) {
+    for (size_t i = 0; i < count && samples_count < sizeof(samples) / sizeof(*samples); i++)
+        samples[samples_count++] = new_samples[i * 2]; // left
+}
+
+/**
+ * Builds a ROM that plays a 50% duty square wave at full volume on channel 2 (left and right) forever.
+ */
+static void build_tone_rom(uint8_t *rom, uint16_t freq) {
+    static const uint8_t logo[] = {
+        0xCE, 0xED, 0x66, 0x66, 0xCC, 0x0D, 0x00, 0x0B, 0x03, 0x73, 0x00, 0x83, 0x00, 0x0C, 0x00, 0x0D,
+        0x00, 0x08, 0x11, 0x1F, 0x88, 0x89, 0x00, 0x0E, 0xDC, 0xCC, 0x6E, 0xE6, 0xDD, 0xDD, 0xD9, 0x99,
+        0xBB, 0xBB, 0x67, 0x63, 0x6E, 0x0E, 0xEC, 0xCC, 0xDD, 0xDC, 0x99, 0x9F, 0xBB, 0xB9, 0x33, 0x3E
+    };
+    const uint8_t program[] = {
+        0x3E, 0x80, 0xE0, 0x26,                    // NR52 = 0x80: apu on
+        0x3E, 0x77, 0xE0, 0x24,                    // NR50 = 0x77: max volume
+        0x3E, 0x22, 0xE0, 0x25,                    // NR51 = 0x22: channel 2 on both outputs
+        0x3E, 0x80, 0xE0, 0x16,                    // NR21 = 0x80: 50% duty
+        0x3E, 0xF0, 0xE0, 0x17,                    // NR22 = 0xF0: volume 15, no envelope
+        0x3E, freq & 0xFF, 0xE0, 0x18,             // NR23: frequency low
+        0x3E, 0x80 | (freq >> 8), 0xE0, 0x19,      // NR24: trigger, frequency high
+        0x18, 0xFE                                 // jr -2
+    };
+
+    memset(rom, 0, ROM_SIZE);
+    rom[0x100] = 0x00; // nop
+    rom[0x101] = 0xC3; // jp 0x0150
+    rom[0x102] = 0x50;
+    rom[0x103] = 0x01;
+    memcpy(&rom[0x104], logo, sizeof(logo));
+    memcpy(&rom[0x134], "APU TEST", 8);
+
+    uint8_t checksum = 0;
+    for (int i = 0x0134; i <= 0x014C; i++)
+        checksum = checksum - rom[i] - 1;
+    rom[0x014D] = checksum;
+
+    memcpy(&rom[0x150], program, sizeof(program));
+}
+
+static void fft(double *re, double *im, size_t n) {
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            double tmp = re[i];
+            re[i]      = re[j];
+            re[j]      = tmp;
+            tmp        = im[i];
+            im[i]      = im[j];
+            im[j]      = tmp;
+        }
+    }
+
+    for (size_t len = 2; len <= n; len <<= 1) {
+        double angle = -2.0 * M_PI / len;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < len / 2; k++) {
+                double w_re = cos(angle * k);
+                double w_im = sin(angle * k);
+                double u_re = re[i + k];
+                double u_im = im[i + k];
+                double v_re = re[i + k + len / 2] * w_re - im[i + k + len / 2] * w_im;
+                double v_im = re[i + k + len / 2] * w_im + im[i + k + len / 2] * w_re;
+
+                re[i + k]           = u_re + v_re;
+                im[i + k]           = u_im + v_im;
+                re[i + k + len / 2] = u_re - v_re;
+                im[i + k + len / 2] = u_im - v_im;
+            }
+        }
+    }
+}
+
+/**
+ * @returns the power of the non harmonic bins relative to the power of the harmonic bins of a `tone_freq` Hz tone
+ * between LOWEST_FREQ and HIGHEST_FREQ in dB.
+ */
+static double aliasing_db(const int16_t *signal, double sampling_rate, double tone_freq) {
+    double *re = xmalloc(FFT_SIZE * sizeof(*re));
+    double *im = xcalloc(FFT_SIZE, sizeof(*im));
+
+    for (size_t i = 0; i < FFT_SIZE; i++)
+        re[i] = signal[i] * (0.5 - 0.5 * cos(2.0 * M_PI * i / (FFT_SIZE - 1))); // Hann window
+    fft(re, im, FFT_SIZE);
+
+    double bin_freq       = sampling_rate / FFT_SIZE;
+    double harmonic_power = 0.0;
+    double alias_power    = 0.0;
+    for (size_t k = LOWEST_FREQ / bin_freq; k < HIGHEST_FREQ / bin_freq && k < FFT_SIZE / 2; k++) {
+        double power = re[k] * re[k] + im[k] * im[k];
+
+        // distance to the nearest harmonic in bins
+        double harmonic = round(k * bin_freq / tone_freq);
+        double distance = fabs(k - harmonic * tone_freq / bin_freq);
+        if (harmonic > 0 && distance <= HARMONIC_BINS)
+            harmonic_power += power;
+        else
+            alias_power += power;
+    }
+
+    free(re);
+    free(im);
+
+    return 10.0 * log10(alias_power / harmonic_power);
+}
+
+/**
+ * Point-samples the square wave played by the ROM like the APU did before it was band-limited: the channel output
+ * was read every GB_CPU_FREQ / sampling_rate cycles (an integer division).
+ * @returns the actual sampling rate.
+ */
+static double point_sample(int16_t *signal, size_t count, uint32_t sampling_rate, uint16_t freq) {
+    uint32_t sample_cycles = GB_CPU_FREQ / sampling_rate;
+    uint32_t step_cycles   = (2048 - freq) * 4;
+
+    for (size_t i = 0; i < count; i++) {
+        uint64_t cycle = (uint64_t) i * sample_cycles;
+        uint8_t  step  = (cycle / step_cycles) % 8;
+        signal[i]      = (step >= 1 && step <= 4) ? 8191 : -8191; // 50% duty: 1, 0, 0, 0, 0, 1, 1, 1
+    }
+
+    return (double) GB_CPU_FREQ / sample_cycles;
+}
+
+static bool run_test(uint8_t *rom, uint32_t sampling_rate, uint16_t freq) {
+    double tone_freq = 131072.0 / (2048 - freq);
+    if (tone_freq >= sampling_rate * 0.4) {
+        printf("%7.1f Hz SKIPPED: too close to the Nyquist frequency\n", tone_freq);
+        return true;
+    }
+
+    build_tone_rom(rom, freq);
+    gbmulator_options_t opts = {
+        .mode              = GBMULATOR_MODE_GB,
+        .rom               = rom,
+        .rom_size          = ROM_SIZE,
+        .skip_boot         = true,
+        .apu_speed         = 1.0f,
+        .apu_sampling_rate = sampling_rate,
+        .on_new_samples    = on_new_samples
+    };
+    gbmulator_t *emu = gbmulator_init(&opts);
+    if (!emu) {
+        eprintf("%.1f Hz: couldn't init the emulator", tone_freq);
+        return false;
+    }
+
+    samples_count = 0;
+    while (samples_count < sizeof(samples) / sizeof(*samples))
+        gbmulator_run_frames(emu, 1);
+    gbmulator_quit(emu);
+
+    double band_limited = aliasing_db(&samples[SETTLE_SAMPLES], sampling_rate, tone_freq);
+
+    double point_sampling_rate = point_sample(samples, FFT_SIZE, sampling_rate, freq);
+    double point_sampled       = aliasing_db(samples, point_sampling_rate, tone_freq);
+
+    bool success = band_limited <= MAX_ALIASING_DB && point_sampled - band_limited >= MIN_IMPROVEMENT_DB;
+    printf("%7.1f Hz %s: aliasing %6.1f dB (point-sampled: %6.1f dB)\n", tone_freq, success ? "PASSED" : "FAILED", band_limited, point_sampled);
+
+    return success;
+}
+
+int main(int argc, char **argv) {
+    uint32_t sampling_rate = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_SAMPLING_RATE;
+    if (sampling_rate == 0)
+        sampling_rate = DEFAULT_SAMPLING_RATE;
+
+    uint8_t *rom     = xmalloc(ROM_SIZE);
+    bool     success = true;
+    for (size_t i = 0; i < sizeof(tones) / sizeof(*tones); i++)
+        success &= run_test(rom, sampling_rate, tones[i]);
+
+    free(rom);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
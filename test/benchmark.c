@@ -0,0 +1,131 @@
+/**
+ * Runs a ROM headless for a fixed amount of frames in each Game Boy mode, with both the pixel FIFO and the scanline
+ * renderer, and reports the emulation speed.
+ * The frame callback is set (but does nothing) so the frame handoff cost is part of the measure.
+ * The "skip" runs enable gbmulator_options_t.skip_rendering, as a batch runner that only needs the RAM or the audio.
+ * The "generic" run replaces the ppu and dma steps specialised for CGB mode by the ones that test the mode at each dot
+ * (the ones used in DMG mode).
+ * The tile cache statistics are only printed if the core is built with GB_PROFILE defined (as test/Makefile does).
+ *
+ * usage: ./benchmark <rom.gb|rom.gbc> [frames]
+ *
+ * To compare the cache behaviour of two builds, run it under perf:
+ *     perf stat -e cycles,instructions,cache-references,cache-misses,L1-dcache-load-misses ./benchmark <rom> [frames]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../core/gb/gb_priv.h"
+
+#define DEFAULT_FRAMES 3600
+#define SCREEN_PIXELS  (160 * 144)
+
+static size_t frames_rendered;
+
+static void on_new_frame(UNUSED const uint8_t *pixels) {
+    frames_rendered++;
+}
+
+static uint8_t *get_rom(const char *path, size_t *rom_size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        errnoprintf("opening file %s", path);
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    size_t len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *buf = xmalloc(len);
+    if (!fread(buf, len, 1, f)) {
+        errnoprintf("reading %s", path);
+        fclose(f);
+        free(buf);
+        return NULL;
+    }
+    fclose(f);
+
+    *rom_size = len;
+    return buf;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool run_benchmark(const char *label, gbmulator_mode_t mode, bool scanline_renderer, bool skip_rendering, bool generic, uint8_t *rom, size_t rom_size, uint64_t frames) {
+    gbmulator_options_t opts = {
+        .mode              = mode,
+        .rom               = rom,
+        .rom_size          = rom_size,
+        .scanline_renderer = scanline_renderer,
+        .skip_rendering    = skip_rendering,
+        .on_new_frame      = on_new_frame
+    };
+
+    gbmulator_t *emu = gbmulator_init(&opts);
+    if (!emu) {
+        eprintf("%s: couldn't init the emulator", label);
+        return false;
+    }
+
+    if (generic) {
+        gb_t *gb           = emu->impl;
+        gb->funcs.ppu_step = ppu_step;
+        gb->funcs.dma_step = dma_step;
+    }
+
+    frames_rendered = 0;
+
+    double start = now();
+    gbmulator_run_frames(emu, frames);
+    double elapsed = now() - start;
+
+    printf("%-18s %8.2f fps (%6.1fx) %8.2f ns/pixel (%zu frames rendered in %.3fs)\n",
+           label,
+           frames / elapsed,
+           frames / elapsed / 60.0,
+           elapsed * 1e9 / ((double) frames * SCREEN_PIXELS),
+           frames_rendered,
+           elapsed);
+    gbmulator_print_stats(emu);
+
+    gbmulator_quit(emu);
+
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("usage: %s <rom.gb|rom.gbc> [frames]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t frames = argc > 2 ? strtoull(argv[2], NULL, 10) : DEFAULT_FRAMES;
+    if (frames == 0)
+        frames = DEFAULT_FRAMES;
+
+    size_t   rom_size;
+    uint8_t *rom = get_rom(argv[1], &rom_size);
+    if (!rom)
+        return EXIT_FAILURE;
+
+    bool success = run_benchmark("DMG", GBMULATOR_MODE_GB, false, false, false, rom, rom_size, frames);
+    success &= run_benchmark("CGB", GBMULATOR_MODE_GBC, false, false, false, rom, rom_size, frames);
+    success &= run_benchmark("CGB generic", GBMULATOR_MODE_GBC, false, false, true, rom, rom_size, frames);
+    success &= run_benchmark("DMG scanline", GBMULATOR_MODE_GB, true, false, false, rom, rom_size, frames);
+    success &= run_benchmark("CGB scanline", GBMULATOR_MODE_GBC, true, false, false, rom, rom_size, frames);
+    success &= run_benchmark("DMG skip", GBMULATOR_MODE_GB, false, true, false, rom, rom_size, frames);
+    success &= run_benchmark("CGB skip", GBMULATOR_MODE_GBC, false, true, false, rom, rom_size, frames);
+    success &= run_benchmark("DMG scanline skip", GBMULATOR_MODE_GB, true, true, false, rom, rom_size, frames);
+    success &= run_benchmark("CGB scanline skip", GBMULATOR_MODE_GBC, true, true, false, rom, rom_size, frames);
+
+    free(rom);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,208 @@
+/**
+ * Stress test of the triple buffered frame handoff (gbmulator_acquire_frame()).
+ * A ROM is first run once to record the checksum of each frame it outputs. It is then run again in a thread while the
+ * main thread acquires and checksums the frames as fast as it can: every acquired frame must be one of the recorded
+ * frames, in order. A frame written while it is read (torn) wouldn't match any of them.
+ * The dirty lines and the hash of each acquired frame are also checked against a copy of the previous acquired frame.
+ * This is built with ThreadSanitizer to also report any data race on the buffers.
+ *
+ * usage: ./frame_test <rom.gb|rom.gbc|rom.gba> [frames]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <zlib.h>
+
+#include "../core/core.h"
+#include "../core/utils.h"
+
+#define DEFAULT_FRAMES 3600
+
+static uint32_t *reference_checksums;
+static size_t    reference_frames;
+static size_t    max_reference_frames;
+static size_t    frame_size;
+static size_t    frame_height;
+
+static atomic_bool is_emulation_done;
+
+static void on_new_reference_frame(const uint8_t *pixels) {
+    if (reference_frames < max_reference_frames)
+        reference_checksums[reference_frames++] = crc32(0, pixels, frame_size);
+}
+
+static uint8_t *get_rom(const char *path, size_t *rom_size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        errnoprintf("opening file %s", path);
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    size_t len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *buf = xmalloc(len);
+    if (!fread(buf, len, 1, f)) {
+        errnoprintf("reading %s", path);
+        fclose(f);
+        free(buf);
+        return NULL;
+    }
+    fclose(f);
+
+    *rom_size = len;
+    return buf;
+}
+
+typedef struct {
+    gbmulator_t *emu;
+    uint64_t     frames;
+} emulation_args_t;
+
+static void *run_emulation(void *arg) {
+    emulation_args_t *args = arg;
+
+    for (uint64_t i = 0; i < args->frames; i++)
+        gbmulator_run_frames(args->emu, 1);
+
+    atomic_store(&is_emulation_done, true);
+    return NULL;
+}
+
+/**
+ * @returns the number of lines of `pixels` that differ from `previous_pixels` but aren't reported by
+ * gbmulator_get_frame_dirty_lines() (or the opposite), plus 1 if the frame hash doesn't change like the pixels.
+ */
+static size_t check_frame_changes(gbmulator_t *emu, const uint8_t *pixels, const uint8_t *previous_pixels, uint64_t previous_hash) {
+    const uint8_t *dirty_lines = gbmulator_get_frame_dirty_lines(emu);
+    size_t         line_size   = frame_size / frame_height;
+    size_t         errors      = 0;
+    bool           is_same     = true;
+
+    for (size_t y = 0; y < frame_height; y++) {
+        bool is_line_same = !memcmp(&pixels[y * line_size], &previous_pixels[y * line_size], line_size);
+        errors += is_line_same == dirty_lines[y];
+        is_same &= is_line_same;
+    }
+
+    return errors + (is_same != (gbmulator_get_frame_hash(emu) == previous_hash));
+}
+
+/**
+ * @returns the index of the first reference frame from `start` matching `pixels`, or -1 if there is none.
+ */
+static ssize_t find_reference_frame(const uint8_t *pixels, size_t start) {
+    uint32_t checksum = crc32(0, pixels, frame_size);
+
+    for (size_t i = start; i < reference_frames; i++)
+        if (reference_checksums[i] == checksum)
+            return i;
+
+    return -1;
+}
+
+static bool run_test(const char *label, gbmulator_mode_t mode, uint8_t *rom, size_t rom_size, uint64_t frames) {
+    gbmulator_options_t opts = {
+        .mode         = mode,
+        .rom          = rom,
+        .rom_size     = rom_size,
+        .on_new_frame = on_new_reference_frame
+    };
+    gbmulator_t *reference_emu = gbmulator_init(&opts);
+
+    opts.on_new_frame     = NULL;
+    gbmulator_t *test_emu = gbmulator_init(&opts);
+
+    if (!reference_emu || !test_emu) {
+        eprintf("%s: couldn't init the emulator", label);
+        gbmulator_quit(reference_emu);
+        gbmulator_quit(test_emu);
+        return false;
+    }
+
+    frame_height = mode == GBMULATOR_MODE_GBA ? GBA_SCREEN_HEIGHT : GB_SCREEN_HEIGHT;
+    frame_size   = (mode == GBMULATOR_MODE_GBA ? GBA_SCREEN_WIDTH : GB_SCREEN_WIDTH) * frame_height * 4;
+    // a frame is also output each time the LCD is turned off
+    max_reference_frames = frames * 2;
+    reference_checksums  = xmalloc(max_reference_frames * sizeof(*reference_checksums));
+    reference_frames     = 0;
+    gbmulator_run_frames(reference_emu, frames);
+
+    atomic_store(&is_emulation_done, false);
+    emulation_args_t args = { .emu = test_emu, .frames = frames };
+    pthread_t        thread;
+    pthread_create(&thread, NULL, run_emulation, &args);
+
+    uint8_t *previous_pixels = xmalloc(frame_size);
+    uint64_t previous_hash   = 0;
+    size_t   acquired_frames = 0;
+    size_t   torn_frames     = 0;
+    size_t   change_errors   = 0;
+    size_t   next_reference  = 0;
+    bool     is_done;
+    do {
+        // read the flag before acquiring to also check the last frame once the emulation is done
+        is_done = atomic_load(&is_emulation_done);
+
+        bool           is_new;
+        const uint8_t *pixels = gbmulator_acquire_frame(test_emu, &is_new);
+        if (!is_new)
+            continue;
+
+        acquired_frames++;
+        ssize_t reference = find_reference_frame(pixels, next_reference);
+        if (reference < 0)
+            torn_frames++;
+        else
+            next_reference = reference;
+
+        if (acquired_frames > 1)
+            change_errors += check_frame_changes(test_emu, pixels, previous_pixels, previous_hash);
+        memcpy(previous_pixels, pixels, frame_size);
+        previous_hash = gbmulator_get_frame_hash(test_emu);
+    } while (!is_done);
+
+    pthread_join(thread, NULL);
+
+    free(previous_pixels);
+    free(reference_checksums);
+    gbmulator_quit(reference_emu);
+    gbmulator_quit(test_emu);
+
+    bool success = torn_frames == 0 && change_errors == 0 && acquired_frames > 0;
+    printf("%-3s %s: %zu frames acquired out of %zu, %zu torn frames, %zu wrong dirty lines or hashes\n", label, success ? "PASSED" : "FAILED", acquired_frames, reference_frames, torn_frames, change_errors);
+
+    return success;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("usage: %s <rom.gb|rom.gbc|rom.gba> [frames]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t frames = argc > 2 ? strtoull(argv[2], NULL, 10) : DEFAULT_FRAMES;
+    if (frames == 0)
+        frames = DEFAULT_FRAMES;
+
+    size_t   rom_size;
+    uint8_t *rom = get_rom(argv[1], &rom_size);
+    if (!rom)
+        return EXIT_FAILURE;
+
+    size_t len = strlen(argv[1]);
+    bool   success;
+    if (len >= 4 && !strcmp(&argv[1][len - 4], ".gba")) {
+        success = run_test("GBA", GBMULATOR_MODE_GBA, rom, rom_size, frames);
+    } else {
+        success = run_test("DMG", GBMULATOR_MODE_GB, rom, rom_size, frames);
+        success &= run_test("CGB", GBMULATOR_MODE_GBC, rom, rom_size, frames);
+    }
+
+    free(rom);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
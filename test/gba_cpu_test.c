@@ -0,0 +1,157 @@
+/**
+ * Tests of the GBA cpu running self-modifying code.
+ * A generated ROM calls a routine in IWRAM, overwrites one byte of one of its instructions with a STRB and calls it
+ * again: the second call must execute the modified instruction.
+ *
+ * The given ROMs are also run: they must be test ROMs that leave 0 in r12 when all their tests passed, like the ones
+ * of this repository: https://github.com/jsmolka/gba-tests (arm.gba, thumb.gba, memory.gba...)
+ *
+ * usage: ./gba_cpu_test [rom.gba...]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/gba/gba_priv.h"
+
+#define ROM_SIZE      0x200
+#define ROM_ENTRY     0xC0
+#define IWRAM_ROUTINE BUS_IWRAM
+#define STEPS         256 // enough for the generated ROM to reach its final loop
+#define ROM_FRAMES    120 // enough for the test ROMs to reach their final loop
+
+typedef struct {
+    uint8_t  byte;     // offset of the overwritten byte in the instruction
+    uint8_t  value;    // value written by the STRB
+    uint32_t expected; // value of r1 after the second call
+} smc_test_t;
+
+// the routine's first instruction is MOV r1, #1 (0xE3A01001)
+static const smc_test_t smc_tests[] = {
+    { 0, 0x05, 5 },          // MOV r1, #5
+    { 1, 0x20, 0 },          // MOV r2, #1
+    { 2, 0xE0, 0xFFFFFFFE }, // MVN r1, #1
+    { 3, 0x03, 0 }           // MOVEQ r1, #1 (Z is clear)
+};
+
+static void rom_write_word(uint8_t *rom, uint32_t offset, uint32_t value) {
+    for (uint8_t i = 0; i < 4; i++)
+        rom[offset + i] = value >> (i * 8);
+}
+
+/**
+ * Builds a ROM that calls the IWRAM routine, overwrites the byte `test->byte` of its first instruction with
+ * `test->value` and calls it again.
+ */
+static void build_smc_rom(uint8_t *rom, const smc_test_t *test) {
+    const uint32_t program[] = {
+        0xE3A00403,                 // MOV r0, #0x03000000
+        0xE1A0E00F,                 // MOV lr, pc
+        0xE12FFF10,                 // BX r0
+        0xE3A01000,                 // MOV r1, #0
+        0xE3A02000 | test->value,   // MOV r2, #value
+        0xE5C02000 | test->byte,    // STRB r2, [r0, #byte]
+        0xE3B03001,                 // MOVS r3, #1 (clears Z)
+        0xE1A0E00F,                 // MOV lr, pc
+        0xE12FFF10,                 // BX r0
+        0xEAFFFFFE                  // B .
+    };
+
+    memset(rom, 0, ROM_SIZE);
+    rom_write_word(rom, 0, 0xEA000000 | ((ROM_ENTRY - 8) >> 2)); // B ROM_ENTRY
+    rom[0xB2] = 0x96;
+    for (size_t i = 0; i < sizeof(program) / sizeof(*program); i++)
+        rom_write_word(rom, ROM_ENTRY + i * 4, program[i]);
+}
+
+static bool run_smc_test(uint8_t *rom, const smc_test_t *test) {
+    build_smc_rom(rom, test);
+
+    gbmulator_options_t opts = {
+        .mode     = GBMULATOR_MODE_GBA,
+        .rom      = rom,
+        .rom_size = ROM_SIZE
+    };
+    gbmulator_t *emu = gbmulator_init(&opts);
+    if (!emu) {
+        eprintf("couldn't init the emulator");
+        return false;
+    }
+    gba_t *gba = emu->impl;
+
+    gba_bus_write_word(gba, IWRAM_ROUTINE, 0xE3A01001);     // MOV r1, #1
+    gba_bus_write_word(gba, IWRAM_ROUTINE + 4, 0xE12FFF1E); // BX lr
+
+    for (int i = 0; i < STEPS; i++)
+        gba_cpu_step(gba);
+
+    uint32_t r1      = gba->cpu.regs[1];
+    bool     success = r1 == test->expected;
+    printf("STRB to byte %u of a previously run instruction %s: r1=0x%08X (expected 0x%08X)\n", test->byte, success ? "PASSED" : "FAILED", r1, test->expected);
+
+    gbmulator_quit(emu);
+
+    return success;
+}
+
+static bool run_test_rom(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        errnoprintf("opening file %s", path);
+        return false;
+    }
+
+    fseek(f, 0, SEEK_END);
+    size_t rom_size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *rom = xmalloc(rom_size);
+    if (!fread(rom, rom_size, 1, f)) {
+        errnoprintf("reading %s", path);
+        fclose(f);
+        free(rom);
+        return false;
+    }
+    fclose(f);
+
+    gbmulator_options_t opts = {
+        .mode     = GBMULATOR_MODE_GBA,
+        .rom      = rom,
+        .rom_size = rom_size
+    };
+    gbmulator_t *emu = gbmulator_init(&opts);
+    if (!emu) {
+        eprintf("couldn't init the emulator");
+        free(rom);
+        return false;
+    }
+
+    gbmulator_run_frames(emu, ROM_FRAMES);
+
+    // r12 holds the number of the first failed test
+    uint32_t r12     = ((gba_t *) emu->impl)->cpu.regs[12];
+    bool     success = r12 == 0;
+    if (success)
+        printf("%s PASSED\n", path);
+    else
+        printf("%s FAILED: test %u\n", path, r12);
+
+    gbmulator_quit(emu);
+    free(rom);
+
+    return success;
+}
+
+int main(int argc, char **argv) {
+    uint8_t *rom     = xmalloc(ROM_SIZE);
+    bool     success = true;
+    for (size_t i = 0; i < sizeof(smc_tests) / sizeof(*smc_tests); i++)
+        success &= run_smc_test(rom, &smc_tests[i]);
+
+    free(rom);
+
+    for (int i = 1; i < argc; i++)
+        success &= run_test_rom(argv[i]);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,632 @@
+/**
+ * Differential test of the GBA recompiler (the core must be built with -DGBA_JIT).
+ * Generated programs of random ARM and THUMB instructions run from ROM, IWRAM and EWRAM on two emulators in lockstep,
+ * one with the recompiler and one with the interpreter only. The programs take timer and vblank interrupts, run
+ * an hblank DMA, load from IO registers and ROM (also beyond its end) and store to the pages of their own
+ * code (and to one of their instructions). The cpu, the bus latches and the memories of the two emulators must be
+ * the same each time the cpu of the first one isn't ahead of its other components.
+ *
+ * usage: ./gba_jit_test
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/gba/gba_priv.h"
+
+#define ROM_SIZE        0x4000
+#define ROM_ENTRY       0xC0
+#define ROM_IRQ_HANDLER 0x400
+#define ROM_PROGRAM     0x1000
+#define ROM_RANDOM_DATA 0x3000
+#define PROGRAM_MAX     0x1800
+#define PAD_SIZE        0x80 // zeroes after the program: they share its last page and are written by the program
+
+#define IRQ_COUNTER (BUS_IWRAM + 0x7000)
+#define IWRAM_DATA  (BUS_IWRAM + 0x4000)
+#define EWRAM_DATA  (BUS_EWRAM + 0x10000)
+#define ROM_DATA    (BUS_ROM0 + ROM_SIZE - 0x200) // the loads from it can go beyond the end of the ROM
+#define IO_BASE     BUS_IO
+
+#define BODY_ITEMS 160
+#define SEEDS      3
+#define STEPS      600000
+#define MEMORY_CHECK_PERIOD 4096 // steps between the comparisons of the memories
+
+typedef enum {
+    PLACE_ROM,
+    PLACE_IWRAM,
+    PLACE_EWRAM
+} place_t;
+
+static const char *place_names[] = { "ROM", "IWRAM", "EWRAM" };
+
+typedef enum {
+    FIXUP_ARM_BRANCH,    // B or BL to an item
+    FIXUP_THUMB_BCOND,   // B<cond> to an item
+    FIXUP_THUMB_B,       // B to an item
+    FIXUP_THUMB_BL,      // BL to an item
+    FIXUP_ARM_CODE_PTR,  // ADD/SUB r12, pc, ... to a store target
+    FIXUP_THUMB_CODE_PTR // MOV r3, #(padding end - store target)
+} fixup_kind_t;
+
+#define ITEM_SUB   (BODY_ITEMS + 1) // the subroutine
+#define ITEM_LOOP  (BODY_ITEMS + 2) // the start of the loop
+#define TARGET_SMC UINT32_MAX       // store target: the overwritten instruction
+
+typedef struct {
+    fixup_kind_t kind;
+    uint32_t     pos;    // offset in the ROM of the instruction to fix
+    uint32_t     item;   // index of the target item (the items past the body's end are its end)
+    uint32_t     target; // store target: offset in the padding or TARGET_SMC
+} fixup_t;
+
+typedef struct {
+    uint8_t *rom;
+    uint32_t pos;   // write offset in the ROM
+    uint32_t base;  // address at which rom[ROM_PROGRAM] runs
+    bool     thumb;
+    place_t  place;
+    uint32_t rng;
+
+    uint32_t items[BODY_ITEMS + 1]; // offsets in the ROM of the items of the loop's body (and of its end)
+    fixup_t  fixups[BODY_ITEMS * 2];
+    size_t   fixup_count;
+    uint32_t sub;       // offset in the ROM of the subroutine
+    uint32_t smc_site;  // offset in the ROM of the instruction overwritten by the program
+    uint32_t pad_start; // offset in the ROM of the padding after the program
+} gen_t;
+
+static uint32_t rnd(gen_t *g, uint32_t n) {
+    // xorshift32
+    g->rng ^= g->rng << 13;
+    g->rng ^= g->rng >> 17;
+    g->rng ^= g->rng << 5;
+    return g->rng % n;
+}
+
+static uint32_t run_address(gen_t *g, uint32_t pos) {
+    return g->base + pos - ROM_PROGRAM;
+}
+
+static void emit_word(gen_t *g, uint32_t word) {
+    for (uint8_t i = 0; i < 4; i++)
+        g->rom[g->pos++] = word >> (i * 8);
+}
+
+static void emit_half(gen_t *g, uint16_t half) {
+    g->rom[g->pos++] = half;
+    g->rom[g->pos++] = half >> 8;
+}
+
+static uint32_t read_word(gen_t *g, uint32_t pos) {
+    return g->rom[pos] | (g->rom[pos + 1] << 8) | (g->rom[pos + 2] << 16) | ((uint32_t) g->rom[pos + 3] << 24);
+}
+
+static void write_word(gen_t *g, uint32_t pos, uint32_t word) {
+    for (uint8_t i = 0; i < 4; i++)
+        g->rom[pos + i] = word >> (i * 8);
+}
+
+static void write_half(gen_t *g, uint32_t pos, uint16_t half) {
+    g->rom[pos]     = half;
+    g->rom[pos + 1] = half >> 8;
+}
+
+static void add_fixup(gen_t *g, fixup_kind_t kind, uint32_t item, uint32_t target) {
+    g->fixups[g->fixup_count++] = (fixup_t) { .kind = kind, .pos = g->pos, .item = item, .target = target };
+}
+
+// ARM encodings
+
+#define COND_AL 0xE
+
+static uint32_t arm_dp(uint8_t cond, uint8_t op, bool s, uint8_t rd, uint8_t rn, bool imm, uint32_t op2) {
+    return (cond << 28) | (imm << 25) | (op << 21) | (s << 20) | (rn << 16) | (rd << 12) | op2;
+}
+
+// MOV rd, #value then ORR rd, rd, #byte for each other non zero byte
+static void arm_const(gen_t *g, uint8_t rd, uint32_t value) {
+    emit_word(g, arm_dp(COND_AL, 0xD, false, rd, 0, true, value & 0xFF));
+    for (uint8_t shift = 8; shift < 32; shift += 8)
+        if ((value >> shift) & 0xFF)
+            emit_word(g, arm_dp(COND_AL, 0xC, false, rd, rd, true, (((32 - shift) / 2) << 8) | ((value >> shift) & 0xFF)));
+}
+
+static uint32_t arm_single_transfer(uint8_t cond, bool reg, bool p, bool u, bool b, bool w, bool l, uint8_t rn, uint8_t rd, uint32_t offset) {
+    return (cond << 28) | 0x04000000 | (reg << 25) | (p << 24) | (u << 23) | (b << 22) | (w << 21) | (l << 20) | (rn << 16) | (rd << 12) | offset;
+}
+
+static uint32_t arm_halfword_transfer(uint8_t cond, bool imm, bool p, bool u, bool w, bool l, uint8_t sh, uint8_t rn, uint8_t rd, uint8_t offset) {
+    return (cond << 28) | (p << 24) | (u << 23) | (imm << 22) | (w << 21) | (l << 20) | (rn << 16) | (rd << 12) | ((offset & 0xF0) << 4) | 0x90 | (sh << 5) | (offset & 0x0F);
+}
+
+static uint8_t arm_cond(gen_t *g) {
+    return rnd(g, 4) ? COND_AL : rnd(g, 15);
+}
+
+// pointer to `target` in r12 (pc-relative so it doesn't depend on the registers)
+static void arm_code_ptr(gen_t *g, uint32_t target) {
+    add_fixup(g, FIXUP_ARM_CODE_PTR, 0, target);
+    emit_word(g, 0);
+    emit_word(g, 0);
+}
+
+static void arm_item(gen_t *g, uint32_t item) {
+    uint8_t cond = arm_cond(g);
+
+    switch (rnd(g, 16)) {
+    case 0 ... 5: { // data processing
+        uint8_t op   = rnd(g, 16);
+        bool    test = op >= 0x8 && op <= 0xB;
+        bool    s    = test || rnd(g, 2);
+        uint8_t rd   = test ? 0 : rnd(g, 8);
+        uint8_t rn   = rnd(g, 10) ? rnd(g, 13) : REG_PC;
+
+        if (rnd(g, 2)) {
+            emit_word(g, arm_dp(cond, op, s, rd, rn, true, (rnd(g, 16) << 8) | rnd(g, 256)));
+        } else if (rnd(g, 8)) {
+            uint8_t rm = rnd(g, 10) ? rnd(g, 13) : REG_PC;
+            emit_word(g, arm_dp(cond, op, s, rd, rn, false, (rnd(g, 32) << 7) | (rnd(g, 4) << 5) | rm));
+        } else { // shift by a register
+            emit_word(g, arm_dp(cond, op, s, rd, rnd(g, 13), false, (rnd(g, 8) << 8) | (rnd(g, 4) << 5) | 0x10 | rnd(g, 13)));
+        }
+        break;
+    }
+    case 6: // MUL/MLA
+        emit_word(g, (cond << 28) | 0x90 | (rnd(g, 2) << 21) | (rnd(g, 2) << 20) | (rnd(g, 8) << 16) | (rnd(g, 8) << 12) | (rnd(g, 8) << 8) | rnd(g, 8));
+        break;
+    case 7 ... 9: { // LDR/STR (B) with an immediate offset
+        bool     l      = rnd(g, 2);
+        bool     b      = rnd(g, 2);
+        uint8_t  rn     = l ? (rnd(g, 8) ? 8 + rnd(g, 3) : REG_PC) : 8 + rnd(g, 2);
+        bool     p      = rnd(g, 4) || rn == REG_PC;
+        bool     u      = rn == 10 || rnd(g, 2);
+        bool     w      = p && rn != REG_PC && !rnd(g, 4);
+        uint32_t offset = rnd(g, 0x400);
+        if (!b && rnd(g, 8))
+            offset &= ~3;
+        uint8_t rd = l || rnd(g, 16) ? rnd(g, 8) : REG_PC;
+        emit_word(g, arm_single_transfer(cond, false, p, u, b, w, l, rn, rd, offset));
+        break;
+    }
+    case 10 ... 11: { // halfword and signed transfers with an immediate offset
+        bool    l      = rnd(g, 2);
+        uint8_t sh     = l ? 1 + rnd(g, 3) : 1;
+        uint8_t rn     = l ? 8 + rnd(g, 3) : 8 + rnd(g, 2);
+        bool    p      = rnd(g, 4);
+        bool    w      = p && !rnd(g, 4);
+        uint8_t offset = rnd(g, 256);
+        if (sh != 2 && rnd(g, 8))
+            offset &= ~1;
+        emit_word(g, arm_halfword_transfer(cond, true, p, rn == 10 || rnd(g, 2), w, l, sh, rn, rnd(g, 8), offset));
+        break;
+    }
+    case 12: // forward branch over up to 3 items
+        add_fixup(g, FIXUP_ARM_BRANCH, item + 1 + rnd(g, 4), 0);
+        emit_word(g, (cond << 28) | 0x0A000000);
+        break;
+    case 13: // BL to the subroutine
+        add_fixup(g, FIXUP_ARM_BRANCH, ITEM_SUB, 0);
+        emit_word(g, (cond << 28) | 0x0B000000);
+        break;
+    case 14: { // loads from IO registers (DISPSTAT and VCOUNT, timer 0, KEYINPUT)
+        static const uint16_t io_offsets[] = { 0x004, 0x100, 0x130 };
+        uint16_t              offset       = io_offsets[rnd(g, 3)];
+        if (offset < 0x100 && rnd(g, 2))
+            emit_word(g, arm_halfword_transfer(cond, true, true, true, false, true, 1, 11, rnd(g, 8), offset + 2 * rnd(g, 2)));
+        else
+            emit_word(g, arm_single_transfer(cond, false, true, true, false, false, true, 11, rnd(g, 8), offset));
+        break;
+    }
+    case 15: { // transfers with a register offset (masked in r12)
+        bool    l  = rnd(g, 2);
+        uint8_t rn = l ? 8 + rnd(g, 3) : 8 + rnd(g, 2);
+        emit_word(g, arm_dp(COND_AL, 0x0, false, 12, rnd(g, 8), true, rnd(g, 2) ? 0x3FC : 0x3FF));
+        if (rnd(g, 2)) {
+            emit_word(g, arm_single_transfer(cond, true, true, true, rnd(g, 2), false, l, rn, rnd(g, 8), (rnd(g, 2) << 7) | 12));
+        } else {
+            uint8_t sh = l ? 1 + rnd(g, 3) : 1;
+            emit_word(g, arm_halfword_transfer(cond, false, true, rnd(g, 2), false, l, sh, rn, rnd(g, 8), 12));
+        }
+        break;
+    }
+    }
+}
+
+// THUMB encodings
+
+static void thumb_code_ptr(gen_t *g, uint32_t target) {
+    // MOV r3, #(pad end - target); NEG r3, r3 (r5 points to the end of the padding)
+    add_fixup(g, FIXUP_THUMB_CODE_PTR, 0, target);
+    emit_half(g, 0x2300);
+    emit_half(g, 0x4240 | (3 << 3) | 3);
+}
+
+static void thumb_item(gen_t *g, uint32_t item) {
+    switch (rnd(g, 20)) {
+    case 0 ... 1: // LSL/LSR/ASR #imm
+        emit_half(g, (rnd(g, 3) << 11) | (rnd(g, 32) << 6) | (rnd(g, 8) << 3) | rnd(g, 4));
+        break;
+    case 2: // ADD/SUB with a register or an imm3
+        emit_half(g, 0x1800 | (rnd(g, 2) << 10) | (rnd(g, 2) << 9) | (rnd(g, 8) << 6) | (rnd(g, 8) << 3) | rnd(g, 4));
+        break;
+    case 3 ... 4: { // MOV/CMP/ADD/SUB #imm8
+        uint8_t op = rnd(g, 4);
+        emit_half(g, 0x2000 | (op << 11) | ((op == 1 ? rnd(g, 8) : rnd(g, 4)) << 8) | rnd(g, 256));
+        break;
+    }
+    case 5 ... 7: { // ALU operations
+        uint8_t op   = rnd(g, 16);
+        bool    test = op == 0x8 || op == 0xA || op == 0xB;
+        emit_half(g, 0x4000 | (op << 6) | (rnd(g, 8) << 3) | (test ? rnd(g, 8) : rnd(g, 4)));
+        break;
+    }
+    case 8: { // hi register operations (r8-r12 and PC)
+        uint8_t op = rnd(g, 3);
+        uint8_t hi = rnd(g, 6) ? 8 + rnd(g, 5) : REG_PC;
+        if (rnd(g, 2) && op != 1) // to a low register
+            emit_half(g, 0x4400 | (op << 8) | (1 << 6) | ((hi & 7) << 3) | rnd(g, 4));
+        else if (op == 1) // CMP
+            emit_half(g, 0x4400 | (op << 8) | (1 << 7) | ((hi & 7)) | (rnd(g, 8) << 3));
+        else // to r8-r12
+            emit_half(g, 0x4400 | (op << 8) | (1 << 7) | (rnd(g, 8) << 3) | (rnd(g, 5)));
+        break;
+    }
+    case 9: // LDR rd, [pc, #imm]
+        emit_half(g, 0x4800 | (rnd(g, 4) << 8) | rnd(g, 256));
+        break;
+    case 10 ... 11: { // LDR/STR (B) with a register offset (r3)
+        bool l = rnd(g, 2);
+        emit_half(g, 0x2300 | (rnd(g, 8) ? rnd(g, 64) << 2 : rnd(g, 256)));
+        emit_half(g, 0x5000 | (l << 11) | (rnd(g, 2) << 10) | (3 << 6) | ((l ? 5 + rnd(g, 3) : 5 + rnd(g, 2)) << 3) | (l ? rnd(g, 4) : rnd(g, 8)));
+        break;
+    }
+    case 12: { // STRH/LDSB/LDRH/LDSH with a register offset (r3)
+        uint8_t hs = rnd(g, 4);
+        emit_half(g, 0x2300 | (rnd(g, 8) ? rnd(g, 128) << 1 : rnd(g, 256)));
+        emit_half(g, 0x5200 | ((hs & 1) << 11) | ((hs >> 1) << 10) | (3 << 6) | ((hs ? 5 + rnd(g, 3) : 5 + rnd(g, 2)) << 3) | (hs ? rnd(g, 4) : rnd(g, 8)));
+        break;
+    }
+    case 13 ... 14: { // LDR/STR (B) with an imm5 offset
+        bool l = rnd(g, 2);
+        emit_half(g, 0x6000 | (rnd(g, 2) << 12) | (l << 11) | (rnd(g, 32) << 6) | ((l ? 5 + rnd(g, 3) : 5 + rnd(g, 2)) << 3) | (l ? rnd(g, 4) : rnd(g, 8)));
+        break;
+    }
+    case 15: { // LDRH/STRH with an imm5 offset
+        bool l = rnd(g, 2);
+        emit_half(g, 0x8000 | (l << 11) | (rnd(g, 32) << 6) | ((l ? 5 + rnd(g, 3) : 5 + rnd(g, 2)) << 3) | (l ? rnd(g, 4) : rnd(g, 8)));
+        break;
+    }
+    case 16: // SP relative transfers and address computations
+        if (rnd(g, 2)) {
+            uint8_t words = 1 + rnd(g, 16);
+            bool    l     = rnd(g, 2);
+            emit_half(g, 0xB080 | words);
+            emit_half(g, 0x9000 | (l << 11) | ((l ? rnd(g, 4) : rnd(g, 8)) << 8) | rnd(g, words + 8));
+            emit_half(g, 0xB000 | words);
+        } else {
+            emit_half(g, 0xA000 | (rnd(g, 2) << 11) | (rnd(g, 4) << 8) | rnd(g, 256));
+        }
+        break;
+    case 17: // loads from IO registers (DISPSTAT and VCOUNT)
+        if (rnd(g, 2))
+            emit_half(g, 0x6800 | (1 << 6) | (4 << 3) | rnd(g, 4));
+        else
+            emit_half(g, 0x8800 | ((2 + rnd(g, 2)) << 6) | (4 << 3) | rnd(g, 4));
+        break;
+    case 18: // forward branch over up to 3 items
+        if (rnd(g, 4)) {
+            add_fixup(g, FIXUP_THUMB_BCOND, item + 1 + rnd(g, 4), 0);
+            emit_half(g, 0xD000 | (rnd(g, 14) << 8));
+        } else {
+            add_fixup(g, FIXUP_THUMB_B, item + 1 + rnd(g, 4), 0);
+            emit_half(g, 0xE000);
+        }
+        break;
+    case 19: // BL to the subroutine
+        add_fixup(g, FIXUP_THUMB_BL, ITEM_SUB, 0);
+        emit_half(g, 0xF000);
+        emit_half(g, 0xF800);
+        break;
+    }
+}
+
+static void apply_fixups(gen_t *g) {
+    for (size_t i = 0; i < g->fixup_count; i++) {
+        fixup_t *f       = &g->fixups[i];
+        uint32_t address = run_address(g, f->pos);
+        uint32_t target;
+        if (f->kind == FIXUP_ARM_CODE_PTR || f->kind == FIXUP_THUMB_CODE_PTR)
+            target = run_address(g, f->target == TARGET_SMC ? g->smc_site : g->pad_start + f->target);
+        else if (f->item == ITEM_SUB)
+            target = run_address(g, g->sub);
+        else if (f->item == ITEM_LOOP)
+            target = run_address(g, ROM_PROGRAM);
+        else
+            target = run_address(g, g->items[MIN(f->item, BODY_ITEMS)]);
+
+        switch (f->kind) {
+        case FIXUP_ARM_BRANCH:
+            write_word(g, f->pos, read_word(g, f->pos) | (((target - address - 8) >> 2) & 0x00FFFFFF));
+            break;
+        case FIXUP_THUMB_BCOND:
+            g->rom[f->pos] = (target - address - 4) >> 1;
+            break;
+        case FIXUP_THUMB_B:
+            write_half(g, f->pos, 0xE000 | (((target - address - 4) >> 1) & 0x07FF));
+            break;
+        case FIXUP_THUMB_BL: {
+            uint32_t offset = target - address - 4;
+            write_half(g, f->pos, 0xF000 | ((offset >> 12) & 0x07FF));
+            write_half(g, f->pos + 2, 0xF800 | ((offset >> 1) & 0x07FF));
+            break;
+        }
+        case FIXUP_ARM_CODE_PTR: {
+            // r12 = pc + 8 -/+ distance with 2 immediates of 8 bits (the programs are smaller than 64KB)
+            uint32_t pc       = address + 8;
+            bool     up       = target >= pc;
+            uint32_t distance = up ? target - pc : pc - target;
+            uint8_t  op       = up ? 0x4 : 0x2;
+            write_word(g, f->pos, arm_dp(COND_AL, op, false, 12, REG_PC, true, distance & 0xFF));
+            write_word(g, f->pos + 4, arm_dp(COND_AL, op, false, 12, 12, true, (12 << 8) | ((distance >> 8) & 0xFF)));
+            break;
+        }
+        case FIXUP_THUMB_CODE_PTR:
+            g->rom[f->pos] = run_address(g, g->pad_start + PAD_SIZE) - target;
+            break;
+        }
+    }
+}
+
+/**
+ * Generates the program's loop at rom[ROM_PROGRAM]: a body of random items then a branch to its start, followed by a
+ * subroutine and the padding. The programs run from RAM also overwrite the immediate of one of their instructions
+ * (MOV r0, #imm) and store to the padding.
+ */
+static void generate_program(gen_t *g) {
+    g->pos         = ROM_PROGRAM;
+    g->fixup_count = 0;
+
+    bool     ram        = g->place != PLACE_ROM;
+    uint32_t smc_item   = ram ? BODY_ITEMS - 1 - rnd(g, 16) : BODY_ITEMS;
+    uint32_t store_item = rnd(g, BODY_ITEMS);
+
+    if (!g->thumb) {
+        // the loop resets the base registers that the transfers write back
+        arm_const(g, 8, IWRAM_DATA);
+        arm_const(g, 9, EWRAM_DATA);
+        arm_const(g, 10, ROM_DATA);
+        arm_const(g, 11, IO_BASE);
+        emit_word(g, arm_dp(COND_AL, 0xD, false, 12, 0, true, 0));
+    }
+
+    for (uint32_t i = 0; i < BODY_ITEMS; i++) {
+        g->items[i] = g->pos;
+
+        if (i == smc_item) {
+            // MOV r0, #imm
+            g->smc_site = g->pos;
+            if (g->thumb)
+                emit_half(g, 0x2000 | rnd(g, 256));
+            else
+                emit_word(g, arm_dp(COND_AL, 0xD, false, 0, 0, true, rnd(g, 256)));
+        } else if (ram && (i == store_item || !rnd(g, 24))) {
+            // stores a byte to the immediate of the overwritten instruction or a register to the padding
+            bool     smc    = i == store_item;
+            uint32_t target = smc ? TARGET_SMC : 4 * rnd(g, PAD_SIZE / 4);
+            if (g->thumb) {
+                thumb_code_ptr(g, target);
+                emit_half(g, (smc ? 0x5400 : 0x5000) | (3 << 6) | (5 << 3) | rnd(g, 8));
+            } else {
+                arm_code_ptr(g, target);
+                emit_word(g, arm_single_transfer(COND_AL, false, true, true, smc, false, false, 12, rnd(g, 8), 0));
+            }
+        } else if (g->thumb) {
+            thumb_item(g, i);
+        } else {
+            arm_item(g, i);
+        }
+    }
+    g->items[BODY_ITEMS] = g->pos;
+
+    if (g->thumb) {
+        add_fixup(g, FIXUP_THUMB_B, ITEM_LOOP, 0);
+        emit_half(g, 0xE000);
+        g->sub = g->pos;
+        emit_half(g, 0x3001); // ADD r0, #1
+        emit_half(g, 0x4770); // BX lr
+        g->pos = ALIGN(g->pos + 3, 4);
+    } else {
+        add_fixup(g, FIXUP_ARM_BRANCH, ITEM_LOOP, 0);
+        emit_word(g, 0xEA000000);
+        g->sub = g->pos;
+        emit_word(g, arm_dp(COND_AL, 0x4, false, 0, 0, true, 1)); // ADD r0, r0, #1
+        emit_word(g, 0xE12FFF1E);                                 // BX lr
+    }
+
+    g->pad_start = g->pos;
+    memset(&g->rom[g->pos], 0, PAD_SIZE);
+    g->pos += PAD_SIZE;
+
+    apply_fixups(g);
+}
+
+static void generate_rom(gen_t *g) {
+    memset(g->rom, 0, ROM_SIZE);
+    for (uint32_t i = ROM_RANDOM_DATA; i < ROM_SIZE; i++)
+        g->rom[i] = rnd(g, 256);
+
+    // header: B ROM_ENTRY
+    write_word(g, 0, 0xEA000000 | ((ROM_ENTRY - 8) >> 2));
+    g->rom[0xB2] = 0x96;
+
+    g->base = g->place == PLACE_ROM ? BUS_ROM0 + ROM_PROGRAM : g->place == PLACE_IWRAM ? BUS_IWRAM : BUS_EWRAM;
+    generate_program(g);
+    uint32_t program_end = g->pos;
+
+    // interrupt handler: acknowledges the interrupts and counts them
+    g->pos = ROM_IRQ_HANDLER;
+    emit_word(g, arm_dp(COND_AL, 0x4, false, 1, 0, true, (12 << 8) | 0x02));                       // ADD r1, r0, #0x200
+    emit_word(g, arm_halfword_transfer(COND_AL, true, true, true, false, true, 1, 1, 2, 2));        // LDRH r2, [r1, #2]
+    emit_word(g, arm_halfword_transfer(COND_AL, true, true, true, false, false, 1, 1, 2, 2));       // STRH r2, [r1, #2]
+    arm_const(g, 3, IRQ_COUNTER);
+    emit_word(g, arm_single_transfer(COND_AL, false, true, true, false, false, true, 3, 12, 0));    // LDR r12, [r3]
+    emit_word(g, arm_dp(COND_AL, 0x4, false, 12, 12, true, 1));                                   // ADD r12, r12, #1
+    emit_word(g, arm_single_transfer(COND_AL, false, true, true, false, false, false, 3, 12, 0));   // STR r12, [r3]
+    emit_word(g, 0xE12FFF1E);                                                                     // BX lr
+
+    // setup: interrupts, timer 0, DMAs, copy of the program to RAM, registers
+    g->pos = ROM_ENTRY;
+    arm_const(g, 0, IO_BASE);
+    arm_const(g, 1, BUS_ROM0 + ROM_IRQ_HANDLER);
+    arm_const(g, 2, BUS_IWRAM + 0x7FFC);
+    emit_word(g, arm_single_transfer(COND_AL, false, true, true, false, false, false, 2, 1, 0));
+    emit_word(g, arm_dp(COND_AL, 0x4, false, 2, 0, true, (12 << 8) | 0x02));                // r2 = IE
+    emit_word(g, arm_dp(COND_AL, 0xD, false, 1, 0, true, 0x09));                           // vblank and timer 0
+    emit_word(g, arm_halfword_transfer(COND_AL, true, true, true, false, false, 1, 2, 1, 0));
+    emit_word(g, arm_dp(COND_AL, 0xD, false, 1, 0, true, 0x01));
+    emit_word(g, arm_halfword_transfer(COND_AL, true, true, true, false, false, 1, 2, 1, 8)); // IME
+    emit_word(g, arm_dp(COND_AL, 0xD, false, 1, 0, true, 0x08));
+    emit_word(g, arm_halfword_transfer(COND_AL, true, true, true, false, false, 1, 0, 1, 4)); // DISPSTAT: vblank irq
+    arm_const(g, 1, 0x00C0F000 | rnd(g, 0x800));
+    emit_word(g, arm_single_transfer(COND_AL, false, true, true, false, false, false, 0, 1, 0x100)); // TM0
+
+    // DMA1 at the first hblank from ROM to the padding (RAM programs)
+    const uint32_t dma[] = { BUS_ROM0 + ROM_RANDOM_DATA, g->place == PLACE_ROM ? EWRAM_DATA + 0x800 : run_address(g, g->pad_start), 0xA4400004 };
+    for (uint8_t i = 0; i < 3; i++) {
+        arm_const(g, 1, dma[i]);
+        emit_word(g, arm_single_transfer(COND_AL, false, true, true, false, false, false, 0, 1, 0x0BC + 4 * i));
+    }
+
+    if (g->place != PLACE_ROM) {
+        // copy loop: LDR r3, [r0], #4; STR r3, [r1], #4; SUBS r2, r2, #1; BNE copy
+        arm_const(g, 0, BUS_ROM0 + ROM_PROGRAM);
+        arm_const(g, 1, g->base);
+        arm_const(g, 2, (program_end - ROM_PROGRAM) / 4);
+        emit_word(g, arm_single_transfer(COND_AL, false, false, true, false, false, true, 0, 3, 4));
+        emit_word(g, arm_single_transfer(COND_AL, false, false, true, false, false, false, 1, 3, 4));
+        emit_word(g, arm_dp(COND_AL, 0x2, true, 2, 2, true, 1));
+        emit_word(g, 0x1AFFFFFB);
+    }
+
+    if (g->thumb) {
+        arm_const(g, 4, IO_BASE);
+        arm_const(g, 5, g->place == PLACE_ROM ? IWRAM_DATA : run_address(g, g->pad_start + PAD_SIZE));
+        arm_const(g, 6, EWRAM_DATA);
+        arm_const(g, 7, ROM_DATA + 0x1C0);
+        for (uint8_t r = 8; r < 12; r++)
+            arm_const(g, r, rnd(g, 0xFFFFFFFF));
+    }
+    for (uint8_t r = 0; r < (g->thumb ? 4 : 8); r++)
+        arm_const(g, r, rnd(g, 0xFFFFFFFF));
+
+    arm_const(g, 12, g->base | g->thumb);
+    emit_word(g, 0xE12FFF1C); // BX r12
+
+    if (g->pos > ROM_IRQ_HANDLER || program_end > ROM_PROGRAM + PROGRAM_MAX) {
+        eprintf("generated code too big");
+        exit(EXIT_FAILURE);
+    }
+}
+
+#define COMPARE(field)                                                                                          \
+    do {                                                                                                        \
+        if (memcmp(&ref->field, &jit->field, sizeof(ref->field))) {                                             \
+            printf("step %lu: " #field " differs (pc=0x%08X, ref pc=0x%08X)\n", step, jit->cpu.regs[REG_PC], ref->cpu.regs[REG_PC]); \
+            return false;                                                                                       \
+        }                                                                                                       \
+    } while (0)
+
+static bool compare_cpus(gba_t *ref, gba_t *jit, uint64_t step) {
+    COMPARE(cpu.regs);
+    COMPARE(cpu.banked_regs_8_12);
+    COMPARE(cpu.banked_regs_13_14);
+    COMPARE(cpu.cpsr);
+    COMPARE(cpu.spsr);
+    COMPARE(cpu.pipeline);
+    COMPARE(cpu.pipeline_flush_cycles);
+    COMPARE(bus.read_data_latch);
+    COMPARE(bus.write_data_latch);
+    COMPARE(bus.rom_address_latch);
+    COMPARE(bus.last_fetched_bios_instr);
+    COMPARE(scheduler.now);
+    return true;
+}
+
+static bool compare_memories(gba_t *ref, gba_t *jit, uint64_t step) {
+    COMPARE(bus.ewram);
+    COMPARE(bus.iwram);
+    COMPARE(bus.io);
+    COMPARE(bus.pram);
+    COMPARE(bus.vram);
+    COMPARE(bus.oam);
+    return true;
+}
+
+static bool run_program(uint8_t *rom, bool thumb, place_t place, uint32_t seed) {
+    gen_t g = { .rom = rom, .thumb = thumb, .place = place, .rng = seed * 2654435761u + 1 };
+    generate_rom(&g);
+
+    gbmulator_options_t opts = {
+        .mode     = GBMULATOR_MODE_GBA,
+        .rom      = rom,
+        .rom_size = ROM_SIZE
+    };
+    gbmulator_t *ref_emu = gbmulator_init(&opts);
+    gbmulator_t *jit_emu = gbmulator_init(&opts);
+    if (!ref_emu || !jit_emu) {
+        eprintf("couldn't init the emulators");
+        return false;
+    }
+    gba_t *ref = ref_emu->impl;
+    gba_t *jit = jit_emu->impl;
+
+    ref->jit.enabled = false;
+
+    bool     success      = true;
+    uint64_t ahead_cycles = 0;
+    uint64_t step;
+    for (step = 0; step < STEPS && success; step++) {
+        gba_step(ref);
+        gba_step(jit);
+
+        if (jit->jit.cycles_ahead) {
+            ahead_cycles++;
+            continue;
+        }
+
+        success = compare_cpus(ref, jit, step);
+        if (success && step % MEMORY_CHECK_PERIOD == 0)
+            success = compare_memories(ref, jit, step);
+    }
+    if (success && !jit->jit.cycles_ahead)
+        success = compare_memories(ref, jit, step);
+
+    // the cycles run by the translated code (without the first one of each run)
+    if (success && ahead_cycles == 0) {
+        printf("no translated code was run\n");
+        success = false;
+    }
+
+    printf("%s program from %s (seed %u) %s: %lu%% of the cycles ahead\n", thumb ? "THUMB" : "ARM", place_names[place], seed, success ? "PASSED" : "FAILED", ahead_cycles * 100 / step);
+
+    gbmulator_quit(ref_emu);
+    gbmulator_quit(jit_emu);
+
+    return success;
+}
+
+int main(void) {
+    uint8_t *rom     = xmalloc(ROM_SIZE);
+    bool     success = true;
+
+    for (uint32_t seed = 1; seed <= SEEDS; seed++)
+        for (place_t place = PLACE_ROM; place <= PLACE_EWRAM; place++)
+            for (uint8_t thumb = 0; thumb < 2; thumb++)
+                success &= run_program(rom, thumb, place, seed);
+
+    free(rom);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
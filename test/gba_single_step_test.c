@@ -0,0 +1,404 @@
+/**
+ * Runs the ARM7TDMI single step tests on the GBA cpu.
+ * This needs the test files from this repository (in the working directory):
+ * https://github.com/SingleStepTests/ARM7TDMI
+ *
+ * The bus reads and writes of the cpu are replaced (with the linker's --wrap option) by the transactions of each test.
+ *
+ * usage: ./gba_single_step_test
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../core/gba/gba_priv.h"
+
+#define MAGIC 0xD33DBAE0
+
+#define CPSR_MODE_MASK     0x0000001F // Mode bits
+#define CPSR_GET_MODE(cpu) ((cpu)->cpsr & CPSR_MODE_MASK)
+
+typedef enum {
+    REG_IDX_USR_SYS = 0,
+    REG_IDX_FIQ,
+    REG_IDX_SVC,
+    REG_IDX_ABT,
+    REG_IDX_IRQ,
+    REG_IDX_UND
+} cpu_mode_reg_indexes_t;
+
+typedef struct {
+    bool is_done;
+
+    enum {
+        GBA_BUS_TRANSACTION_KIND_INSTR_READ,
+        GBA_BUS_TRANSACTION_KIND_READ,
+        GBA_BUS_TRANSACTION_KIND_WRITE
+    } kind;
+    uint32_t size;
+    uint32_t addr;
+    uint32_t data;
+    uint32_t cycle;
+    uint32_t access;
+} gba_bus_transaction_t;
+
+static size_t                next_transaction  = 0;
+static size_t                transactions_size = 0;
+static gba_bus_transaction_t transactions[64];
+
+// the reads also set the data latch, like the bus does
+uint8_t __wrap__gba_bus_read_byte(gba_t *gba, UNUSED bus_access_t access, uint32_t address) {
+    bool is_same_addr                      = address == transactions[next_transaction].addr;
+    bool is_read                           = transactions[next_transaction].kind != GBA_BUS_TRANSACTION_KIND_WRITE;
+    bool is_same_size                      = transactions[next_transaction].size == 1;
+    transactions[next_transaction].is_done = is_same_addr && is_read && is_same_size;
+
+    uint8_t data             = transactions[next_transaction++].data;
+    gba->bus.read_data_latch = ((uint32_t) data << 24) | ((uint32_t) data << 16) | ((uint32_t) data << 8) | data;
+    return data;
+}
+
+uint16_t __wrap__gba_bus_read_half(gba_t *gba, UNUSED bus_access_t access, uint32_t address) {
+    bool is_same_addr                      = address == transactions[next_transaction].addr;
+    bool is_read                           = transactions[next_transaction].kind != GBA_BUS_TRANSACTION_KIND_WRITE;
+    bool is_same_size                      = transactions[next_transaction].size == 2;
+    transactions[next_transaction].is_done = is_same_addr && is_read && is_same_size;
+
+    uint16_t data            = transactions[next_transaction++].data;
+    gba->bus.read_data_latch = ((uint32_t) data << 16) | data;
+    return data;
+}
+
+uint32_t __wrap__gba_bus_read_word(gba_t *gba, UNUSED bus_access_t access, uint32_t address) {
+    bool is_same_addr                      = address == transactions[next_transaction].addr;
+    bool is_read                           = transactions[next_transaction].kind != GBA_BUS_TRANSACTION_KIND_WRITE;
+    bool is_same_size                      = transactions[next_transaction].size == 4;
+    transactions[next_transaction].is_done = is_same_addr && is_read && is_same_size;
+
+    gba->bus.read_data_latch = transactions[next_transaction++].data;
+    return gba->bus.read_data_latch;
+}
+
+void __wrap__gba_bus_write_byte(UNUSED gba_t *gba, UNUSED bus_access_t access, uint32_t address, uint8_t data) {
+    bool is_same_addr                        = address == transactions[next_transaction].addr;
+    bool is_same_data                        = data == transactions[next_transaction].data;
+    bool is_write                            = transactions[next_transaction].kind == GBA_BUS_TRANSACTION_KIND_WRITE;
+    bool is_same_size                        = transactions[next_transaction].size == 1;
+    transactions[next_transaction++].is_done = is_same_addr && is_same_data && is_write && is_same_size;
+}
+
+void __wrap__gba_bus_write_half(UNUSED gba_t *gba, UNUSED bus_access_t access, uint32_t address, uint16_t data) {
+    bool is_same_addr                        = address == transactions[next_transaction].addr;
+    bool is_same_data                        = data == transactions[next_transaction].data;
+    bool is_write                            = transactions[next_transaction].kind == GBA_BUS_TRANSACTION_KIND_WRITE;
+    bool is_same_size                        = transactions[next_transaction].size == 2;
+    transactions[next_transaction++].is_done = is_same_addr && is_same_data && is_write && is_same_size;
+}
+
+void __wrap__gba_bus_write_word(UNUSED gba_t *gba, UNUSED bus_access_t access, uint32_t address, uint32_t data) {
+    bool is_same_addr                        = address == transactions[next_transaction].addr;
+    bool is_same_data                        = data == transactions[next_transaction].data;
+    bool is_write                            = transactions[next_transaction].kind == GBA_BUS_TRANSACTION_KIND_WRITE;
+    bool is_same_size                        = transactions[next_transaction].size == 4;
+    transactions[next_transaction++].is_done = is_same_addr && is_same_data && is_write && is_same_size;
+}
+
+static bool cpu_equals(gba_cpu_t *expected, gba_cpu_t *got, bool is_arm_str_ldr) {
+    bool success = true;
+
+    for (size_t i = 0; i < sizeof(expected->regs) / sizeof(*expected->regs); i++) {
+        if (i == REG_PC && is_arm_str_ldr)
+            continue;
+
+        if (expected->regs[i] != got->regs[i]) {
+            success = false;
+            printf("R%zu expected 0x%08X, got 0x%08X\n", i, expected->regs[i], got->regs[i]);
+        }
+    }
+
+    for (size_t i = REG_IDX_FIQ; i < sizeof(expected->banked_regs_8_12) / sizeof(*expected->banked_regs_8_12); i++) {
+        for (size_t j = 0; j < sizeof(*expected->banked_regs_8_12) / sizeof(**expected->banked_regs_8_12); j++) {
+            if (expected->banked_regs_8_12[i][j] != got->banked_regs_8_12[i][j]) {
+                success = false;
+                printf("R%zu (bank %zu) expected 0x%08X, got 0x%08X\n", j + 8, i, expected->banked_regs_8_12[i][j], got->banked_regs_8_12[i][j]);
+            }
+        }
+    }
+
+    for (size_t j = 0; j < sizeof(*expected->banked_regs_13_14) / sizeof(**expected->banked_regs_13_14); j++) {
+        if (expected->banked_regs_13_14[REG_IDX_FIQ][j] != got->banked_regs_13_14[REG_IDX_FIQ][j]) {
+            success = false;
+            printf("R%zu (bank %d) expected 0x%08X, got 0x%08X\n", j + 13, REG_IDX_FIQ, expected->banked_regs_13_14[REG_IDX_FIQ][j], got->banked_regs_13_14[REG_IDX_FIQ][j]);
+        }
+    }
+
+    if (expected->cpsr != got->cpsr) {
+        success = false;
+        printf("CPSR expected 0x%08X, got 0x%08X\n", expected->cpsr, got->cpsr);
+    }
+
+    for (size_t i = 0; i < sizeof(expected->spsr) / sizeof(*expected->spsr); i++) {
+        if (expected->spsr[i] != got->spsr[i]) {
+            success = false;
+            printf("spsr[%zu] expected 0x%08X, got 0x%08X\n", i, expected->spsr[i], got->spsr[i]);
+        }
+    }
+
+    return success;
+}
+
+static bool check_transactions(void) {
+    // TODO transaction check sequential/non sequential
+    for (size_t i = 0; i < transactions_size; i++)
+        if (!transactions[i].is_done)
+            return false; // TODO print details of failed transactions
+
+    return true;
+}
+
+static uint32_t parse_u32(uint8_t **test_data) {
+    uint32_t ret;
+    memcpy(&ret, *test_data, sizeof(ret));
+    *test_data += sizeof(ret);
+    return ret;
+}
+
+static void parse_u32_array(uint8_t **test_data, uint32_t *array, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        array[i] = parse_u32(test_data);
+}
+
+static void parse_state(uint8_t **test_data, gba_cpu_t *cpu) {
+    /* uint32_t full_sz = */ parse_u32(test_data);
+    parse_u32(test_data); // ignore 4 bytes
+
+    // R
+    parse_u32_array(test_data, cpu->regs, 16);
+    memcpy(cpu->banked_regs_8_12[0], &cpu->regs[8], sizeof(cpu->banked_regs_8_12[0]));
+    memcpy(cpu->banked_regs_13_14[0], &cpu->regs[13], sizeof(cpu->banked_regs_13_14[0]));
+    // R_fiq
+    parse_u32_array(test_data, cpu->banked_regs_8_12[REG_IDX_FIQ], 5);
+    parse_u32_array(test_data, cpu->banked_regs_13_14[REG_IDX_FIQ], 2);
+    // R_svc
+    parse_u32_array(test_data, cpu->banked_regs_13_14[REG_IDX_SVC], 2);
+    // R_abt
+    parse_u32_array(test_data, cpu->banked_regs_13_14[REG_IDX_ABT], 2);
+    // R_irq
+    parse_u32_array(test_data, cpu->banked_regs_13_14[REG_IDX_IRQ], 2);
+    // R_und
+    parse_u32_array(test_data, cpu->banked_regs_13_14[REG_IDX_UND], 2);
+
+    cpu->cpsr    = parse_u32(test_data);
+    cpu->spsr[0] = cpu->cpsr;
+
+    parse_u32_array(test_data, &cpu->spsr[1], 5);
+    parse_u32_array(test_data, cpu->pipeline, 2);
+
+    /* uint32_t access = */ parse_u32(test_data);
+}
+
+static void parse_transactions(uint8_t **test_data) {
+    transactions_size = 0;
+    next_transaction  = 0;
+
+    /* uint32_t full_sz = */ parse_u32(test_data);
+    /* uint32_t magic = */ parse_u32(test_data);
+    uint32_t num_transactions = parse_u32(test_data);
+
+    for (uint32_t i = 0; i < num_transactions; i++) {
+        transactions[transactions_size].kind   = parse_u32(test_data);
+        transactions[transactions_size].size   = parse_u32(test_data);
+        transactions[transactions_size].addr   = parse_u32(test_data);
+        transactions[transactions_size].data   = parse_u32(test_data);
+        transactions[transactions_size].cycle  = parse_u32(test_data);
+        transactions[transactions_size].access = parse_u32(test_data);
+
+        transactions[transactions_size].is_done = false;
+        transactions_size++;
+    }
+}
+
+static void parse_opcodes(uint8_t **test_data, gba_cpu_t *cpu) {
+    /* uint32_t full_sz = */ parse_u32(test_data);
+    parse_u32(test_data); // ignore 4 bytes
+    uint32_t opcode = parse_u32(test_data);
+    /* uint32_t base_addr = */ parse_u32(test_data);
+
+    cpu->pipeline[1] = opcode;
+}
+
+typedef struct {
+    uint8_t      rom[256];
+    gbmulator_t *init;
+    gbmulator_t *expected;
+} gba_cpu_tester_t;
+
+static gba_cpu_tester_t gba_cpu_tester = { .rom = { [0xB2] = 0x96 } };
+
+static void gba_cpu_tester_init(void) {
+    uint8_t checksum = 0;
+    for (int i = 0xA0; i < 0xBC; i++)
+        checksum -= gba_cpu_tester.rom[i];
+    checksum -= 0x19;
+
+    gba_cpu_tester.rom[0xBD] = checksum;
+
+    gbmulator_options_t opts = {
+        .rom      = gba_cpu_tester.rom,
+        .rom_size = sizeof(gba_cpu_tester.rom),
+        .mode     = GBMULATOR_MODE_GBA
+    };
+
+    gba_cpu_tester.init     = gbmulator_init(&opts);
+    gba_cpu_tester.expected = gbmulator_init(&opts);
+}
+
+static void gba_cpu_tester_quit(void) {
+    gbmulator_quit(gba_cpu_tester.init);
+    gbmulator_quit(gba_cpu_tester.expected);
+}
+
+static bool gba_cpu_tester_run(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        errnoprintf("opening file %s", path);
+        return false;
+    }
+
+    fseek(f, 0, SEEK_END);
+    size_t len = ftell(f);
+    rewind(f);
+
+    uint8_t *test_data = xmalloc(len);
+    if (!fread(test_data, len, 1, f)) {
+        errnoprintf("reading %s", path);
+        fclose(f);
+        free(test_data);
+        return false;
+    }
+    fclose(f);
+
+    uint8_t *test_data_ptr = test_data;
+
+    uint32_t magic = parse_u32(&test_data_ptr);
+    if (magic != MAGIC) {
+        eprintf("%s: wrong magic number\n", path);
+        free(test_data);
+        return false;
+    }
+
+    uint32_t num_tests = parse_u32(&test_data_ptr);
+    printf("num_tests=%u\n", num_tests);
+
+    bool is_arm_str_ldr = strstr(path, "arm_ldrh_strh") || strstr(path, "arm_ldrsb_ldrsh") || strstr(path, "arm_ldr_str_immediate_offset") || strstr(path, "arm_ldr_str_register_offset");
+
+    gba_t *init     = gba_cpu_tester.init->impl;
+    gba_t *expected = gba_cpu_tester.expected->impl;
+
+    uint32_t errors = 0;
+    for (uint32_t i = 0; i < num_tests; i++) {
+        /* uint32_t full_sz = */ parse_u32(&test_data_ptr);
+
+        parse_state(&test_data_ptr, &init->cpu);
+        parse_state(&test_data_ptr, &expected->cpu);
+        parse_transactions(&test_data_ptr);
+        parse_opcodes(&test_data_ptr, &init->cpu);
+
+        if (i < 6)
+            continue;
+
+        uint8_t mode = CPSR_GET_MODE(&init->cpu);
+        bank_registers(&init->cpu, 0, mode); // from usr_sys mode to mode of current test
+
+        init->cpu.pipeline_flush_cycles = 0;
+        gba_cpu_step(init);
+
+        while (init->cpu.pipeline_flush_cycles > 0)
+            gba_cpu_step(init);
+
+        mode = CPSR_GET_MODE(&init->cpu);
+        bank_registers(&init->cpu, mode, 0); // go back to usr_sys mode
+
+        // TODO when cpu sets cpsr, we shouldn't always (never?) mirror it to spsr[0]
+        // ----> understand exactly when/where spsr is written
+
+        if (!cpu_equals(&expected->cpu, &init->cpu, is_arm_str_ldr) || !check_transactions()) {
+            printf("❌ CPU state mismatch (%u)!\n", i);
+            errors++;
+            break;
+        }
+    }
+
+    free(test_data);
+
+    if (errors > 0)
+        printf("errors: %u/%u\n", errors, num_tests);
+
+    return errors == 0;
+}
+
+int main(void) {
+    gba_cpu_tester_init();
+
+    static const char *test_paths[] = {
+        "ARM7TDMI/v1/arm_b_bl.json.bin",
+        "ARM7TDMI/v1/arm_bx.json.bin",
+        "ARM7TDMI/v1/arm_cdp.json.bin",
+        "ARM7TDMI/v1/arm_data_proc_immediate.json.bin",
+        "ARM7TDMI/v1/arm_data_proc_immediate_shift.json.bin",
+        "ARM7TDMI/v1/arm_data_proc_register_shift.json.bin",
+        // "ARM7TDMI/v1/arm_ldm_stm.json.bin", // 0
+        "ARM7TDMI/v1/arm_ldrh_strh.json.bin",
+        "ARM7TDMI/v1/arm_ldrsb_ldrsh.json.bin",
+        "ARM7TDMI/v1/arm_ldr_str_immediate_offset.json.bin",
+        "ARM7TDMI/v1/arm_ldr_str_register_offset.json.bin",
+        "ARM7TDMI/v1/arm_mcr_mrc.json.bin",
+        "ARM7TDMI/v1/arm_mrs.json.bin",
+        "ARM7TDMI/v1/arm_msr_imm.json.bin",
+        "ARM7TDMI/v1/arm_msr_reg.json.bin",
+        // "ARM7TDMI/v1/arm_mull_mlal.json.bin", // 101
+        // "ARM7TDMI/v1/arm_mul_mla.json.bin", // 100
+        "ARM7TDMI/v1/arm_stc_ldc.json.bin",
+        "ARM7TDMI/v1/arm_swi.json.bin",
+        "ARM7TDMI/v1/arm_swp.json.bin",
+        "ARM7TDMI/v1/thumb_add_cmp_mov_hi.json.bin",
+        "ARM7TDMI/v1/thumb_add_sp_or_pc.json.bin",
+        "ARM7TDMI/v1/thumb_add_sub.json.bin",
+        "ARM7TDMI/v1/thumb_add_sub_sp.json.bin",
+        "ARM7TDMI/v1/thumb_bcc.json.bin",
+        "ARM7TDMI/v1/thumb_b.json.bin",
+        "ARM7TDMI/v1/thumb_bl_blx_prefix.json.bin",
+        "ARM7TDMI/v1/thumb_bl_suffix.json.bin",
+        "ARM7TDMI/v1/thumb_bx.json.bin",
+        // "ARM7TDMI/v1/thumb_data_proc.json.bin", // 117
+        "ARM7TDMI/v1/thumb_ldm_stm.json.bin",
+        "ARM7TDMI/v1/thumb_ldrb_strb_imm_offset.json.bin",
+        "ARM7TDMI/v1/thumb_ldrh_strh_imm_offset.json.bin",
+        "ARM7TDMI/v1/thumb_ldrh_strh_reg_offset.json.bin",
+        "ARM7TDMI/v1/thumb_ldr_pc_rel.json.bin",
+        "ARM7TDMI/v1/thumb_ldrsb_strb_reg_offset.json.bin",
+        "ARM7TDMI/v1/thumb_ldrsh_ldrsb_reg_offset.json.bin",
+        "ARM7TDMI/v1/thumb_ldr_str_imm_offset.json.bin",
+        "ARM7TDMI/v1/thumb_ldr_str_reg_offset.json.bin",
+        "ARM7TDMI/v1/thumb_ldr_str_sp_rel.json.bin",
+        "ARM7TDMI/v1/thumb_lsl_lsr_asr.json.bin",
+        "ARM7TDMI/v1/thumb_mov_cmp_add_sub.json.bin",
+        "ARM7TDMI/v1/thumb_push_pop.json.bin",
+        "ARM7TDMI/v1/thumb_swi.json.bin",
+        "ARM7TDMI/v1/thumb_undefined_bcc.json.bin"
+    };
+
+    bool success = true;
+    for (size_t i = 0; i < sizeof(test_paths) / sizeof(*test_paths); i++) {
+        printf("Testing: %s\n", test_paths[i]);
+
+        if (!gba_cpu_tester_run(test_paths[i])) {
+            success = false;
+            break;
+        }
+    }
+
+    gba_cpu_tester_quit();
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,240 @@
+/**
+ * Test and benchmark of the resampling of the audio from the fixed sampling rate of the emulation to the rate of the
+ * audio device.
+ * Sine tones are resampled: the tones in the passband must come out at their frequency and the power of the other
+ * frequencies (distortion, images and noise) must be low. The tones above the nyquist frequency of the output must be
+ * filtered out instead of being aliased.
+ * The benchmark resamples one second of stereo audio for each of BENCH_INSTANCES resamplers while adjusting their ratio
+ * like the dynamic rate control does.
+ *
+ * usage: ./resampler_test [output_rate]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "../core/core.h"
+#include "../core/utils.h"
+#include "../platform/common/resampler.h"
+
+#define INPUT_RATE          (GB_CPU_FREQ / 64) // see APU_SAMPLING_RATE in app.c
+#define DEFAULT_OUTPUT_RATE 48000
+#define SETTLE_SAMPLES      4096  // skipped to start the analysis in the steady state
+#define FFT_SIZE            32768 // power of 2
+#define TONE_BINS           8     // bins around the tone that belong to it (the window leaks over a few bins)
+#define AMPLITUDE           16384
+#define INPUT_BLOCK         1092 // samples given at once (one frame of the GB APU at INPUT_RATE)
+#define MAX_DISTORTION_DB   -80.0
+#define MIN_REJECTION_DB    70.0 // minimum attenuation of the tones above the nyquist frequency of the output
+#define BENCH_INSTANCES     64
+#define BENCH_MAX_MS        250.0 // maximum time to resample one second for all the instances
+#define DRC_MAX_FREQ_DIFF   0.005
+
+static const double passband_tones[] = { 100.0, 440.0, 1000.0, 5000.0, 12000.0 };
+static const double stopband_tones[] = { 26000.0, 30000.0 };
+
+static void fft(double *re, double *im, size_t n) {
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            double tmp = re[i];
+            re[i]      = re[j];
+            re[j]      = tmp;
+            tmp        = im[i];
+            im[i]      = im[j];
+            im[j]      = tmp;
+        }
+    }
+
+    for (size_t len = 2; len <= n; len <<= 1) {
+        double angle = -2.0 * M_PI / len;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < len / 2; k++) {
+                double w_re = cos(angle * k);
+                double w_im = sin(angle * k);
+                double u_re = re[i + k];
+                double u_im = im[i + k];
+                double v_re = re[i + k + len / 2] * w_re - im[i + k + len / 2] * w_im;
+                double v_im = re[i + k + len / 2] * w_im + im[i + k + len / 2] * w_re;
+
+                re[i + k]           = u_re + v_re;
+                im[i + k]           = u_im + v_im;
+                re[i + k + len / 2] = u_re - v_re;
+                im[i + k + len / 2] = u_im - v_im;
+            }
+        }
+    }
+}
+
+/**
+ * Analyzes the right channel of `FFT_SIZE` interleaved stereo samples.
+ * @param peak_freq set to the frequency of the highest bin.
+ * @returns the power of the bins away from `tone_freq` relative to the power of the bins around it in dB.
+ */
+static double distortion_db(const int16_t *signal, double sampling_rate, double tone_freq, double *peak_freq) {
+    double *re = xmalloc(FFT_SIZE * sizeof(*re));
+    double *im = xcalloc(FFT_SIZE, sizeof(*im));
+
+    for (size_t i = 0; i < FFT_SIZE; i++) {
+        // Blackman-Harris window: its sidelobes (-92 dB) are below the distortion measured
+        double x = 2.0 * M_PI * i / (FFT_SIZE - 1);
+        re[i]    = signal[i * 2 + 1] * (0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2.0 * x) - 0.01168 * cos(3.0 * x));
+    }
+    fft(re, im, FFT_SIZE);
+
+    double bin_freq    = sampling_rate / FFT_SIZE;
+    double tone_power  = 0.0;
+    double other_power = 0.0;
+    double peak_power  = 0.0;
+    for (size_t k = 1; k < FFT_SIZE / 2; k++) {
+        double power = re[k] * re[k] + im[k] * im[k];
+        if (power > peak_power) {
+            peak_power = power;
+            *peak_freq = k * bin_freq;
+        }
+
+        if (fabs(k - tone_freq / bin_freq) <= TONE_BINS)
+            tone_power += power;
+        else
+            other_power += power;
+    }
+
+    free(re);
+    free(im);
+
+    return 10.0 * log10(other_power / tone_power);
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void generate_tone(int16_t *samples, size_t start, size_t count, double tone_freq) {
+    for (size_t i = 0; i < count; i++) {
+        int16_t sample     = AMPLITUDE * sin(2.0 * M_PI * tone_freq * (start + i) / INPUT_RATE);
+        samples[i * 2]     = sample;
+        samples[i * 2 + 1] = -sample;
+    }
+}
+
+/**
+ * Resamples `input_count` samples of a `tone_freq` Hz tone.
+ * @returns the number of samples written in `output`.
+ */
+static size_t resample_tone(uint32_t output_rate, double tone_freq, size_t input_count, int16_t *output) {
+    resampler_t *resampler = resampler_init(INPUT_RATE, output_rate);
+    int16_t      input[INPUT_BLOCK * 2];
+    size_t       received = 0;
+
+    for (size_t i = 0; i < input_count; i += INPUT_BLOCK) {
+        size_t count = MIN(INPUT_BLOCK, input_count - i);
+        generate_tone(input, i, count, tone_freq);
+        resampler_put_samples(resampler, input, count);
+        received += resampler_receive_samples(resampler, &output[received * 2], (input_count - i) * output_rate / INPUT_RATE + 1);
+    }
+
+    resampler_quit(resampler);
+    return received;
+}
+
+static bool run_passband_test(uint32_t output_rate, double tone_freq) {
+    if (tone_freq >= output_rate * 0.4) {
+        printf("%7.1f Hz SKIPPED: too close to the Nyquist frequency\n", tone_freq);
+        return true;
+    }
+
+    size_t   output_count = SETTLE_SAMPLES + FFT_SIZE;
+    size_t   input_count  = (uint64_t) (output_count + 1) * INPUT_RATE / output_rate + INPUT_BLOCK;
+    int16_t *output       = xmalloc((input_count * (uint64_t) output_rate / INPUT_RATE + 2) * 2 * sizeof(*output));
+
+    size_t received   = resample_tone(output_rate, tone_freq, input_count, output);
+    double peak_freq  = 0.0;
+    double distortion = received >= output_count ? distortion_db(&output[SETTLE_SAMPLES * 2], output_rate, tone_freq, &peak_freq) : 0.0;
+
+    bool success = received >= output_count && fabs(peak_freq - tone_freq) <= (double) output_rate / FFT_SIZE && distortion <= MAX_DISTORTION_DB;
+    printf("%7.1f Hz %s: peak %7.1f Hz, distortion %6.1f dB\n", tone_freq, success ? "PASSED" : "FAILED", peak_freq, distortion);
+
+    free(output);
+    return success;
+}
+
+static bool run_stopband_test(uint32_t output_rate, double tone_freq) {
+    if (tone_freq <= output_rate * 0.5 || tone_freq >= INPUT_RATE * 0.5) {
+        printf("%7.1f Hz SKIPPED: not between the Nyquist frequencies of the output and the input\n", tone_freq);
+        return true;
+    }
+
+    size_t   input_count = INPUT_RATE / 4;
+    int16_t *output      = xmalloc((input_count * (uint64_t) output_rate / INPUT_RATE + 2) * 2 * sizeof(*output));
+    size_t   received    = resample_tone(output_rate, tone_freq, input_count, output);
+
+    double power = 0.0;
+    for (size_t i = SETTLE_SAMPLES; i < received; i++)
+        power += (double) output[i * 2] * output[i * 2];
+    power /= MAX(received - MIN(received, SETTLE_SAMPLES), 1);
+
+    // compared to the power of the input tone
+    double rejection = 10.0 * log10((AMPLITUDE * AMPLITUDE / 2.0) / MAX(power, 1e-3));
+
+    bool success = received > SETTLE_SAMPLES && rejection >= MIN_REJECTION_DB;
+    printf("%7.1f Hz %s: rejection %6.1f dB\n", tone_freq, success ? "PASSED" : "FAILED", rejection);
+
+    free(output);
+    return success;
+}
+
+static bool run_benchmark(uint32_t output_rate) {
+    resampler_t *resamplers[BENCH_INSTANCES];
+    for (size_t i = 0; i < BENCH_INSTANCES; i++)
+        resamplers[i] = resampler_init(INPUT_RATE, output_rate);
+
+    int16_t input[INPUT_BLOCK * 2];
+    int16_t output[INPUT_BLOCK * 2]; // the output rate is lower than the input rate
+    generate_tone(input, 0, INPUT_BLOCK, 440.0);
+
+    size_t received = 0;
+    double elapsed  = 0.0;
+    for (size_t block = 0; block < INPUT_RATE / INPUT_BLOCK; block++) {
+        double start = now_ms();
+        for (size_t i = 0; i < BENCH_INSTANCES; i++) {
+            // oscillates around the nominal ratio like the dynamic rate control (differently for each instance)
+            double diff = DRC_MAX_FREQ_DIFF * sin(block * 0.1 + i);
+            resampler_set_ratio(resamplers[i], output_rate * (1.0 - diff) / INPUT_RATE);
+
+            resampler_put_samples(resamplers[i], input, INPUT_BLOCK);
+            received += resampler_receive_samples(resamplers[i], output, INPUT_BLOCK);
+        }
+        elapsed += now_ms() - start;
+    }
+
+    for (size_t i = 0; i < BENCH_INSTANCES; i++)
+        resampler_quit(resamplers[i]);
+
+    bool success = elapsed <= BENCH_MAX_MS;
+    printf("benchmark %s: %d instances, %zu samples in %.1f ms (%.0fx real time per instance)\n", success ? "PASSED" : "FAILED",
+           BENCH_INSTANCES, received, elapsed, 1000.0 * BENCH_INSTANCES / elapsed);
+
+    return success;
+}
+
+int main(int argc, char **argv) {
+    uint32_t output_rate = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_OUTPUT_RATE;
+    if (output_rate == 0 || output_rate > INPUT_RATE)
+        output_rate = DEFAULT_OUTPUT_RATE;
+
+    bool success = true;
+    for (size_t i = 0; i < sizeof(passband_tones) / sizeof(*passband_tones); i++)
+        success &= run_passband_test(output_rate, passband_tones[i]);
+    for (size_t i = 0; i < sizeof(stopband_tones) / sizeof(*stopband_tones); i++)
+        success &= run_stopband_test(output_rate, stopband_tones[i]);
+    success &= run_benchmark(output_rate);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
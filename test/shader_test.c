@@ -0,0 +1,225 @@
+/**
+ * Checks that the BGR555 screen shader of the renderer outputs the same colors as the CPU color conversion of the core.
+ * A ROM is run twice in lockstep, once with RGBA8888 pixels (the reference) and once with BGR555 pixels which are
+ * rendered headless through glrenderer (surfaceless EGL context) and read back.
+ * DMG colors are rounded down to 5 bits in BGR555 so the reference is rounded the same way in DMG mode.
+ *
+ * usage: ./shader_test <rom.gb|rom.gbc|rom.gba> [frames]
+ *
+ * To run it without a GPU, force Mesa's software rasterizer:
+ *     LIBGL_ALWAYS_SOFTWARE=1 ./shader_test <rom> [frames]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+
+#include "../core/core.h"
+#include "../core/utils.h"
+#include "../platform/common/glrenderer.h"
+
+#define DEFAULT_FRAMES 600
+
+static uint8_t reference_pixels[GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT * 4];
+static uint8_t bgr555_pixels[GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT * 2];
+static size_t  screen_w;
+static size_t  screen_h;
+static size_t  reference_frames;
+static size_t  bgr555_frames;
+
+static void on_new_reference_frame(const uint8_t *pixels) {
+    memcpy(reference_pixels, pixels, screen_w * screen_h * 4);
+    reference_frames++;
+}
+
+static void on_new_bgr555_frame(const uint8_t *pixels) {
+    memcpy(bgr555_pixels, pixels, screen_w * screen_h * 2);
+    bgr555_frames++;
+}
+
+static uint8_t *get_rom(const char *path, size_t *rom_size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        errnoprintf("opening file %s", path);
+        return NULL;
+    }
+
+    fseek(f, 0, SEEK_END);
+    size_t len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *buf = xmalloc(len);
+    if (!fread(buf, len, 1, f)) {
+        errnoprintf("reading %s", path);
+        fclose(f);
+        free(buf);
+        return NULL;
+    }
+    fclose(f);
+
+    *rom_size = len;
+    return buf;
+}
+
+static bool init_egl(void) {
+    EGLDisplay display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+        eprintf("couldn't initialize the EGL display\n");
+        return false;
+    }
+
+    eglBindAPI(EGL_OPENGL_ES_API);
+
+    // the default EGL_SURFACE_TYPE (EGL_WINDOW_BIT) has no matching config on a surfaceless display
+    EGLint    config_attribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT, EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_NONE };
+    EGLConfig config;
+    EGLint    n_configs;
+    if (!eglChooseConfig(display, config_attribs, &config, 1, &n_configs) || n_configs == 0) {
+        eprintf("no EGL config supporting OpenGL ES 3\n");
+        return false;
+    }
+
+    EGLint     context_attribs[] = { EGL_CONTEXT_MAJOR_VERSION, 3, EGL_NONE };
+    EGLContext context           = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        eprintf("couldn't create the OpenGL ES 3 context\n");
+        return false;
+    }
+
+    // render into an offscreen framebuffer of the size of the screen so that each texel maps to exactly one pixel
+    GLuint framebuffer, renderbuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glGenRenderbuffers(1, &renderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, screen_w, screen_h);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+/**
+ * @returns the number of pixels of the rendered frame differing from the reference frame.
+ */
+static size_t compare_frame(glrenderer_t *renderer, gbmulator_mode_t mode) {
+    static uint8_t rendered_pixels[GBA_SCREEN_WIDTH * GBA_SCREEN_HEIGHT * 4];
+
+    glrenderer_update_screen(renderer, bgr555_pixels);
+    glrenderer_render(renderer);
+    glReadPixels(0, 0, screen_w, screen_h, GL_RGBA, GL_UNSIGNED_BYTE, rendered_pixels);
+
+    size_t n_differences = 0;
+    for (size_t y = 0; y < screen_h; y++) {
+        for (size_t x = 0; x < screen_w; x++) {
+            // glReadPixels() rows start from the bottom of the screen
+            uint8_t *rendered  = &rendered_pixels[((screen_h - 1 - y) * screen_w + x) * 4];
+            uint8_t *reference = &reference_pixels[(y * screen_w + x) * 4];
+
+            bool is_different = false;
+            for (uint8_t i = 0; i < 3; i++) {
+                uint8_t expected = reference[i];
+                if (mode == GBMULATOR_MODE_GB)
+                    expected = ((expected >> 3) << 3) | (expected >> 5);
+                is_different |= rendered[i] != expected;
+            }
+            n_differences += is_different;
+        }
+    }
+
+    return n_differences;
+}
+
+static bool run_test(const char *label, gbmulator_mode_t mode, uint8_t *rom, size_t rom_size, uint64_t frames) {
+    glrenderer_color_correction_t color_correction = GLRENDERER_COLOR_CORRECTION_NONE;
+#ifndef DISABLE_COLOR_CORRECTION
+    if (mode == GBMULATOR_MODE_GBC)
+        color_correction = GLRENDERER_COLOR_CORRECTION_CGB;
+#endif
+
+    gbmulator_options_t opts = {
+        .mode         = mode,
+        .rom          = rom,
+        .rom_size     = rom_size,
+        .pixel_format = GBMULATOR_PIXEL_FORMAT_RGBA8888,
+        .on_new_frame = on_new_reference_frame
+    };
+    gbmulator_t *reference_emu = gbmulator_init(&opts);
+
+    opts.pixel_format     = GBMULATOR_PIXEL_FORMAT_BGR555;
+    opts.on_new_frame     = on_new_bgr555_frame;
+    gbmulator_t *test_emu = gbmulator_init(&opts);
+
+    if (!reference_emu || !test_emu) {
+        eprintf("%s: couldn't init the emulator", label);
+        gbmulator_quit(reference_emu);
+        gbmulator_quit(test_emu);
+        return false;
+    }
+
+    glrenderer_t *renderer = glrenderer_init(screen_w, screen_h, 0);
+    glrenderer_set_screen_format(renderer, GLRENDERER_SCREEN_FORMAT_BGR555, color_correction);
+
+    reference_frames = 0;
+    bgr555_frames    = 0;
+
+    size_t n_differing_frames = 0;
+    size_t n_differences      = 0;
+    for (uint64_t i = 0; i < frames; i++) {
+        gbmulator_run_frames(reference_emu, 1);
+        gbmulator_run_frames(test_emu, 1);
+
+        // no frame is output while the LCD is off
+        if (reference_frames == 0 || bgr555_frames == 0)
+            continue;
+
+        size_t frame_differences = compare_frame(renderer, mode);
+        n_differing_frames += frame_differences > 0;
+        n_differences += frame_differences;
+    }
+
+    glrenderer_quit(renderer);
+    gbmulator_quit(reference_emu);
+    gbmulator_quit(test_emu);
+
+    printf("%-3s %s: %zu differing frames, %zu differing pixels\n", label, n_differences ? "FAILED" : "PASSED", n_differing_frames, n_differences);
+
+    return n_differences == 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("usage: %s <rom.gb|rom.gbc|rom.gba> [frames]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t frames = argc > 2 ? strtoull(argv[2], NULL, 10) : DEFAULT_FRAMES;
+    if (frames == 0)
+        frames = DEFAULT_FRAMES;
+
+    size_t len    = strlen(argv[1]);
+    bool   is_gba = len >= 4 && !strcmp(&argv[1][len - 4], ".gba");
+    screen_w      = is_gba ? GBA_SCREEN_WIDTH : GB_SCREEN_WIDTH;
+    screen_h      = is_gba ? GBA_SCREEN_HEIGHT : GB_SCREEN_HEIGHT;
+
+    if (!init_egl())
+        return EXIT_FAILURE;
+
+    size_t   rom_size;
+    uint8_t *rom = get_rom(argv[1], &rom_size);
+    if (!rom)
+        return EXIT_FAILURE;
+
+    bool success;
+    if (is_gba) {
+        success = run_test("GBA", GBMULATOR_MODE_GBA, rom, rom_size, frames);
+    } else {
+        success = run_test("DMG", GBMULATOR_MODE_GB, rom, rom_size, frames);
+        success &= run_test("CGB", GBMULATOR_MODE_GBC, rom, rom_size, frames);
+    }
+
+    free(rom);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,177 @@
+/**
+ * Test of the pitch-preserving time-stretching of the audio (used at fast-forward speeds).
+ * Sine tones are stretched at each tested ratio like the frontend does: in blocks of the size output by the GB APU.
+ * The output must last the duration of the input divided by the ratio, its spectrum must peak at the frequency of the
+ * tone (its pitch is kept) and the power of the other frequencies (the artifacts of the splicing) must be low.
+ * The time taken to stretch each block of output is also measured.
+ *
+ * usage: ./timestretch_test [sampling_rate]
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "../core/core.h"
+#include "../core/utils.h"
+#include "../platform/common/timestretch.h"
+
+#define DEFAULT_SAMPLING_RATE 48000
+#define SETTLE_SAMPLES        4096  // skipped to start the analysis in the steady state
+#define FFT_SIZE              32768 // power of 2
+#define TONE_BINS             8     // bins around the tone that belong to it (the Hann window leaks over a few bins)
+#define MAX_PITCH_ERROR_BINS  2
+#define MAX_ARTIFACTS_DB      -30.0 // maximum artifacts to tone power ratio
+#define AMPLITUDE             16384
+#define OUTPUT_BLOCK          1024 // samples received at once (see STRETCHED_SAMPLES_BLOCK in app.c)
+#define MAX_BLOCK_MS          1.0  // maximum mean time to stretch a block of samples
+#define MAX_LATENCY_MS        100  // maximum duration of the output still held by the stretcher at the end
+
+static const double tones[]  = { 220.0, 440.0, 1000.0, 3000.0 };
+static const float  ratios[] = { 2.0f, 4.0f, 8.0f };
+
+static void fft(double *re, double *im, size_t n) {
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j) {
+            double tmp = re[i];
+            re[i]      = re[j];
+            re[j]      = tmp;
+            tmp        = im[i];
+            im[i]      = im[j];
+            im[j]      = tmp;
+        }
+    }
+
+    for (size_t len = 2; len <= n; len <<= 1) {
+        double angle = -2.0 * M_PI / len;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < len / 2; k++) {
+                double w_re = cos(angle * k);
+                double w_im = sin(angle * k);
+                double u_re = re[i + k];
+                double u_im = im[i + k];
+                double v_re = re[i + k + len / 2] * w_re - im[i + k + len / 2] * w_im;
+                double v_im = re[i + k + len / 2] * w_im + im[i + k + len / 2] * w_re;
+
+                re[i + k]           = u_re + v_re;
+                im[i + k]           = u_im + v_im;
+                re[i + k + len / 2] = u_re - v_re;
+                im[i + k + len / 2] = u_im - v_im;
+            }
+        }
+    }
+}
+
+/**
+ * Analyzes the left channel of `FFT_SIZE` interleaved stereo samples.
+ * @param peak_freq set to the frequency of the highest bin.
+ * @returns the power of the bins away from `tone_freq` relative to the power of the bins around it in dB.
+ */
+static double artifacts_db(const int16_t *signal, double sampling_rate, double tone_freq, double *peak_freq) {
+    double *re = xmalloc(FFT_SIZE * sizeof(*re));
+    double *im = xcalloc(FFT_SIZE, sizeof(*im));
+
+    for (size_t i = 0; i < FFT_SIZE; i++)
+        re[i] = signal[i * 2] * (0.5 - 0.5 * cos(2.0 * M_PI * i / (FFT_SIZE - 1))); // Hann window
+    fft(re, im, FFT_SIZE);
+
+    double bin_freq       = sampling_rate / FFT_SIZE;
+    double tone_power     = 0.0;
+    double artifact_power = 0.0;
+    double peak_power     = 0.0;
+    for (size_t k = 1; k < FFT_SIZE / 2; k++) {
+        double power = re[k] * re[k] + im[k] * im[k];
+        if (power > peak_power) {
+            peak_power = power;
+            *peak_freq = k * bin_freq;
+        }
+
+        if (fabs(k - tone_freq / bin_freq) <= TONE_BINS)
+            tone_power += power;
+        else
+            artifact_power += power;
+    }
+
+    free(re);
+    free(im);
+
+    return 10.0 * log10(artifact_power / tone_power);
+}
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static bool run_test(timestretch_t *stretcher, uint32_t sampling_rate, double tone_freq, float ratio) {
+    // the GB APU outputs its samples every 4096 cycles
+    size_t input_block  = MAX(sampling_rate * 4096ULL / GB_CPU_FREQ, 1);
+    size_t max_latency  = sampling_rate * MAX_LATENCY_MS / 1000;
+    size_t output_count = SETTLE_SAMPLES + FFT_SIZE;
+    size_t input_count  = (output_count + max_latency) * ratio;
+
+    int16_t *input  = xmalloc(input_block * 2 * sizeof(*input));
+    int16_t *output = xmalloc((input_count / ratio + OUTPUT_BLOCK) * 2 * sizeof(*output));
+
+    timestretch_clear(stretcher);
+    timestretch_set_ratio(stretcher, ratio);
+
+    size_t received = 0;
+    double elapsed  = 0.0;
+    for (size_t i = 0; i < input_count; i += input_block) {
+        size_t count = MIN(input_block, input_count - i);
+        for (size_t j = 0; j < count; j++) {
+            int16_t sample   = AMPLITUDE * sin(2.0 * M_PI * tone_freq * (i + j) / sampling_rate);
+            input[j * 2]     = sample;
+            input[j * 2 + 1] = sample;
+        }
+
+        double start = now_ms();
+        timestretch_put_samples(stretcher, input, count);
+        size_t n;
+        while ((n = timestretch_receive_samples(stretcher, &output[received * 2], OUTPUT_BLOCK)) > 0)
+            received += n;
+        elapsed += now_ms() - start;
+    }
+
+    // the samples that aren't output yet are those of the next segment and of its seek window
+    double expected_count = input_count / ratio;
+    bool   is_length_ok   = received <= expected_count + 1 && received + max_latency >= expected_count;
+
+    double peak_freq   = 0.0;
+    double artifacts   = received >= output_count ? artifacts_db(&output[SETTLE_SAMPLES * 2], sampling_rate, tone_freq, &peak_freq) : 0.0;
+    bool   is_pitch_ok = fabs(peak_freq - tone_freq) <= MAX_PITCH_ERROR_BINS * (double) sampling_rate / FFT_SIZE;
+
+    double block_ms = elapsed / (received / (double) OUTPUT_BLOCK);
+
+    bool success = is_length_ok && is_pitch_ok && artifacts <= MAX_ARTIFACTS_DB && block_ms <= MAX_BLOCK_MS;
+    printf("%6.1f Hz x%.1f %s: %zu/%.0f samples, peak %6.1f Hz, artifacts %6.1f dB, %.3f ms per %d samples\n",
+           tone_freq, ratio, success ? "PASSED" : "FAILED", received, expected_count, peak_freq, artifacts, block_ms, OUTPUT_BLOCK);
+
+    free(input);
+    free(output);
+
+    return success;
+}
+
+int main(int argc, char **argv) {
+    uint32_t sampling_rate = argc > 1 ? strtoul(argv[1], NULL, 10) : DEFAULT_SAMPLING_RATE;
+    if (sampling_rate == 0)
+        sampling_rate = DEFAULT_SAMPLING_RATE;
+
+    timestretch_t *stretcher = timestretch_init(sampling_rate);
+    bool           success   = true;
+    for (size_t i = 0; i < sizeof(tones) / sizeof(*tones); i++)
+        for (size_t j = 0; j < sizeof(ratios) / sizeof(*ratios); j++)
+            success &= run_test(stretcher, sampling_rate, tones[i], ratios[j]);
+
+    timestretch_quit(stretcher);
+
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}